@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+#
+# converts a PBM image (P1 or P4) into a C++ header with a OneBitBitmap
+#
+# The OLED drivers store 8 vertical pixels per byte (one "page"), so the
+# image is stored the same way: one byte per column for each group of 8 rows,
+# bit 0 being the top row of the group. OneBitGraphicsDisplay::DrawBitmap()
+# can then copy whole bytes into the display buffer.
+#
+# Usage: generate_bitmap.py logo.pbm [--name logo] [-o logo.h]
+#
+import argparse
+import os
+import re
+import sys
+
+parser = argparse.ArgumentParser(
+    description='Converts a PBM image into a OneBitBitmap header')
+parser.add_argument('image', help='P1 or P4 PBM file')
+parser.add_argument('--name',
+                    help='name of the bitmap, defaults to the file name')
+parser.add_argument('-o', '--output',
+                    help='header to write, defaults to <image>.h')
+args = parser.parse_args()
+
+with open(args.image, 'rb') as f:
+    content = f.read()
+
+# the header: magic, width and height, separated by whitespace and comments
+tokens = []
+pos = 0
+while len(tokens) < 3:
+    match = re.compile(rb'\s*(#[^\n]*\n\s*)*(\S+)').match(content, pos)
+    if match is None:
+        sys.exit('{}: not a PBM image'.format(args.image))
+    tokens.append(match.group(2))
+    pos = match.end()
+magic, width, height = tokens[0], int(tokens[1]), int(tokens[2])
+
+if magic == b'P1':
+    values = [c == ord('1') for c in content[pos:] if c in b'01']
+    if len(values) < width * height:
+        sys.exit('{}: not enough pixels'.format(args.image))
+    pixels = [values[y * width:(y + 1) * width] for y in range(height)]
+elif magic == b'P4':
+    data = content[pos + 1:]
+    row_bytes = (width + 7) // 8
+    if len(data) < row_bytes * height:
+        sys.exit('{}: not enough pixels'.format(args.image))
+    pixels = [[bool(data[y * row_bytes + x // 8] & (0x80 >> (x % 8)))
+               for x in range(width)] for y in range(height)]
+else:
+    sys.exit('{}: only P1 and P4 images are supported'.format(args.image))
+
+name = args.name or re.sub(r'\W', '_',
+                           os.path.splitext(os.path.basename(args.image))[0])
+output_path = args.output or os.path.splitext(args.image)[0] + '.h'
+
+lines = [
+    '/* Generated by ci/generate_bitmap.py from {}.'.format(
+        os.path.basename(args.image)),
+    ' * Do not edit, run the script again instead.',
+    ' */',
+    '#pragma once',
+    '#include "hid/disp/graphics_common.h"',
+    '',
+    'static const uint8_t {}_data[] = {{'.format(name),
+]
+for page in range((height + 7) // 8):
+    values = []
+    for x in range(width):
+        byte = 0
+        for bit in range(8):
+            y = page * 8 + bit
+            if y < height and pixels[y][x]:
+                byte |= 1 << bit
+        values.append('0x{:02X},'.format(byte))
+    # at most 12 values per line, to stay within 80 columns
+    for start in range(0, width, 12):
+        lines.append('    ' + ' '.join(values[start:start + 12]))
+lines.append('};')
+lines.append('')
+lines.append('static const daisy::OneBitBitmap {} = {{{}, {}, {}_data}};'.format(
+    name, width, height, name))
+
+with open(output_path, 'w') as f:
+    f.write('\n'.join(lines) + '\n')
@@ -0,0 +1,91 @@
+#!/usr/bin/env python
+#
+# generates src/util/oled_fonts_columns.c from the row-major fonts in
+# src/util/oled_fonts.c
+#
+# The OLED drivers store 8 vertical pixels per byte (one "page"), so a glyph
+# stored as one uint16_t per row has to be transposed bit by bit when it is
+# drawn. This script does the transposition once: each glyph is stored as
+# [page][column] bytes, bit 0 being the top row of the page.
+#
+# Run it again after changing oled_fonts.c. With --check it only verifies
+# that the generated file is up to date.
+#
+import argparse
+import os
+import re
+import sys
+
+NUM_GLYPHS = 95  # ' ' to '~'
+
+root = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+source_path = os.path.join(root, 'src', 'util', 'oled_fonts.c')
+output_path = os.path.join(root, 'src', 'util', 'oled_fonts_columns.c')
+
+parser = argparse.ArgumentParser(
+    description='Generates column byte versions of the OLED fonts')
+parser.add_argument('--check', action='store_true',
+                    help='fail if the generated file is not up to date')
+args = parser.parse_args()
+
+with open(source_path) as f:
+    source = f.read()
+
+# strip comments before reading the tables
+code = re.sub(r'//[^\n]*', '', source)
+code = re.sub(r'/\*.*?\*/', '', code, flags=re.S)
+
+tables = {}
+for name, body in re.findall(
+        r'static const uint16_t (\w+)\[\]\s*=\s*\{(.*?)\};', code, re.S):
+    tables[name] = [int(v, 16) for v in re.findall(r'0x[0-9A-Fa-f]+', body)]
+
+fonts = re.findall(r'FontDef\s+\w+\s*=\s*\{\s*(\d+),\s*(\d+),\s*(\w+)', code)
+
+lines = [
+    '/* Generated by ci/generate_oled_font_atlas.py from oled_fonts.c.',
+    ' * Do not edit, run the script again instead.',
+    ' *',
+    ' * Each glyph is stored as [page][column]: one byte per column for each',
+    ' * group of 8 rows, bit 0 being the top row of the group.',
+    ' */',
+    '#include <stdint.h>',
+]
+for width, height, name in fonts:
+    width, height = int(width), int(height)
+    rows = tables[name]
+    if len(rows) != NUM_GLYPHS * height:
+        sys.exit('{}: expected {} rows, found {}'.format(
+            name, NUM_GLYPHS * height, len(rows)))
+    pages = (height + 7) // 8
+    lines.append('')
+    lines.append('const uint8_t {}Columns[] = {{'.format(name))
+    for glyph in range(NUM_GLYPHS):
+        glyph_rows = rows[glyph * height:(glyph + 1) * height]
+        for page in range(pages):
+            values = []
+            for column in range(width):
+                byte = 0
+                for bit in range(8):
+                    row = page * 8 + bit
+                    if row < height and (glyph_rows[row] << column) & 0x8000:
+                        byte |= 1 << bit
+                values.append('0x{:02X},'.format(byte))
+            # at most 8 values per line, to stay within 80 columns
+            for start in range(0, width, 8):
+                lines.append('    ' + ' '.join(values[start:start + 8]))
+        # a backslash at the end of a comment would continue it
+        names = {' ': 'sp', '\\': 'backslash'}
+        char = chr(32 + glyph)
+        lines[-1] += ' // ' + names.get(char, char)
+    lines.append('};')
+output = '\n'.join(lines) + '\n'
+
+if args.check:
+    with open(output_path) as f:
+        if f.read() != output:
+            sys.exit('{} is out of date'.format(output_path))
+    print('{} is up to date'.format(output_path))
+else:
+    with open(output_path, 'w') as f:
+        f.write(output)
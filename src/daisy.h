@@ -22,12 +22,17 @@
 #include "per/adc.h"
 #include "per/uart.h"
 #include "hid/midi.h"
+#include "hid/ump_parser.h"
+#include "hid/ump_translator.h"
 #include "hid/encoder.h"
 #include "hid/switch.h"
 #include "hid/switch3.h"
+#include "hid/port_debouncer.h"
 #include "hid/ctrl.h"
+#include "hid/ctrl_bank.h"
 #include "hid/gatein.h"
 #include "hid/parameter.h"
+#include "hid/parameter_ramp.h"
 #include "hid/usb.h"
 #include "hid/logger.h"
 #include "hid/usb_host.h"
@@ -43,6 +48,7 @@
 #include "hid/disp/graphics_common.h"
 #include "hid/led.h"
 #include "hid/rgb_led.h"
+#include "hid/bam_pattern.h"
 #include "dev/sr_595.h"
 #include "dev/apds9960.h"
 #include "dev/codec_ak4556.h"
@@ -63,19 +69,26 @@
 #include "ui/UiEventQueue.h"
 #include "ui/AbstractMenu.h"
 #include "ui/FullScreenItemMenu.h"
+#include "ui/AudioScopePages.h"
 #include "util/scopedirqblocker.h"
 #include "util/CpuLoadMeter.h"
+#include "util/AudioScopeBuffer.h"
+#include "util/CurveTables.h"
 #include "util/FileReader.h"
 #include "util/FileTable.h"
 #include "util/FIFO.h"
 #include "util/FixedCapStr.h"
 #include "util/MappedValue.h"
+#include "util/MidiClockFollower.h"
 #include "util/PersistentStorage.h"
 #include "util/Stack.h"
 #include "util/VoctCalibration.h"
+#include "util/VoiceAllocator.h"
+#include "util/MpeReceiver.h"
 #include "util/WaveTableLoader.h"
 #include "util/WavParser.h"
 #include "util/WavPlayer.h"
+#include "util/MidiFilePlayer.h"
 #include "util/WavWriter.h"
 #endif
 #endif
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef SA_OLED_DIRTY_WINDOW_H
+#define SA_OLED_DIRTY_WINDOW_H /**< & */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace daisy
+{
+/**
+ * The bounding box of the pixels that were drawn since the last update
+ *
+ * The color OLED drivers use it to set the column/row address window of the
+ * controller to just the part of the frame that changed.
+ */
+class OledDirtyWindow
+{
+  public:
+    OledDirtyWindow() { Clear(); }
+
+    /** Empties the window */
+    void Clear()
+    {
+        x0_ = 0xffff;
+        y0_ = 0xffff;
+        x1_ = 0;
+        y1_ = 0;
+    }
+
+    /** Sets the window to the whole frame */
+    void SetAll(size_t width, size_t height)
+    {
+        x0_ = 0;
+        y0_ = 0;
+        x1_ = width - 1;
+        y1_ = height - 1;
+    }
+
+    /** Grows the window to include a pixel */
+    void Add(size_t x, size_t y)
+    {
+        if(x < x0_)
+            x0_ = x;
+        if(x > x1_)
+            x1_ = x;
+        if(y < y0_)
+            y0_ = y;
+        if(y > y1_)
+            y1_ = y;
+    }
+
+    bool IsEmpty() const { return x0_ > x1_ || y0_ > y1_; }
+
+    /** \return the first column, only valid if !IsEmpty() */
+    size_t GetX0() const { return x0_; }
+    /** \return the last column, included */
+    size_t GetX1() const { return x1_; }
+    /** \return the first row */
+    size_t GetY0() const { return y0_; }
+    /** \return the last row, included */
+    size_t GetY1() const { return y1_; }
+
+  private:
+    uint16_t x0_, y0_, x1_, y1_;
+};
+
+} // namespace daisy
+
+#endif
@@ -13,28 +13,13 @@ class SH1106Driver : public SSD130xDriver<width, height, Transport>
 {
   public:
     /**
-   * Update the display
+   * Update the display. Only the changed part of each page is sent.
+   * The SH1106 has 132 columns of RAM, with the 128 visible ones centered.
    */
-    void Update()
-    {
-        uint8_t i;
-        uint8_t high_column_addr;
-        switch(height)
-        {
-            case 32: high_column_addr = 0x12; break;
-
-            default: high_column_addr = 0x10; break;
-        }
-        for(i = 0; i < (height / 8); i++)
-        {
-            this->transport_.SendCommand(0xB0 + i);
-            this->transport_.SendCommand(0x02);
-            this->transport_.SendCommand(high_column_addr);
-            this->transport_.SendData(&this->buffer_[width * i], width);
-        }
-    };
+    void Update() { this->SendDirtyPages((height == 32 ? 0x20 : 0x00) + 2); };
 };
 
+#ifndef UNIT_TEST
 /**
  * A driver for SH1106 128x64 OLED displays connected via 4 wire SPI
  */
@@ -45,6 +30,7 @@ using SH11064WireSpi128x64Driver
  * A driver for SH1106 128x64 OLED displays connected via I2C
  */
 using SH1106I2c128x64Driver = SH1106Driver<128, 64, SSD130xI2CTransport>;
+#endif // ifndef UNIT_TEST
 
 }; // namespace daisy
 
@@ -2,14 +2,18 @@
 #ifndef SA_OLED_SSD130X_H
 #define SA_OLED_SSD130X_H /**< & */
 
-#include "per/i2c.h"
 #include "per/spi.h"
 #include "per/gpio.h"
 #include "sys/system.h"
+#include "dev/oled_transfer_chain.h"
+#ifndef UNIT_TEST // the drivers are tested with mock transports
+#include "per/i2c.h"
 #include "stm32h7xx_hal.h"
+#endif
 
 namespace daisy
 {
+#ifndef UNIT_TEST
 /**
  * I2C Transport for SSD1306 / SSD1309 OLED display devices
  */
@@ -55,6 +59,16 @@ class SSD130xI2CTransport
         }
     };
 
+    /** Sends the data with a blocking transfer and calls end_callback */
+    void SendDataDma(uint8_t*                          buff,
+                     size_t                            size,
+                     SpiHandle::EndCallbackFunctionPtr end_callback,
+                     void*                             context)
+    {
+        SendData(buff, size);
+        end_callback(context, SpiHandle::Result::OK);
+    };
+
   private:
     daisy::I2CHandle i2c_;
     uint8_t          i2c_address_;
@@ -112,6 +126,7 @@ class SSD130x4WireSpiTransport
 
         // Initialize SPI
         spi_.Init(config.spi_config);
+        use_dma_ = config.useDma;
 
         // Reset and Configure OLED.
         pin_reset_.Write(0);
@@ -138,11 +153,21 @@ class SSD130x4WireSpiTransport
         spi_.BlockingTransmit(buff, size);
     };
 
+    /** Sends the data with DMA, or with a blocking transfer if useDma is
+     *  off, and calls end_callback when done. The buffer must not be in
+     *  DTCM RAM.
+     */
     void SendDataDma(uint8_t*                          buff,
                      size_t                            size,
                      SpiHandle::EndCallbackFunctionPtr end_callback,
                      void*                             context)
     {
+        if(!use_dma_)
+        {
+            SendData(buff, size);
+            end_callback(context, SpiHandle::Result::OK);
+            return;
+        }
         SCB_CleanInvalidateDCache_by_Addr(buff, size);
         pin_dc_.Write(1);
         spi_.DmaTransmit(buff, size, NULL, end_callback, context);
@@ -152,6 +177,7 @@ class SSD130x4WireSpiTransport
     SpiHandle spi_;
     GPIO      pin_reset_;
     GPIO      pin_dc_;
+    bool      use_dma_;
 };
 
 /**
@@ -217,6 +243,16 @@ class SSD130x4WireSoftSpiTransport
             SoftSpiTransmit(buff[i]);
     };
 
+    /** Sends the data with a blocking transfer and calls end_callback */
+    void SendDataDma(uint8_t*                          buff,
+                     size_t                            size,
+                     SpiHandle::EndCallbackFunctionPtr end_callback,
+                     void*                             context)
+    {
+        SendData(buff, size);
+        end_callback(context, SpiHandle::Result::OK);
+    };
+
   private:
     void SoftSpiTransmit(uint8_t val)
     {
@@ -245,14 +281,29 @@ class SSD130x4WireSoftSpiTransport
     GPIO     pin_reset_;
     GPIO     pin_dc_;
 };
+#endif // ifndef UNIT_TEST
 
 
 /**
  * A driver implementation for the SSD1306/SSD1309
+ *
+ * Drawing only changes the buffer. The driver keeps track of the range of
+ * columns that were written on each page, and Update() compares them with a
+ * copy of what was last sent to only send the columns that differ. A UI that
+ * clears and redraws the whole screen where one value changed then costs a
+ * few bytes per frame instead of the full width * height / 8.
+ *
+ * The changed columns are copied to the front buffer and sent from there, so
+ * with a DMA transport (e.g. SSD130x4WireSpiTransport with useDma) Update()
+ * returns right away and drawing can continue while the frame is sent. The
+ * driver must not be placed in DTCM RAM in that case.
  */
 template <size_t width, size_t height, typename Transport>
 class SSD130xDriver
 {
+    static_assert(width <= 128 && height % 8 == 0,
+                  "SSD130xDriver supports up to 128 columns and whole pages");
+
   public:
     struct Config
     {
@@ -262,6 +313,7 @@ class SSD130xDriver
     void Init(Config config)
     {
         transport_.Init(config.transport_config);
+        chain_.Init(&transport_);
 
         // Init routine...
 
@@ -353,6 +405,9 @@ class SSD130xDriver
 
         // Display On
         transport_.SendCommand(0xAF); //--turn on oled panel
+
+        // the display RAM content is unknown
+        SetAllDirty();
     };
 
     size_t Width() const { return width; };
@@ -362,52 +417,293 @@ class SSD130xDriver
     {
         if(x >= width || y >= height)
             return;
-        if(on)
-            buffer_[x + (y / 8) * width] |= (1 << (y % 8));
-        else
-            buffer_[x + (y / 8) * width] &= ~(1 << (y % 8));
+        const size_t  page  = y / 8;
+        uint8_t&      byte  = buffer_[x + page * width];
+        const uint8_t value = on ? (byte | (1 << (y % 8)))
+                                 : (byte & ~(1 << (y % 8)));
+        if(value == byte)
+            return;
+        byte = value;
+        MarkDirty(page, x, x);
+    }
+
+    /** Draws `length` pixels to the right of (x, y) */
+    void DrawHorizontalSpan(uint_fast8_t  x,
+                            uint_fast8_t  y,
+                            uint_fast16_t length,
+                            bool          on)
+    {
+        if(x >= width || y >= height || length == 0)
+            return;
+        const size_t  last = (x + length > width) ? width - 1 : x + length - 1;
+        const size_t  page = y / 8;
+        const uint8_t mask = 1 << (y % 8);
+        uint8_t*      row  = &buffer_[page * width];
+        for(size_t i = x; i <= last; i++)
+            row[i] = on ? (row[i] | mask) : (row[i] & ~mask);
+        MarkDirty(page, x, last);
+    }
+
+    /** Draws `length` pixels downwards from (x, y), a page at a time */
+    void DrawVerticalSpan(uint_fast8_t  x,
+                          uint_fast8_t  y,
+                          uint_fast16_t length,
+                          bool          on)
+    {
+        if(x >= width || y >= height)
+            return;
+        const size_t end = (y + length > height) ? height : y + length;
+        for(size_t top = y; top < end;)
+        {
+            const size_t  bit   = top % 8;
+            const size_t  count = (end - top < 8 - bit) ? end - top : 8 - bit;
+            const uint8_t mask  = ((1 << count) - 1) << bit;
+            WriteBits(x, top / 8, on ? mask : 0, mask);
+            top += count;
+        }
+    }
+
+    /** Sets `count` (1..8) pixels downwards from (x, y) to the lowest bits of
+     *  `bits`. This touches at most two bytes of the buffer.
+     */
+    void WriteColumnBits(uint_fast8_t x,
+                         uint_fast8_t y,
+                         uint8_t      bits,
+                         uint_fast8_t count)
+    {
+        if(x >= width || y >= height)
+            return;
+        const size_t   page  = y / 8;
+        const size_t   shift = y % 8;
+        const uint16_t mask  = ((1u << count) - 1) << shift;
+        const uint16_t value = uint16_t(bits) << shift;
+        WriteBits(x, page, value, mask);
+        if((mask >> 8) != 0 && page + 1 < kNumPages)
+            WriteBits(x, page + 1, value >> 8, mask >> 8);
+    }
+
+    /** WriteColumnBits() for `length` columns: sets the pixels whose bit in
+     *  `bits` is set to `on`, the others to `!on`. Text at a page aligned y
+     *  stores whole bytes into one page.
+     */
+    void WriteColumnBytes(uint_fast8_t   x,
+                          uint_fast8_t   y,
+                          const uint8_t* bits,
+                          uint_fast16_t  length,
+                          uint_fast8_t   count,
+                          bool           on)
+    {
+        if(x >= width || y >= height || length == 0)
+            return;
+        if(x + length > width)
+            length = width - x;
+        const size_t   page   = y / 8;
+        const int      shift  = y % 8;
+        const uint8_t  invert = on ? 0x00 : 0xff;
+        const uint16_t mask   = ((1u << count) - 1) << shift;
+        WriteRowBits(x, page, bits, length, invert, shift, mask);
+        if((mask >> 8) != 0 && page + 1 < kNumPages)
+            WriteRowBits(
+                x, page + 1, bits, length, invert, shift - 8, mask >> 8);
+    }
+
+    /** Like WriteColumnBytes(), but only the pixels whose bit in `bits` is
+     *  set are drawn `on`; the others are left as they are.
+     */
+    void DrawColumnBytes(uint_fast8_t   x,
+                         uint_fast8_t   y,
+                         const uint8_t* bits,
+                         uint_fast16_t  length,
+                         uint_fast8_t   count,
+                         bool           on)
+    {
+        if(x >= width || y >= height || length == 0)
+            return;
+        if(x + length > width)
+            length = width - x;
+        const size_t   page  = y / 8;
+        const int      shift = y % 8;
+        const uint16_t mask  = ((1u << count) - 1) << shift;
+        DrawRowBits(x, page, bits, length, on, shift, mask);
+        if((mask >> 8) != 0 && page + 1 < kNumPages)
+            DrawRowBits(x, page + 1, bits, length, on, shift - 8, mask >> 8);
     }
 
     void Fill(bool on)
     {
-        for(size_t i = 0; i < sizeof(buffer_); i++)
+        const uint8_t value = on ? 0xff : 0x00;
+        for(size_t page = 0; page < kNumPages; page++)
         {
-            buffer_[i] = on ? 0xff : 0x00;
+            uint8_t* row = &buffer_[page * width];
+            // only the columns that actually change become dirty
+            size_t first = 0;
+            while(first < width && row[first] == value)
+                first++;
+            if(first == width)
+                continue;
+            size_t last = width - 1;
+            while(row[last] == value)
+                last--;
+            for(size_t x = first; x <= last; x++)
+                row[x] = value;
+            MarkDirty(page, first, last);
         }
     };
 
     /**
-     * Update the display
+     * Update the display. Only the changed part of each page is sent.
+     * Waits for the previous update to finish first.
     */
-    void Update()
+    void Update() { SendDirtyPages(height == 32 ? 0x20 : 0x00); };
+
+    /**
+     * Has update finished
+    */
+    bool UpdateFinished() { return !chain_.IsBusy(); }
+
+    /** Marks the whole buffer as changed, so the next Update() sends it all.
+     *  Use this when the display lost its content, e.g. after a reset.
+     */
+    void SetAllDirty()
     {
-        uint8_t i;
-        uint8_t high_column_addr;
-        switch(height)
+        for(size_t page = 0; page < kNumPages; page++)
         {
-            case 32: high_column_addr = 0x12; break;
+            dirty_first_[page] = 0;
+            dirty_last_[page]  = width - 1;
+        }
+        send_all_ = true;
+    }
 
-            default: high_column_addr = 0x10; break;
+  protected:
+    static constexpr size_t kNumPages = height / 8;
+
+    /** Adds columns to the dirty range of a page. A clean page has
+     *  dirty_first_ > dirty_last_. */
+    void MarkDirty(size_t page, size_t first, size_t last)
+    {
+        if(first < dirty_first_[page])
+            dirty_first_[page] = first;
+        if(last > dirty_last_[page])
+            dirty_last_[page] = last;
+    }
+
+    /** Sets the bits in `mask` of a buffer byte to those of `value` */
+    void WriteBits(size_t x, size_t page, uint8_t value, uint8_t mask)
+    {
+        uint8_t&      byte   = buffer_[x + page * width];
+        const uint8_t result = (byte & ~mask) | (value & mask);
+        if(result == byte)
+            return;
+        byte = result;
+        MarkDirty(page, x, x);
+    }
+
+    /** Merges a row of column bytes into a page
+     *  \param shift how far the bits move down, negative to move them up
+     *  \param mask  the bits of the page to change
+     */
+    void WriteRowBits(size_t         x,
+                      size_t         page,
+                      const uint8_t* bits,
+                      size_t         length,
+                      uint8_t        invert,
+                      int            shift,
+                      uint8_t        mask)
+    {
+        uint8_t* row     = &buffer_[page * width + x];
+        bool     changed = false;
+        for(size_t i = 0; i < length; i++)
+        {
+            const uint8_t b      = bits[i] ^ invert;
+            const uint8_t value  = shift >= 0 ? b << shift : b >> -shift;
+            const uint8_t result = (row[i] & ~mask) | (value & mask);
+            changed |= (result != row[i]);
+            row[i] = result;
         }
-        for(i = 0; i < (height / 8); i++)
+        if(changed)
+            MarkDirty(page, x, x + length - 1);
+    }
+
+    /** Sets the pixels of a page whose bit in a row of column bytes is set
+     *  \param shift how far the bits move down, negative to move them up
+     *  \param mask  the bits of the page that may change
+     */
+    void DrawRowBits(size_t         x,
+                     size_t         page,
+                     const uint8_t* bits,
+                     size_t         length,
+                     bool           on,
+                     int            shift,
+                     uint8_t        mask)
+    {
+        uint8_t* row     = &buffer_[page * width + x];
+        bool     changed = false;
+        for(size_t i = 0; i < length; i++)
         {
-            transport_.SendCommand(0xB0 + i);
-            transport_.SendCommand(0x00);
-            transport_.SendCommand(high_column_addr);
-            transport_.SendData(&buffer_[width * i], width);
+            const uint8_t set
+                = (shift >= 0 ? bits[i] << shift : bits[i] >> -shift) & mask;
+            const uint8_t result = on ? (row[i] | set) : (row[i] & ~set);
+            changed |= (result != row[i]);
+            row[i] = result;
         }
-    };
+        if(changed)
+            MarkDirty(page, x, x + length - 1);
+    }
 
-    /**
-     * Has update finished
-    */
-    bool UpdateFinished() { return true; }
+    /** Starts sending the changed columns of each page and clears the dirty
+     *  ranges
+     *  \param column_offset RAM column of the first pixel column
+     */
+    void SendDirtyPages(uint8_t column_offset)
+    {
+        chain_.Wait();
+        chain_.Clear();
+        for(size_t page = 0; page < kNumPages; page++)
+        {
+            size_t first       = dirty_first_[page];
+            size_t last        = dirty_last_[page];
+            dirty_first_[page] = 0xff;
+            dirty_last_[page]  = 0;
+            if(first > last)
+                continue;
+
+            // skip the columns that are the same as on the display
+            const uint8_t* row  = &buffer_[width * page];
+            uint8_t*       sent = &sent_[width * page];
+            if(!send_all_)
+            {
+                while(first <= last && row[first] == sent[first])
+                    first++;
+                if(first > last)
+                    continue;
+                while(row[last] == sent[last])
+                    last--;
+            }
+
+            for(size_t x = first; x <= last; x++)
+                sent[x] = row[x];
+            const uint8_t column     = column_offset + first;
+            const uint8_t commands[] = {
+                static_cast<uint8_t>(0xB0 + page),
+                static_cast<uint8_t>(column & 0x0f),
+                static_cast<uint8_t>(0x10 | (column >> 4)),
+            };
+            chain_.Add(commands, 3, &sent[first], last - first + 1);
+        }
+        send_all_ = false;
+        chain_.Start();
+    }
 
-  protected:
     Transport transport_;
     uint8_t   buffer_[width * height / 8];
+    uint8_t   sent_[width * height / 8]; /**< front buffer, sent by DMA */
+    uint8_t   dirty_first_[kNumPages];
+    uint8_t   dirty_last_[kNumPages];
+    bool      send_all_;
+    OledTransferChain<Transport, kNumPages> chain_;
 };
 
+#ifndef UNIT_TEST
 /**
  * A driver for the SSD1306/SSD1309 128x64 OLED displays connected via 4 wire SPI
  */
@@ -470,10 +766,15 @@ using SSD130xI2c64x32Driver = daisy::SSD130xDriver<64, 32, SSD130xI2CTransport>;
  */
 using SSD130x4WireSoftSpi128x64Driver
     = daisy::SSD130xDriver<128, 64, SSD130x4WireSoftSpiTransport>;
+#endif // ifndef UNIT_TEST
 
 
 /**
  * A driver implementation for the SSD1307
+ *
+ * Update() copies the buffer to a front buffer and sends it page by page,
+ * with DMA if the transport is configured for it. Drawing can continue while
+ * the frame is sent.
  */
 template <size_t width, size_t height, typename Transport>
 class SSD1307Driver
@@ -487,8 +788,7 @@ class SSD1307Driver
     void Init(Config config)
     {
         transport_.Init(config.transport_config);
-
-        useDma_ = config.transport_config.useDma;
+        chain_.Init(&transport_);
 
         // Init routine...
         uint8_t uDispayOffset;
@@ -578,95 +878,43 @@ class SSD1307Driver
     };
 
     /**
-     * Update the display
+     * Update the display. Waits for the previous update to finish first.
     */
     void Update()
     {
-        if(useDma_)
+        uint8_t high_column_addr;
+        switch(height)
         {
-            transferPagesCount_ = (height / 8);
-            if(transferPagesCount_)
-            {
-                updateing_ = true;
-                TransferPageDma(0);
-            }
+            case 32: high_column_addr = 0x12; break;
+
+            default: high_column_addr = 0x10; break;
         }
-        else
+        chain_.Wait();
+        chain_.Clear();
+        for(size_t i = 0; i < sizeof(buffer_); i++)
+            front_[i] = buffer_[i];
+        for(size_t page = 0; page < height / 8; page++)
         {
-            uint8_t i;
-            uint8_t high_column_addr;
-            switch(height)
-            {
-                case 32: high_column_addr = 0x12; break;
-
-                default: high_column_addr = 0x10; break;
-            }
-            for(i = 0; i < (height / 8); i++)
-            {
-                transport_.SendCommand(0xB0 + i);
-                transport_.SendCommand(0x00);
-                transport_.SendCommand(high_column_addr);
-                transport_.SendData(&buffer_[width * i], width);
-            }
-            updateing_ = false;
+            const uint8_t commands[]
+                = {static_cast<uint8_t>(0xB0 + page), 0x00, high_column_addr};
+            chain_.Add(commands, 3, &front_[width * page], width);
         }
+        chain_.Start();
     };
 
     /**
      * Has update finished
     */
-    bool UpdateFinished() { return !updateing_; }
+    bool UpdateFinished() { return !chain_.IsBusy(); }
 
   private:
     Transport transport_;
     uint8_t   buffer_[width * height / 8];
-    bool      updateing_;
-    uint8_t   transferPagesCount_;
-    uint8_t   transferingPage_;
-    bool      useDma_;
-
-    void TransferPageDma(uint8_t page)
-    {
-        transferingPage_ = page;
-
-        uint8_t high_column_addr;
-        switch(height)
-        {
-            case 32: high_column_addr = 0x12; break;
-
-            default: high_column_addr = 0x10; break;
-        }
-        uint8_t commands[] = {static_cast<uint8_t>(0xB0 + transferingPage_),
-                              0x00,
-                              high_column_addr};
-        transport_.SendCommands(commands, 3);
-        // transport_.SendCommand(0xB0 + transferingPage_);
-        // transport_.SendCommand(0x00);
-        // transport_.SendCommand(high_column_addr);
-        transport_.SendDataDma(&buffer_[width * transferingPage_],
-                               width,
-                               SpiPageCompleteCallback,
-                               this);
-        //        transport_.SendDataDma(&buffer_[width * 16], width, SpiPageCompleteCallback, this);
-    }
-
-    void PageTransfered(void)
-    {
-        if(transferingPage_ < transferPagesCount_ - 1)
-        {
-            TransferPageDma(transferingPage_ + 1);
-        }
-        else
-            updateing_ = false;
-    }
-
-    static void SpiPageCompleteCallback(void*                    context,
-                                        daisy::SpiHandle::Result result)
-    {
-        static_cast<SSD1307Driver*>(context)->PageTransfered();
-    }
+    uint8_t   front_[width * height / 8];
+    OledTransferChain<Transport, height / 8> chain_;
 };
 
+#ifndef UNIT_TEST
 /**
  * A driver for the SSD1307 128x64 OLED displays connected via 4 wire SPI
  */
@@ -702,6 +950,7 @@ using SSD1307I2c128x80Driver
  */
 using SSD1307I2c128x128Driver
     = daisy::SSD130xDriver<128, 128, SSD130xI2CTransport>;
+#endif // ifndef UNIT_TEST
 
 
 }; // namespace daisy
@@ -3,9 +3,16 @@
 #include "per/spi.h"
 #include "per/gpio.h"
 #include "sys/system.h"
+#include "dev/oled_transfer_chain.h"
+#include "dev/oled_dirty_window.h"
+#include "hid/disp/graphics_common.h"
+#ifndef UNIT_TEST // the drivers are tested with mock transports
+#include "stm32h7xx_hal.h"
+#endif
 
 namespace daisy
 {
+#ifndef UNIT_TEST
 /**
  * 4 Wire SPI Transport for SSD1327 OLED display devices
  */
@@ -25,6 +32,7 @@ class SSD13274WireSpiTransport
             Pin dc;    /**< Pin used for Data/Command signaling */
             Pin reset; /**< Pin used for Reset */
         } pin_config;
+        bool useDma; /**< Send the frame buffer with DMA */
         void Defaults()
         {
             // SPI peripheral config
@@ -45,6 +53,8 @@ class SSD13274WireSpiTransport
             // SSD1327 control pin config
             pin_config.dc    = Pin(PORTB, 4);
             pin_config.reset = Pin(PORTB, 15);
+            // Using DMA off by default
+            useDma = false;
         }
     };
     void Init(const Config& config)
@@ -55,6 +65,7 @@ class SSD13274WireSpiTransport
 
         // Initialize SPI
         spi_.Init(config.spi_config);
+        use_dma_ = config.useDma;
 
         // Reset and Configure OLED.
         pin_reset_.Write(false);
@@ -74,15 +85,44 @@ class SSD13274WireSpiTransport
         spi_.BlockingTransmit(buff, size);
     };
 
+    /** Sends the data with DMA, or with a blocking transfer if useDma is
+     *  off, and calls end_callback when done. The buffer must not be in
+     *  DTCM RAM.
+     */
+    void SendDataDma(uint8_t*                          buff,
+                     size_t                            size,
+                     SpiHandle::EndCallbackFunctionPtr end_callback,
+                     void*                             context)
+    {
+        if(!use_dma_)
+        {
+            SendData(buff, size);
+            end_callback(context, SpiHandle::Result::OK);
+            return;
+        }
+        SCB_CleanInvalidateDCache_by_Addr(buff, size);
+        pin_dc_.Write(true);
+        spi_.DmaTransmit(buff, size, NULL, end_callback, context);
+    };
+
   private:
     SpiHandle spi_;
     GPIO      pin_reset_;
     GPIO      pin_dc_;
+    bool      use_dma_;
 };
+#endif // ifndef UNIT_TEST
 
 
 /**
  * A driver implementation for the SSD1327
+ *
+ * Update() sends the smallest window of columns and rows that holds all
+ * pixels that differ from the last frame sent. The window is copied to a
+ * front buffer and sent from there, with DMA if the transport is configured
+ * for it. Drawing can continue while the frame is sent.
+ *
+ * Rgb565 colors are converted to 16 levels of gray.
  */
 template <size_t width, size_t height, typename Transport>
 class SSD1327Driver
@@ -95,8 +135,10 @@ class SSD1327Driver
 
     void Init(Config config)
     {
-        color_ = 0x0f;
+        color_    = 0x0f;
+        bg_color_ = 0x00;
         transport_.Init(config.transport_config);
+        chain_.Init(&transport_);
 
         transport_.SendCommand(0x15); // set column address
         transport_.SendCommand(0x00); // start column   0
@@ -151,6 +193,8 @@ class SSD1327Driver
         System::Delay(200);           //	wait 200ms
         transport_.SendCommand(0xaf); // turn on display
         Fill(false);
+        // the display RAM content is unknown until the first frame is sent
+        send_all_ = true;
     };
 
     size_t Width() const { return width; };
@@ -158,79 +202,156 @@ class SSD1327Driver
 
     void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on)
     {
-        uint8_t  pixel;
-        uint32_t line = width / 2;
+        SetPixel(x, y, on ? color_ : bg_color_);
+    };
 
-        if((x >= width) || (y >= height))
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, Rgb565 color)
+    {
+        SetPixel(x, y, color.GetGray4());
+    }
+
+    void Fill(bool on) { FillRam((on ? color_ : bg_color_) * 0x11); };
+
+    void Fill(Rgb565 color) { FillRam(color.GetGray4() * 0x11); }
+
+    /**
+     * Update the display. Waits for the previous update to finish first.
+    */
+    void Update()
+    {
+        chain_.Wait();
+        if(!FindChangedWindow())
             return;
 
-        if(on)
+        // the window is in bytes, i.e. pairs of pixels
+        const size_t line    = width / 2;
+        const size_t x0      = dirty_.GetX0();
+        const size_t y0      = dirty_.GetY0();
+        const size_t columns = dirty_.GetX1() - x0 + 1;
+        const size_t rows    = dirty_.GetY1() - y0 + 1;
+        for(size_t y = y0; y < y0 + rows; y++)
         {
-            pixel = buffer_[y * line + (x / 2)];
-            if(x % 2)
-            {
-                pixel &= 0xf0;
-                pixel |= color_;
-            }
-            else
-            {
-                pixel &= 0x0f;
-                pixel |= color_ << 4;
-            }
-            buffer_[y * line + (x / 2)] = pixel;
+            for(size_t x = x0; x < x0 + columns; x++)
+                front_[y * line + x] = buffer_[y * line + x];
         }
-        else
+
+        const uint8_t commands[] = {
+            0x15, // column
+            uint8_t(x0),
+            uint8_t(x0 + columns - 1),
+            0x75, // row
+            uint8_t(y0),
+            uint8_t(y0 + rows - 1),
+        };
+        chain_.Clear();
+        if(columns == line)
         {
-            pixel = buffer_[y * line + (x / 2)];
-            if(x % 2)
-            {
-                pixel &= 0xf0;
-            }
-            else
-            {
-                pixel &= 0x0f;
-            }
-            buffer_[y * line + (x / 2)] = pixel;
+            // whole rows are contiguous in the front buffer
+            chain_.Add(commands,
+                       sizeof(commands),
+                       &front_[y0 * line],
+                       rows * line);
         }
-    };
-
-    void Fill(bool on)
-    {
-        for(size_t i = 0; i < sizeof(buffer_); i++)
+        else
         {
-            buffer_[i] = on ? 0xff : 0x00;
+            // the controller wraps to the next row of the window by itself,
+            // so the following rows need no commands
+            for(size_t y = y0; y < y0 + rows; y++)
+                chain_.Add(commands,
+                           y == y0 ? sizeof(commands) : 0,
+                           &front_[y * line + x0],
+                           columns);
         }
+        chain_.Start();
+        dirty_.Clear();
     };
 
     /**
-     * Update the display
+     * Has update finished
     */
-    void Update()
-    {
-        transport_.SendCommand(0x15); // column
-        transport_.SendCommand(0x00);
-        transport_.SendCommand((width / 2) - 1);
+    bool UpdateFinished() { return !chain_.IsBusy(); }
 
-        transport_.SendCommand(0x75); // row
-        transport_.SendCommand(0x00);
-        transport_.SendCommand(height - 1);
+    void Set_Color(uint8_t in_col) { color_ = in_col & 0x0f; };
 
-        //write data
-        transport_.SendData(buffer_, 8192);
-    };
+    /** Sets the gray level of "on" pixels from 5 bit red, 6 bit green and
+     *  5 bit blue
+     */
+    void SetColorFG(uint8_t red, uint8_t green, uint8_t blue)
+    {
+        color_ = Rgb565::FromComponents(red, green, blue).GetGray4();
+    }
 
-    void Set_Color(uint8_t in_col) { color_ = in_col & 0x0f; };
+    /** Sets the gray level of "off" pixels */
+    void SetColorBG(uint8_t red, uint8_t green, uint8_t blue)
+    {
+        bg_color_ = Rgb565::FromComponents(red, green, blue).GetGray4();
+    }
 
   protected:
-    Transport transport_;
-    uint8_t   buffer_[width / 2 * height];
-    uint8_t   color_;
+    void SetPixel(size_t x, size_t y, uint8_t gray)
+    {
+        if((x >= width) || (y >= height))
+            return;
+
+        // even columns are in the high nibble
+        uint8_t& pixel = buffer_[y * (width / 2) + (x / 2)];
+        if(x % 2)
+            pixel = (pixel & 0xf0) | gray;
+        else
+            pixel = (pixel & 0x0f) | (gray << 4);
+        dirty_.Add(x / 2, y);
+    }
+
+    void FillRam(uint8_t value)
+    {
+        for(size_t i = 0; i < sizeof(buffer_); i++)
+            buffer_[i] = value;
+        dirty_.SetAll(width / 2, height);
+    }
+
+    /** Shrinks the dirty window to the bytes that differ from the front
+     *  buffer. \return false if nothing needs to be sent
+     */
+    bool FindChangedWindow()
+    {
+        const size_t line = width / 2;
+        if(send_all_)
+        {
+            send_all_ = false;
+            dirty_.SetAll(line, height);
+            return true;
+        }
+        if(dirty_.IsEmpty())
+            return false;
+        OledDirtyWindow changed;
+        for(size_t y = dirty_.GetY0(); y <= dirty_.GetY1(); y++)
+        {
+            for(size_t x = dirty_.GetX0(); x <= dirty_.GetX1(); x++)
+            {
+                if(buffer_[y * line + x] != front_[y * line + x])
+                    changed.Add(x, y);
+            }
+        }
+        dirty_ = changed;
+        return !dirty_.IsEmpty();
+    }
+
+    Transport       transport_;
+    uint8_t         buffer_[width / 2 * height];
+    uint8_t         front_[width / 2 * height]; // what the display RAM holds
+    uint8_t         color_;
+    uint8_t         bg_color_;
+    OledDirtyWindow dirty_;
+    bool            send_all_;
+    OledTransferChain<Transport, height> chain_;
 };
 
+#ifndef UNIT_TEST
 /**
  * A driver for the SSD1327 128x128 OLED displays connected via 4 wire SPI
  */
 using SSD13274WireSpi128x128Driver
     = daisy::SSD1327Driver<128, 128, SSD13274WireSpiTransport>;
+#endif
 
 }; // namespace daisy
@@ -3,6 +3,12 @@
 #include "per/spi.h"
 #include "per/gpio.h"
 #include "sys/system.h"
+#include "dev/oled_transfer_chain.h"
+#include "dev/oled_dirty_window.h"
+#include "hid/disp/graphics_common.h"
+#ifndef UNIT_TEST // the drivers are tested with mock transports
+#include "stm32h7xx_hal.h"
+#endif
 
 #define oled_white 0xffff
 #define oled_black 0x0000
@@ -15,6 +21,7 @@
 
 namespace daisy
 {
+#ifndef UNIT_TEST
 /**
  * 4 Wire SPI Transport for SSD1351 OLED display devices
  */
@@ -34,6 +41,7 @@ class SSD13514WireSpiTransport
             Pin dc;    /**< Pin used for Data/Command signaling */
             Pin reset; /**< Pin used for Reset */
         } pin_config;
+        bool useDma; /**< Send the frame buffer with DMA */
         void Defaults()
         {
             // SPI peripheral config
@@ -54,6 +62,8 @@ class SSD13514WireSpiTransport
             // SSD1351 control pin config
             pin_config.dc    = Pin(PORTB, 4);
             pin_config.reset = Pin(PORTB, 15);
+            // Using DMA off by default
+            useDma = false;
         }
     };
     void Init(const Config& config)
@@ -64,6 +74,7 @@ class SSD13514WireSpiTransport
 
         // Initialize SPI
         spi_.Init(config.spi_config);
+        use_dma_ = config.useDma;
 
         // Reset and Configure OLED.
         pin_reset_.Write(false);
@@ -83,6 +94,26 @@ class SSD13514WireSpiTransport
         spi_.BlockingTransmit(buff, size);
     };
 
+    /** Sends the data with DMA, or with a blocking transfer if useDma is
+     *  off, and calls end_callback when done. The buffer must not be in
+     *  DTCM RAM.
+     */
+    void SendDataDma(uint8_t*                          buff,
+                     size_t                            size,
+                     SpiHandle::EndCallbackFunctionPtr end_callback,
+                     void*                             context)
+    {
+        if(!use_dma_)
+        {
+            SendData(buff, size);
+            end_callback(context, SpiHandle::Result::OK);
+            return;
+        }
+        SCB_CleanInvalidateDCache_by_Addr(buff, size);
+        pin_dc_.Write(true);
+        spi_.DmaTransmit(buff, size, NULL, end_callback, context);
+    };
+
     void SendData(uint8_t data)
     {
         pin_dc_.Write(true);
@@ -93,26 +124,24 @@ class SSD13514WireSpiTransport
     SpiHandle spi_;
     GPIO      pin_reset_;
     GPIO      pin_dc_;
+    bool      use_dma_;
 };
+#endif // ifndef UNIT_TEST
 
 
 /**
- * A driver implementation for the SSD1351
+ * The SSD1351 setup shared by SSD1351Driver and SSD1351TiledDriver
+ *
+ * Pixels are stored in the byte order they are sent in, i.e. RGB565 with the
+ * high byte first.
  */
-template <size_t width, size_t height, typename Transport>
-class SSD1351Driver
+template <typename Transport>
+class SSD1351DriverBase
 {
-  public:
-    struct Config
-    {
-        typename Transport::Config transport_config;
-    };
-
-    void Init(Config config)
+  protected:
+    void InitController(const typename Transport::Config& transport_config)
     {
-        fg_color_ = oled_white;
-        bg_color_ = oled_black;
-        transport_.Init(config.transport_config);
+        transport_.Init(transport_config);
 
         transport_.SendCommand(0xfd); // lock IC
         transport_.SendData(0x12);
@@ -184,7 +213,60 @@ class SSD1351Driver
 
         System::Delay(300);           //	wait 300ms
         transport_.SendCommand(0xaf); // turn on display
+    }
+
+    /** Sets the columns and rows that the next RAM write goes to */
+    void SetWindow(size_t x0, size_t y0, size_t x1, size_t y1)
+    {
+        // the window arguments are data bytes, so they're sent here rather
+        // than as commands of the transfer
+        transport_.SendCommand(0x15); // column
+        transport_.SendData(x0);
+        transport_.SendData(x1);
+
+        transport_.SendCommand(0x75); // row
+        transport_.SendData(y0);
+        transport_.SendData(y1);
+    }
+
+    /** \return the color in the byte order of the display RAM */
+    static uint16_t ToRam(Rgb565 color)
+    {
+        const uint16_t value = color.GetValue();
+        return uint16_t((value >> 8) | (value << 8));
+    }
+
+    Transport transport_;
+    uint16_t  fg_color_;
+    uint16_t  bg_color_;
+};
+
+/**
+ * A driver implementation for the SSD1351
+ *
+ * Update() sends the smallest window of columns and rows that holds all
+ * pixels that differ from the last frame sent. The window is copied to a
+ * front buffer and sent from there, with DMA if the transport is configured
+ * for it. Drawing can continue while the frame is sent.
+ */
+template <size_t width, size_t height, typename Transport>
+class SSD1351Driver : public SSD1351DriverBase<Transport>
+{
+  public:
+    struct Config
+    {
+        typename Transport::Config transport_config;
+    };
+
+    void Init(Config config)
+    {
+        this->fg_color_ = oled_white;
+        this->bg_color_ = oled_black;
+        this->InitController(config.transport_config);
+        chain_.Init(&this->transport_);
         Fill(false);
+        // the display RAM content is unknown until the first frame is sent
+        send_all_ = true;
     };
 
     size_t Width() const { return width; };
@@ -192,75 +274,269 @@ class SSD1351Driver
 
     void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on)
     {
-        if((x >= width) || (y >= height))
+        SetPixel(x, y, on ? this->fg_color_ : this->bg_color_);
+    };
+
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, Rgb565 color)
+    {
+        SetPixel(x, y, this->ToRam(color));
+    }
+
+    void Fill(bool on) { FillRam(on ? this->fg_color_ : this->bg_color_); };
+
+    void Fill(Rgb565 color) { FillRam(this->ToRam(color)); }
+
+    /**
+     * Update the display. Waits for the previous update to finish first.
+    */
+    void Update()
+    {
+        chain_.Wait();
+        if(!FindChangedWindow())
             return;
 
-        if(on)
+        const size_t x0      = dirty_.GetX0();
+        const size_t y0      = dirty_.GetY0();
+        const size_t columns = dirty_.GetX1() - x0 + 1;
+        const size_t rows    = dirty_.GetY1() - y0 + 1;
+        for(size_t y = y0; y < y0 + rows; y++)
         {
-            buffer_[(y * width) + x] = fg_color_;
+            for(size_t x = x0; x < x0 + columns; x++)
+                front_[y * width + x] = buffer_[y * width + x];
+        }
+
+        const uint8_t write_ram = 0x5c; // write display buffer
+        this->SetWindow(x0, y0, x0 + columns - 1, y0 + rows - 1);
+        chain_.Clear();
+        if(columns == width)
+        {
+            // whole rows are contiguous in the front buffer
+            chain_.Add(&write_ram,
+                       1,
+                       (uint8_t*)&front_[y0 * width],
+                       rows * width * 2);
         }
         else
         {
-            buffer_[(y * width) + x] = bg_color_;
+            // the controller wraps to the next row of the window by itself,
+            // so the following rows need no commands
+            for(size_t y = y0; y < y0 + rows; y++)
+                chain_.Add(&write_ram,
+                           y == y0 ? 1 : 0,
+                           (uint8_t*)&front_[y * width + x0],
+                           columns * 2);
         }
+        chain_.Start();
+        dirty_.Clear();
     };
 
-    void Fill(bool on)
+    /**
+     * Has update finished
+    */
+    bool UpdateFinished() { return !chain_.IsBusy(); }
+
+    void SetColorFG(uint8_t red, uint8_t green, uint8_t blue)
     {
-        for(size_t i = 0; i < sizeof(buffer_) / 2; i++)
+        this->fg_color_
+            = this->ToRam(Rgb565::FromComponents(red, green, blue));
+    };
+
+    void SetColorBG(uint8_t red, uint8_t green, uint8_t blue)
+    {
+        this->bg_color_
+            = this->ToRam(Rgb565::FromComponents(red, green, blue));
+    };
+
+  protected:
+    void SetPixel(size_t x, size_t y, uint16_t value)
+    {
+        if((x >= width) || (y >= height))
+            return;
+        buffer_[(y * width) + x] = value;
+        dirty_.Add(x, y);
+    }
+
+    void FillRam(uint16_t value)
+    {
+        for(size_t i = 0; i < width * height; i++)
+            buffer_[i] = value;
+        dirty_.SetAll(width, height);
+    }
+
+    /** Shrinks the dirty window to the pixels that differ from the front
+     *  buffer. \return false if nothing needs to be sent
+     */
+    bool FindChangedWindow()
+    {
+        if(send_all_)
+        {
+            send_all_ = false;
+            dirty_.SetAll(width, height);
+            return true;
+        }
+        if(dirty_.IsEmpty())
+            return false;
+        OledDirtyWindow changed;
+        for(size_t y = dirty_.GetY0(); y <= dirty_.GetY1(); y++)
         {
-            buffer_[i] = on ? fg_color_ : bg_color_;
+            for(size_t x = dirty_.GetX0(); x <= dirty_.GetX1(); x++)
+            {
+                if(buffer_[y * width + x] != front_[y * width + x])
+                    changed.Add(x, y);
+            }
         }
+        dirty_ = changed;
+        return !dirty_.IsEmpty();
+    }
+
+    uint16_t        buffer_[width * height];
+    uint16_t        front_[width * height]; // what the display RAM holds
+    OledDirtyWindow dirty_;
+    bool            send_all_;
+    OledTransferChain<Transport, height> chain_;
+};
+
+/**
+ * An SSD1351 driver that renders the frame in horizontal bands of tile_rows
+ * rows instead of keeping a whole frame buffer
+ *
+ * It needs two band buffers (2 * width * tile_rows * 2 bytes, e.g. 8 KB for
+ * 128x128 in bands of 16 rows) instead of the 64 KB of SSD1351Driver. In
+ * exchange the whole frame is drawn and sent on every Render(), and the draw
+ * function is called once per band. Drawing outside the current band is
+ * clipped, so the draw function must not depend on being called only once.
+ *
+ * \code
+ * display.Render([&]() {
+ *     display.Fill(Rgb565::FromRgb888(0, 0, 64));
+ *     display.WriteString("hello", Font_7x10, Rgb565(0xffff), Rgb565());
+ * });
+ * \endcode
+ *
+ * While one band is sent (with DMA if the transport is configured for it),
+ * the next one is drawn into the other buffer.
+ */
+template <size_t width, size_t height, size_t tile_rows, typename Transport>
+class SSD1351TiledDriver : public SSD1351DriverBase<Transport>
+{
+    static_assert(height % tile_rows == 0,
+                  "tile_rows must divide the height of the display");
+
+  public:
+    struct Config
+    {
+        typename Transport::Config transport_config;
     };
 
-    /**
-     * Update the display
-    */
-    void Update()
+    void Init(Config config)
     {
-        transport_.SendCommand(0x15); // column
-        transport_.SendData(0x00);
-        transport_.SendData(width - 1);
+        this->fg_color_ = oled_white;
+        this->bg_color_ = oled_black;
+        tile_           = nullptr;
+        tile_y_         = 0;
+        this->InitController(config.transport_config);
+        chain_.Init(&this->transport_);
+    };
 
-        transport_.SendCommand(0x75); // row
-        transport_.SendData(0x00);
-        transport_.SendData(height - 1);
+    size_t Width() const { return width; };
+    size_t Height() const { return height; };
 
-        transport_.SendCommand(0x5c); // write display buffer
-        transport_.SendData((uint8_t*)buffer_, sizeof(buffer_));
+    /** Draws and sends a frame
+     *  \param draw called without arguments once per band, draws the frame
+     *         through the display that owns this driver
+     */
+    template <typename DrawFunction>
+    void Render(DrawFunction&& draw)
+    {
+        const uint8_t write_ram = 0x5c; // write display buffer
+        chain_.Wait();
+        for(size_t y0 = 0; y0 < height; y0 += tile_rows)
+        {
+            // the other buffer is free: its band was sent before the
+            // previous band was started
+            tile_   = tiles_[(y0 / tile_rows) % 2];
+            tile_y_ = y0;
+            FillTile(this->bg_color_);
+            draw();
+
+            chain_.Wait();
+            if(y0 == 0)
+                this->SetWindow(0, 0, width - 1, height - 1);
+            chain_.Clear();
+            chain_.Add(&write_ram,
+                       y0 == 0 ? 1 : 0,
+                       (uint8_t*)tile_,
+                       sizeof(tiles_[0]));
+            chain_.Start();
+        }
+        tile_ = nullptr;
+    }
+
+    /** Draws into the current band. Does nothing outside of Render(). */
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on)
+    {
+        SetPixel(x, y, on ? this->fg_color_ : this->bg_color_);
     };
 
-    void SetColorFG(uint8_t red, uint8_t green, uint8_t blue)
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, Rgb565 color)
     {
-        uint16_t t1, t2;
+        SetPixel(x, y, this->ToRam(color));
+    }
+
+    /** Fills the current band */
+    void Fill(bool on) { FillTile(on ? this->fg_color_ : this->bg_color_); };
+
+    void Fill(Rgb565 color) { FillTile(this->ToRam(color)); }
 
-        fg_color_ = (red & 0x1f) << 11 | (green & 0x3f) << 5 | (blue & 0x1f);
-        t1        = (fg_color_ >> 8) & 0xff;
-        t2        = (fg_color_ & 0xff);
-        fg_color_ = t2 << 8 | t1;
+    /** Frames are sent by Render(), this does nothing */
+    void Update() {}
+
+    /**
+     * Has the last band of the frame been sent
+    */
+    bool UpdateFinished() { return !chain_.IsBusy(); }
+
+    void SetColorFG(uint8_t red, uint8_t green, uint8_t blue)
+    {
+        this->fg_color_
+            = this->ToRam(Rgb565::FromComponents(red, green, blue));
     };
 
     void SetColorBG(uint8_t red, uint8_t green, uint8_t blue)
     {
-        uint16_t t1, t2;
-
-        bg_color_ = (red & 0x1f) << 11 | (green & 0x3f) << 5 | (blue & 0x1f);
-        t1        = (bg_color_ >> 8) & 0xff;
-        t2        = (bg_color_ & 0xff);
-        bg_color_ = t2 << 8 | t1;
+        this->bg_color_
+            = this->ToRam(Rgb565::FromComponents(red, green, blue));
     };
 
   protected:
-    Transport transport_;
-    uint16_t  buffer_[width * height];
-    uint16_t  fg_color_;
-    uint16_t  bg_color_;
+    void SetPixel(size_t x, size_t y, uint16_t value)
+    {
+        if(tile_ == nullptr || x >= width || y < tile_y_
+           || y >= tile_y_ + tile_rows)
+            return;
+        tile_[(y - tile_y_) * width + x] = value;
+    }
+
+    void FillTile(uint16_t value)
+    {
+        if(tile_ == nullptr)
+            return;
+        for(size_t i = 0; i < width * tile_rows; i++)
+            tile_[i] = value;
+    }
+
+    uint16_t  tiles_[2][width * tile_rows];
+    uint16_t* tile_;
+    size_t    tile_y_;
+    OledTransferChain<Transport, 1> chain_;
 };
 
+#ifndef UNIT_TEST
 /**
  * A driver for the SSD1351 128x128 OLED displays connected via 4 wire SPI
  */
 using SSD13514WireSpi128x128Driver
     = daisy::SSD1351Driver<128, 128, SSD13514WireSpiTransport>;
+#endif
 
 }; // namespace daisy
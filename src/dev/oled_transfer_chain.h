@@ -0,0 +1,160 @@
+#pragma once
+#ifndef SA_OLED_TRANSFER_CHAIN_H
+#define SA_OLED_TRANSFER_CHAIN_H /**< & */
+
+#include <cstddef>
+#include <cstdint>
+#include "per/spi.h"
+
+namespace daisy
+{
+/**
+ * Sends a display frame as a chain of transfers
+ *
+ * Each segment is a few command bytes followed by a block of data, e.g. the
+ * page address and the columns of one page of an SSD1306. Start() sends the
+ * first segment; each following segment is started from the completion
+ * callback of the previous data transfer. With a DMA transport the display
+ * drivers return from Update() right away and the frame goes out in the
+ * background, while the application keeps drawing into the driver's back
+ * buffer.
+ *
+ * The transport needs these functions:
+ * - `void SendCommand(uint8_t cmd)`
+ * - `void SendDataDma(uint8_t* buff, size_t size,
+ *   SpiHandle::EndCallbackFunctionPtr end_callback, void* context)`
+ *
+ * Transports without DMA send the data with a blocking transfer and call
+ * `end_callback` before SendDataDma() returns. The chain then continues in
+ * a loop instead of recursing, so Start() returns once the whole frame is
+ * sent.
+ *
+ * The data must stay unchanged until IsBusy() returns false. Commands are
+ * sent from the completion callback, i.e. from an interrupt with DMA.
+ */
+template <typename Transport, size_t kMaxSegments>
+class OledTransferChain
+{
+  public:
+    /** Maximum number of command bytes before the data of a segment */
+    static constexpr size_t kMaxCommands = 6;
+
+    OledTransferChain()
+    : transport_(nullptr),
+      num_segments_(0),
+      next_(0),
+      busy_(false),
+      sending_(false),
+      completed_(false)
+    {
+    }
+
+    void Init(Transport* transport)
+    {
+        transport_    = transport;
+        num_segments_ = 0;
+        next_         = 0;
+        busy_         = false;
+        sending_      = false;
+        completed_    = false;
+    }
+
+    /** Removes all segments. Only call this while the chain isn't busy. */
+    void Clear() { num_segments_ = 0; }
+
+    /** Adds a segment to the chain
+     *  \param commands     bytes sent with SendCommand() before the data
+     *  \param num_commands up to kMaxCommands
+     *  \param data         data sent after the commands
+     *  \param size         size of the data in bytes
+     *  \return false if the chain is full
+     */
+    bool Add(const uint8_t* commands,
+             size_t         num_commands,
+             uint8_t*       data,
+             size_t         size)
+    {
+        if(num_segments_ >= kMaxSegments || num_commands > kMaxCommands)
+            return false;
+        Segment& segment     = segments_[num_segments_++];
+        segment.num_commands = num_commands;
+        for(size_t i = 0; i < num_commands; i++)
+            segment.commands[i] = commands[i];
+        segment.data = data;
+        segment.size = size;
+        return true;
+    }
+
+    /** Starts sending the segments that were added since Clear() */
+    void Start()
+    {
+        if(num_segments_ == 0)
+            return;
+        next_ = 0;
+        busy_ = true;
+        SendNext();
+    }
+
+    /** \return true while a frame is being sent */
+    bool IsBusy() const { return busy_; }
+
+    /** Waits for the current frame to be sent */
+    void Wait() const
+    {
+        while(busy_) {}
+    }
+
+  private:
+    struct Segment
+    {
+        uint8_t  commands[kMaxCommands];
+        size_t   num_commands;
+        uint8_t* data;
+        size_t   size;
+    };
+
+    void SendNext()
+    {
+        // a blocking transport completes inside SendDataDma(), so the next
+        // segment is sent from this loop rather than from the callback
+        if(sending_)
+        {
+            completed_ = true;
+            return;
+        }
+        do
+        {
+            if(next_ >= num_segments_)
+            {
+                busy_ = false;
+                return;
+            }
+            const Segment& segment = segments_[next_++];
+            sending_               = true;
+            completed_             = false;
+            for(size_t i = 0; i < segment.num_commands; i++)
+                transport_->SendCommand(segment.commands[i]);
+            transport_->SendDataDma(
+                segment.data, segment.size, TransferCompleteCallback, this);
+            sending_ = false;
+        } while(completed_);
+    }
+
+    static void TransferCompleteCallback(void* context,
+                                         SpiHandle::Result /* result */)
+    {
+        static_cast<OledTransferChain*>(context)->SendNext();
+    }
+
+    Transport*    transport_;
+    Segment       segments_[kMaxSegments];
+    size_t        num_segments_;
+    size_t        next_;
+    volatile bool busy_;
+    volatile bool sending_;
+    volatile bool completed_;
+};
+
+} // namespace daisy
+
+#endif
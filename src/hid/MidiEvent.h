@@ -1,3 +1,9 @@
+#pragma once
+#ifndef DSY_MIDI_EVENT_H
+#define DSY_MIDI_EVENT_H
+
+#include <stdint.h>
+
 // TODO: make this adjustable
 #define SYSEX_BUFFER_LEN 128
 
@@ -435,3 +441,5 @@ struct MidiEvent
 
 /** @} */ // End midi
 } //namespace daisy
+
+#endif
@@ -0,0 +1,318 @@
+#pragma once
+#ifndef DSY_UMP_PACKET_H
+#define DSY_UMP_PACKET_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace daisy
+{
+/** @addtogroup midi MIDI
+ *  @{
+ */
+
+/** @defgroup ump_packets UMP_PACKETS
+ *  @brief MIDI 2.0 Universal MIDI Packet types
+ *  @{
+*/
+
+/** Message Type field, found in the top nibble of the first word of every UMP.
+ *  The message type alone determines the size of the packet.
+ */
+enum UmpMessageType
+{
+    UmpUtility           = 0x0, /**< 32 bit */
+    UmpSystem            = 0x1, /**< 32 bit */
+    UmpMidi1ChannelVoice = 0x2, /**< 32 bit */
+    UmpData64            = 0x3, /**< 64 bit, SysEx7 */
+    UmpMidi2ChannelVoice = 0x4, /**< 64 bit */
+    UmpData128           = 0x5, /**< 128 bit, SysEx8 and Mixed Data Set */
+    UmpFlexData          = 0xD, /**< 128 bit */
+    UmpStream            = 0xF, /**< 128 bit */
+};
+
+/** Status nibble of a MIDI 2.0 Channel Voice message (UmpMidi2ChannelVoice).
+ *  The values from UmpNoteOff to UmpPitchBend match the MIDI 1.0 status
+ *  nibbles, so (status - UmpNoteOff) is the equivalent MidiMessageType.
+ */
+enum UmpChannelVoiceStatus
+{
+    UmpRegisteredPerNoteController  = 0x0, /**< & */
+    UmpAssignablePerNoteController  = 0x1, /**< & */
+    UmpRegisteredController         = 0x2, /**< RPN */
+    UmpAssignableController         = 0x3, /**< NRPN */
+    UmpRelativeRegisteredController = 0x4, /**< & */
+    UmpRelativeAssignableController = 0x5, /**< & */
+    UmpPerNotePitchBend             = 0x6, /**< & */
+    UmpNoteOff                      = 0x8, /**< & */
+    UmpNoteOn                       = 0x9, /**< & */
+    UmpPolyPressure                 = 0xA, /**< & */
+    UmpControlChange                = 0xB, /**< & */
+    UmpProgramChange                = 0xC, /**< & */
+    UmpChannelPressure              = 0xD, /**< & */
+    UmpPitchBend                    = 0xE, /**< & */
+    UmpPerNoteManagement            = 0xF, /**< & */
+};
+
+/** Status nibble of a Data 64 (SysEx7) message */
+enum UmpSysExStatus
+{
+    UmpSysExComplete = 0x0, /**< Whole message in one packet */
+    UmpSysExStart    = 0x1, /**< & */
+    UmpSysExContinue = 0x2, /**< & */
+    UmpSysExEnd      = 0x3, /**< & */
+};
+
+/** Struct containing note, 16-bit velocity, and attribute data.
+Can be made from UmpPacket
+*/
+struct Midi2NoteOnEvent
+{
+    uint8_t  group;          /**< & */
+    int      channel;        /**< & */
+    uint8_t  note;           /**< & */
+    uint16_t velocity;       /**< & */
+    uint8_t  attribute_type; /**< & */
+    uint16_t attribute;      /**< & */
+};
+
+/** Struct containing note, 16-bit velocity, and attribute data.
+Can be made from UmpPacket
+*/
+struct Midi2NoteOffEvent
+{
+    uint8_t  group;          /**< & */
+    int      channel;        /**< & */
+    uint8_t  note;           /**< & */
+    uint16_t velocity;       /**< & */
+    uint8_t  attribute_type; /**< & */
+    uint16_t attribute;      /**< & */
+};
+
+/** Struct containing note, and 32-bit pressure data.
+Can be made from UmpPacket
+*/
+struct Midi2PolyPressureEvent
+{
+    uint8_t  group;    /**< & */
+    int      channel;  /**< & */
+    uint8_t  note;     /**< & */
+    uint32_t pressure; /**< & */
+};
+
+/** Struct containing control index, and 32-bit value.
+Can be made from UmpPacket
+*/
+struct Midi2ControlChangeEvent
+{
+    uint8_t  group;   /**< & */
+    int      channel; /**< & */
+    uint8_t  index;   /**< & */
+    uint32_t value;   /**< & */
+};
+
+/** Struct containing a Registered (RPN) or Assignable (NRPN) controller.
+Can be made from UmpPacket
+*/
+struct Midi2ControllerEvent
+{
+    uint8_t  group;      /**< & */
+    int      channel;    /**< & */
+    bool     registered; /**< true for RPN, false for NRPN */
+    uint8_t  bank;       /**< & */
+    uint8_t  index;      /**< & */
+    uint32_t value;      /**< & */
+};
+
+/** Struct containing program and optional bank select.
+Can be made from UmpPacket
+*/
+struct Midi2ProgramChangeEvent
+{
+    uint8_t group;      /**< & */
+    int     channel;    /**< & */
+    uint8_t program;    /**< & */
+    bool    bank_valid; /**< & */
+    uint8_t bank_msb;   /**< & */
+    uint8_t bank_lsb;   /**< & */
+};
+
+/** Struct containing 32-bit channel pressure.
+Can be made from UmpPacket
+*/
+struct Midi2ChannelPressureEvent
+{
+    uint8_t  group;    /**< & */
+    int      channel;  /**< & */
+    uint32_t pressure; /**< & */
+};
+
+/** Struct containing 32-bit pitch bend, centered on 0x80000000.
+Can be made from UmpPacket
+*/
+struct Midi2PitchBendEvent
+{
+    uint8_t  group;   /**< & */
+    int      channel; /**< & */
+    uint32_t value;   /**< & */
+};
+
+/** Struct containing per-note 32-bit pitch bend, centered on 0x80000000.
+Can be made from UmpPacket
+*/
+struct Midi2PerNotePitchBendEvent
+{
+    uint8_t  group;   /**< & */
+    int      channel; /**< & */
+    uint8_t  note;    /**< & */
+    uint32_t value;   /**< & */
+};
+
+/** A single Universal MIDI Packet of up to 128 bits.
+ *  Words beyond GetNumWords() are zero.
+ *
+ *  The As* accessors only extract bit fields and do not check
+ *  the message type or status; check those first.
+ */
+struct UmpPacket
+{
+    uint32_t words[4]; /**< & */
+
+    /** Returns the number of 32-bit words for a given message type */
+    static size_t GetNumWords(uint8_t message_type)
+    {
+        // two bits per message type containing (size - 1),
+        // so a lookup costs one shift and one mask.
+        return ((0xfe950d40u >> ((message_type & 0x0f) * 2)) & 0x03) + 1;
+    }
+
+    /** Returns the number of 32-bit words in this packet */
+    size_t GetNumWords() const { return GetNumWords(words[0] >> 28); }
+
+    UmpMessageType GetMessageType() const
+    {
+        return static_cast<UmpMessageType>(words[0] >> 28);
+    }
+
+    uint8_t GetGroup() const { return (words[0] >> 24) & 0x0f; }
+
+    /** Status nibble. For channel voice messages this
+     *  is an UmpChannelVoiceStatus, for Data 64 an UmpSysExStatus.
+     */
+    uint8_t GetStatus() const { return (words[0] >> 20) & 0x0f; }
+
+    /** Channel of a channel voice message */
+    int GetChannel() const { return (words[0] >> 16) & 0x0f; }
+
+    /** Returns the data within the UmpPacket as a Midi2NoteOnEvent struct */
+    Midi2NoteOnEvent AsMidi2NoteOn() const
+    {
+        Midi2NoteOnEvent m;
+        m.group          = GetGroup();
+        m.channel        = GetChannel();
+        m.note           = (words[0] >> 8) & 0x7f;
+        m.attribute_type = words[0] & 0xff;
+        m.velocity       = words[1] >> 16;
+        m.attribute      = words[1] & 0xffff;
+        return m;
+    }
+
+    /** Returns the data within the UmpPacket as a Midi2NoteOffEvent struct */
+    Midi2NoteOffEvent AsMidi2NoteOff() const
+    {
+        Midi2NoteOffEvent m;
+        m.group          = GetGroup();
+        m.channel        = GetChannel();
+        m.note           = (words[0] >> 8) & 0x7f;
+        m.attribute_type = words[0] & 0xff;
+        m.velocity       = words[1] >> 16;
+        m.attribute      = words[1] & 0xffff;
+        return m;
+    }
+
+    /** Returns the data within the UmpPacket as a Midi2PolyPressureEvent struct */
+    Midi2PolyPressureEvent AsMidi2PolyPressure() const
+    {
+        Midi2PolyPressureEvent m;
+        m.group    = GetGroup();
+        m.channel  = GetChannel();
+        m.note     = (words[0] >> 8) & 0x7f;
+        m.pressure = words[1];
+        return m;
+    }
+
+    /** Returns the data within the UmpPacket as a Midi2ControlChangeEvent struct */
+    Midi2ControlChangeEvent AsMidi2ControlChange() const
+    {
+        Midi2ControlChangeEvent m;
+        m.group   = GetGroup();
+        m.channel = GetChannel();
+        m.index   = (words[0] >> 8) & 0x7f;
+        m.value   = words[1];
+        return m;
+    }
+
+    /** Returns the data within the UmpPacket as a Midi2ControllerEvent struct */
+    Midi2ControllerEvent AsMidi2Controller() const
+    {
+        Midi2ControllerEvent m;
+        m.group      = GetGroup();
+        m.channel    = GetChannel();
+        m.registered = GetStatus() == UmpRegisteredController;
+        m.bank       = (words[0] >> 8) & 0x7f;
+        m.index      = words[0] & 0x7f;
+        m.value      = words[1];
+        return m;
+    }
+
+    /** Returns the data within the UmpPacket as a Midi2ProgramChangeEvent struct */
+    Midi2ProgramChangeEvent AsMidi2ProgramChange() const
+    {
+        Midi2ProgramChangeEvent m;
+        m.group      = GetGroup();
+        m.channel    = GetChannel();
+        m.bank_valid = words[0] & 0x01;
+        m.program    = (words[1] >> 24) & 0x7f;
+        m.bank_msb   = (words[1] >> 8) & 0x7f;
+        m.bank_lsb   = words[1] & 0x7f;
+        return m;
+    }
+
+    /** Returns the data within the UmpPacket as a Midi2ChannelPressureEvent struct */
+    Midi2ChannelPressureEvent AsMidi2ChannelPressure() const
+    {
+        Midi2ChannelPressureEvent m;
+        m.group    = GetGroup();
+        m.channel  = GetChannel();
+        m.pressure = words[1];
+        return m;
+    }
+
+    /** Returns the data within the UmpPacket as a Midi2PitchBendEvent struct */
+    Midi2PitchBendEvent AsMidi2PitchBend() const
+    {
+        Midi2PitchBendEvent m;
+        m.group   = GetGroup();
+        m.channel = GetChannel();
+        m.value   = words[1];
+        return m;
+    }
+
+    /** Returns the data within the UmpPacket as a Midi2PerNotePitchBendEvent struct */
+    Midi2PerNotePitchBendEvent AsMidi2PerNotePitchBend() const
+    {
+        Midi2PerNotePitchBendEvent m;
+        m.group   = GetGroup();
+        m.channel = GetChannel();
+        m.note    = (words[0] >> 8) & 0x7f;
+        m.value   = words[1];
+        return m;
+    }
+};
+
+/** @} */ // End ump_packets
+
+/** @} */ // End midi
+} // namespace daisy
+
+#endif
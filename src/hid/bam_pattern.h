@@ -0,0 +1,94 @@
+#pragma once
+#ifndef DSY_BAM_PATTERN_H
+#define DSY_BAM_PATTERN_H
+#include <stddef.h>
+#include <stdint.h>
+
+namespace daisy
+{
+/**
+    @brief Bit angle modulation (BAM) patterns for the LEDs on a GPIO port \n
+    Holds one cycle of output states for up to 16 pins of a port as words
+    for the port's bit set/reset register (BSRR): the lower 16 bits switch
+    pins on, the upper 16 bits switch them off, and pins without LEDs are
+    left alone. Bit n of an 8-bit brightness level decides the state of a
+    pin for a stretch of 2^n slots, so the cycle is 255 slots long and a pin
+    is on for `level` of them.
+
+    Streamed into `GPIOx->BSRR` by a circular memory-to-peripheral DMA that
+    is triggered by a timer, e.g. at 255 * 200 Hz, the pattern refreshes the
+    LEDs without any CPU time. The buffer must then live in memory that the
+    DMA can access, e.g. a `DMA_BUFFER_MEM_SECTION` object. SetLevel() only
+    changes the bits of one pin, one word at a time, so it can be called
+    while the DMA is running.
+
+    Led::Init() and RgbLed::Init() can bind LEDs to a pattern.
+    @ingroup feedback
+*/
+class BamPattern
+{
+  public:
+    /** The number of bits of the brightness levels */
+    static constexpr size_t kNumBits = 8;
+    /** The level of a pin that is always on */
+    static constexpr uint8_t kMaxLevel = (1 << kNumBits) - 1;
+    /** The number of words per cycle */
+    static constexpr size_t kNumSlots = kMaxLevel;
+
+    BamPattern() {}
+    ~BamPattern() {}
+
+    /** Clears the pattern so that it doesn't change any pins */
+    void Init()
+    {
+        for(size_t i = 0; i < kNumSlots; i++)
+            buffer_[i] = 0;
+        for(size_t pin = 0; pin < 16; pin++)
+            levels_[pin] = 0;
+    }
+
+    /** Sets the brightness of a pin, and adds the pin to the pattern
+    \param pin   the pin number on the port, 0..15
+    \param level the number of slots per cycle that the pin is high
+    */
+    void SetLevel(uint8_t pin, uint8_t level)
+    {
+        if(pin >= 16)
+            return;
+        levels_[pin]         = level;
+        const uint32_t on    = 1u << pin;
+        const uint32_t off   = 1u << (pin + 16);
+        const uint32_t clear = ~(on | off);
+        for(size_t bit = 0; bit < kNumBits; bit++)
+        {
+            // bit n covers slots 2^n - 1 .. 2^(n + 1) - 2
+            const uint32_t state = (level >> bit) & 1u ? on : off;
+            const size_t   first = (size_t(1) << bit) - 1;
+            for(size_t slot = first; slot < 2 * first + 1; slot++)
+                buffer_[slot] = (buffer_[slot] & clear) | state;
+        }
+    }
+
+    /** \return the level for a duty cycle, which is clamped to 0..1 */
+    static inline uint8_t LevelFromDuty(float duty)
+    {
+        duty = duty < 0.0f ? 0.0f : (duty > 1.0f ? 1.0f : duty);
+        return uint8_t(duty * kMaxLevel + 0.5f);
+    }
+
+    /** \return the brightness of a pin */
+    inline uint8_t GetLevel(uint8_t pin) const
+    {
+        return pin < 16 ? levels_[pin] : 0;
+    }
+
+    /** \return the BSRR words of one cycle, kNumSlots of them */
+    inline const uint32_t* GetBuffer() const { return buffer_; }
+
+  private:
+    uint32_t buffer_[kNumSlots] = {};
+    uint8_t  levels_[16]        = {};
+};
+
+} // namespace daisy
+#endif
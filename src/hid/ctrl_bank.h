@@ -0,0 +1,169 @@
+#pragma once
+#ifndef DSY_CTRL_BANK_H
+#define DSY_CTRL_BANK_H
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+namespace daisy
+{
+/**
+    @brief A bank of analog controls that are processed together \n
+    Does the same as an array of AnalogControl, but keeps the settings of
+    all channels in separate arrays (structure of arrays) and reads the raw
+    values from one contiguous buffer, e.g. the DMA buffer of the ADC. \n
+    Process() is a single branch-free loop over all channels, which the
+    compiler can unroll or vectorize, instead of one call with branches per
+    control. The results are the same as those of AnalogControl.
+    @ingroup controls
+
+    \tparam num_controls the number of controls
+*/
+template <size_t num_controls>
+class AnalogControlBank
+{
+  public:
+    AnalogControlBank() {}
+    ~AnalogControlBank() {}
+
+    /**
+    Initializes all controls like AnalogControl::Init()
+    \param adcptr points to the raw values of the controls, one after the
+                  other, e.g. AdcHandle::GetPtr(0)
+    \param sr is the rate in Hz that Process() will be called at
+    \param slew_seconds is the slew time in seconds that it takes for the
+                        controls to change to a new value
+    */
+    void Init(const uint16_t *adcptr, float sr, float slew_seconds = 0.002f)
+    {
+        raw_        = adcptr;
+        samplerate_ = sr;
+        for(size_t i = 0; i < num_controls; i++)
+        {
+            val_[i]          = 0.0f;
+            slew_seconds_[i] = slew_seconds;
+            scale_[i]        = 1.0f;
+            offset_[i]       = 0.0f;
+            invert_[i]       = false;
+            SetFlip(i, false);
+            UpdateCoeff(i);
+            UpdateGain(i);
+        }
+    }
+
+    /**
+    Configures a control for a -5V to 5V inverted input, like
+    AnalogControl::InitBipolarCv()
+    \param idx the control
+    */
+    void InitBipolarCv(size_t idx)
+    {
+        slew_seconds_[idx] = 0.002f;
+        scale_[idx]        = 2.0f;
+        offset_[idx]       = 0.5f;
+        invert_[idx]       = true;
+        SetFlip(idx, false);
+        UpdateCoeff(idx);
+        UpdateGain(idx);
+    }
+
+    /** Flips the input of a control (i.e. 1.f - input) */
+    void SetFlip(size_t idx, bool flip)
+    {
+        flip_offset_[idx] = flip ? 1.0f : 0.0f;
+        flip_sign_[idx]   = flip ? -1.0f : 1.0f;
+    }
+
+    /** Inverts the input of a control (i.e. -1.f * input) */
+    void SetInvert(size_t idx, bool invert)
+    {
+        invert_[idx] = invert;
+        UpdateGain(idx);
+    }
+
+    /** Sets the scaling factor of a control, see AnalogControl::SetScale() */
+    void SetScale(size_t idx, float scale)
+    {
+        scale_[idx] = scale;
+        UpdateGain(idx);
+    }
+
+    /** Sets the offset of a control, see AnalogControl::SetOffset() */
+    void SetOffset(size_t idx, float offset) { offset_[idx] = offset; }
+
+    /** Directly sets the coefficient of the one pole smoothing filter of a
+     *  control. Max of 1, min of 0.
+     */
+    void SetCoeff(size_t idx, float val)
+    {
+        val = val > 1.f ? 1.f : val;
+        val = val < 0.f ? 0.f : val;
+
+        coeff_[idx] = val;
+    }
+
+    /** Sets a new rate for Process() after the bank has been initialized */
+    void SetSampleRate(float sample_rate)
+    {
+        samplerate_ = sample_rate;
+        for(size_t i = 0; i < num_controls; i++)
+            UpdateCoeff(i);
+    }
+
+    /**
+    Filters and transforms the raw ADC reads of all controls into their
+    normalized ranges. This should be called at the rate specified at Init
+    time.
+    */
+    void Process()
+    {
+        for(size_t i = 0; i < num_controls; i++)
+        {
+            float t = (float)raw_[i] / 65536.0f;
+            t       = flip_offset_[i] + flip_sign_[i] * t;
+            t       = (t - offset_[i]) * gain_[i];
+            val_[i] += coeff_[i] * (t - val_[i]);
+        }
+    }
+
+    /** Returns the current value of a control, without reprocessing */
+    inline float Value(size_t idx) const { return val_[idx]; }
+
+    /** Returns the current values of all controls */
+    inline const float *Values() const { return val_; }
+
+    /** Returns the raw unsigned 16-bit value of a control from the ADC */
+    inline uint16_t GetRawValue(size_t idx) const { return raw_[idx]; }
+
+    /** Returns the number of controls */
+    static constexpr size_t GetNumControls() { return num_controls; }
+
+  private:
+    void UpdateCoeff(size_t idx)
+    {
+        SetCoeff(idx, 1.0f / (slew_seconds_[idx] * samplerate_ * 0.5f));
+    }
+
+    void UpdateGain(size_t idx)
+    {
+        gain_[idx] = scale_[idx] * (invert_[idx] ? -1.0f : 1.0f);
+    }
+
+    // used by Process()
+    float flip_offset_[num_controls];
+    float flip_sign_[num_controls];
+    float offset_[num_controls];
+    float gain_[num_controls]; /**< scale with the sign of the inversion */
+    float coeff_[num_controls];
+    float val_[num_controls];
+
+    // settings
+    const uint16_t *raw_ = nullptr;
+    float           samplerate_;
+    float           scale_[num_controls];
+    float           slew_seconds_[num_controls];
+    bool            invert_[num_controls];
+};
+} // namespace daisy
+#endif
+#endif
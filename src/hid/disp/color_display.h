@@ -38,6 +38,12 @@ class ColorGraphicsDisplay
     */
     virtual void Fill(bool on) = 0;
 
+    /**
+    Fills the entire display with a color.
+    \param color the color
+    */
+    virtual void Fill(Rgb565 color) = 0;
+
     /**
     Sets the pixel at the specified coordinate to be on/off.
     \param x   x Coordinate
@@ -46,6 +52,14 @@ class ColorGraphicsDisplay
     */
     virtual void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) = 0;
 
+    /**
+    Sets the pixel at the specified coordinate to a color.
+    \param x     x Coordinate
+    \param y     y coordinate
+    \param color the color
+    */
+    virtual void DrawPixel(uint_fast8_t x, uint_fast8_t y, Rgb565 color) = 0;
+
     /**
     Set foreground color
     \param red   Red color
@@ -77,6 +91,14 @@ class ColorGraphicsDisplay
                           bool         on)
         = 0;
 
+    /** Draws a line in a color, see DrawLine() above */
+    virtual void DrawLine(uint_fast8_t x1,
+                          uint_fast8_t y1,
+                          uint_fast8_t x2,
+                          uint_fast8_t y2,
+                          Rgb565       color)
+        = 0;
+
     /**
     Draws a rectangle based on two coordinates.
     \param x1 x Coordinate of the first point
@@ -94,6 +116,15 @@ class ColorGraphicsDisplay
                           bool         fill = false)
         = 0;
 
+    /** Draws a rectangle in a color, see DrawRect() above */
+    virtual void DrawRect(uint_fast8_t x1,
+                          uint_fast8_t y1,
+                          uint_fast8_t x2,
+                          uint_fast8_t y2,
+                          Rgb565       color,
+                          bool         fill = false)
+        = 0;
+
     /**
     Draws a rectangle.
     \param rect the rectangle
@@ -110,6 +141,17 @@ class ColorGraphicsDisplay
                  fill);
     }
 
+    /** Draws a rectangle in a color, see DrawRect() above */
+    void DrawRect(const Rectangle& rect, Rgb565 color, bool fill = false)
+    {
+        DrawRect(rect.GetX(),
+                 rect.GetY(),
+                 rect.GetRight(),
+                 rect.GetBottom(),
+                 color,
+                 fill);
+    }
+
     /**
     Draws an arc around the specified coordinate
     \param x           x Coordinate of the center of the arc
@@ -127,6 +169,15 @@ class ColorGraphicsDisplay
                          bool         on)
         = 0;
 
+    /** Draws an arc in a color, see DrawArc() above */
+    virtual void DrawArc(uint_fast8_t x,
+                         uint_fast8_t y,
+                         uint_fast8_t radius,
+                         int_fast16_t start_angle,
+                         int_fast16_t sweep,
+                         Rgb565       color)
+        = 0;
+
     /**
     Draws a circle around the specified coordinate
     \param x           x Coordinate of the center of the circle
@@ -140,6 +191,15 @@ class ColorGraphicsDisplay
         DrawArc(x, y, radius, 0, 360, on);
     };
 
+    /** Draws a circle in a color, see DrawCircle() above */
+    void DrawCircle(uint_fast8_t x,
+                    uint_fast8_t y,
+                    uint_fast8_t radius,
+                    Rgb565       color)
+    {
+        DrawArc(x, y, radius, 0, 360, color);
+    };
+
     /** 
     Writes the character with the specific FontDef
     to the display buffer at the current Cursor position.
@@ -150,6 +210,18 @@ class ColorGraphicsDisplay
     */
     virtual char WriteChar(char ch, FontDef font, bool on) = 0;
 
+    /** 
+    Writes a character in a color, see WriteChar() above.
+    \param ch         character to be written
+    \param font       font to be written in
+    \param color      color of the character
+    \param background color of the rest of the character cell
+    \return &
+    */
+    virtual char
+    WriteChar(char ch, FontDef font, Rgb565 color, Rgb565 background)
+        = 0;
+
     /** 
     Similar to WriteChar, except it will handle an entire String.
     Wrapping does not happen automatically, so the width
@@ -161,6 +233,11 @@ class ColorGraphicsDisplay
     */
     virtual char WriteString(const char* str, FontDef font, bool on) = 0;
 
+    /** Writes a string in a color, see WriteString() and WriteChar() above */
+    virtual char
+    WriteString(const char* str, FontDef font, Rgb565 color, Rgb565 background)
+        = 0;
+
     /** 
     Similar to WriteString but justified within a bounding box.
     \param str          string to be written
@@ -177,6 +254,16 @@ class ColorGraphicsDisplay
                                          bool           on)
         = 0;
 
+    /** Writes an aligned string in a color, see WriteStringAligned() and
+     *  WriteChar() above */
+    virtual Rectangle WriteStringAligned(const char*    str,
+                                         const FontDef& font,
+                                         Rectangle      boundingBox,
+                                         Alignment      alignment,
+                                         Rgb565         color,
+                                         Rgb565         background)
+        = 0;
+
     /** 
     Moves the 'Cursor' position used for WriteChar, and WriteStr to the specified coordinate.
     \param x x pos
@@ -194,6 +281,12 @@ class ColorGraphicsDisplay
     */
     virtual void Update() = 0;
 
+    /** 
+    Returns true if the Update has finished, used for chained DMA transfers.
+    Displays that update synchronously don't need to override this.
+    */
+    virtual bool UpdateFinished() { return true; }
+
   protected:
     uint16_t currentX_;
     uint16_t currentY_;
@@ -202,7 +295,8 @@ class ColorGraphicsDisplay
 /** This class is intended as a intermediary class for your actual implementation of the ColorGraphicsDisplay
  *  interface. It uses the CRTP design pattern where the template argument is the child class. It provides 
  *  implementations for most of the functions, except DrawPixel(), SetColorFG(), SetColorBG, Update() and
- *  Fill(), which you'll have to provide in your child class.
+ *  Fill(), which you'll have to provide in your child class. DrawPixel() and Fill() come in two versions,
+ *  one for on/off (drawn in the foreground/background colors) and one for an Rgb565 color.
  *  The main goal of this class is to provide common drawing functions without relying on massive amounts of 
  *  virtual function calls that would result in a performance loss. To achieve this, any drawing function that
  *  is implemented here and internally calls other drawing functions (e.g. DrawRect() which internally calls
@@ -219,8 +313,10 @@ class ColorGraphicsDisplay
  *      class MyDisplayClass : public ColorGraphicsDisplayImpl<MyDisplayClass>
  *      {
  *      public:
- *          void Fill() override { ... };
+ *          void Fill(bool on) override { ... };
+ *          void Fill(Rgb565 color) override { ... };
  *          void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) override { ... };
+ *          void DrawPixel(uint_fast8_t x, uint_fast8_t y, Rgb565 color) override { ... };
  *          void Update() override { ... }
  *      };
  *  
@@ -232,11 +328,121 @@ class ColorGraphicsDisplayImpl : public ColorGraphicsDisplay
     ColorGraphicsDisplayImpl() {}
     virtual ~ColorGraphicsDisplayImpl() {}
 
+    using ColorGraphicsDisplay::DrawRect;
+
+    // Each drawing function comes in an on/off and in a color version. Both
+    // are implemented by the same template below, which passes either the
+    // bool or the Rgb565 on to the child's DrawPixel().
+
     void DrawLine(uint_fast8_t x1,
                   uint_fast8_t y1,
                   uint_fast8_t x2,
                   uint_fast8_t y2,
                   bool         on) override
+    {
+        Line(x1, y1, x2, y2, on);
+    }
+
+    void DrawLine(uint_fast8_t x1,
+                  uint_fast8_t y1,
+                  uint_fast8_t x2,
+                  uint_fast8_t y2,
+                  Rgb565       color) override
+    {
+        Line(x1, y1, x2, y2, color);
+    }
+
+    void DrawRect(uint_fast8_t x1,
+                  uint_fast8_t y1,
+                  uint_fast8_t x2,
+                  uint_fast8_t y2,
+                  bool         on,
+                  bool         fill = false) override
+    {
+        Rect(x1, y1, x2, y2, on, fill);
+    }
+
+    void DrawRect(uint_fast8_t x1,
+                  uint_fast8_t y1,
+                  uint_fast8_t x2,
+                  uint_fast8_t y2,
+                  Rgb565       color,
+                  bool         fill = false) override
+    {
+        Rect(x1, y1, x2, y2, color, fill);
+    }
+
+    void DrawArc(uint_fast8_t x,
+                 uint_fast8_t y,
+                 uint_fast8_t radius,
+                 int_fast16_t start_angle,
+                 int_fast16_t sweep,
+                 bool         on) override
+    {
+        Arc(x, y, radius, start_angle, sweep, on);
+    }
+
+    void DrawArc(uint_fast8_t x,
+                 uint_fast8_t y,
+                 uint_fast8_t radius,
+                 int_fast16_t start_angle,
+                 int_fast16_t sweep,
+                 Rgb565       color) override
+    {
+        Arc(x, y, radius, start_angle, sweep, color);
+    }
+
+    char WriteChar(char ch, FontDef font, bool on) override
+    {
+        return Char(ch, font, on, !on);
+    }
+
+    char
+    WriteChar(char ch, FontDef font, Rgb565 color, Rgb565 background) override
+    {
+        return Char(ch, font, color, background);
+    }
+
+    char WriteString(const char* str, FontDef font, bool on) override
+    {
+        return String(str, font, on, !on);
+    }
+
+    char WriteString(const char* str,
+                     FontDef     font,
+                     Rgb565      color,
+                     Rgb565      background) override
+    {
+        return String(str, font, color, background);
+    }
+
+    Rectangle WriteStringAligned(const char*    str,
+                                 const FontDef& font,
+                                 Rectangle      boundingBox,
+                                 Alignment      alignment,
+                                 bool           on) override
+    {
+        return StringAligned(str, font, boundingBox, alignment, on, !on);
+    }
+
+    Rectangle WriteStringAligned(const char*    str,
+                                 const FontDef& font,
+                                 Rectangle      boundingBox,
+                                 Alignment      alignment,
+                                 Rgb565         color,
+                                 Rgb565         background) override
+    {
+        return StringAligned(
+            str, font, boundingBox, alignment, color, background);
+    }
+
+  private:
+    template <typename ColorType>
+    void Line(uint_fast8_t x1,
+              uint_fast8_t y1,
+              uint_fast8_t x2,
+              uint_fast8_t y2,
+              ColorType    on)
     {
         int_fast16_t deltaX = abs((int_fast16_t)x2 - (int_fast16_t)x1);
         int_fast16_t deltaY = abs((int_fast16_t)y2 - (int_fast16_t)y1);
@@ -268,12 +474,13 @@ class ColorGraphicsDisplayImpl : public ColorGraphicsDisplay
         }
     }
 
-    void DrawRect(uint_fast8_t x1,
-                  uint_fast8_t y1,
-                  uint_fast8_t x2,
-                  uint_fast8_t y2,
-                  bool         on,
-                  bool         fill = false) override
+    template <typename ColorType>
+    void Rect(uint_fast8_t x1,
+              uint_fast8_t y1,
+              uint_fast8_t x2,
+              uint_fast8_t y2,
+              ColorType    on,
+              bool         fill)
     {
         if(fill)
         {
@@ -287,19 +494,20 @@ class ColorGraphicsDisplayImpl : public ColorGraphicsDisplay
         }
         else
         {
-            ((ChildType*)(this))->ChildType::DrawLine(x1, y1, x2, y1, on);
-            ((ChildType*)(this))->ChildType::DrawLine(x2, y1, x2, y2, on);
-            ((ChildType*)(this))->ChildType::DrawLine(x2, y2, x1, y2, on);
-            ((ChildType*)(this))->ChildType::DrawLine(x1, y2, x1, y1, on);
+            Line(x1, y1, x2, y1, on);
+            Line(x2, y1, x2, y2, on);
+            Line(x2, y2, x1, y2, on);
+            Line(x1, y2, x1, y1, on);
         }
     }
 
-    void DrawArc(uint_fast8_t x,
-                 uint_fast8_t y,
-                 uint_fast8_t radius,
-                 int_fast16_t start_angle,
-                 int_fast16_t sweep,
-                 bool         on) override
+    template <typename ColorType>
+    void Arc(uint_fast8_t x,
+             uint_fast8_t y,
+             uint_fast8_t radius,
+             int_fast16_t start_angle,
+             int_fast16_t sweep,
+             ColorType    on)
     {
         // Values to calculate the circle
         int_fast16_t t_x, t_y, err, e2;
@@ -407,7 +615,8 @@ class ColorGraphicsDisplayImpl : public ColorGraphicsDisplay
         } while(t_x <= 0);
     }
 
-    char WriteChar(char ch, FontDef font, bool on) override
+    template <typename ColorType>
+    char Char(char ch, FontDef font, ColorType on, ColorType off)
     {
         uint32_t i, b, j;
 
@@ -429,18 +638,10 @@ class ColorGraphicsDisplayImpl : public ColorGraphicsDisplay
             b = font.data[(ch - 32) * font.FontHeight + i];
             for(j = 0; j < font.FontWidth; j++)
             {
-                if((b << j) & 0x8000)
-                {
-                    ((ChildType*)(this))
-                        ->ChildType::DrawPixel(
-                            currentX_ + j, (currentY_ + i), on);
-                }
-                else
-                {
-                    ((ChildType*)(this))
-                        ->ChildType::DrawPixel(
-                            currentX_ + j, (currentY_ + i), !on);
-                }
+                ((ChildType*)(this))
+                    ->ChildType::DrawPixel(currentX_ + j,
+                                           (currentY_ + i),
+                                           ((b << j) & 0x8000) ? on : off);
             }
         }
 
@@ -451,13 +652,13 @@ class ColorGraphicsDisplayImpl : public ColorGraphicsDisplay
         return ch;
     }
 
-    char WriteString(const char* str, FontDef font, bool on) override
+    template <typename ColorType>
+    char String(const char* str, FontDef font, ColorType on, ColorType off)
     {
         // Write until null-byte
         while(*str)
         {
-            if(((ChildType*)(this))->ChildType::WriteChar(*str, font, on)
-               != *str)
+            if(Char(*str, font, on, off) != *str)
             {
                 // Char could not be written
                 return *str;
@@ -471,20 +672,21 @@ class ColorGraphicsDisplayImpl : public ColorGraphicsDisplay
         return *str;
     }
 
-    Rectangle WriteStringAligned(const char*    str,
-                                 const FontDef& font,
-                                 Rectangle      boundingBox,
-                                 Alignment      alignment,
-                                 bool           on) override
+    template <typename ColorType>
+    Rectangle StringAligned(const char*    str,
+                            const FontDef& font,
+                            Rectangle      boundingBox,
+                            Alignment      alignment,
+                            ColorType      on,
+                            ColorType      off)
     {
         const auto alignedRect
             = GetTextRect(str, font).AlignedWithin(boundingBox, alignment);
         SetCursor(alignedRect.GetX(), alignedRect.GetY());
-        ((ChildType*)(this))->ChildType::WriteString(str, font, on);
+        String(str, font, on, off);
         return alignedRect;
     }
 
-  private:
     uint32_t strlen(const char* string)
     {
         uint32_t result = 0;
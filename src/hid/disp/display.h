@@ -126,6 +126,36 @@ class OneBitGraphicsDisplay
         DrawArc(x, y, radius, 0, 360, on);
     };
 
+    /**
+    Draws a bitmap with its top left corner at (x, y). Pixels outside of
+    the display are clipped, so the bitmap may be partially off screen.
+    \param x           x Coordinate of the left column, can be negative
+    \param y           y Coordinate of the top row, can be negative
+    \param bitmap      the image
+    \param on          state of the set pixels; the others are drawn `!on`
+    \param transparent only draw the set pixels and leave the others
+    */
+    virtual void DrawBitmap(int_fast16_t        x,
+                            int_fast16_t        y,
+                            const OneBitBitmap& bitmap,
+                            bool                on          = true,
+                            bool                transparent = false)
+    {
+        for(int_fast16_t row = 0; row < bitmap.height; row++)
+        {
+            for(int_fast16_t column = 0; column < bitmap.width; column++)
+            {
+                const int_fast16_t px  = x + column;
+                const int_fast16_t py  = y + row;
+                const bool         set = bitmap.GetPixel(column, row);
+                if(px < 0 || py < 0 || px >= Width() || py >= Height()
+                   || (transparent && !set))
+                    continue;
+                DrawPixel(px, py, set ? on : !on);
+            }
+        }
+    }
+
     /** 
     Writes the character with the specific FontDef
     to the display buffer at the current Cursor position.
@@ -214,6 +244,32 @@ class OneBitGraphicsDisplay
  *          void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) override { ... };
  *          void Update() override { ... }
  *      };
+ *
+ *  The child class can optionally provide faster versions of the operations
+ *  that the drawing functions are built from. They are found at compile time
+ *  and used instead of DrawPixel() loops when they exist:
+ *
+ *      // draws `length` pixels to the right of (x, y)
+ *      void DrawHorizontalSpan(uint_fast8_t x, uint_fast8_t y, uint_fast16_t length, bool on);
+ *      // draws `length` pixels downwards from (x, y)
+ *      void DrawVerticalSpan(uint_fast8_t x, uint_fast8_t y, uint_fast16_t length, bool on);
+ *      // sets `count` (1..8) pixels downwards from (x, y); bit 0 of `bits` is (x, y)
+ *      void WriteColumnBits(uint_fast8_t x, uint_fast8_t y, uint8_t bits, uint_fast8_t count);
+ *      // WriteColumnBits() for `length` columns; set bits are drawn `on`, the others `!on`
+ *      void WriteColumnBytes(uint_fast8_t x, uint_fast8_t y, const uint8_t* bits,
+ *                            uint_fast16_t length, uint_fast8_t count, bool on);
+ *      // like WriteColumnBytes(), but only the set bits are drawn `on`
+ *      void DrawColumnBytes(uint_fast8_t x, uint_fast8_t y, const uint8_t* bits,
+ *                           uint_fast16_t length, uint_fast8_t count, bool on);
+ *
+ *  They must clip to the display bounds like DrawPixel(). Filled rectangles,
+ *  straight lines and rectangle outlines use the spans. WriteChar() blits
+ *  the glyphs with WriteColumnBytes() if the font has column bytes
+ *  (FontDef::columns), otherwise column by column. DrawBitmap() blits a
+ *  page of the bitmap at a time if the child has both column byte
+ *  operations. For displays with the
+ *  usual page layout (8 vertical pixels per byte) each of these calls is a
+ *  few byte operations instead of one read-modify-write per pixel.
  *  
  */
 template <class ChildType>
@@ -229,6 +285,18 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
                   uint_fast8_t y2,
                   bool         on) override
     {
+        // straight lines are spans
+        if(y1 == y2)
+        {
+            HorizontalSpan(Child(), min(x1, x2), y1, Distance(x1, x2), on, 0);
+            return;
+        }
+        if(x1 == x2)
+        {
+            VerticalSpan(Child(), x1, min(y1, y2), Distance(y1, y2), on, 0);
+            return;
+        }
+
         int_fast16_t deltaX = abs((int_fast16_t)x2 - (int_fast16_t)x1);
         int_fast16_t deltaY = abs((int_fast16_t)y2 - (int_fast16_t)y1);
         int_fast16_t signX  = ((x1 < x2) ? 1 : -1);
@@ -268,20 +336,22 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
     {
         if(fill)
         {
-            for(uint_fast8_t x = x1; x <= x2; x++)
-            {
-                for(uint_fast8_t y = y1; y <= y2; y++)
-                {
-                    ((ChildType*)(this))->ChildType::DrawPixel(x, y, on);
-                }
-            }
+            // an inverted rectangle draws nothing
+            if(x1 > x2 || y1 > y2)
+                return;
+            for(uint_fast16_t x = x1; x <= x2; x++)
+                VerticalSpan(Child(), x, y1, y2 - y1 + 1, on, 0);
         }
         else
         {
-            ((ChildType*)(this))->ChildType::DrawLine(x1, y1, x2, y1, on);
-            ((ChildType*)(this))->ChildType::DrawLine(x2, y1, x2, y2, on);
-            ((ChildType*)(this))->ChildType::DrawLine(x2, y2, x1, y2, on);
-            ((ChildType*)(this))->ChildType::DrawLine(x1, y2, x1, y1, on);
+            const uint_fast8_t  left   = min(x1, x2);
+            const uint_fast8_t  top    = min(y1, y2);
+            const uint_fast16_t width  = Distance(x1, x2);
+            const uint_fast16_t height = Distance(y1, y2);
+            HorizontalSpan(Child(), left, y1, width, on, 0);
+            HorizontalSpan(Child(), left, y2, width, on, 0);
+            VerticalSpan(Child(), x1, top, height, on, 0);
+            VerticalSpan(Child(), x2, top, height, on, 0);
         }
     }
 
@@ -400,8 +470,6 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
 
     char WriteChar(char ch, FontDef font, bool on) override
     {
-        uint32_t i, b, j;
-
         // Check if character is valid
         if(ch < 32 || ch > 126)
             return 0;
@@ -415,25 +483,7 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
         }
 
         // Use the font to write
-        for(i = 0; i < font.FontHeight; i++)
-        {
-            b = font.data[(ch - 32) * font.FontHeight + i];
-            for(j = 0; j < font.FontWidth; j++)
-            {
-                if((b << j) & 0x8000)
-                {
-                    ((ChildType*)(this))
-                        ->ChildType::DrawPixel(
-                            currentX_ + j, (currentY_ + i), on);
-                }
-                else
-                {
-                    ((ChildType*)(this))
-                        ->ChildType::DrawPixel(
-                            currentX_ + j, (currentY_ + i), !on);
-                }
-            }
-        }
+        WriteGlyph(Child(), ch - 32, font, on, 0);
 
         // The current space is now taken
         SetCursor(currentX_ + font.FontWidth, currentY_);
@@ -475,7 +525,280 @@ class OneBitGraphicsDisplayImpl : public OneBitGraphicsDisplay
         return alignedRect;
     }
 
+    void DrawBitmap(int_fast16_t        x,
+                    int_fast16_t        y,
+                    const OneBitBitmap& bitmap,
+                    bool                on          = true,
+                    bool                transparent = false) override
+    {
+        // the visible columns and rows of the bitmap
+        const int_fast16_t left  = (x < 0) ? -x : 0;
+        const int_fast16_t top   = (y < 0) ? -y : 0;
+        const int_fast16_t right = (x + bitmap.width > Width())
+                                       ? int_fast16_t(Width()) - x
+                                       : bitmap.width;
+        const int_fast16_t bottom = (y + bitmap.height > Height())
+                                        ? int_fast16_t(Height()) - y
+                                        : bitmap.height;
+        if(left >= right || top >= bottom)
+            return;
+        BlitBitmap(Child(),
+                   x,
+                   y,
+                   bitmap,
+                   Rectangle(left, top, right - left, bottom - top),
+                   on,
+                   transparent,
+                   0);
+    }
+
   private:
+    ChildType* Child() { return (ChildType*)(this); }
+
+    static uint_fast8_t min(uint_fast8_t a, uint_fast8_t b)
+    {
+        return (a < b) ? a : b;
+    }
+
+    /** Number of pixels from a to b, both included */
+    static uint_fast16_t Distance(uint_fast8_t a, uint_fast8_t b)
+    {
+        return (a < b) ? (b - a + 1) : (a - b + 1);
+    }
+
+    // The span operations below are overloaded on their last argument: the
+    // `int` version only exists if the child class provides the operation
+    // and is preferred for a literal 0; otherwise the `long` version draws
+    // the pixels one by one.
+
+    template <class T>
+    auto HorizontalSpan(T*            child,
+                        uint_fast8_t  x,
+                        uint_fast8_t  y,
+                        uint_fast16_t length,
+                        bool          on,
+                        int) -> decltype(child->T::DrawHorizontalSpan(x,
+                                                                      y,
+                                                                      length,
+                                                                      on))
+    {
+        return child->T::DrawHorizontalSpan(x, y, length, on);
+    }
+
+    template <class T>
+    void HorizontalSpan(T*            child,
+                        uint_fast8_t  x,
+                        uint_fast8_t  y,
+                        uint_fast16_t length,
+                        bool          on,
+                        long)
+    {
+        for(uint_fast16_t i = 0; i < length; i++)
+            child->T::DrawPixel(x + i, y, on);
+    }
+
+    template <class T>
+    auto VerticalSpan(T*            child,
+                      uint_fast8_t  x,
+                      uint_fast8_t  y,
+                      uint_fast16_t length,
+                      bool          on,
+                      int)
+        -> decltype(child->T::DrawVerticalSpan(x, y, length, on))
+    {
+        return child->T::DrawVerticalSpan(x, y, length, on);
+    }
+
+    template <class T>
+    void VerticalSpan(T*            child,
+                      uint_fast8_t  x,
+                      uint_fast8_t  y,
+                      uint_fast16_t length,
+                      bool          on,
+                      long)
+    {
+        for(uint_fast16_t i = 0; i < length; i++)
+            child->T::DrawPixel(x, y + i, on);
+    }
+
+    /** Blits a glyph a page row at a time from the column bytes of the
+     *  font, if it has them
+     */
+    template <class T>
+    auto WriteGlyph(T*             child,
+                    uint_fast8_t   glyph,
+                    const FontDef& font,
+                    bool           on,
+                    int) -> decltype(child->T::WriteColumnBytes(0,
+                                                                0,
+                                                                nullptr,
+                                                                0,
+                                                                0,
+                                                                on))
+    {
+        if(font.columns == nullptr)
+            return WriteGlyphColumns(child, glyph, font, on, 0);
+
+        const uint_fast8_t pages = (font.FontHeight + 7) / 8;
+        const uint8_t*     column
+            = &font.columns[glyph * pages * font.FontWidth];
+        for(uint_fast8_t i = 0; i < font.FontHeight; i += 8)
+        {
+            const uint_fast8_t count
+                = (font.FontHeight - i < 8) ? font.FontHeight - i : 8;
+            child->T::WriteColumnBytes(
+                currentX_, currentY_ + i, column, font.FontWidth, count, on);
+            column += font.FontWidth;
+        }
+    }
+
+    template <class T>
+    void WriteGlyph(T*             child,
+                    uint_fast8_t   glyph,
+                    const FontDef& font,
+                    bool           on,
+                    long)
+    {
+        WriteGlyphColumns(child, glyph, font, on, 0);
+    }
+
+    /** Blits a glyph column by column, 8 rows at a time */
+    template <class T>
+    auto WriteGlyphColumns(T*             child,
+                           uint_fast8_t   glyph,
+                           const FontDef& font,
+                           bool           on,
+                           int)
+        -> decltype(child->T::WriteColumnBits(0, 0, 0, 0))
+    {
+        const uint_fast8_t pages = (font.FontHeight + 7) / 8;
+        const uint16_t*    rows  = &font.data[glyph * font.FontHeight];
+        const uint8_t*     atlas = font.columns;
+        for(uint_fast8_t j = 0; j < font.FontWidth; j++)
+        {
+            for(uint_fast8_t i = 0; i < font.FontHeight; i += 8)
+            {
+                const uint_fast8_t count
+                    = (font.FontHeight - i < 8) ? font.FontHeight - i : 8;
+                uint_fast8_t bits = 0;
+                if(atlas != nullptr)
+                {
+                    bits = atlas[(glyph * pages + i / 8) * font.FontWidth + j];
+                }
+                else
+                {
+                    // transpose the rows
+                    for(uint_fast8_t k = 0; k < count; k++)
+                    {
+                        if((rows[i + k] << j) & 0x8000)
+                            bits |= 1 << k;
+                    }
+                }
+                if(!on)
+                    bits = ~bits;
+                child->T::WriteColumnBits(
+                    currentX_ + j, currentY_ + i, bits, count);
+            }
+        }
+    }
+
+    template <class T>
+    void WriteGlyphColumns(T*             child,
+                           uint_fast8_t   glyph,
+                           const FontDef& font,
+                           bool           on,
+                           long)
+    {
+        const uint16_t* rows = &font.data[glyph * font.FontHeight];
+        for(uint_fast8_t i = 0; i < font.FontHeight; i++)
+        {
+            const uint32_t b = rows[i];
+            for(uint_fast8_t j = 0; j < font.FontWidth; j++)
+            {
+                const bool set = (b << j) & 0x8000;
+                child->T::DrawPixel(
+                    currentX_ + j, currentY_ + i, set ? on : !on);
+            }
+        }
+    }
+
+    /** Blits the visible part of a bitmap a page row at a time. Only a
+     *  bitmap that starts above the display needs its first page shifted
+     *  up; the others are passed straight from the bitmap data.
+     */
+    template <class T>
+    auto BlitBitmap(T*                  child,
+                    int_fast16_t        x,
+                    int_fast16_t        y,
+                    const OneBitBitmap& bitmap,
+                    const Rectangle&    visible,
+                    bool                on,
+                    bool                transparent,
+                    int)
+        -> decltype(child->T::WriteColumnBytes(0, 0, nullptr, 0, 0, on),
+                    child->T::DrawColumnBytes(0, 0, nullptr, 0, 0, on),
+                    void())
+    {
+        const int_fast16_t length = visible.GetWidth();
+        const int_fast16_t bottom = visible.GetBottom();
+        for(int_fast16_t row = visible.GetY(); row < bottom;)
+        {
+            const int_fast16_t skip  = row % 8;
+            const int_fast16_t count = (bottom - row < 8 - skip)
+                                           ? bottom - row
+                                           : 8 - skip;
+            const uint8_t*     bits
+                = &bitmap.data[(row / 8) * bitmap.width + visible.GetX()];
+            for(int_fast16_t i = 0; i < length;)
+            {
+                uint8_t             shifted[32];
+                const uint8_t*      source = &bits[i];
+                const uint_fast16_t chunk
+                    = skip == 0 ? length - i
+                                : (length - i < 32 ? length - i : 32);
+                if(skip != 0)
+                {
+                    for(uint_fast16_t j = 0; j < chunk; j++)
+                        shifted[j] = source[j] >> skip;
+                    source = shifted;
+                }
+                const uint_fast8_t dx = x + visible.GetX() + i;
+                const uint_fast8_t dy = y + row;
+                if(transparent)
+                    child->T::DrawColumnBytes(
+                        dx, dy, source, chunk, count, on);
+                else
+                    child->T::WriteColumnBytes(
+                        dx, dy, source, chunk, count, on);
+                i += chunk;
+            }
+            row += count;
+        }
+    }
+
+    template <class T>
+    void BlitBitmap(T*                  child,
+                    int_fast16_t        x,
+                    int_fast16_t        y,
+                    const OneBitBitmap& bitmap,
+                    const Rectangle&    visible,
+                    bool                on,
+                    bool                transparent,
+                    long)
+    {
+        for(int_fast16_t row = visible.GetY(); row < visible.GetBottom(); row++)
+        {
+            for(int_fast16_t column = visible.GetX();
+                column < visible.GetRight();
+                column++)
+            {
+                const bool set = bitmap.GetPixel(column, row);
+                if(set || !transparent)
+                    child->T::DrawPixel(x + column, y + row, set ? on : !on);
+            }
+        }
+    }
+
     uint32_t strlen(const char* string)
     {
         uint32_t result = 0;
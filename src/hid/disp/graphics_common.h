@@ -18,6 +18,58 @@ enum class Alignment
     centeredRight
 };
 
+/** A 16 bit color with 5 bits of red, 6 bits of green and 5 bits of blue,
+ *  the native format of color OLED and TFT displays.
+ */
+class Rgb565
+{
+  public:
+    constexpr Rgb565() : value_(0) {}
+    constexpr explicit Rgb565(uint16_t value) : value_(value) {}
+
+    /** Creates a color from 5 bit red, 6 bit green and 5 bit blue */
+    static constexpr Rgb565 FromComponents(uint8_t red,
+                                           uint8_t green,
+                                           uint8_t blue)
+    {
+        return Rgb565(uint16_t(((red & 0x1f) << 11) | ((green & 0x3f) << 5)
+                               | (blue & 0x1f)));
+    }
+
+    /** Creates a color from 8 bit red, green and blue */
+    static constexpr Rgb565
+    FromRgb888(uint8_t red, uint8_t green, uint8_t blue)
+    {
+        return FromComponents(red >> 3, green >> 2, blue >> 3);
+    }
+
+    constexpr uint16_t GetValue() const { return value_; }
+    constexpr uint8_t  GetRed() const { return value_ >> 11; }
+    constexpr uint8_t  GetGreen() const { return (value_ >> 5) & 0x3f; }
+    constexpr uint8_t  GetBlue() const { return value_ & 0x1f; }
+
+    /** The brightness from 0 to 15, for grayscale displays */
+    constexpr uint8_t GetGray4() const
+    {
+        // Rec. 601 luma weights on the 6 bit scale, out of 256
+        return ((GetRed() * 2 * 77) + (GetGreen() * 150)
+                + (GetBlue() * 2 * 29))
+               >> 10;
+    }
+
+    constexpr bool operator==(const Rgb565& other) const
+    {
+        return value_ == other.value_;
+    }
+    constexpr bool operator!=(const Rgb565& other) const
+    {
+        return value_ != other.value_;
+    }
+
+  private:
+    uint16_t value_;
+};
+
 class Rectangle
 {
   public:
@@ -262,4 +314,30 @@ class Rectangle
     int16_t min(int16_t a, int16_t b) { return (a < b) ? a : b; }
 };
 
+/** A 1 bit per pixel image, packed like the RAM of the SSD130x displays:
+ *  one byte per column for each page of 8 rows, bit 0 being the top row of
+ *  the page, pages stored top to bottom. The pixels are only referenced, so
+ *  a bitmap made from `const` arrays stays in flash:
+ *
+ *      static const uint8_t    icon_data[] = {0x3c, 0x42, ...};
+ *      static const OneBitBitmap icon      = {8, 8, icon_data};
+ *
+ *  ci/generate_bitmap.py converts PBM images into this format.
+ */
+struct OneBitBitmap
+{
+    uint16_t       width;
+    uint16_t       height;
+    const uint8_t* data; /**< ((height + 7) / 8) * width bytes */
+
+    /** Returns the number of 8 pixel rows */
+    uint16_t GetNumPages() const { return (height + 7) / 8; }
+
+    /** Returns true if the pixel at (x, y) is set */
+    bool GetPixel(uint16_t x, uint16_t y) const
+    {
+        return (data[(y / 8) * width + x] >> (y % 8)) & 1;
+    }
+};
+
 } // namespace daisy
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <utility>
 #include "color_display.h"
 
 namespace daisy
@@ -42,6 +43,35 @@ class OledColorDisplay
         driver_.DrawPixel(x, y, on);
     }
 
+    /**
+    Fills the entire display with a color.
+    \param color The color
+    */
+    void Fill(Rgb565 color) override { driver_.Fill(color); }
+
+    /**
+    Sets the pixel at the specified coordinate to a color.
+    \param x     x Coordinate
+    \param y     y coordinate
+    \param color The color
+    */
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, Rgb565 color) override
+    {
+        driver_.DrawPixel(x, y, color);
+    }
+
+    /**
+    Draws and sends a frame with drivers that render in tiles, like
+    SSD1351TiledDriver. Only available with those drivers.
+    \param draw Draws the frame with this display, called once per tile
+    */
+    template <typename DrawFunction, typename Driver = DisplayDriver>
+    auto Render(DrawFunction&& draw)
+        -> decltype(std::declval<Driver&>().Render(draw))
+    {
+        return driver_.Render(draw);
+    }
+
     /**
     Set foreground color
     \param red   Red color
@@ -70,6 +100,8 @@ class OledColorDisplay
     */
     void Update() override { driver_.Update(); }
 
+    bool UpdateFinished() override { return driver_.UpdateFinished(); }
+
   private:
     DisplayDriver driver_;
 
@@ -2,6 +2,7 @@
 #ifndef DSY_OLED_DISPLAY_H
 #define DSY_OLED_DISPLAY_H /**< Macro */
 
+#include <utility>
 #include "display.h"
 
 namespace daisy
@@ -44,6 +45,82 @@ class OledDisplay : public OneBitGraphicsDisplayImpl<OledDisplay<DisplayDriver>>
         driver_.DrawPixel(x, y, on);
     }
 
+    // The span operations of OneBitGraphicsDisplayImpl, forwarded if the
+    // driver provides them.
+
+    template <typename Driver = DisplayDriver>
+    auto DrawHorizontalSpan(uint_fast8_t  x,
+                            uint_fast8_t  y,
+                            uint_fast16_t length,
+                            bool          on)
+        -> decltype(std::declval<Driver&>().DrawHorizontalSpan(x,
+                                                               y,
+                                                               length,
+                                                               on))
+    {
+        return driver_.DrawHorizontalSpan(x, y, length, on);
+    }
+
+    template <typename Driver = DisplayDriver>
+    auto DrawVerticalSpan(uint_fast8_t  x,
+                          uint_fast8_t  y,
+                          uint_fast16_t length,
+                          bool          on)
+        -> decltype(std::declval<Driver&>().DrawVerticalSpan(x,
+                                                             y,
+                                                             length,
+                                                             on))
+    {
+        return driver_.DrawVerticalSpan(x, y, length, on);
+    }
+
+    template <typename Driver = DisplayDriver>
+    auto WriteColumnBits(uint_fast8_t x,
+                         uint_fast8_t y,
+                         uint8_t      bits,
+                         uint_fast8_t count)
+        -> decltype(std::declval<Driver&>().WriteColumnBits(x,
+                                                            y,
+                                                            bits,
+                                                            count))
+    {
+        return driver_.WriteColumnBits(x, y, bits, count);
+    }
+
+    template <typename Driver = DisplayDriver>
+    auto WriteColumnBytes(uint_fast8_t   x,
+                          uint_fast8_t   y,
+                          const uint8_t* bits,
+                          uint_fast16_t  length,
+                          uint_fast8_t   count,
+                          bool           on)
+        -> decltype(std::declval<Driver&>().WriteColumnBytes(x,
+                                                             y,
+                                                             bits,
+                                                             length,
+                                                             count,
+                                                             on))
+    {
+        return driver_.WriteColumnBytes(x, y, bits, length, count, on);
+    }
+
+    template <typename Driver = DisplayDriver>
+    auto DrawColumnBytes(uint_fast8_t   x,
+                         uint_fast8_t   y,
+                         const uint8_t* bits,
+                         uint_fast16_t  length,
+                         uint_fast8_t   count,
+                         bool           on)
+        -> decltype(std::declval<Driver&>().DrawColumnBytes(x,
+                                                            y,
+                                                            bits,
+                                                            length,
+                                                            count,
+                                                            on))
+    {
+        return driver_.DrawColumnBytes(x, y, bits, length, count, on);
+    }
+
     /** 
     Writes the current display buffer to the OLED device using SPI or I2C depending on 
     how the object was initialized.
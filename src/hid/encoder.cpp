@@ -13,8 +13,10 @@ void Encoder::Init(Pin a, Pin b, Pin click, float update_rate)
     // Default Initialization for Switch
     sw_.Init(click);
     // Set initial states, etc.
-    inc_ = 0;
+    inc_       = 0;
+    accel_inc_ = 0;
     a_ = b_ = 0xff;
+    acceleration_.Init();
 }
 
 void Encoder::Debounce()
@@ -29,19 +31,7 @@ void Encoder::Debounce()
         updated_     = true;
 
         // Shift Button states to debounce
-        a_ = (a_ << 1) | hw_a_.Read();
-        b_ = (b_ << 1) | hw_b_.Read();
-
-        // infer increment direction
-        inc_ = 0; // reset inc_ first
-        if((a_ & 0x03) == 0x02 && (b_ & 0x03) == 0x00)
-        {
-            inc_ = 1;
-        }
-        else if((b_ & 0x03) == 0x02 && (a_ & 0x03) == 0x00)
-        {
-            inc_ = -1;
-        }
+        Decode(hw_a_.Read(), hw_b_.Read());
     }
 
     // Debounce built-in switch
@@ -7,6 +7,109 @@
 
 namespace daisy
 {
+/**
+    @brief Turns the steps of an encoder into accelerated increments \n
+    Measures the time between steps to track the speed of the encoder in
+    steps per second. Slow turns give one increment per step; above a
+    threshold speed, each step is multiplied with a gain that grows with
+    the speed, so that a quick spin sweeps a whole parameter range. The
+    fractions of increments are carried over to the next step, so every
+    step moves at least one increment. Turning back or pausing resets the
+    speed.
+    @ingroup controls
+*/
+class EncoderAcceleration
+{
+  public:
+    EncoderAcceleration() {}
+    ~EncoderAcceleration() {}
+
+    /** Sets up the acceleration curve and resets the speed
+    \param threshold   the speed in steps/s above which turns are accelerated
+    \param sensitivity how much the gain grows per step/s above the threshold
+    \param max_gain    the highest number of increments per step
+    */
+    void Init(float threshold   = 10.0f,
+              float sensitivity = 0.1f,
+              float max_gain    = 8.0f)
+    {
+        threshold_   = threshold;
+        sensitivity_ = sensitivity;
+        max_gain_    = max_gain < 1.0f ? 1.0f : max_gain;
+        Reset();
+    }
+
+    /** Forgets the speed and the fractions of increments */
+    void Reset()
+    {
+        velocity_  = 0.0f;
+        remainder_ = 0.0f;
+        direction_ = 0;
+    }
+
+    /** Adds steps of the encoder
+    \param steps  the steps, e.g. Encoder::Increment()
+    \param now_us the time of the steps in microseconds, e.g. System::GetUs()
+    \return the accelerated increment
+    */
+    int32_t Process(int32_t steps, uint32_t now_us)
+    {
+        if(steps == 0)
+            return 0;
+        const int32_t  direction = steps > 0 ? 1 : -1;
+        const uint32_t interval  = now_us - last_step_us_;
+        if(direction != direction_ || interval >= kTimeoutUs)
+        {
+            // starting again, or turning back to fine tune
+            velocity_  = 0.0f;
+            remainder_ = 0.0f;
+        }
+        else
+        {
+            const float speed = float(steps * direction) * 1e6f
+                                / float(interval > 0 ? interval : 1);
+            velocity_ = velocity_ > 0.0f ? 0.5f * (velocity_ + speed) : speed;
+        }
+        direction_    = direction;
+        last_step_us_ = now_us;
+
+        remainder_ += float(steps) * GetGain();
+        const int32_t increment = int32_t(remainder_);
+        remainder_ -= float(increment);
+        return increment;
+    }
+
+    /** \return the number of increments per step at the current speed */
+    float GetGain() const
+    {
+        const float gain = 1.0f + sensitivity_ * (velocity_ - threshold_);
+        return gain < 1.0f ? 1.0f : (gain > max_gain_ ? max_gain_ : gain);
+    }
+
+    /** \return the speed in steps/s, negative when turning backwards, or 0
+     *  if there was no step for a while
+     *  \param now_us the current time in microseconds
+     */
+    float GetVelocity(uint32_t now_us) const
+    {
+        if(direction_ == 0 || now_us - last_step_us_ >= kTimeoutUs)
+            return 0.0f;
+        return velocity_ * float(direction_);
+    }
+
+  private:
+    /** a pause after which the next step starts slow again */
+    static constexpr uint32_t kTimeoutUs = 200000;
+
+    float    threshold_    = 10.0f;
+    float    sensitivity_  = 0.1f;
+    float    max_gain_     = 8.0f;
+    float    velocity_     = 0.0f;
+    float    remainder_    = 0.0f;
+    uint32_t last_step_us_ = 0;
+    int32_t  direction_    = 0;
+};
+
 /** 
     @brief Generic Class for handling Quadrature Encoders \n 
     Inspired/influenced by Mutable Instruments (pichenettes) Encoder classes
@@ -29,9 +132,49 @@ class Encoder
      */
     void Debounce();
 
+    /** Updates the encoder from pin states that were read elsewhere, e.g. by
+     *  a PortDebouncer, instead of reading its pins. Call this once per
+     *  update instead of Debounce(). The quadrature signals should not be
+     *  debounced, or fast turns will be missed.
+     *  \param a     the level of pin A, true = high
+     *  \param b     the level of pin B, true = high
+     *  \param click the debounced state of the switch, true while pressed
+     */
+    inline void Update(bool a, bool b, bool click)
+    {
+        updated_ = true;
+        Decode(a, b);
+        sw_.Update(click);
+    }
+
     /** Returns +1 if the encoder was turned clockwise, -1 if it was turned counter-clockwise, or 0 if it was not just turned. */
     inline int32_t Increment() const { return updated_ ? inc_ : 0; }
 
+    /** Returns the increment with the acceleration curve applied: +1/-1 for
+     *  slow turns, more when the encoder is spun fast, 0 if it was not just
+     *  turned. Pass this to UiEventQueue::AddEncoderTurned() for faster
+     *  sweeps through long menus and parameter ranges.
+     */
+    inline int32_t AcceleratedIncrement() const
+    {
+        return updated_ ? accel_inc_ : 0;
+    }
+
+    /** Returns the speed in steps per second, negative when turned
+     *  counter-clockwise, or 0 if the encoder stopped.
+     */
+    inline float Velocity() const
+    {
+        return acceleration_.GetVelocity(System::GetUs());
+    }
+
+    /** Sets up the acceleration curve, see EncoderAcceleration::Init() */
+    inline void
+    SetAcceleration(float threshold, float sensitivity, float max_gain)
+    {
+        acceleration_.Init(threshold, sensitivity, max_gain);
+    }
+
     /** Returns true if the encoder was just pressed. */
     inline bool RisingEdge() const { return sw_.RisingEdge(); }
 
@@ -47,15 +190,40 @@ class Encoder
     /** To be removed in breaking update
      * \param update_rate Does nothing
     */
-    inline void SetUpdateRate(float update_rate) {}
+    inline void SetUpdateRate(float /* update_rate */) {}
 
   private:
+    /** Shifts in new levels of the pins and infers the increment */
+    inline void Decode(bool a, bool b)
+    {
+        a_ = (a_ << 1) | a;
+        b_ = (b_ << 1) | b;
+
+        // infer increment direction
+        inc_ = 0; // reset inc_ first
+        if((a_ & 0x03) == 0x02 && (b_ & 0x03) == 0x00)
+        {
+            inc_ = 1;
+        }
+        else if((b_ & 0x03) == 0x02 && (a_ & 0x03) == 0x00)
+        {
+            inc_ = -1;
+        }
+
+        // the time of the step only matters when there is one
+        accel_inc_
+            = inc_ != 0 ? acceleration_.Process(inc_, System::GetUs()) : 0;
+    }
+
     uint32_t last_update_;
-    bool     updated_;
+    bool     updated_ = false;
     Switch   sw_;
     GPIO     hw_a_, hw_b_;
-    uint8_t  a_, b_;
-    int32_t  inc_;
+    uint8_t  a_   = 0xff, b_ = 0xff;
+    int32_t  inc_ = 0;
+
+    EncoderAcceleration acceleration_;
+    int32_t             accel_inc_ = 0;
 };
 } // namespace daisy
 #endif
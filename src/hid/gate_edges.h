@@ -0,0 +1,308 @@
+#pragma once
+#ifndef DSY_GATE_EDGES_H
+#define DSY_GATE_EDGES_H
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace daisy
+{
+/** An edge of a gate signal */
+struct GateEdge
+{
+    /** When the edge happened, in microseconds, e.g. System::GetUs() */
+    uint32_t time_us;
+    /** True if the gate opened, false if it closed */
+    bool rising;
+};
+
+/**
+    @brief A lock-free queue for the edges of a gate input \n
+    Passes timestamped edges from an interrupt (the single writer) to the
+    audio callback (the single reader) without blocking either. When the
+    queue is full, new edges are dropped and counted.
+    \tparam capacity the number of edges the queue can hold
+    @ingroup controls
+*/
+template <size_t capacity>
+class GateEdgeQueue
+{
+  public:
+    GateEdgeQueue() {}
+    ~GateEdgeQueue() {}
+
+    /** Removes all edges */
+    void Init()
+    {
+        read_    = 0;
+        write_   = 0;
+        dropped_ = 0;
+    }
+
+    /** Adds an edge, from the interrupt
+    \return false if the queue is full and the edge was dropped
+    */
+    bool Push(const GateEdge& edge)
+    {
+        const size_t w    = write_;
+        const size_t next = (w + 1) % kSize;
+        if(next == read_)
+        {
+            dropped_ = dropped_ + 1;
+            return false;
+        }
+        buffer_[w] = edge;
+        // the edge must be in the buffer before the reader can see it
+        std::atomic_signal_fence(std::memory_order_release);
+        write_ = next;
+        return true;
+    }
+
+    /** Reads the oldest edge without removing it
+    \return false if the queue is empty
+    */
+    bool Peek(GateEdge& edge) const
+    {
+        const size_t r = read_;
+        if(r == write_)
+            return false;
+        std::atomic_signal_fence(std::memory_order_acquire);
+        edge = buffer_[r];
+        return true;
+    }
+
+    /** Removes the oldest edge
+    \return false if the queue is empty
+    */
+    bool Pop(GateEdge& edge)
+    {
+        if(!Peek(edge))
+            return false;
+        std::atomic_signal_fence(std::memory_order_release);
+        read_ = (read_ + 1) % kSize;
+        return true;
+    }
+
+    /** \return the number of edges in the queue */
+    inline size_t GetNumEdges() const
+    {
+        return (write_ + kSize - read_) % kSize;
+    }
+
+    /** \return true if there are no edges in the queue */
+    inline bool IsEmpty() const { return read_ == write_; }
+
+    /** \return the number of edges that were dropped because the queue was
+     *  full
+     */
+    inline uint32_t GetNumDropped() const { return dropped_; }
+
+  private:
+    // one slot stays free to tell a full queue from an empty one
+    static constexpr size_t kSize = capacity + 1;
+
+    GateEdge          buffer_[kSize];
+    volatile size_t   read_    = 0;
+    volatile size_t   write_   = 0;
+    volatile uint32_t dropped_ = 0;
+};
+
+/**
+    @brief Places timestamped gate edges in the frames of an audio block \n
+    Polling a gate input once per audio block quantizes its edges to the
+    block length, e.g. 5.3 ms at 256 frames and 48 kHz. When the edges are
+    timestamped by an interrupt instead (see GateIn::InitInterrupt()), this
+    maps them to frame offsets in the block being rendered. The block
+    covers the time between the previous and the current callback, so every
+    edge is delayed by the same block length instead of by a varying amount.
+
+    It also estimates the period of a clock from the time between rising
+    edges, smoothing small deviations and following larger ones once two
+    similar intervals in a row confirm them.
+
+        // at the start of the audio callback
+        tracker.Process(gate.GetEdgeQueue(), System::GetUs());
+        for(size_t i = 0; i < tracker.GetNumEdges(); i++)
+        {
+            const GateEdgeTracker::BlockEdge& edge = tracker.GetEdge(i);
+            if(edge.rising)
+                sequencer.TriggerAt(edge.offset);
+        }
+
+    @ingroup controls
+*/
+class GateEdgeTracker
+{
+  public:
+    /** The most edges that can be placed in one block */
+    static constexpr size_t kMaxEdgesPerBlock = 16;
+
+    /** An edge in an audio block */
+    struct BlockEdge
+    {
+        /** The frame of the block at which the edge happened */
+        size_t offset;
+        /** True if the gate opened, false if it closed */
+        bool rising;
+    };
+
+    GateEdgeTracker() {}
+    ~GateEdgeTracker() {}
+
+    /** Initializes the tracker
+    \param samplerate    the audio sample rate in Hz
+    \param block_size    the number of frames per audio block
+    \param max_deviation the relative deviation from the period above which
+                         an interval counts as a change of tempo
+    \param timeout_us    the time without rising edges after which the
+                         clock counts as stopped
+    */
+    void Init(float    samplerate,
+              size_t   block_size,
+              float    max_deviation = 0.2f,
+              uint32_t timeout_us    = 2000000)
+    {
+        block_size_    = block_size;
+        frames_per_us_ = samplerate * 1e-6f;
+        block_us_      = float(block_size) / frames_per_us_;
+        max_deviation_ = max_deviation;
+        timeout_us_    = timeout_us;
+        num_edges_     = 0;
+        state_         = false;
+        has_last_rise_ = false;
+        has_candidate_ = false;
+        period_us_     = 0.0f;
+    }
+
+    /** Takes the edges up to now from a queue and places them in the block.
+    Edges that came in after now stay in the queue for the next block.
+    \param queue  the edges of a gate input
+    \param now_us the time of the start of the audio callback
+    \return the number of edges in the block
+    */
+    template <size_t capacity>
+    size_t Process(GateEdgeQueue<capacity>& queue, uint32_t now_us)
+    {
+        num_edges_ = 0;
+        GateEdge edge;
+        while(queue.Peek(edge))
+        {
+            const int32_t age = int32_t(now_us - edge.time_us);
+            if(age < 0)
+                break;
+            queue.Pop(edge);
+            AddEdge(edge, uint32_t(age));
+        }
+        if(has_last_rise_ && now_us - last_rise_us_ > timeout_us_)
+        {
+            has_last_rise_ = false;
+            period_us_     = 0.0f;
+        }
+        return num_edges_;
+    }
+
+    /** \return the number of edges in the block */
+    inline size_t GetNumEdges() const { return num_edges_; }
+
+    /** \return an edge of the block, in order of time */
+    inline const BlockEdge& GetEdge(size_t idx) const { return edges_[idx]; }
+
+    /** \return true if the gate is open at the end of the block */
+    inline bool State() const { return state_; }
+
+    /** \return the estimated clock period in microseconds, or 0 before the
+     *  second rising edge and after a timeout
+     */
+    inline float GetPeriodUs() const { return period_us_; }
+
+    /** \return the estimated clock period in frames, or 0 */
+    inline float GetPeriodFrames() const
+    {
+        return period_us_ * frames_per_us_;
+    }
+
+    /** \return the estimated clock frequency in Hz, or 0 */
+    inline float GetFrequency() const
+    {
+        return period_us_ > 0.0f ? 1e6f / period_us_ : 0.0f;
+    }
+
+  private:
+    void AddEdge(const GateEdge& edge, uint32_t age_us)
+    {
+        state_ = edge.rising;
+        if(edge.rising)
+            UpdatePeriod(edge.time_us);
+        if(num_edges_ >= kMaxEdgesPerBlock)
+            return;
+
+        // the block covers the time from block_us_ ago until now; late
+        // edges go to the first frame
+        const float position = (block_us_ - float(age_us)) * frames_per_us_;
+        size_t      offset   = position > 0.0f ? size_t(position) : 0;
+        if(offset >= block_size_)
+            offset = block_size_ - 1;
+        edges_[num_edges_].offset = offset;
+        edges_[num_edges_].rising = edge.rising;
+        num_edges_++;
+    }
+
+    void UpdatePeriod(uint32_t time_us)
+    {
+        const uint32_t interval = time_us - last_rise_us_;
+        const bool     valid    = has_last_rise_ && interval <= timeout_us_;
+        last_rise_us_           = time_us;
+        has_last_rise_          = true;
+        if(!valid)
+            return;
+
+        const float delta = float(interval) - period_us_;
+        if(period_us_ <= 0.0f)
+        {
+            period_us_ = float(interval);
+        }
+        else if(!IsClose(float(interval), period_us_))
+        {
+            // one odd interval is a glitch, two similar ones are a new tempo
+            if(has_candidate_ && IsClose(float(interval), candidate_us_))
+            {
+                period_us_     = float(interval);
+                has_candidate_ = false;
+            }
+            else
+            {
+                candidate_us_  = float(interval);
+                has_candidate_ = true;
+            }
+        }
+        else
+        {
+            period_us_ += 0.25f * delta;
+            has_candidate_ = false;
+        }
+    }
+
+    inline bool IsClose(float interval, float reference) const
+    {
+        const float delta = interval - reference;
+        return delta <= max_deviation_ * reference
+               && delta >= -max_deviation_ * reference;
+    }
+
+    BlockEdge edges_[kMaxEdgesPerBlock];
+    size_t    num_edges_     = 0;
+    size_t    block_size_    = 1;
+    float     frames_per_us_ = 0.048f;
+    float     block_us_      = 0.0f;
+    float     max_deviation_ = 0.2f;
+    uint32_t  timeout_us_    = 2000000;
+    uint32_t  last_rise_us_  = 0;
+    bool      has_last_rise_ = false;
+    bool      state_         = false;
+    bool      has_candidate_ = false;
+    float     candidate_us_  = 0.0f;
+    float     period_us_     = 0.0f;
+};
+
+} // namespace daisy
+#endif
@@ -2,6 +2,7 @@
 #ifndef DSY_GATEIN_H
 #define DSY_GATEIN_H
 #include "per/gpio.h"
+#include "hid/gate_edges.h"
 
 namespace daisy
 {
@@ -41,10 +42,44 @@ class GateIn
      */
     inline bool State() { return invert_ ? !pin_.Read() : pin_.Read(); }
 
+    /** @brief Initializes the gate input, and timestamps its edges with an
+     *  interrupt
+     *
+     *  Each edge is added to the edge queue with the time of the interrupt,
+     *  so that the audio callback can place it within its block with a
+     *  GateEdgeTracker. Trig() and State() keep working.
+     *
+     *  @param pin the pin, which must not share its EXTI line (the pin
+     *         number) with another interrupt driven GateIn
+     *  @param invert see Init()
+     *  @return false if the EXTI line of the pin is taken
+     */
+    bool InitInterrupt(Pin pin, bool invert = true);
+
+    /** Adds an edge to the queue, if the state has changed. Called by the
+     *  interrupt of the pin.
+     *  @param time_us the time of the edge, from System::GetUs()
+     */
+    void OnEdge(uint32_t time_us)
+    {
+        const bool state = State();
+        if(state == edge_state_)
+            return;
+        edge_state_ = state;
+        edges_.Push({time_us, state});
+    }
+
+    /** @return the timestamped edges, for inputs initialized with
+     *  InitInterrupt()
+     */
+    inline GateEdgeQueue<16>& GetEdgeQueue() { return edges_; }
+
   private:
-    GPIO pin_;
-    bool prev_state_, state_;
-    bool invert_;
+    GPIO              pin_;
+    bool              prev_state_, state_;
+    bool              invert_;
+    volatile bool     edge_state_ = false;
+    GateEdgeQueue<16> edges_;
 };
 } // namespace daisy
 #endif
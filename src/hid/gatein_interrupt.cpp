@@ -0,0 +1,82 @@
+#include "hid/gatein.h"
+#include "sys/system.h"
+#include "stm32h7xx_hal.h"
+
+using namespace daisy;
+
+// The EXTI handlers are kept out of gatein.cpp, so that programs that only
+// poll their gate inputs can still use these interrupts for other things.
+
+// The gate inputs on each of the 16 EXTI lines
+static GateIn* exti_gates[16];
+
+bool GateIn::InitInterrupt(Pin pin, bool invert)
+{
+    if(!pin.IsValid() || pin.port >= PORTX)
+        return false;
+    if(exti_gates[pin.pin] != nullptr && exti_gates[pin.pin] != this)
+        return false;
+
+    Init(pin, invert);
+    edges_.Init();
+    edge_state_ = State();
+
+    static GPIO_TypeDef* const ports[] = {GPIOA,
+                                          GPIOB,
+                                          GPIOC,
+                                          GPIOD,
+                                          GPIOE,
+                                          GPIOF,
+                                          GPIOG,
+                                          GPIOH,
+                                          GPIOI,
+                                          GPIOJ,
+                                          GPIOK};
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+    GPIO_InitTypeDef ginit;
+    ginit.Pin           = 1 << pin.pin;
+    ginit.Mode          = GPIO_MODE_IT_RISING_FALLING;
+    ginit.Pull          = GPIO_NOPULL;
+    ginit.Speed         = GPIO_SPEED_FREQ_LOW;
+    exti_gates[pin.pin] = this;
+    HAL_GPIO_Init(ports[pin.port], &ginit);
+
+    IRQn_Type irq;
+    switch(pin.pin)
+    {
+        case 0: irq = EXTI0_IRQn; break;
+        case 1: irq = EXTI1_IRQn; break;
+        case 2: irq = EXTI2_IRQn; break;
+        case 3: irq = EXTI3_IRQn; break;
+        case 4: irq = EXTI4_IRQn; break;
+        default: irq = pin.pin < 10 ? EXTI9_5_IRQn : EXTI15_10_IRQn; break;
+    }
+    HAL_NVIC_SetPriority(irq, 0, 0);
+    HAL_NVIC_EnableIRQ(irq);
+    return true;
+}
+
+static void HandleExti(uint8_t first, uint8_t last)
+{
+    const uint32_t now = System::GetUs();
+    for(uint8_t line = first; line <= last; line++)
+    {
+        const uint32_t mask = 1u << line;
+        if(__HAL_GPIO_EXTI_GET_IT(mask) == 0)
+            continue;
+        __HAL_GPIO_EXTI_CLEAR_IT(mask);
+        if(exti_gates[line] != nullptr)
+            exti_gates[line]->OnEdge(now);
+    }
+}
+
+extern "C"
+{
+    void EXTI0_IRQHandler() { HandleExti(0, 0); }
+    void EXTI1_IRQHandler() { HandleExti(1, 1); }
+    void EXTI2_IRQHandler() { HandleExti(2, 2); }
+    void EXTI3_IRQHandler() { HandleExti(3, 3); }
+    void EXTI4_IRQHandler() { HandleExti(4, 4); }
+    void EXTI9_5_IRQHandler() { HandleExti(5, 9); }
+    void EXTI15_10_IRQHandler() { HandleExti(10, 15); }
+}
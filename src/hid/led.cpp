@@ -7,6 +7,8 @@ using namespace daisy;
 
 void Led::Init(Pin pin, bool invert, float samplerate)
 {
+    pwm_channel_ = nullptr;
+    bam_         = nullptr;
     // Init hardware LED
     // Simple OUTPUT GPIO for now.
     hw_pin_.Init(pin, GPIO::Mode::OUTPUT);
@@ -27,14 +29,43 @@ void Led::Init(Pin pin, bool invert, float samplerate)
         off_ = false;
     }
 }
+void Led::Init(PWMHandle::Channel &channel, bool invert)
+{
+    pwm_channel_ = &channel;
+    bam_         = nullptr;
+    invert_      = invert;
+    Set(0.0f);
+}
+
+void Led::Init(BamPattern &pattern, uint8_t pin, bool invert)
+{
+    pwm_channel_ = nullptr;
+    bam_         = &pattern;
+    bam_pin_     = pin;
+    invert_      = invert;
+    Set(0.0f);
+}
+
 void Led::Set(float val)
 {
     bright_     = cube(val);
     pwm_thresh_ = bright_ * static_cast<float>(RESOLUTION_MAX);
+
+    // values above 1 are fully on, like with the software PWM
+    float duty = bright_ < 0.0f ? 0.0f : (bright_ > 1.0f ? 1.0f : bright_);
+    duty       = invert_ ? 1.0f - duty : duty;
+    if(pwm_channel_ != nullptr)
+        pwm_channel_->Set(duty);
+    else if(bam_ != nullptr)
+        bam_->SetLevel(bam_pin_, BamPattern::LevelFromDuty(duty));
 }
 
 void Led::Update()
 {
+    // the timer or DMA does the PWM
+    if(pwm_channel_ != nullptr || bam_ != nullptr)
+        return;
+
     // Shout out to @grrwaaa for the quick fix for pwm
     pwm_ += 120.f / samplerate_;
     if(pwm_ > 1.f)
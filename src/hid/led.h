@@ -4,16 +4,18 @@
 #define DSY_LED_H
 #include "daisy_core.h"
 #include "per/gpio.h"
+#include "per/pwm.h"
+#include "hid/bam_pattern.h"
 
 /* TODO - Get this set up to work with the dev_leddriver stuff as well
-- Setup Hardware PWM for pins that have it
 */
 
 namespace daisy
 {
 /**
     @brief LED Class providing simple Software PWM ability, etc \n 
-    Eventually this will work with hardware PWM, and external LED Driver devices as well.
+    Can also be driven by a hardware PWM channel or by a BamPattern that a
+    DMA streams to a GPIO port. Eventually this will work with external LED Driver devices as well.
     @author shensley
     @date March 2020
     @ingroup feedback
@@ -32,6 +34,25 @@ class Led
     */
     void Init(Pin pin, bool invert, float samplerate = 1000.0f);
 
+    /**
+    Initializes an LED that is driven by a hardware PWM channel. The timer
+    generates the PWM, so Update() isn't needed.
+    \param channel an initialized channel, e.g. pwm.Channel1()
+    \param invert whether to invert the brightness due to hardware config.
+    */
+    void Init(PWMHandle::Channel &channel, bool invert);
+
+    /**
+    Initializes an LED that is driven by bit angle modulation on a GPIO
+    port, e.g. with many LEDs per port. The DMA that streams the pattern
+    generates the PWM, so Update() isn't needed. The pin must be configured
+    as an output.
+    \param pattern the pattern of the port of the LED
+    \param pin the pin number of the LED on the port, 0..15
+    \param invert whether to invert the brightness due to hardware config.
+    */
+    void Init(BamPattern &pattern, uint8_t pin, bool invert);
+
     /** 
     Sets the brightness of the Led.
     \param val will be cubed for gamma correction, and then quantized to 8-bit values for Software PWM
@@ -42,6 +63,7 @@ class Led
     /** 
     This processes the pwm of the LED
     sets the hardware accordingly.
+    Does nothing for LEDs with a PWM channel or a BamPattern.
     */
     void Update();
 
@@ -57,6 +79,10 @@ class Led
     float  samplerate_;
     bool   invert_, on_, off_;
     GPIO   hw_pin_;
+
+    PWMHandle::Channel *pwm_channel_ = nullptr;
+    BamPattern         *bam_         = nullptr;
+    uint8_t             bam_pin_     = 0;
 };
 
 } // namespace daisy
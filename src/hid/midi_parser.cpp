@@ -189,6 +189,7 @@ bool MidiParser::Parse(uint8_t byte, MidiEvent* event_out)
 
 void MidiParser::Reset()
 {
-    pstate_                = ParserEmpty;
-    incoming_message_.type = MessageLast;
+    pstate_                   = ParserEmpty;
+    incoming_message_.type    = MessageLast;
+    incoming_message_.sc_type = SystemCommonLast;
 }
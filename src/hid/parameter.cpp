@@ -1,4 +1,5 @@
 #include "hid/parameter.h"
+#include "util/CurveTables.h"
 #include <math.h>
 
 using namespace daisy;
@@ -9,8 +10,8 @@ void Parameter::Init(AnalogControl input, float min, float max, Curve curve)
     pmax_   = max;
     pcurve_ = curve;
     in_     = input;
-    lmin_   = logf(min < 0.0000001f ? 0.0000001f : min);
-    lmax_   = logf(max);
+    lmin_   = log2f(min < 0.0000001f ? 0.0000001f : min);
+    lmax_   = log2f(max);
 }
 
 float Parameter::Process()
@@ -23,7 +24,8 @@ float Parameter::Process()
             val_ = ((val_ * val_) * (pmax_ - pmin_)) + pmin_;
             break;
         case LOGARITHMIC:
-            val_ = expf((in_.Process() * (lmax_ - lmin_)) + lmin_);
+            val_ = CurveTables::Exp2((in_.Process() * (lmax_ - lmin_))
+                                     + lmin_);
             break;
         case CUBE:
             val_ = in_.Process();
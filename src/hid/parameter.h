@@ -50,7 +50,7 @@ class Parameter
   private:
     AnalogControl in_;
     float         pmin_, pmax_;
-    float         lmin_, lmax_; // for log range
+    float         lmin_, lmax_; // for log range, in octaves
     float         val_;
     Curve         pcurve_;
 };
@@ -0,0 +1,133 @@
+#pragma once
+#ifndef DSY_PARAMETER_RAMP_H
+#define DSY_PARAMETER_RAMP_H
+#include <stddef.h>
+#include <math.h>
+
+namespace daisy
+{
+/** @addtogroup controls
+    @{
+*/
+
+/** Turns a value that changes once per audio block, e.g. the output of
+ *  Parameter::Process(), into a block of per-sample values, so that the
+ *  parameter changes smoothly instead of in steps (zipper noise).
+ *
+ *      void AudioCallback(AudioHandle::InputBuffer  in,
+ *                         AudioHandle::OutputBuffer out,
+ *                         size_t                    size)
+ *      {
+ *          float gain[48];
+ *          gainRamp.ProcessBlock(gainParam.Process(), gain, size);
+ *          for(size_t i = 0; i < size; i++)
+ *              out[0][i] = in[0][i] * gain[i];
+ *      }
+ *
+ *  LINEAR ramps from the last value to the new one over the block and
+ *  arrives at it with the last sample. Each value only depends on the
+ *  index, so the compiler can unroll or vectorize the loop.
+ *  ONE_POLE approaches the new value exponentially with a time constant,
+ *  like a one pole lowpass filter running at the sample rate.
+ */
+class ParameterRamp
+{
+  public:
+    /** The shape of the ramps */
+    enum Mode
+    {
+        LINEAR,   /**< straight lines over one block */
+        ONE_POLE, /**< exponential approach with a time constant */
+    };
+
+    ParameterRamp() {}
+    ~ParameterRamp() {}
+
+    /** Initializes the ramp
+    \param sample_rate   the audio sample rate in Hz
+    \param mode          the shape of the ramps
+    \param time_constant the time in seconds that ONE_POLE takes for 63%
+                         of a step
+    \param initial_value the value before the first block
+    */
+    void Init(float sample_rate,
+              Mode  mode          = LINEAR,
+              float time_constant = 0.002f,
+              float initial_value = 0.0f)
+    {
+        sample_rate_ = sample_rate;
+        mode_        = mode;
+        val_         = initial_value;
+        target_      = initial_value;
+        SetTimeConstant(time_constant);
+    }
+
+    /** Sets the time constant of ONE_POLE in seconds */
+    void SetTimeConstant(float time_constant)
+    {
+        const float samples = time_constant * sample_rate_;
+        coeff_ = samples > 0.0f ? 1.0f - expf(-1.0f / samples) : 1.0f;
+    }
+
+    /** Jumps to a value without ramping */
+    void Reset(float value)
+    {
+        val_    = value;
+        target_ = value;
+    }
+
+    /** Sets the value that the next block ramps to */
+    void SetTarget(float target) { target_ = target; }
+
+    /** Fills a block with the ramp to the target
+    \param out  receives `size` values
+    \param size the block size
+    */
+    void ProcessBlock(float* out, size_t size)
+    {
+        if(size == 0)
+            return;
+        if(mode_ == LINEAR)
+        {
+            const float start = val_;
+            const float step  = (target_ - start) / float(size);
+            for(size_t i = 0; i < size; i++)
+                out[i] = start + step * float(i + 1);
+            // no rounding errors at the end of the ramp
+            out[size - 1] = target_;
+            val_          = target_;
+        }
+        else
+        {
+            const float target = target_;
+            const float keep   = 1.0f - coeff_;
+            float       diff   = val_ - target;
+            for(size_t i = 0; i < size; i++)
+            {
+                diff *= keep;
+                out[i] = target + diff;
+            }
+            val_ = target + diff;
+        }
+    }
+
+    /** Sets the target and fills a block with the ramp to it */
+    void ProcessBlock(float target, float* out, size_t size)
+    {
+        SetTarget(target);
+        ProcessBlock(out, size);
+    }
+
+    /** Returns the value of the last sample */
+    inline float Value() const { return val_; }
+
+  private:
+    float sample_rate_;
+    float coeff_;
+    float val_;
+    float target_;
+    Mode  mode_;
+};
+/** @} */
+} // namespace daisy
+#endif
@@ -0,0 +1,27 @@
+#include "hid/port_debouncer.h"
+#include "stm32h7xx_hal.h"
+
+using namespace daisy;
+
+void GpioPortReader::InitPin(Pin pin, GPIO::Pull pull)
+{
+    // the configuration stays in the GPIO registers
+    GPIO gpio;
+    gpio.Init(pin, GPIO::Mode::INPUT, pull);
+}
+
+uint32_t GpioPortReader::ReadPort(GPIOPort port)
+{
+    static GPIO_TypeDef* const ports[] = {GPIOA,
+                                          GPIOB,
+                                          GPIOC,
+                                          GPIOD,
+                                          GPIOE,
+                                          GPIOF,
+                                          GPIOG,
+                                          GPIOH,
+                                          GPIOI,
+                                          GPIOJ,
+                                          GPIOK};
+    return port < PORTX ? ports[port]->IDR : 0;
+}
@@ -0,0 +1,236 @@
+#pragma once
+#ifndef DSY_PORT_DEBOUNCER_H
+#define DSY_PORT_DEBOUNCER_H
+#include <stddef.h>
+#include <stdint.h>
+#include "daisy_core.h"
+#include "per/gpio.h"
+#include "sys/system.h"
+
+namespace daisy
+{
+/**
+    @brief Debounces 32 digital inputs at once with vertical counters \n
+    Each bit of the sample words is one input. Every input has a two bit
+    counter, stored "vertically" in two words, that counts the samples that
+    differ from the debounced state. The state of an input changes once it
+    has differed for four samples in a row; any sample that matches the
+    state resets the counter. A few bit operations update all 32 inputs.
+    @ingroup controls
+*/
+class BitDebouncer
+{
+  public:
+    BitDebouncer() {}
+    ~BitDebouncer() {}
+
+    /** Sets the debounced state without edges
+    \param state one bit per input, 1 = pressed
+    */
+    void Init(uint32_t state = 0)
+    {
+        state_   = state;
+        count0_  = ~0u;
+        count1_  = ~0u;
+        changed_ = 0;
+    }
+
+    /** Adds a sample of all inputs
+    \param sample one bit per input, 1 = pressed
+    */
+    void Process(uint32_t sample)
+    {
+        const uint32_t differs = state_ ^ sample;
+        // count down from 3 while the input differs, reload otherwise
+        count0_  = ~(count0_ & differs);
+        count1_  = count0_ ^ (count1_ & differs);
+        changed_ = differs & count0_ & count1_;
+        state_ ^= changed_;
+    }
+
+    /** \return the debounced state, one bit per input */
+    inline uint32_t State() const { return state_; }
+
+    /** \return the inputs that were pressed by the last sample */
+    inline uint32_t Rising() const { return changed_ & state_; }
+
+    /** \return the inputs that were released by the last sample */
+    inline uint32_t Falling() const { return changed_ & ~state_; }
+
+  private:
+    uint32_t state_   = 0;
+    uint32_t count0_  = ~0u;
+    uint32_t count1_  = ~0u;
+    uint32_t changed_ = 0;
+};
+
+/** Reads the input data registers of the GPIO ports of the STM32H7 */
+class GpioPortReader
+{
+  public:
+    /** Configures a pin as an input */
+    void InitPin(Pin pin, GPIO::Pull pull);
+
+    /** \return the levels of all 16 pins of a port, bit n = pin n */
+    uint32_t ReadPort(GPIOPort port);
+};
+
+/**
+    @brief Samples and debounces many switches from a few GPIO port reads \n
+    Switch::Debounce() queries the time and reads one pin per switch. For
+    many switches, this reads each GPIO port that has inputs once per tick,
+    then debounces the inputs in groups of 32 with a BitDebouncer. The
+    results can be passed on to Switch::Update(), Encoder::Update() and
+    Switch3::Position(), or used directly.
+
+        PortDebouncer<4> inputs;
+        Switch           button;
+        Encoder          encoder;
+
+        const size_t btn = inputs.AddInput(seed::D15);
+        const size_t a   = inputs.AddInput(seed::D11, false);
+        const size_t b   = inputs.AddInput(seed::D12, false);
+        const size_t clk = inputs.AddInput(seed::D13);
+
+        // once per ms, e.g. in the audio callback
+        if(inputs.Process())
+        {
+            button.Update(inputs.Pressed(btn));
+            // the raw samples, as quadrature signals can't wait for debouncing
+            encoder.Update(inputs.RawState(a), inputs.RawState(b),
+                           inputs.Pressed(clk));
+        }
+
+    \tparam max_inputs  the number of inputs that can be added
+    \tparam PortReader  reads the GPIO ports, with the same interface as
+                        GpioPortReader. The unit tests use a mock.
+*/
+template <size_t max_inputs, class PortReader = GpioPortReader>
+class PortDebouncer
+{
+  public:
+    PortDebouncer() {}
+    ~PortDebouncer() {}
+
+    /**
+    Configures a pin as an input and adds it.
+    \param pin        the pin
+    \param active_low true if the pin is low while pressed, e.g. a button to
+                      ground with the internal pull up
+    \param pull       the pull resistor of the pin
+    \return the index of the input, or max_inputs if there's no room
+    */
+    size_t AddInput(Pin        pin,
+                    bool       active_low = true,
+                    GPIO::Pull pull       = GPIO::Pull::PULLUP)
+    {
+        if(num_inputs_ >= max_inputs || !pin.IsValid())
+            return max_inputs;
+        reader_.InitPin(pin, pull);
+
+        const size_t idx = num_inputs_++;
+        port_[idx]       = pin.port;
+        pin_[idx]        = pin.pin;
+        if(active_low)
+            invert_[idx / 32] |= 1u << (idx % 32);
+        else
+            invert_[idx / 32] &= ~(1u << (idx % 32));
+        used_ports_ |= 1u << pin.port;
+        return idx;
+    }
+
+    /**
+    Reads the ports and debounces the inputs, no faster than once per
+    millisecond, like Switch::Debounce(). The edges are only reported by
+    the call that updates.
+    \return true if the inputs were updated
+    */
+    bool Process()
+    {
+        const uint32_t now = System::GetNow();
+        updated_           = false;
+        if(now - last_update_ < 1)
+            return false;
+        last_update_ = now;
+        Update();
+        return true;
+    }
+
+    /** Reads the ports and debounces the inputs right away */
+    void Update()
+    {
+        updated_               = true;
+        uint32_t levels[PORTX] = {};
+        for(int port = 0; port < PORTX; port++)
+            if(used_ports_ & (1u << port))
+                levels[port] = reader_.ReadPort(GPIOPort(port));
+
+        for(size_t w = 0; w * 32 < num_inputs_; w++)
+        {
+            const size_t last = w * 32 + 32;
+            const size_t end  = num_inputs_ < last ? num_inputs_ : last;
+            uint32_t     word = 0;
+            for(size_t i = w * 32; i < end; i++)
+                word |= ((levels[port_[i]] >> pin_[i]) & 1u) << (i % 32);
+            raw_[w] = word ^ invert_[w];
+            debouncers_[w].Process(raw_[w]);
+        }
+    }
+
+    /** \return true while the input is pressed, debounced */
+    inline bool Pressed(size_t idx) const
+    {
+        return (debouncers_[idx / 32].State() >> (idx % 32)) & 1u;
+    }
+
+    /** \return true if the input was just pressed */
+    inline bool RisingEdge(size_t idx) const
+    {
+        return updated_
+               && ((debouncers_[idx / 32].Rising() >> (idx % 32)) & 1u);
+    }
+
+    /** \return true if the input was just released */
+    inline bool FallingEdge(size_t idx) const
+    {
+        return updated_
+               && ((debouncers_[idx / 32].Falling() >> (idx % 32)) & 1u);
+    }
+
+    /** \return the last sample of the input, without debouncing */
+    inline bool RawState(size_t idx) const
+    {
+        return (raw_[idx / 32] >> (idx % 32)) & 1u;
+    }
+
+    /** \return the debouncer of inputs 32 * word to 32 * word + 31, e.g. to
+     *  check many inputs with one comparison
+     */
+    inline const BitDebouncer& GetDebouncer(size_t word) const
+    {
+        return debouncers_[word];
+    }
+
+    /** \return the number of inputs that were added */
+    inline size_t GetNumInputs() const { return num_inputs_; }
+
+    /** \return the port reader, e.g. to set up a mock */
+    inline PortReader& GetPortReader() { return reader_; }
+
+  private:
+    static constexpr size_t kNumWords = (max_inputs + 31) / 32;
+
+    PortReader   reader_;
+    BitDebouncer debouncers_[kNumWords];
+    uint32_t     raw_[kNumWords]    = {};
+    uint32_t     invert_[kNumWords] = {};
+    GPIOPort     port_[max_inputs];
+    uint8_t      pin_[max_inputs];
+    size_t       num_inputs_  = 0;
+    uint32_t     used_ports_  = 0;
+    uint32_t     last_update_ = 0;
+    bool         updated_     = false;
+};
+
+} // namespace daisy
+#endif
@@ -7,6 +7,27 @@ void RgbLed::Init(Pin red, Pin green, Pin blue, bool invert)
     b_.Init(blue, invert);
 }
 
+void RgbLed::Init(PWMHandle::Channel &red,
+                  PWMHandle::Channel &green,
+                  PWMHandle::Channel &blue,
+                  bool                invert)
+{
+    r_.Init(red, invert);
+    g_.Init(green, invert);
+    b_.Init(blue, invert);
+}
+
+void RgbLed::Init(BamPattern &pattern,
+                  uint8_t     red,
+                  uint8_t     green,
+                  uint8_t     blue,
+                  bool        invert)
+{
+    r_.Init(pattern, red, invert);
+    g_.Init(pattern, green, invert);
+    b_.Init(pattern, blue, invert);
+}
+
 void RgbLed::Set(float r, float g, float b)
 {
     r_.Set(r);
@@ -25,6 +25,31 @@ class RgbLed
     */
     void Init(Pin red, Pin green, Pin blue, bool invert);
 
+    /** Initializes the LED with hardware PWM channels, see Led::Init()
+    \param red  Red element
+    \param green Green element
+    \param blue Blue element
+    \param invert Flips led polarity
+    */
+    void Init(PWMHandle::Channel &red,
+              PWMHandle::Channel &green,
+              PWMHandle::Channel &blue,
+              bool                invert);
+
+    /** Initializes the LED with bit angle modulation on a GPIO port, see
+    Led::Init()
+    \param pattern the pattern of the port of the LED
+    \param red  Pin number of the red element on the port
+    \param green Pin number of the green element on the port
+    \param blue Pin number of the blue element on the port
+    \param invert Flips led polarity
+    */
+    void Init(BamPattern &pattern,
+              uint8_t     red,
+              uint8_t     green,
+              uint8_t     blue,
+              bool        invert);
+
     /** Sets each element of the LED with a floating point number 0-1 
     \param r Red element
     \param g Green element
@@ -54,6 +79,7 @@ class RgbLed
 
     /** Updates the PWM of the LED based on the current values.
     Should be called at a regular interval. (i.e. 1kHz/1ms)
+    Not needed with PWM channels or a BamPattern.
     */
     void Update();
 
@@ -61,6 +61,30 @@ class Switch
     */
     void Debounce();
 
+    /**
+    Updates the switch from a state that was read and debounced elsewhere,
+    e.g. by a PortDebouncer, instead of reading its pin. Call this once per
+    update instead of Debounce(). The switch doesn't need to be initialized
+    with a pin, but RawState() won't work then.
+    \param pressed the debounced state, true while pressed
+    */
+    inline void Update(bool pressed)
+    {
+        updated_ = true;
+        if(pressed)
+        {
+            if(state_ != 0xff && state_ != 0x7f)
+            {
+                state_            = 0x7f;
+                rising_edge_time_ = System::GetNow();
+            }
+            else
+                state_ = 0xff;
+        }
+        else
+            state_ = (state_ == 0xff || state_ == 0x7f) ? 0x80 : 0x00;
+    }
+
     /** \return true if a button was just pressed. */
     inline bool RisingEdge() const { return updated_ ? state_ == 0x7f : false; }
 
@@ -89,14 +113,14 @@ class Switch
     /** Left for backwards compatability until next breaking change
      * \param update_rate Doesn't do anything
     */
-    inline void SetUpdateRate(float update_rate) {}
+    inline void SetUpdateRate(float /* update_rate */) {}
 
   private:
     uint32_t last_update_;
-    bool     updated_;
+    bool     updated_ = false;
     Type     t_;
     GPIO     hw_gpio_;
-    uint8_t  state_;
+    uint8_t  state_ = 0x00;
     bool     flip_;
     float    rising_edge_time_;
 };
@@ -26,11 +26,18 @@ class Switch3
         pinb_gpio_.Init(pinb, GPIO::Mode::INPUT, GPIO::Pull::PULLUP);
     }
 
-    int Read()
+    int Read() { return Position(!pina_gpio_.Read(), !pinb_gpio_.Read()); }
+
+    /** Returns the position for pin states that were read elsewhere, e.g. by
+     *  a PortDebouncer with active low inputs
+     *  \param a true while pin a is low
+     *  \param b true while pin b is low
+     */
+    static int Position(bool a, bool b)
     {
-        if(!pina_gpio_.Read())
+        if(a)
             return POS_UP;
-        if(!pinb_gpio_.Read())
+        if(b)
             return POS_DOWN;
         return POS_CENTER;
     }
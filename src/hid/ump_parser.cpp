@@ -0,0 +1,65 @@
+#include "ump_parser.h"
+
+using namespace daisy;
+
+bool UmpParser::Parse(uint32_t word, UmpPacket* packet_out)
+{
+    // the first word of a packet carries the message type, and with it the size
+    if(words_received_ == 0)
+    {
+        words_expected_ = UmpPacket::GetNumWords(word >> 28);
+    }
+
+    incoming_packet_.words[words_received_++] = word;
+
+    if(words_received_ < words_expected_)
+        return false;
+
+    // unused trailing words are always zero
+    for(size_t i = words_received_; i < 4; i++)
+    {
+        incoming_packet_.words[i] = 0;
+    }
+    words_received_ = 0;
+
+    if(packet_out != nullptr)
+    {
+        *packet_out = incoming_packet_;
+    }
+    return true;
+}
+
+size_t UmpParser::ParseBytes(const uint8_t* data,
+                             size_t         size,
+                             void (*callback)(const UmpPacket& packet,
+                                              void*            context),
+                             void* context)
+{
+    size_t    num_parsed = 0;
+    UmpPacket packet;
+    for(size_t i = 0; i + 3 < size; i += 4)
+    {
+        const uint32_t word = (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8)
+                              | ((uint32_t)data[i + 2] << 16)
+                              | ((uint32_t)data[i + 3] << 24);
+        if(Parse(word, &packet))
+        {
+            num_parsed++;
+            if(callback != nullptr)
+            {
+                callback(packet, context);
+            }
+        }
+    }
+    return num_parsed;
+}
+
+void UmpParser::Reset()
+{
+    words_expected_ = 0;
+    words_received_ = 0;
+    for(size_t i = 0; i < 4; i++)
+    {
+        incoming_packet_.words[i] = 0;
+    }
+}
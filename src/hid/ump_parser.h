@@ -0,0 +1,64 @@
+#pragma once
+#ifndef DSY_UMP_PARSER_H
+#define DSY_UMP_PARSER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "hid/UmpPacket.h"
+
+namespace daisy
+{
+/** @brief   Utility class for assembling 32-bit words into Universal MIDI Packets
+ *  @details The size of each packet is known from the message type of its
+ *           first word, so the parser only needs to count words. No bit
+ *           fields are decoded until one of the UmpPacket accessors is used.
+ *  @ingroup midi
+ */
+class UmpParser
+{
+  public:
+    UmpParser(){};
+    ~UmpParser() {}
+
+    inline void Init() { Reset(); }
+
+    /**
+     * @brief Parse one UMP word. If the word completes a packet,
+     *        it will be assigned to the dereferenced output pointer.
+     *
+     * @param word       Raw 32-bit UMP word in host byte order
+     * @param packet_out Pointer to output packet, value assigned on parse success
+     * @return true      If a new packet was parsed
+     * @return false     If more words are needed
+     */
+    bool Parse(uint32_t word, UmpPacket *packet_out);
+
+    /**
+     * @brief Parse a little-endian UMP byte stream, as received over
+     *        USB MIDI 2.0. Completed packets are passed to the callback.
+     *
+     * @param data     Raw bytes, length should be a multiple of 4
+     * @param size     Number of bytes in data
+     * @param callback Called once for every completed packet
+     * @param context  Passed through to the callback
+     * @return         Number of packets parsed
+     */
+    size_t ParseBytes(const uint8_t *data,
+                      size_t         size,
+                      void (*callback)(const UmpPacket &packet, void *context),
+                      void *context);
+
+    /**
+     * @brief Reset parser to default state
+     */
+    void Reset();
+
+  private:
+    UmpPacket incoming_packet_;
+    size_t    words_expected_;
+    size_t    words_received_;
+};
+
+} // namespace daisy
+
+#endif
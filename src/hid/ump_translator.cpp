@@ -0,0 +1,430 @@
+#include "ump_translator.h"
+
+using namespace daisy;
+
+void UmpTranslator::Init(Protocol protocol, uint8_t group)
+{
+    protocol_ = protocol;
+    group_    = group & 0x0f;
+    Reset();
+}
+
+void UmpTranslator::Reset()
+{
+    for(size_t i = 0; i < 16; i++)
+    {
+        ChannelState& ch    = channels_[i];
+        ch.bank_msb         = 0;
+        ch.bank_lsb         = 0;
+        ch.bank_valid       = false;
+        ch.param_msb        = 0x7f;
+        ch.param_lsb        = 0x7f;
+        ch.param_registered = true;
+        ch.param_valid      = false;
+        ch.data_msb         = 0;
+        ch.data_lsb         = 0;
+    }
+    sysex_active_                  = false;
+    sysex_event_.sysex_message_len = 0;
+}
+
+size_t UmpTranslator::MidiToUmp(const MidiEvent& event,
+                                UmpPacket*       packets_out,
+                                size_t           max_packets)
+{
+    if(max_packets == 0)
+        return 0;
+
+    UmpPacket& packet = packets_out[0];
+    packet.words[1]   = 0;
+    packet.words[2]   = 0;
+    packet.words[3]   = 0;
+
+    if(event.type == SystemRealTime)
+    {
+        packet.words[0] = MakeWord0(UmpSystem, 0xf8 | event.srt_type, 0, 0);
+        return 1;
+    }
+
+    if(event.type == SystemCommon)
+    {
+        switch(event.sc_type)
+        {
+            case SystemExclusive:
+                return SysExToUmp(event, packets_out, max_packets);
+            case MTCQuarterFrame:
+                packet.words[0] = MakeWord0(UmpSystem, 0xf1, event.data[0], 0);
+                return 1;
+            case SongPositionPointer:
+                packet.words[0]
+                    = MakeWord0(UmpSystem, 0xf2, event.data[0], event.data[1]);
+                return 1;
+            case SongSelect:
+                packet.words[0] = MakeWord0(UmpSystem, 0xf3, event.data[0], 0);
+                return 1;
+            case TuneRequest:
+                packet.words[0] = MakeWord0(UmpSystem, 0xf6, 0, 0);
+                return 1;
+            default: return 0;
+        }
+    }
+
+    if(event.type == MessageLast)
+        return 0;
+
+    // Channel Mode messages are Control Changes on the wire
+    const uint8_t chn    = event.channel & 0x0f;
+    const uint8_t status = event.type == ChannelMode
+                               ? (0xb0 | chn)
+                               : (((0x08 + event.type) << 4) | chn);
+    const uint8_t data0 = event.data[0] & 0x7f;
+    const uint8_t data1 = event.data[1] & 0x7f;
+
+    if(protocol_ == Protocol::MIDI1)
+    {
+        const bool single_byte
+            = event.type == ProgramChange || event.type == ChannelPressure;
+        packet.words[0] = MakeWord0(
+            UmpMidi1ChannelVoice, status, data0, single_byte ? 0 : data1);
+        return 1;
+    }
+
+    switch(event.type)
+    {
+        case NoteOff:
+        case NoteOn:
+            packet.words[0] = MakeWord0(UmpMidi2ChannelVoice, status, data0, 0);
+            packet.words[1] = ScaleUp(data1, 7, 16) << 16;
+            return 1;
+        case PolyphonicKeyPressure:
+            packet.words[0] = MakeWord0(UmpMidi2ChannelVoice, status, data0, 0);
+            packet.words[1] = ScaleUp(data1, 7, 32);
+            return 1;
+        case ControlChange:
+        case ChannelMode: return ControlChangeToUmp(event, packets_out);
+        case ProgramChange:
+        {
+            const ChannelState& ch = channels_[chn];
+            packet.words[0]        = MakeWord0(
+                UmpMidi2ChannelVoice, status, 0, ch.bank_valid ? 0x01 : 0x00);
+            packet.words[1] = (uint32_t)data0 << 24;
+            if(ch.bank_valid)
+            {
+                packet.words[1] |= ((uint32_t)ch.bank_msb << 8) | ch.bank_lsb;
+            }
+            return 1;
+        }
+        case ChannelPressure:
+            packet.words[0] = MakeWord0(UmpMidi2ChannelVoice, status, 0, 0);
+            packet.words[1] = ScaleUp(data0, 7, 32);
+            return 1;
+        case PitchBend:
+            packet.words[0] = MakeWord0(UmpMidi2ChannelVoice, status, 0, 0);
+            packet.words[1] = ScaleUp(((uint32_t)data1 << 7) | data0, 14, 32);
+            return 1;
+        default: return 0;
+    }
+}
+
+size_t UmpTranslator::ControlChangeToUmp(const MidiEvent& event,
+                                         UmpPacket*       packets_out)
+{
+    const uint8_t chn    = event.channel & 0x0f;
+    const uint8_t index  = event.data[0] & 0x7f;
+    const uint8_t value  = event.data[1] & 0x7f;
+    ChannelState& ch     = channels_[chn];
+    UmpPacket&    packet = packets_out[0];
+
+    switch(index)
+    {
+        // Bank Select is held until the next Program Change
+        case 0:
+            ch.bank_msb   = value;
+            ch.bank_valid = true;
+            return 0;
+        case 32:
+            ch.bank_lsb   = value;
+            ch.bank_valid = true;
+            return 0;
+
+        // RPN / NRPN selection, 0x7f 0x7f is the "null" parameter
+        case 99:
+        case 98:
+        case 101:
+        case 100:
+            ch.param_registered = index >= 100;
+            if(index == 99 || index == 101)
+                ch.param_msb = value;
+            else
+                ch.param_lsb = value;
+            ch.param_valid = !(ch.param_msb == 0x7f && ch.param_lsb == 0x7f);
+            return 0;
+
+        // Data Entry for the selected parameter
+        case 6:
+        case 38:
+            if(!ch.param_valid)
+                break;
+            if(index == 6)
+            {
+                ch.data_msb = value;
+                ch.data_lsb = 0;
+            }
+            else
+            {
+                ch.data_lsb = value;
+            }
+            packet.words[0] = MakeWord0(
+                UmpMidi2ChannelVoice,
+                ((ch.param_registered ? UmpRegisteredController
+                                      : UmpAssignableController)
+                 << 4)
+                    | chn,
+                ch.param_msb,
+                ch.param_lsb);
+            packet.words[1] = ScaleUp(
+                ((uint32_t)ch.data_msb << 7) | ch.data_lsb, 14, 32);
+            return 1;
+        default: break;
+    }
+
+    packet.words[0]
+        = MakeWord0(UmpMidi2ChannelVoice, (UmpControlChange << 4) | chn, index, 0);
+    packet.words[1] = ScaleUp(value, 7, 32);
+    return 1;
+}
+
+size_t UmpTranslator::SysExToUmp(const MidiEvent& event,
+                                 UmpPacket*       packets_out,
+                                 size_t           max_packets)
+{
+    const size_t len         = event.sysex_message_len;
+    size_t       pos         = 0;
+    size_t       num_packets = 0;
+
+    // a message that doesn't fit is dropped, rather than sent without its
+    // end packet; an empty message still produces one "complete" packet
+    const size_t needed = len > 0 ? (len + 5) / 6 : 1;
+    if(needed > max_packets)
+        return 0;
+
+    do
+    {
+        const size_t count = (len - pos) > 6 ? 6 : (len - pos);
+        const bool   last  = pos + count >= len;
+        uint8_t      status;
+        if(pos == 0)
+            status = last ? UmpSysExComplete : UmpSysExStart;
+        else
+            status = last ? UmpSysExEnd : UmpSysExContinue;
+
+        uint8_t bytes[6] = {0, 0, 0, 0, 0, 0};
+        for(size_t i = 0; i < count; i++)
+        {
+            bytes[i] = event.sysex_data[pos + i] & 0x7f;
+        }
+
+        UmpPacket& packet = packets_out[num_packets++];
+        packet.words[0]   = MakeWord0(
+            UmpData64, (status << 4) | (uint8_t)count, bytes[0], bytes[1]);
+        packet.words[1] = ((uint32_t)bytes[2] << 24) | ((uint32_t)bytes[3] << 16)
+                          | ((uint32_t)bytes[4] << 8) | bytes[5];
+        packet.words[2] = 0;
+        packet.words[3] = 0;
+        pos += count;
+    } while(pos < len);
+
+    return num_packets;
+}
+
+size_t UmpTranslator::UmpToMidi(const UmpPacket& packet,
+                                MidiEvent*       events_out,
+                                size_t           max_events)
+{
+    if(max_events == 0)
+        return 0;
+
+    const uint32_t word   = packet.words[0];
+    const uint8_t  status = (word >> 16) & 0xff;
+
+    switch(packet.GetMessageType())
+    {
+        case UmpSystem:
+            // SysEx is carried in Data 64 packets instead
+            if(status <= 0xf0 || status == 0xf7)
+                return 0;
+            MakeMidiEvent(status, word >> 8, word, &events_out[0]);
+            return 1;
+        case UmpMidi1ChannelVoice:
+            if(status < 0x80 || status >= 0xf0)
+                return 0;
+            MakeMidiEvent(status, word >> 8, word, &events_out[0]);
+            return 1;
+        case UmpMidi2ChannelVoice:
+            return Midi2ToMidi(packet, events_out, max_events);
+        case UmpData64: return SysExToMidi(packet, &events_out[0]);
+        default: return 0;
+    }
+}
+
+size_t UmpTranslator::Midi2ToMidi(const UmpPacket& packet,
+                                  MidiEvent*       events_out,
+                                  size_t           max_events)
+{
+    const uint32_t word0  = packet.words[0];
+    const uint32_t word1  = packet.words[1];
+    const uint8_t  chn    = packet.GetChannel();
+    const uint8_t  status = packet.GetStatus();
+    const uint8_t  byte2  = (word0 >> 8) & 0x7f;
+    const uint8_t  byte3  = word0 & 0x7f;
+    size_t         n      = 0;
+
+    switch(status)
+    {
+        case UmpNoteOff:
+            MakeMidiEvent(
+                0x80 | chn, byte2, ScaleDown(word1 >> 16, 16, 7), &events_out[n++]);
+            break;
+        case UmpNoteOn:
+        {
+            // a MIDI 1.0 velocity of 0 would turn the note off
+            uint8_t velocity = ScaleDown(word1 >> 16, 16, 7);
+            if(velocity == 0)
+                velocity = 1;
+            MakeMidiEvent(0x90 | chn, byte2, velocity, &events_out[n++]);
+            break;
+        }
+        case UmpPolyPressure:
+            MakeMidiEvent(
+                0xa0 | chn, byte2, ScaleDown(word1, 32, 7), &events_out[n++]);
+            break;
+        case UmpControlChange:
+            MakeMidiEvent(
+                0xb0 | chn, byte2, ScaleDown(word1, 32, 7), &events_out[n++]);
+            break;
+        case UmpProgramChange:
+            if(word0 & 0x01)
+            {
+                if(max_events < 3)
+                    return 0;
+                MakeMidiEvent(0xb0 | chn, 0, word1 >> 8, &events_out[n++]);
+                MakeMidiEvent(0xb0 | chn, 32, word1, &events_out[n++]);
+            }
+            MakeMidiEvent(0xc0 | chn, word1 >> 24, 0, &events_out[n++]);
+            break;
+        case UmpChannelPressure:
+            MakeMidiEvent(
+                0xd0 | chn, ScaleDown(word1, 32, 7), 0, &events_out[n++]);
+            break;
+        case UmpPitchBend:
+        {
+            const uint32_t value = ScaleDown(word1, 32, 14);
+            MakeMidiEvent(0xe0 | chn, value, value >> 7, &events_out[n++]);
+            break;
+        }
+        case UmpRegisteredController:
+        case UmpAssignableController:
+        {
+            if(max_events < 4)
+                return 0;
+            const bool     registered = status == UmpRegisteredController;
+            const uint32_t value      = ScaleDown(word1, 32, 14);
+            MakeMidiEvent(
+                0xb0 | chn, registered ? 101 : 99, byte2, &events_out[n++]);
+            MakeMidiEvent(
+                0xb0 | chn, registered ? 100 : 98, byte3, &events_out[n++]);
+            MakeMidiEvent(0xb0 | chn, 6, value >> 7, &events_out[n++]);
+            MakeMidiEvent(0xb0 | chn, 38, value, &events_out[n++]);
+            break;
+        }
+        default: break;
+    }
+    return n;
+}
+
+size_t UmpTranslator::SysExToMidi(const UmpPacket& packet, MidiEvent* event_out)
+{
+    const uint8_t status = packet.GetStatus();
+    if(status > UmpSysExEnd)
+        return 0;
+
+    if(status == UmpSysExComplete || status == UmpSysExStart)
+    {
+        sysex_active_                  = true;
+        sysex_event_.sysex_message_len = 0;
+    }
+    else if(!sysex_active_)
+    {
+        // continuation without a start
+        return 0;
+    }
+
+    size_t count = (packet.words[0] >> 16) & 0x0f;
+    if(count > 6)
+        count = 6;
+
+    const uint8_t bytes[6] = {(uint8_t)((packet.words[0] >> 8) & 0x7f),
+                              (uint8_t)(packet.words[0] & 0x7f),
+                              (uint8_t)((packet.words[1] >> 24) & 0x7f),
+                              (uint8_t)((packet.words[1] >> 16) & 0x7f),
+                              (uint8_t)((packet.words[1] >> 8) & 0x7f),
+                              (uint8_t)(packet.words[1] & 0x7f)};
+    for(size_t i = 0; i < count; i++)
+    {
+        if(sysex_event_.sysex_message_len < SYSEX_BUFFER_LEN)
+        {
+            sysex_event_.sysex_data[sysex_event_.sysex_message_len++]
+                = bytes[i];
+        }
+    }
+
+    if(status == UmpSysExStart || status == UmpSysExContinue)
+        return 0;
+
+    sysex_active_         = false;
+    sysex_event_.type     = SystemCommon;
+    sysex_event_.channel  = 0;
+    sysex_event_.data[0]  = 0;
+    sysex_event_.data[1]  = 0;
+    sysex_event_.sc_type  = SystemExclusive;
+    sysex_event_.srt_type = SystemRealTimeLast;
+    sysex_event_.cm_type  = ChannelModeLast;
+    *event_out            = sysex_event_;
+    return 1;
+}
+
+void UmpTranslator::MakeMidiEvent(uint8_t    status,
+                                  uint8_t    data0,
+                                  uint8_t    data1,
+                                  MidiEvent* event)
+{
+    // fields are filled the same way MidiParser fills them
+    event->type    = static_cast<MidiMessageType>((status & 0x70) >> 4);
+    event->channel = status & 0x0f;
+    event->data[0] = data0 & 0x7f;
+    event->data[1] = data1 & 0x7f;
+    event->sysex_message_len = 0;
+    event->sc_type           = SystemCommonLast;
+    event->srt_type          = SystemRealTimeLast;
+    event->cm_type           = ChannelModeLast;
+
+    if((status & 0xf8) == 0xf8)
+    {
+        event->type     = SystemRealTime;
+        event->srt_type = static_cast<SystemRealTimeType>(status & 0x07);
+    }
+    else if(event->type == SystemCommon)
+    {
+        event->channel = 0;
+        event->sc_type = static_cast<SystemCommonType>(status & 0x07);
+    }
+    else if(event->type == NoteOn && event->data[1] == 0)
+    {
+        event->type = NoteOff;
+    }
+    else if(event->type == ControlChange && event->data[0] > 119)
+    {
+        event->type    = ChannelMode;
+        event->cm_type = static_cast<ChannelModeType>(event->data[0] - 120);
+    }
+}
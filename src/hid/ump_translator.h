@@ -0,0 +1,155 @@
+#pragma once
+#ifndef DSY_UMP_TRANSLATOR_H
+#define DSY_UMP_TRANSLATOR_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "hid/MidiEvent.h"
+#include "hid/UmpPacket.h"
+
+namespace daisy
+{
+/** @brief   Translates between MIDI 1.0 MidiEvents and Universal MIDI Packets
+ *  @details Follows the default translation rules of the UMP specification:
+ *           values are scaled with the min-center-max algorithm, Bank Select
+ *           is folded into Program Change, RPN/NRPN Control Change sequences
+ *           become MIDI 2.0 Registered/Assignable Controller messages, and
+ *           SysEx is split into (or assembled from) SysEx7 packets.
+ *
+ *           Both directions keep a little per-channel state, so a translator
+ *           should be used for a single stream only.
+ *  @ingroup midi
+ */
+class UmpTranslator
+{
+  public:
+    /** Protocol used for channel voice messages created by MidiToUmp() */
+    enum class Protocol
+    {
+        MIDI1, /**< MIDI 1.0 Channel Voice packets (message type 0x2) */
+        MIDI2, /**< MIDI 2.0 Channel Voice packets (message type 0x4) */
+    };
+
+    UmpTranslator() {}
+    ~UmpTranslator() {}
+
+    /** Initializes the translator
+     *  \param protocol Protocol used for channel voice output of MidiToUmp()
+     *  \param group    UMP group assigned to all packets created by MidiToUmp()
+     */
+    void Init(Protocol protocol = Protocol::MIDI2, uint8_t group = 0);
+
+    /** Clears all pending bank, RPN/NRPN, and SysEx state */
+    void Reset();
+
+    /** Translates a MIDI 1.0 event into zero or more UMPs.
+     *  Bank Select and RPN/NRPN selection CCs are absorbed (MIDI2 protocol only),
+     *  and SysEx messages produce one packet per 6 data bytes. A SysEx
+     *  message that needs more than max_packets packets is dropped as a
+     *  whole, so that no stream is sent without its end packet.
+     *  \param event       Event to translate
+     *  \param packets_out Array of output packets
+     *  \param max_packets Size of packets_out
+     *  \return            Number of packets written, 0 if the event was
+     *                     absorbed or didn't fit
+     */
+    size_t MidiToUmp(const MidiEvent &event,
+                     UmpPacket       *packets_out,
+                     size_t           max_packets);
+
+    /** Translates a UMP into zero or more MIDI 1.0 events.
+     *  A MIDI 2.0 program change with bank produces 3 events, and a
+     *  MIDI 2.0 RPN/NRPN produces 4. SysEx7 packets are collected until the
+     *  end of the message. Packets with no MIDI 1.0 equivalent are dropped.
+     *  \param packet     Packet to translate
+     *  \param events_out Array of output events
+     *  \param max_events Size of events_out
+     *  \return           Number of events written
+     */
+    size_t UmpToMidi(const UmpPacket &packet,
+                     MidiEvent       *events_out,
+                     size_t           max_events);
+
+    /** Scales a value up to a higher resolution with the UMP min-center-max
+     *  algorithm: 0 maps to 0, center to center, and max to max.
+     */
+    static uint32_t ScaleUp(uint32_t value, uint8_t src_bits, uint8_t dst_bits)
+    {
+        const uint8_t  scale_bits = dst_bits - src_bits;
+        const uint32_t shifted    = value << scale_bits;
+        const uint32_t center     = 1u << (src_bits - 1);
+        if(value <= center)
+            return shifted;
+
+        // fill the lower bits by repeating the bits below the MSB
+        const uint8_t repeat_bits  = src_bits - 1;
+        uint32_t      repeat_value = value & ((1u << repeat_bits) - 1);
+        if(scale_bits > repeat_bits)
+            repeat_value <<= scale_bits - repeat_bits;
+        else
+            repeat_value >>= repeat_bits - scale_bits;
+
+        uint32_t result = shifted;
+        while(repeat_value != 0)
+        {
+            result |= repeat_value;
+            repeat_value >>= repeat_bits;
+        }
+        return result;
+    }
+
+    /** Scales a value down to a lower resolution by truncation */
+    static uint32_t
+    ScaleDown(uint32_t value, uint8_t src_bits, uint8_t dst_bits)
+    {
+        return value >> (src_bits - dst_bits);
+    }
+
+  private:
+    struct ChannelState
+    {
+        uint8_t bank_msb;
+        uint8_t bank_lsb;
+        bool    bank_valid;
+        uint8_t param_msb;
+        uint8_t param_lsb;
+        bool    param_registered;
+        bool    param_valid;
+        uint8_t data_msb;
+        uint8_t data_lsb;
+    };
+
+    size_t ControlChangeToUmp(const MidiEvent &event, UmpPacket *packets_out);
+    size_t SysExToUmp(const MidiEvent &event,
+                      UmpPacket       *packets_out,
+                      size_t           max_packets);
+    size_t Midi2ToMidi(const UmpPacket &packet,
+                       MidiEvent       *events_out,
+                       size_t           max_events);
+    size_t SysExToMidi(const UmpPacket &packet, MidiEvent *event_out);
+
+    uint32_t MakeWord0(UmpMessageType type,
+                       uint8_t        status_byte,
+                       uint8_t        byte2,
+                       uint8_t        byte3)
+    {
+        return ((uint32_t)type << 28) | ((uint32_t)group_ << 24)
+               | ((uint32_t)status_byte << 16) | ((uint32_t)byte2 << 8)
+               | byte3;
+    }
+
+    static void MakeMidiEvent(uint8_t    status,
+                              uint8_t    data0,
+                              uint8_t    data1,
+                              MidiEvent *event);
+
+    Protocol     protocol_;
+    uint8_t      group_;
+    ChannelState channels_[16];
+    MidiEvent    sysex_event_;
+    bool         sysex_active_;
+};
+
+} // namespace daisy
+
+#endif
@@ -93,6 +93,8 @@ struct dsy_adc
     // dma buffer ptrs
     uint16_t* dma_buffer;
     uint16_t (*mux_cache)[DSY_ADC_MAX_MUX_CHANNELS];
+    // scan schedule and filters of the muxes, writing to mux_cache
+    AdcMuxScan        mux_scan[DSY_ADC_MAX_CHANNELS];
     ADC_HandleTypeDef hadc1;
     DMA_HandleTypeDef hdma_adc1;
     bool              mux_used; // flag set when mux is configured
@@ -182,6 +184,8 @@ void AdcChannelConfig::InitMux(Pin                               adc_pin,
 
     mux_channels_ = mux_channels < 8 ? mux_channels : 8;
     pins_to_init  = get_num_mux_pins_required(mux_channels_);
+    for(size_t i = 0; i < AdcMuxScan::kMaxInputs; i++)
+        mux_inputs_[i].Defaults();
     for(size_t i = 0; i < pins_to_init; i++)
     {
         GPIO::Config& mux_pin_config = mux_pin_[i].GetConfig();
@@ -192,6 +196,18 @@ void AdcChannelConfig::InitMux(Pin                               adc_pin,
     speed_ = speed;
 }
 
+void AdcChannelConfig::SetMuxInput(size_t             idx,
+                                   uint8_t            rate,
+                                   AdcMuxScan::Filter filter,
+                                   uint8_t            decimation)
+{
+    if(idx >= AdcMuxScan::kMaxInputs)
+        return;
+    mux_inputs_[idx].rate       = rate;
+    mux_inputs_[idx].filter     = filter;
+    mux_inputs_[idx].decimation = decimation;
+}
+
 // Begin AdcHandle Implementations
 
 void AdcHandle::Init(AdcChannelConfig* cfg,
@@ -223,7 +239,12 @@ void AdcHandle::Init(AdcChannelConfig* cfg,
         adc.dma_buffer[i]   = 0;
         adc.mux_channels[i] = cfg[i].mux_channels_;
         if(cfg[i].mux_channels_ > 0)
+        {
             adc.mux_used = true;
+            adc.mux_scan[i].Init(adc.mux_cache[i], cfg[i].mux_channels_);
+            for(size_t j = 0; j < cfg[i].mux_channels_; j++)
+                adc.mux_scan[i].SetInput(j, cfg[i].mux_inputs_[j]);
+        }
     }
     adc.hadc1.Instance                  = ADC1;
     adc.hadc1.Init.ClockPrescaler       = ADC_CLOCK_ASYNC_DIV2;
@@ -482,17 +503,11 @@ static void adc_internal_callback()
 {
     for(uint16_t i = 0; i < adc.channels; i++)
     {
-        const uint8_t chn              = i;
-        const uint8_t current_position = adc.mux_index[i];
+        const uint8_t chn = i;
         if(adc.mux_channels[chn] > 0)
         {
-            // Capture current value to mux_cache
-            const auto value                   = adc.dma_buffer[i];
-            adc.mux_cache[i][current_position] = value;
-            // Update Mux Position, and write GPIO
-            adc.mux_index[chn] += 1;
-            if(adc.mux_index[chn] >= adc.mux_channels[chn])
-                adc.mux_index[chn] = 0;
+            // Filter the value into mux_cache, and pick the next position
+            adc.mux_index[chn] = adc.mux_scan[chn].Process(adc.dma_buffer[i]);
             write_mux_value(
                 chn, adc.mux_index[chn], adc.num_mux_pins_required[chn]);
         }
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include "daisy_core.h"
 #include "per/gpio.h"
+#include "per/adc_mux_scan.h"
 
 #define DSY_ADC_MAX_CHANNELS 16 /**< Maximum number of ADC channels */
 
@@ -78,10 +79,26 @@ struct AdcChannelConfig
                  Pin             mux_2 = Pin(PORTX, 0),
                  ConversionSpeed speed = SPEED_8CYCLES_5);
 
-    GPIO            pin_;                   /**< & */
-    GPIO            mux_pin_[MUX_SEL_LAST]; /**< & */
-    uint8_t         mux_channels_;          /**< & */
-    ConversionSpeed speed_;
+    /**
+    Sets how often an input of a multiplexed pin is read, and how its
+    readings are filtered, see AdcMuxScan. Call after InitMux().
+    \param idx        the mux input, 0..mux_channels - 1
+    \param rate       the relative scan rate, 1..255: an input with a rate of
+                      4 is read four times as often as one with a rate of 1
+    \param filter     the filter for the readings
+    \param decimation averages 2^decimation readings per value with the CIC
+                      filter, 0..6
+    */
+    void SetMuxInput(size_t             idx,
+                     uint8_t            rate,
+                     AdcMuxScan::Filter filter     = AdcMuxScan::Filter::NONE,
+                     uint8_t            decimation = 0);
+
+    GPIO                    pin_;                   /**< & */
+    GPIO                    mux_pin_[MUX_SEL_LAST]; /**< & */
+    uint8_t                 mux_channels_;          /**< & */
+    ConversionSpeed         speed_;
+    AdcMuxScan::InputConfig mux_inputs_[AdcMuxScan::kMaxInputs]; /**< & */
 };
 
 /**
@@ -146,6 +163,8 @@ class AdcHandle
 
     /**
        Getters for multiplexed inputs on a single channel (up to 8 per ADC input). 
+       The values are filtered as configured with
+       AdcChannelConfig::SetMuxInput().
        \param chn Channel to get from
        \param idx &
        \return data
@@ -0,0 +1,275 @@
+#pragma once
+#ifndef DSY_ADC_MUX_SCAN_H
+#define DSY_ADC_MUX_SCAN_H
+#include <stddef.h>
+#include <stdint.h>
+
+namespace daisy
+{
+/** @addtogroup per_analog
+    @{
+*/
+
+/**
+    @brief Schedules and filters the inputs of one ADC multiplexer \n
+    Every completed conversion of a multiplexed ADC channel is passed to
+    Process(), which filters the reading into the output value of the
+    current mux input and picks the input to read next.
+
+    Inputs are read in proportion to their rate, spread as evenly as
+    possible (smooth weighted round robin), so e.g. a CV input with a rate
+    of 4 is read four times as often as a pot with a rate of 1. With the
+    default settings all inputs have the same rate and no filter, so they
+    are read in turn, one after the other, and passed through.
+
+    The filters run per reading, so they are cheap enough for the DMA
+    completion interrupt:
+    - MEDIAN: the median of the last three readings, which removes single
+      spikes, e.g. from switching the mux or digital noise
+    - CIC: a second order cascaded integrator-comb decimator, which
+      averages 2^decimation readings per output with a triangular window.
+      Each output is computed from the 2 * 2^decimation - 1 latest
+      readings and the noise of independent readings drops by about
+      sqrt(1.5 * 2^decimation).
+    - MEDIAN_CIC: both, the median first
+
+    AdcChannelConfig::SetMuxInput() configures the inputs of an
+    AdcHandle mux; the filtered values are what GetMux() and GetMuxFloat()
+    return.
+*/
+class AdcMuxScan
+{
+  public:
+    /** The maximum number of inputs of a mux */
+    static constexpr size_t kMaxInputs = 8;
+    /** The maximum CIC decimation, as a power of two */
+    static constexpr uint8_t kMaxDecimation = 6;
+
+    /** The filter of an input */
+    enum class Filter
+    {
+        NONE,
+        MEDIAN,
+        CIC,
+        MEDIAN_CIC,
+    };
+
+    /** The scan rate and filter of an input */
+    struct InputConfig
+    {
+        /** The relative scan rate, 1..255 */
+        uint8_t rate;
+        /** The filter */
+        Filter filter;
+        /** Averages 2^decimation readings per output with the CIC filter,
+         *  0..kMaxDecimation
+         */
+        uint8_t decimation;
+
+        /** Read as often as the other inputs, without filters */
+        void Defaults()
+        {
+            rate       = 1;
+            filter     = Filter::NONE;
+            decimation = 0;
+        }
+    };
+
+    AdcMuxScan() {}
+    ~AdcMuxScan() {}
+
+    /** Initializes all inputs with the default settings
+    \param output     the filtered values, one per input
+    \param num_inputs the number of inputs of the mux, 1..kMaxInputs
+    */
+    void Init(uint16_t* output, size_t num_inputs)
+    {
+        output_     = output;
+        num_inputs_ = num_inputs < kMaxInputs ? num_inputs : kMaxInputs;
+        if(num_inputs_ == 0)
+            num_inputs_ = 1;
+        InputConfig cfg;
+        cfg.Defaults();
+        for(size_t i = 0; i < num_inputs_; i++)
+            SetInput(i, cfg);
+        Restart();
+    }
+
+    /** Configures an input, and restarts its filter. Not to be called while
+    the ADC is running.
+    \param idx the mux input
+    \param cfg the settings
+    */
+    void SetInput(size_t idx, const InputConfig& cfg)
+    {
+        if(idx >= num_inputs_)
+            return;
+        Input& input = inputs_[idx];
+        input.rate   = cfg.rate > 0 ? cfg.rate : 1;
+        input.median = cfg.filter == Filter::MEDIAN
+                       || cfg.filter == Filter::MEDIAN_CIC;
+        const bool cic = cfg.filter == Filter::CIC
+                         || cfg.filter == Filter::MEDIAN_CIC;
+        input.shift = cic ? cfg.decimation : 0;
+        if(input.shift > kMaxDecimation)
+            input.shift = kMaxDecimation;
+        input.cic   = input.shift > 0;
+        total_rate_ = 0;
+        for(size_t i = 0; i < num_inputs_; i++)
+            total_rate_ += inputs_[i].rate;
+        ResetFilter(input);
+    }
+
+    /** Starts the scan over at input 0, which is where the mux is set when
+     *  the ADC starts
+     */
+    void Restart()
+    {
+        for(size_t i = 0; i < num_inputs_; i++)
+            inputs_[i].credit = inputs_[i].rate;
+        // a pick would take the input with the highest rate, so input 0 is
+        // chosen, and pays for it, directly
+        inputs_[0].credit -= total_rate_;
+        current_ = 0;
+    }
+
+    /** Filters a reading of the current input and moves on to the next
+    \param sample the reading
+    \return the input to read next
+    */
+    uint8_t Process(uint16_t sample)
+    {
+        Input&   input = inputs_[current_];
+        uint16_t value = sample;
+        if(input.median)
+            value = Median(input, sample);
+        if(input.cic)
+        {
+            if(Decimate(input, value))
+                output_[current_] = input.value;
+        }
+        else
+        {
+            output_[current_] = value;
+        }
+        current_ = Pick();
+        return current_;
+    }
+
+    /** \return the input that the next reading is from */
+    inline uint8_t GetCurrentInput() const { return current_; }
+
+    /** \return the number of inputs */
+    inline size_t GetNumInputs() const { return num_inputs_; }
+
+    /** \return the filtered value of an input */
+    inline uint16_t Get(size_t idx) const { return output_[idx]; }
+
+    /** \return the filtered value of an input, 0..1 */
+    inline float GetFloat(size_t idx) const
+    {
+        return float(output_[idx]) / 65536.0f;
+    }
+
+  private:
+    struct Input
+    {
+        uint8_t  rate          = 1;
+        bool     median        = false;
+        bool     cic           = false;
+        uint8_t  shift         = 0;
+        int32_t  credit        = 0;
+        uint16_t history[2]    = {};
+        uint8_t  num_history   = 0;
+        uint8_t  num_readings  = 0;
+        bool     settled       = false;
+        uint32_t integrator[2] = {};
+        uint32_t comb_delay[2] = {};
+        uint16_t value         = 0;
+    };
+
+    static void ResetFilter(Input& input)
+    {
+        input.history[0]    = 0;
+        input.history[1]    = 0;
+        input.num_history   = 0;
+        input.num_readings  = 0;
+        input.settled       = false;
+        input.integrator[0] = 0;
+        input.integrator[1] = 0;
+        input.comb_delay[0] = 0;
+        input.comb_delay[1] = 0;
+        input.value         = 0;
+    }
+
+    /** Smooth weighted round robin: every input earns its rate, the input
+     *  with the most credit is read and pays the sum of all rates
+     */
+    uint8_t Pick()
+    {
+        size_t best = 0;
+        for(size_t i = 0; i < num_inputs_; i++)
+        {
+            inputs_[i].credit += inputs_[i].rate;
+            if(inputs_[i].credit > inputs_[best].credit)
+                best = i;
+        }
+        inputs_[best].credit -= total_rate_;
+        return uint8_t(best);
+    }
+
+    static uint16_t Median(Input& input, uint16_t sample)
+    {
+        const uint16_t a = input.history[0];
+        const uint16_t b = input.history[1];
+        input.history[0] = b;
+        input.history[1] = sample;
+        if(input.num_history < 2)
+        {
+            input.num_history++;
+            return sample;
+        }
+        const uint16_t lo = a < b ? a : b;
+        const uint16_t hi = a < b ? b : a;
+        return sample < lo ? lo : (sample > hi ? hi : sample);
+    }
+
+    /** \return true when a new output is ready in input.value */
+    static bool Decimate(Input& input, uint16_t sample)
+    {
+        // the integrators wrap around, which the combs undo
+        input.integrator[0] += sample;
+        input.integrator[1] += input.integrator[0];
+        const bool done = ++input.num_readings >= (1u << input.shift);
+        if(!done && input.settled)
+            return false;
+        // until the window is full, the readings are passed through
+        input.value = sample;
+        if(!done)
+            return true;
+        input.num_readings = 0;
+
+        const uint32_t comb0 = input.integrator[1] - input.comb_delay[0];
+        input.comb_delay[0]  = input.integrator[1];
+        const uint32_t comb1 = comb0 - input.comb_delay[1];
+        input.comb_delay[1]  = comb0;
+        // the first output is missing the readings before the start
+        if(!input.settled)
+        {
+            input.settled = true;
+            return true;
+        }
+        input.value = uint16_t(comb1 >> (2 * input.shift));
+        return true;
+    }
+
+    Input     inputs_[kMaxInputs];
+    uint16_t* output_     = nullptr;
+    size_t    num_inputs_ = 1;
+    int32_t   total_rate_ = 1;
+    uint8_t   current_    = 0;
+};
+
+/** @} */
+} // namespace daisy
+#endif
@@ -276,6 +276,12 @@ class System
         return testIsolator_.GetStateForCurrentTest()->tickFreqHz_;
     }
 
+    /** Advances the time of the test that's currently running. */
+    static void Delay(uint32_t delay_ms)
+    {
+        testIsolator_.GetStateForCurrentTest()->currentUs_ += delay_ms * 1000;
+    }
+
     /** Sets the current "tick" value for the test that's currently running. */
     static void SetTickForUnitTest(uint32_t tick)
     {
@@ -9,6 +9,7 @@ void AbstractMenu::SelectItem(uint16_t itemIdx)
         return;
     selectedItemIdx_ = itemIdx;
     isEditing_       = false;
+    Invalidate();
 }
 
 // inherited from UiPage
@@ -163,6 +164,9 @@ void AbstractMenu::Init(const ItemConfig* items,
     selectedItemIdx_  = 0;
     isEditing_        = false;
     isFuncButtonDown_ = false;
+
+    // the menu may be re-initialized while it's displayed
+    Invalidate();
 }
 
 bool AbstractMenu::CanItemBeEnteredForEditing(uint16_t itemIdx)
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "hid/disp/display.h"
+#include "util/AudioScopeBuffer.h"
+#include "UI.h"
+#include <cmath>
+
+namespace daisy
+{
+/** @brief Base class for pages that show the audio of an AudioScopeBuffer
+ *  @ingroup ui
+ *
+ *  Like FullScreenItemMenu, the pages draw to the canvas returned by
+ *  `UI::GetPrimaryOneBitGraphicsDisplayId()`, unless configured otherwise.
+ *  On canvases that are only redrawn when invalidated, call Poll() from the
+ *  main loop so that the page is redrawn when a new frame arrives.
+ *
+ *  \tparam BufferType the AudioScopeBuffer to read from
+ */
+template <class BufferType>
+class AudioScopePageBase : public UiPage
+{
+  public:
+    /** Call this to initialize the page.
+     *  \param buffer   the buffer that the audio callback writes to
+     *  \param canvasId the canvas to draw to, or UI::invalidCanvasId for
+     *                  the primary OneBitGraphicsDisplay of the UI
+     */
+    void Init(BufferType& buffer, uint16_t canvasId = UI::invalidCanvasId)
+    {
+        buffer_   = &buffer;
+        canvasId_ = canvasId;
+    }
+
+    /** Invalidates the page if the buffer has a new frame */
+    void Poll()
+    {
+        if(buffer_ != nullptr && buffer_->HasNewFrame())
+            Invalidate();
+    }
+
+  protected:
+    /** Returns the display to draw to, or nullptr if it's not this canvas */
+    OneBitGraphicsDisplay* GetDisplay(const UiCanvasDescriptor& canvas)
+    {
+        uint16_t id = canvasId_;
+        if(id == UI::invalidCanvasId)
+        {
+            const auto* ui = GetParentUI();
+            if(ui == nullptr)
+                return nullptr;
+            id = ui->GetPrimaryOneBitGraphicsDisplayId();
+        }
+        if(buffer_ == nullptr || id != canvas.id_)
+            return nullptr;
+        return (OneBitGraphicsDisplay*)(canvas.handle_);
+    }
+
+    BufferType* buffer_   = nullptr;
+    uint16_t    canvasId_ = UI::invalidCanvasId;
+};
+
+/** @brief A page that shows the waveform of each channel
+ *  @ingroup ui
+ *
+ *  The channels are stacked vertically. Each column of the frame is drawn
+ *  as a vertical line from its lowest to its highest sample, one column per
+ *  pixel, with -1..1 filling the height of the channel.
+ */
+template <class BufferType>
+class ScopePage : public AudioScopePageBase<BufferType>
+{
+  public:
+    void Draw(const UiCanvasDescriptor& canvas) override
+    {
+        OneBitGraphicsDisplay* display = this->GetDisplay(canvas);
+        if(display == nullptr)
+            return;
+
+        const auto&  frame    = this->buffer_->GetFrame();
+        const size_t channels = BufferType::numChannels;
+        const size_t columns  = BufferType::numColumns;
+        const int    width    = display->Width();
+        const int    height   = display->Height() / channels;
+        for(size_t ch = 0; ch < channels; ch++)
+        {
+            const int top = ch * height;
+            for(size_t x = 0; x < columns && int(x) < width; x++)
+            {
+                display->DrawLine(x,
+                                  top + ToY(frame.max[ch][x], height),
+                                  x,
+                                  top + ToY(frame.min[ch][x], height),
+                                  true);
+            }
+        }
+    }
+
+  private:
+    /** Maps 1..-1 to 0..height - 1 */
+    static int ToY(float sample, int height)
+    {
+        sample = sample > 1.0f ? 1.0f : (sample < -1.0f ? -1.0f : sample);
+        return int((1.0f - sample) * 0.5f * float(height - 1) + 0.5f);
+    }
+};
+
+/** @brief A page with a horizontal level meter for each channel
+ *  @ingroup ui
+ *
+ *  Each meter is a bar filled up to the RMS level with a marker at the
+ *  peak level, on a decibel scale from SetRange() (-60 dB by default) to
+ *  0 dBFS.
+ */
+template <class BufferType>
+class LevelMeterPage : public AudioScopePageBase<BufferType>
+{
+  public:
+    /** Sets the level at the left end of the meters, e.g. -60.0f */
+    void SetRange(float minDb) { minDb_ = minDb < 0.0f ? minDb : -1.0f; }
+
+    void Draw(const UiCanvasDescriptor& canvas) override
+    {
+        OneBitGraphicsDisplay* display = this->GetDisplay(canvas);
+        if(display == nullptr)
+            return;
+
+        const auto&  frame    = this->buffer_->GetFrame();
+        const size_t channels = BufferType::numChannels;
+        const int    width    = display->Width();
+        const int    height   = display->Height() / channels;
+        for(size_t ch = 0; ch < channels; ch++)
+        {
+            // a gap of a pixel between the meters
+            const int top    = ch * height;
+            const int bottom = top + height - 2;
+            if(bottom < top)
+                continue;
+            display->DrawRect(0, top, width - 1, bottom, true);
+            const int rms = ToX(frame.rms[ch], width);
+            if(rms > 0)
+                display->DrawRect(1, top + 1, rms, bottom - 1, true, true);
+            const int peak = ToX(frame.peak[ch], width);
+            if(peak > 0)
+                display->DrawLine(peak, top, peak, bottom, true);
+        }
+    }
+
+  private:
+    /** Maps a level to 0 (below the range) ..width - 2 (0 dBFS) */
+    int ToX(float level, int width) const
+    {
+        if(level <= 0.0f)
+            return 0;
+        float position = 1.0f - 20.0f * log10f(level) / minDb_;
+        position = position > 1.0f ? 1.0f : (position < 0.0f ? 0.0f : position);
+        return int(position * float(width - 2) + 0.5f);
+    }
+
+    float minDb_ = -60.0f;
+};
+
+} // namespace daisy
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <math.h>
 #include "UiEventQueue.h"
 #include "../sys/system.h"
 
@@ -30,6 +31,16 @@ namespace daisy
  *
  *      float GetPotValue(uint16_t potId);
  *
+ *  With noisy pots, fixed dead bands are either too small, so that the noise
+ *  floods the queue with events, or so large that slow movements are missed.
+ *  When initialised with InitAdaptive() instead, the monitor estimates the
+ *  noise of each pot while it runs and sizes the dead bands to it. The
+ *  positions that are posted are quantized and change only when the pot
+ *  leaves the dead band around the last posted position (hysteresis), and
+ *  the events of each pot can be limited to one per minimum interval. When
+ *  a pot comes to rest after a fast movement, the dead band shrinks back to
+ *  the noise floor, so that the final position is still posted.
+ *
  *   @tparam BackendType     The class type of the backend that will supply pot values.
  *   @tparam numPots         The number of pots to monitor.
  */
@@ -37,12 +48,61 @@ template <typename BackendType, uint32_t numPots>
 class PotMonitor
 {
   public:
+    /** The settings of the adaptive dead bands, see InitAdaptive() */
+    struct AdaptiveSettings
+    {
+        /** The dead band of a moving pot, in multiples of its estimated
+         *  noise (standard deviation)
+         */
+        float noiseFactor;
+        /** The smallest dead band of a moving pot */
+        float minDeadBand;
+        /** The largest dead band of a moving pot. Until the noise is known,
+         *  this is used, too.
+         */
+        float maxDeadBand;
+        /** The dead band of an idle pot, in multiples of the dead band of a
+         *  moving pot
+         */
+        float idleFactor;
+        /** The posted positions are rounded to multiples of this; 0 for no
+         *  rounding
+         */
+        float resolution;
+        /** The shortest time between two movement events of a pot */
+        uint16_t minEventIntervalMs;
+
+        /** Sets the defaults */
+        void Defaults()
+        {
+            noiseFactor        = 6.0f;
+            minDeadBand        = 1.0f / (1 << 12);
+            maxDeadBand        = 1.0f / (1 << 7);
+            idleFactor         = 2.0f;
+            resolution         = 1.0f / (1 << 12);
+            minEventIntervalMs = 10;
+        }
+    };
+
+    /** Counts the events of all pots */
+    struct Stats
+    {
+        /** UiEventQueue::Event::EventType::potMoved events that were posted */
+        uint32_t numMoved = 0;
+        /** UiEventQueue::Event::EventType::potActivityChanged
+         *  events that were posted */
+        uint32_t numActivityChanged = 0;
+        /** Movements that were held back by the minimum event interval */
+        uint32_t numRateLimited = 0;
+    };
+
     PotMonitor()
     : queue_(nullptr),
       backend_(nullptr),
       deadBand_(1.0 / (1 << 12)),
       deadBandIdle_(1.0 / (1 << 10)),
-      timeout_(0)
+      timeout_(0),
+      adaptive_(false)
     {
     }
 
@@ -67,14 +127,37 @@ class PotMonitor
         backend_      = &backend;
         deadBandIdle_ = deadBandIdle;
         timeout_      = idleTimeoutMs;
+        adaptive_     = false;
+        settings_.Defaults();
+        settings_.resolution         = 0.0f;
+        settings_.minEventIntervalMs = 0;
 
-        for(uint32_t i = 0; i < numPots; i++)
-        {
-            lastValue_[i]        = 0.0;
-            timeoutCounterMs_[i] = 0;
-        }
+        Reset(0.0f);
+    }
 
-        lastCallSysTime_ = System::GetNow();
+    /** Initialises the PotMonitor with dead bands that adapt to the noise of
+     *  each pot.
+     * @param queueToAddEventsTo    The UiEventQueue to which events should be posted.
+     * @param backend                The backend that supplies the current value of each potentiometer.
+     * @param settings                The settings of the dead bands and events.
+     * @param idleTimeoutMs           When the pot is currently moving, but no event is generated over
+     *                              "idleTimeoutMs", the pot enters the idle state.
+     */
+    void InitAdaptive(UiEventQueue&           queueToAddEventsTo,
+                      BackendType&            backend,
+                      const AdaptiveSettings& settings,
+                      uint16_t                idleTimeoutMs = 500)
+    {
+        queue_    = &queueToAddEventsTo;
+        backend_  = &backend;
+        timeout_  = idleTimeoutMs;
+        adaptive_ = true;
+        settings_ = settings;
+        if(settings_.minEventIntervalMs > timeout_)
+            settings_.minEventIntervalMs = timeout_;
+
+        // start with the largest dead band, until the noise is known
+        Reset(settings_.maxDeadBand / settings_.noiseFactor);
     }
 
     /** Checks the value of each pot and generates messages for the UIEventQueue.
@@ -113,13 +196,73 @@ class PotMonitor
             return lastValue_[potId];
     }
 
+    /** Returns the estimated noise of a pot, as the standard deviation of
+     *  its values around their recent average. Only estimated after
+     *  InitAdaptive().
+     *  @param potId    The unique ID of the potentiometer (< numPots)
+     */
+    float GetNoiseFloor(uint16_t potId) const
+    {
+        if(potId >= numPots)
+            return 0.0f;
+        else
+            return noise_[potId];
+    }
+
+    /** Returns the dead band that currently applies to a pot, which depends
+     *  on whether it's moving or idle.
+     *  @param potId    The unique ID of the potentiometer (< numPots)
+     */
+    float GetDeadBand(uint16_t potId) const
+    {
+        if(potId >= numPots)
+            return 0.0f;
+        else if(!adaptive_)
+            return IsMoving(potId) ? deadBand_ : deadBandIdle_;
+
+        const float lo   = settings_.minDeadBand;
+        const float hi   = settings_.maxDeadBand;
+        float       band = settings_.noiseFactor * noise_[potId];
+        band             = band > lo ? band : lo;
+        band             = band < hi ? band : hi;
+        // one step of the resolution at least, so that the posted
+        // position always changes
+        band = band > settings_.resolution ? band : settings_.resolution;
+        return IsMoving(potId) ? band : band * settings_.idleFactor;
+    }
+
+    /** Returns the number of events since Init() or the last ResetStats(). */
+    const Stats& GetStats() const { return stats_; }
+
+    /** Resets the counters returned by GetStats(). */
+    void ResetStats() { stats_ = Stats(); }
+
     /** Returns the BackendType that is used by the monitor. */
-    BackendType& GetBackend() { return backend_; }
+    BackendType& GetBackend() { return *backend_; }
 
     /** Returns the number of pots that are monitored by this class. */
     uint16_t GetNumPotsMonitored() const { return numPots; }
 
   private:
+    /** Resets the state of all pots.
+     *  @param noise    The initial noise estimate
+     */
+    void Reset(float noise)
+    {
+        for(uint32_t i = 0; i < numPots; i++)
+        {
+            lastValue_[i]        = 0.0;
+            timeoutCounterMs_[i] = 0;
+            average_[i]          = -1.0f;
+            noise_[i]            = noise;
+            variance_[i]         = noise * noise;
+            pending_[i]          = false;
+        }
+        stats_ = Stats();
+
+        lastCallSysTime_ = System::GetNow();
+    }
+
     /** Process a potentiometer and detect movements - or
      *  flags the pot as "idle" when no movement is detected for
      *  a longer period of time.
@@ -129,27 +272,45 @@ class PotMonitor
      */
     void ProcessPot(uint16_t id, float value, uint32_t timeDiffMs)
     {
+        // only the adaptive dead bands need the noise. At most one update
+        // per ms, so that calling more often than the values change doesn't
+        // make the pot look quieter than it is.
+        if(adaptive_ && timeDiffMs > 0)
+            UpdateNoise(id, value, timeDiffMs);
+
+        const float band    = GetDeadBand(id);
+        const float delta   = lastValue_[id] - value;
+        const bool  outside = (delta > band) || (delta < -band);
+
         // currently moving?
         if(timeoutCounterMs_[id] < timeout_)
         {
             // check if pot has left the deadband. If so, add a new message
-            // to the queue.
-            float delta = lastValue_[id] - value;
-            if((delta > deadBand_) || (delta < -deadBand_))
+            // to the queue - unless the last one was too recent, in which
+            // case the latest position is posted once the interval is over.
+            if(outside || pending_[id])
             {
-                lastValue_[id] = value;
-                queue_->AddPotMoved(id, value);
-                timeoutCounterMs_[id] = 0;
+                if(timeoutCounterMs_[id] >= settings_.minEventIntervalMs)
+                {
+                    pending_[id] = false;
+                    PostMoved(id, value);
+                    return;
+                }
+                if(outside)
+                {
+                    pending_[id] = true;
+                    stats_.numRateLimited++;
+                }
             }
             // no movement, increment timeout counter
-            else
+            const uint32_t counter = timeoutCounterMs_[id] + timeDiffMs;
+            timeoutCounterMs_[id]  = counter < timeout_ ? counter : timeout_;
+            // post activity changed event after timeout expired.
+            if(timeoutCounterMs_[id] == timeout_)
             {
-                timeoutCounterMs_[id] += timeDiffMs;
-                // post activity changed event after timeout expired.
-                if(timeoutCounterMs_[id] == timeout_)
-                {
-                    queue_->AddPotActivityChanged(id, false);
-                }
+                pending_[id] = false;
+                queue_->AddPotActivityChanged(id, false);
+                stats_.numActivityChanged++;
             }
         }
         // not moving right now
@@ -157,28 +318,87 @@ class PotMonitor
         {
             // check if pot has left the idle deadband. If so, add a new message
             // to the queue and restart the timeout
-            float delta = lastValue_[id] - value;
-            if((delta > deadBandIdle_) || (delta < -deadBandIdle_))
+            if(outside)
             {
-                lastValue_[id] = value;
                 queue_->AddPotActivityChanged(id, true);
-                queue_->AddPotMoved(id, value);
-                timeoutCounterMs_[id] = 0;
+                stats_.numActivityChanged++;
+                PostMoved(id, value);
             }
         }
     }
 
+    /** Posts the (quantized) position of a pot and restarts its timeout,
+     *  if the position changed.
+     */
+    void PostMoved(uint16_t id, float value)
+    {
+        const float res = settings_.resolution;
+        if(res > 0.0f)
+        {
+            value = floorf(value / res + 0.5f) * res;
+            value = value < 1.0f ? (value > 0.0f ? value : 0.0f) : 1.0f;
+        }
+        if(value == lastValue_[id])
+            return;
+        timeoutCounterMs_[id] = 0;
+        lastValue_[id]        = value;
+        queue_->AddPotMoved(id, value);
+        stats_.numMoved++;
+    }
+
+    /** Tracks the average of a pot, and the variance of the values around
+     *  it. Deviations of more than four times the noise, i.e. movements,
+     *  are clipped, so the estimate rises only slowly while the pot moves
+     *  and falls back to the noise floor when it rests.
+     */
+    void UpdateNoise(uint16_t id, float value, uint32_t timeDiffMs)
+    {
+        if(average_[id] < 0.0f)
+        {
+            average_[id] = value;
+            return;
+        }
+        // the coefficients are per ms, and scaled to the time since the
+        // last update
+        const float dt        = float(timeDiffMs);
+        const float avgCoeff  = Min(kAverageCoeff * dt, 1.0f);
+        const float varCoeff  = Min(kVarianceCoeff * dt, 1.0f);
+        const float deviation = value - average_[id];
+        average_[id] += deviation * avgCoeff;
+
+        const float limit = 16.0f * variance_[id] + kMinNoise * kMinNoise;
+        float       d2    = deviation * deviation;
+        d2                = d2 < limit ? d2 : limit;
+        variance_[id] += (d2 - variance_[id]) * varCoeff;
+        noise_[id] = sqrtf(variance_[id]);
+    }
+
     PotMonitor(const PotMonitor&) = delete;
     PotMonitor& operator=(const PotMonitor&) = delete;
 
-    UiEventQueue* queue_;
-    BackendType*  backend_;
-    float         deadBand_;
-    float         deadBandIdle_;
-    uint16_t      timeout_;
-    float         lastValue_[numPots];
-    uint16_t      timeoutCounterMs_[numPots];
-    uint32_t      lastCallSysTime_;
+    static inline float Min(float a, float b) { return a < b ? a : b; }
+
+    /** The coefficients of the average and the noise estimate for 1 ms */
+    static constexpr float kAverageCoeff  = 1.0f / 16.0f;
+    static constexpr float kVarianceCoeff = 1.0f / 64.0f;
+    /** Lets the noise estimate grow from 0, about one 16 bit step */
+    static constexpr float kMinNoise = 1.0f / (1 << 16);
+
+    UiEventQueue*    queue_;
+    BackendType*     backend_;
+    float            deadBand_;
+    float            deadBandIdle_;
+    uint16_t         timeout_;
+    bool             adaptive_;
+    AdaptiveSettings settings_;
+    float            lastValue_[numPots];
+    uint16_t         timeoutCounterMs_[numPots];
+    float            average_[numPots];
+    float            variance_[numPots];
+    float            noise_[numPots];
+    bool             pending_[numPots];
+    Stats            stats_;
+    uint32_t         lastCallSysTime_;
 };
 
 } // namespace daisy
\ No newline at end of file
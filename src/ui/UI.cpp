@@ -9,6 +9,42 @@ void UiPage::Close()
         parent_->ClosePage(*this);
 }
 
+void UiPage::Invalidate()
+{
+    if(parent_ != nullptr)
+        parent_->Invalidate();
+}
+
+void UiPage::Invalidate(const Rectangle& area)
+{
+    if(parent_ != nullptr)
+        parent_->Invalidate(area);
+}
+
+// =========================================================================
+
+namespace
+{
+/** Covers any canvas, used for full redraws */
+const Rectangle kEntireCanvas(0, 0, 0x7fff, 0x7fff);
+
+/** The smallest rectangle that contains both rectangles */
+Rectangle Union(const Rectangle& a, const Rectangle& b)
+{
+    if(a.IsEmpty())
+        return b;
+    if(b.IsEmpty())
+        return a;
+    const int16_t left  = a.GetX() < b.GetX() ? a.GetX() : b.GetX();
+    const int16_t top   = a.GetY() < b.GetY() ? a.GetY() : b.GetY();
+    const int16_t right = a.GetRight() > b.GetRight() ? a.GetRight()
+                                                      : b.GetRight();
+    const int16_t bottom = a.GetBottom() > b.GetBottom() ? a.GetBottom()
+                                                         : b.GetBottom();
+    return {left, top, int16_t(right - left), int16_t(bottom - top)};
+}
+} // namespace
+
 // =========================================================================
 
 // =========================================================================
@@ -26,9 +62,14 @@ void UI::Init(UiEventQueue&                             inputQueue,
     specialControlIds_              = specialControlIds;
     canvases_                       = decltype(canvases_)(canvases);
     primaryOneBitGraphicsDisplayId_ = primaryOneBitGraphicsDisplayId;
+    eventTimeBudgetUs_              = 0;
 
+    lastEventTime_ = System::GetNow();
     for(int i = 0; i < kMaxNumCanvases; i++)
+    {
         lastUpdateTimes_[i] = 0;
+        invalidAreas_[i]    = kEntireCanvas;
+    }
 }
 
 UI::~UI()
@@ -44,8 +85,15 @@ void UI::Process()
     // handle user input
     if(!isMuted_)
     {
+        const uint32_t startUs        = System::GetUs();
+        bool           processedEvent = false;
         while(!eventQueue_->IsQueueEmpty())
         {
+            // leave the rest for the next call when out of time
+            if(processedEvent && eventTimeBudgetUs_ > 0
+               && System::GetUs() - startUs >= eventTimeBudgetUs_)
+                break;
+
             // clear next event if screen is off
             for(uint32_t i = 0; i < canvases_.GetNumElements(); i++)
             {
@@ -53,6 +101,7 @@ void UI::Process()
                 {
                     eventQueue_->GetAndRemoveNextEvent();
                     canvases_[i].screenSaverOn = false;
+                    invalidAreas_[i]           = kEntireCanvas;
                     break;
                 }
             }
@@ -62,10 +111,17 @@ void UI::Process()
             if(e.type != UiEventQueue::Event::EventType::invalid)
             {
                 ProcessEvent(e);
-                for(int32_t i = pages_.GetNumElements() - 1; i >= 0; i--)
-                    pages_[i]->OnUserInteraction();
+                processedEvent = true;
             }
         }
+
+        if(processedEvent)
+        {
+            for(int32_t i = pages_.GetNumElements() - 1; i >= 0; i--)
+                pages_[i]->OnUserInteraction();
+            // the pages may have changed in response
+            Invalidate();
+        }
     }
     else if(!queueEvents_)
     {
@@ -82,10 +138,13 @@ void UI::Process()
                   < canvases_[i].screenSaverTimeOut)
         {
             const uint32_t timeDiff = currentTimeInMs - lastUpdateTimes_[i];
-            if(timeDiff > canvases_[i].updateRateMs_)
+            const bool     needsRedraw
+                = !canvases_[i].redrawOnlyWhenInvalidated
+                  || !invalidAreas_[i].IsEmpty();
+            if(needsRedraw && timeDiff > canvases_[i].updateRateMs_)
                 RedrawCanvas(i, currentTimeInMs);
         }
-        else
+        else if(!canvases_[i].screenSaverOn)
         { // turn off oled
             canvases_[i].clearFunction_(canvases_[i]);
             canvases_[i].flushFunction_(canvases_[i]);
@@ -125,6 +184,7 @@ void UI::OpenPage(UiPage& page)
         // Remove focus
         pages_[pages_.GetNumElements() - 2]->OnFocusLost();
     page.OnFocusGained();
+    Invalidate();
 }
 
 /** Called to close a page: */
@@ -160,6 +220,19 @@ void UI::ClosePage(UiPage& page)
     // close the page
     page.OnHide();
     page.parent_ = nullptr;
+    Invalidate();
+}
+
+void UI::Invalidate()
+{
+    for(uint32_t i = 0; i < canvases_.GetNumElements(); i++)
+        invalidAreas_[i] = kEntireCanvas;
+}
+
+void UI::Invalidate(const Rectangle& area)
+{
+    for(uint32_t i = 0; i < canvases_.GetNumElements(); i++)
+        invalidAreas_[i] = Union(invalidAreas_[i], area);
 }
 
 void UI::ProcessEvent(const UiEventQueue::Event& e)
@@ -269,8 +342,16 @@ void UI::RedrawCanvas(uint8_t index, uint32_t currentTimeInSysticks)
     if(firstToDraw < 0)
         firstToDraw = 0;
 
-    // clear canvas
-    canvas.clearFunction_(canvas);
+    // clear canvas, or only the invalidated area if the canvas supports it
+    const bool partial = canvas.redrawOnlyWhenInvalidated
+                         && canvas.clearAreaFunction_ != nullptr
+                         && invalidAreas_[index] != kEntireCanvas;
+    canvas.redrawArea_   = partial ? invalidAreas_[index] : kEntireCanvas;
+    invalidAreas_[index] = Rectangle();
+    if(partial)
+        canvas.clearAreaFunction_(canvas, canvas.redrawArea_);
+    else
+        canvas.clearFunction_(canvas);
 
     // draw pages
     for(uint32_t i = firstToDraw; i < pages_.GetNumElements(); i++)
@@ -2,6 +2,7 @@
 #include <initializer_list>
 #include "UiEventQueue.h"
 #include "../util/Stack.h"
+#include "../hid/disp/graphics_common.h"
 
 namespace daisy
 {
@@ -63,6 +64,29 @@ struct UiCanvasDescriptor
      */
     using FlushFuncPtr = void (*)(const UiCanvasDescriptor& canvasToFlush);
     FlushFuncPtr flushFunction_;
+
+    /** If true, the canvas is only redrawn after it was invalidated, e.g.
+     *  by UiPage::Invalidate() or by user input, and at most every
+     *  updateRateMs_. While nothing changes, the clear, draw and flush
+     *  functions aren't called at all. Pages with content that changes
+     *  without user input must call UiPage::Invalidate() then.
+     *  If false, the canvas is redrawn every updateRateMs_.
+     */
+    bool redrawOnlyWhenInvalidated = false;
+
+    /** An optional function to clear an area of the canvas. If set, it's
+     *  used instead of clearFunction_ when only parts of the canvas were
+     *  invalidated.
+     */
+    using ClearAreaFuncPtr = void (*)(const UiCanvasDescriptor& canvasToClear,
+                                      const Rectangle&          area);
+    ClearAreaFuncPtr clearAreaFunction_ = nullptr;
+
+    /** The area that is being redrawn. It's set by the UI before the pages
+     *  are drawn, and covers the entire canvas for full redraws. Pages can
+     *  use it to skip drawing outside of this area.
+     */
+    Rectangle redrawArea_;
 };
 
 class OneBitGraphicsLookAndFeel;
@@ -92,7 +116,19 @@ class UiPage
     /** Returns true if the page is currently active on a UI - it may not be visible, though. */
     bool IsActive() { return parent_ != nullptr; }
 
-    /** Called on any user input event, after the respective callback has completed.
+    /** Asks the UI to redraw the canvases, e.g. because the content of this
+     *  page changed without user input. This is required for canvases with
+     *  `redrawOnlyWhenInvalidated` set. Does nothing if the page isn't active.
+     */
+    void Invalidate();
+
+    /** Asks the UI to redraw an area of the canvases. Canvases without a
+     *  `clearAreaFunction_` are redrawn entirely.
+     */
+    void Invalidate(const Rectangle& area);
+
+    /** Called after user input events were processed, once per call of
+     * UI::Process() that handled any events.
      * OnUserInteraction will be invoked for all pages in the page stack and can be used to 
      * track general user activity. */
     virtual void OnUserInteraction() {}
@@ -356,7 +392,8 @@ class UiPage
  *  used for the drawing, where each canvas could be a graphics display, 
  *  LEDs, alphanumeric displays, etc. The UI system makes sure that drawing 
  *  is executed with a constant refresh rate that can be individually 
- *  specified for each canvas.
+ *  specified for each canvas. Canvases with `redrawOnlyWhenInvalidated` 
+ *  are only redrawn after user input or a call to Invalidate().
  */
 class UI
 {
@@ -412,6 +449,16 @@ class UI
      **/
     void Process();
 
+    /** Limits the time that Process() spends on user input events. Once
+     *  the budget is used up, the remaining events are left in the queue
+     *  for the next call. At least one event is processed per call.
+     *  0 (the default) processes all events.
+     */
+    void SetEventTimeBudget(uint32_t budgetUs)
+    {
+        eventTimeBudgetUs_ = budgetUs;
+    }
+
     /** Call this to temporarily disable processing of user input, e.g.
      *  while a project is loading. If queueEvents==true, all user input
      *  that happens while muted will be queued up and processed when the
@@ -430,6 +477,14 @@ class UI
     /** Called to close a page. */
     void ClosePage(UiPage& page);
 
+    /** Requests a redraw of all canvases. See 
+     *  `UiCanvasDescriptor::redrawOnlyWhenInvalidated`.
+     */
+    void Invalidate();
+
+    /** Requests a redraw of an area on all canvases. */
+    void Invalidate(const Rectangle& area);
+
     /** If this UI has a canvas that uses a OneBitGraphicsDisplay AND this canvas should be used 
      *  as the main display for menus, etc. then this function returns the canvas ID of this display.
      *  If no such canvas exists, this function returns UI::invalidCanvasId.
@@ -453,10 +508,12 @@ class UI
     Stack<UiPage*, kMaxNumPages>               pages_;
     Stack<UiCanvasDescriptor, kMaxNumCanvases> canvases_;
     uint32_t          lastUpdateTimes_[kMaxNumCanvases];
+    Rectangle         invalidAreas_[kMaxNumCanvases];
     uint32_t          lastEventTime_;
     UiEventQueue*     eventQueue_;
     SpecialControlIds specialControlIds_;
     uint16_t          primaryOneBitGraphicsDisplayId_ = invalidCanvasId;
+    uint32_t          eventTimeBudgetUs_              = 0;
 
     // internal
     void RemovePage(UiPage* page);
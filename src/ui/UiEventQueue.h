@@ -81,7 +81,9 @@ class UiEventQueue
             {
                 /** The unique ID of the encoder that was turned. */
                 uint16_t id;
-                /** The number of increments detected. */
+                /** The number of increments detected, possibly with an
+                 *  acceleration curve applied (Encoder::AcceleratedIncrement)
+                 */
                 int16_t increments;
                 /** The total number of increments per revolution. */
                 uint16_t stepsPerRev;
@@ -124,7 +126,7 @@ class UiEventQueue
         e.asButtonPressed.numSuccessivePresses = numSuccessivePresses;
         e.asButtonPressed.isRetriggering       = isRetriggering;
         ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        Push(e);
     }
 
     /** Adds a Event::EventType::buttonReleased event to the queue. */
@@ -134,10 +136,15 @@ class UiEventQueue
         m.type                = Event::EventType::buttonReleased;
         m.asButtonReleased.id = buttonID;
         ScopedIrqBlocker sIrqBl;
-        events_.PushBack(m);
+        Push(m);
     }
 
-    /** Adds a Event::EventType::encoderTurned event to the queue. */
+    /** Adds a Event::EventType::encoderTurned event to the queue. If the
+     *  queue already holds a turn of this encoder that wasn't followed by
+     *  anything but encoder turns and pot moves, the increments are added
+     *  to that event instead. To make long sweeps faster, pass the
+     *  accelerated increments of Encoder::AcceleratedIncrement().
+     */
     void AddEncoderTurned(uint16_t encoderID,
                           int16_t  increments,
                           uint16_t stepsPerRev)
@@ -148,7 +155,8 @@ class UiEventQueue
         e.asEncoderTurned.increments  = increments;
         e.asEncoderTurned.stepsPerRev = stepsPerRev;
         ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        if(!Merge(e))
+            Push(e);
     }
 
     /** Adds a Event::EventType::encoderActivityChanged event to the queue. */
@@ -161,10 +169,13 @@ class UiEventQueue
             = isActive ? Event::ActivityType::active
                        : Event::ActivityType::inactive;
         ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        Push(e);
     }
 
-    /** Adds a Event::EventType::potMoved event to the queue. */
+    /** Adds a Event::EventType::potMoved event to the queue. Like encoder
+     *  turns, a pending move of the same pot is updated to the new position
+     *  instead.
+     */
     void AddPotMoved(uint16_t potId, float newPosition)
     {
         Event e;
@@ -172,7 +183,8 @@ class UiEventQueue
         e.asPotMoved.id          = potId;
         e.asPotMoved.newPosition = newPosition;
         ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        if(!Merge(e))
+            Push(e);
     }
 
     /** Adds a Event::EventType::potActivityChanged event to the queue. */
@@ -185,7 +197,7 @@ class UiEventQueue
             = isActive ? Event::ActivityType::active
                        : Event::ActivityType::inactive;
         ScopedIrqBlocker sIrqBl;
-        events_.PushBack(e);
+        Push(e);
     }
 
     /** Removes and returns an event from the queue. */
@@ -211,8 +223,79 @@ class UiEventQueue
         return events_.IsEmpty();
     }
 
+    /** Counts the events that didn't end up in the queue as separate events */
+    struct Stats
+    {
+        /** Events that were merged into a pending event of the same control */
+        uint32_t numMerged = 0;
+        /** Events that were dropped because the queue was full */
+        uint32_t numDropped = 0;
+    };
+
+    /** Returns the counters since construction or the last ResetStats(). */
+    Stats GetStats()
+    {
+        ScopedIrqBlocker sIrqBl;
+        return stats_;
+    }
+
+    /** Resets the counters returned by GetStats(). */
+    void ResetStats()
+    {
+        ScopedIrqBlocker sIrqBl;
+        stats_ = Stats();
+    }
+
   private:
     FIFO<Event, 256> events_;
+    Stats            stats_;
+
+    /** Adds an event. Call with interrupts blocked. */
+    void Push(const Event& e)
+    {
+        if(!events_.PushBack(e))
+            stats_.numDropped++;
+    }
+
+    /** Merges an encoder turn or pot move into a pending event of the same
+     *  control. Only the trailing turns and moves are searched, so the order
+     *  relative to other events is kept. Call with interrupts blocked.
+     *  Returns false if there was nothing to merge with.
+     */
+    bool Merge(const Event& e)
+    {
+        for(int i = int(events_.GetNumElements()) - 1; i >= 0; i--)
+        {
+            Event& pending = events_[i];
+            if(pending.type != Event::EventType::encoderTurned
+               && pending.type != Event::EventType::potMoved)
+                return false;
+            if(pending.type != e.type)
+                continue;
+
+            if(e.type == Event::EventType::encoderTurned
+               && pending.asEncoderTurned.id == e.asEncoderTurned.id)
+            {
+                const int32_t sum = int32_t(pending.asEncoderTurned.increments)
+                                    + e.asEncoderTurned.increments;
+                if(sum > INT16_MAX || sum < INT16_MIN)
+                    return false;
+                pending.asEncoderTurned.increments  = sum;
+                pending.asEncoderTurned.stepsPerRev
+                    = e.asEncoderTurned.stepsPerRev;
+                stats_.numMerged++;
+                return true;
+            }
+            if(e.type == Event::EventType::potMoved
+               && pending.asPotMoved.id == e.asPotMoved.id)
+            {
+                pending.asPotMoved.newPosition = e.asPotMoved.newPosition;
+                stats_.numMerged++;
+                return true;
+            }
+        }
+        return false;
+    }
 };
 
 } // namespace daisy
\ No newline at end of file
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <cmath>
+
+namespace daisy
+{
+/** @brief Passes audio from the audio callback to the UI for scopes and meters
+ *  @ingroup utility
+ *
+ *  The audio callback hands its blocks to Process(), which decimates them
+ *  into `numColumns` columns per frame: the lowest and highest sample of
+ *  each column for a scope display, plus the peak and RMS level of the whole
+ *  frame for a meter. Each sample costs a few comparisons and a multiply,
+ *  regardless of how the UI uses the data.
+ *
+ *  Complete frames are passed on through a lock-free triple buffer: the
+ *  audio callback always has a frame to write to and the UI always has the
+ *  last complete frame to read from, so neither waits for the other and the
+ *  UI never sees a frame that is half old, half new. Process() must only be
+ *  called from one context (the audio callback), GetFrame() only from
+ *  another (e.g. the main loop).
+ *
+ *      AudioScopeBuffer<2, 128> scope;
+ *
+ *      void AudioCallback(AudioHandle::InputBuffer  in,
+ *                         AudioHandle::OutputBuffer out,
+ *                         size_t                    size)
+ *      {
+ *          ...
+ *          scope.Process(out, size);
+ *      }
+ *
+ *      // in main(), before starting the audio:
+ *      scope.Init(8); // 128 columns of 8 samples, i.e. 47 frames/s at 48kHz
+ *
+ *  ScopePage and LevelMeterPage draw the frames on a UI.
+ *
+ *  \tparam numChannels_ the number of audio channels
+ *  \tparam numColumns_  the number of columns per frame, e.g. the width of
+ *                       the display
+ */
+template <size_t numChannels_, size_t numColumns_>
+class AudioScopeBuffer
+{
+  public:
+    static constexpr size_t numChannels = numChannels_;
+    static constexpr size_t numColumns  = numColumns_;
+
+    /** The decimated audio of `numColumns * samplesPerColumn` samples */
+    struct Frame
+    {
+        /** lowest sample of each column, oldest column first */
+        float min[numChannels][numColumns];
+        /** highest sample of each column, oldest column first */
+        float max[numChannels][numColumns];
+        /** highest absolute sample value of the frame */
+        float peak[numChannels];
+        /** root mean square of the samples of the frame */
+        float rms[numChannels];
+        /** counts the frames, starting at 1; 0 before the first frame */
+        uint32_t number;
+    };
+
+    AudioScopeBuffer() : middle_(kMiddle) {}
+
+    /** Initializes the buffer. Call this before the audio callback starts.
+     *  \param samplesPerColumn how many samples make up one column
+     */
+    void Init(size_t samplesPerColumn)
+    {
+        samplesPerColumn_ = samplesPerColumn > 0 ? samplesPerColumn : 1;
+        for(auto& frame : frames_)
+            frame = Frame();
+        write_       = kWrite;
+        read_        = kRead;
+        frameNumber_ = 0;
+        middle_.store(kMiddle);
+        column_        = 0;
+        columnSamples_ = 0;
+        ResetColumn();
+        for(size_t ch = 0; ch < numChannels; ch++)
+        {
+            peak_[ch]         = 0.0f;
+            sumOfSquares_[ch] = 0.0f;
+        }
+    }
+
+    /** Adds a block of audio, one buffer per channel, e.g. the buffers of
+     *  the non-interleaving audio callback. Call from the audio callback.
+     */
+    void Process(const float* const* in, size_t size)
+    {
+        size_t i = 0;
+        while(i < size)
+        {
+            const size_t remaining = samplesPerColumn_ - columnSamples_;
+            const size_t count = (size - i < remaining) ? size - i : remaining;
+            for(size_t ch = 0; ch < numChannels; ch++)
+                Accumulate(ch, &in[ch][i], 1, count);
+            i += count;
+            AdvanceColumn(count);
+        }
+    }
+
+    /** Adds a block of interleaved audio with `size` frames of
+     *  `numChannels` samples, e.g. the buffers of the interleaving audio
+     *  callback. Call from the audio callback.
+     */
+    void ProcessInterleaved(const float* in, size_t size)
+    {
+        size_t i = 0;
+        while(i < size)
+        {
+            const size_t remaining = samplesPerColumn_ - columnSamples_;
+            const size_t count = (size - i < remaining) ? size - i : remaining;
+            for(size_t ch = 0; ch < numChannels; ch++)
+                Accumulate(ch, &in[i * numChannels + ch], numChannels, count);
+            i += count;
+            AdvanceColumn(count);
+        }
+    }
+
+    /** Returns true if a frame was completed since the last GetFrame() */
+    bool HasNewFrame() const { return (middle_.load() & kNewFrame) != 0; }
+
+    /** Returns the last complete frame. The frame doesn't change until the
+     *  next call. Call from the UI context.
+     */
+    const Frame& GetFrame()
+    {
+        if((middle_.load() & kNewFrame) != 0)
+            read_ = middle_.exchange(read_) & kIndexMask;
+        return frames_[read_];
+    }
+
+    /** Returns how many samples make up one column */
+    size_t GetSamplesPerColumn() const { return samplesPerColumn_; }
+
+  private:
+    // the triple buffer: the audio callback owns `write_`, the UI owns
+    // `read_`, and they swap with `middle_`, which also flags unread frames
+    static constexpr uint8_t kWrite     = 0;
+    static constexpr uint8_t kRead      = 1;
+    static constexpr uint8_t kMiddle    = 2;
+    static constexpr uint8_t kIndexMask = 0x03;
+    static constexpr uint8_t kNewFrame  = 0x04;
+
+    void Accumulate(size_t ch, const float* in, size_t stride, size_t count)
+    {
+        float lo = min_[ch], hi = max_[ch], sum = 0.0f;
+        for(size_t i = 0; i < count; i++)
+        {
+            const float sample = in[i * stride];
+            lo                 = sample < lo ? sample : lo;
+            hi                 = sample > hi ? sample : hi;
+            sum += sample * sample;
+        }
+        min_[ch] = lo;
+        max_[ch] = hi;
+        sumOfSquares_[ch] += sum;
+    }
+
+    void AdvanceColumn(size_t count)
+    {
+        columnSamples_ += count;
+        if(columnSamples_ < samplesPerColumn_)
+            return;
+
+        Frame& frame = frames_[write_];
+        for(size_t ch = 0; ch < numChannels; ch++)
+        {
+            frame.min[ch][column_] = min_[ch];
+            frame.max[ch][column_] = max_[ch];
+            const float level      = fmaxf(-min_[ch], max_[ch]);
+            peak_[ch]              = level > peak_[ch] ? level : peak_[ch];
+        }
+        ResetColumn();
+        columnSamples_ = 0;
+        if(++column_ < numColumns)
+            return;
+
+        // the frame is complete
+        const float numSamples = float(numColumns * samplesPerColumn_);
+        for(size_t ch = 0; ch < numChannels; ch++)
+        {
+            frame.peak[ch]    = peak_[ch];
+            frame.rms[ch]     = sqrtf(sumOfSquares_[ch] / numSamples);
+            peak_[ch]         = 0.0f;
+            sumOfSquares_[ch] = 0.0f;
+        }
+        frame.number = ++frameNumber_;
+        write_       = middle_.exchange(write_ | kNewFrame) & kIndexMask;
+        column_      = 0;
+    }
+
+    void ResetColumn()
+    {
+        for(size_t ch = 0; ch < numChannels; ch++)
+        {
+            min_[ch] = INFINITY;
+            max_[ch] = -INFINITY;
+        }
+    }
+
+    Frame                frames_[3];
+    uint8_t              write_ = kWrite;
+    uint8_t              read_  = kRead;
+    std::atomic<uint8_t> middle_;
+    uint32_t             frameNumber_      = 0;
+    size_t               samplesPerColumn_ = 1;
+    size_t               column_           = 0;
+    size_t               columnSamples_    = 0;
+    float                min_[numChannels];
+    float                max_[numChannels];
+    float                peak_[numChannels];
+    float                sumOfSquares_[numChannels];
+};
+
+} // namespace daisy
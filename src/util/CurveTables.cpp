@@ -0,0 +1,72 @@
+#include "CurveTables.h"
+
+namespace daisy
+{
+namespace
+{
+    constexpr double kLn2Double = 0.69314718055994530942;
+
+    /** e^x for small x, by its Taylor series */
+    constexpr double Exp(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for(int n = 1; n < 30; n++)
+        {
+            term *= x / n;
+            sum += term;
+        }
+        return sum;
+    }
+
+    /** ln(x) for 1 <= x <= 2, by the series of 2 * atanh((x - 1) / (x + 1)) */
+    constexpr double Ln(double x)
+    {
+        const double y   = (x - 1.0) / (x + 1.0);
+        double       sum = 0.0, power = y;
+        for(int n = 1; n < 60; n += 2)
+        {
+            sum += power / n;
+            power *= y * y;
+        }
+        return 2.0 * sum;
+    }
+
+    constexpr CurveTables::Table MakeExp2Table()
+    {
+        CurveTables::Table table{};
+        for(int i = 0; i < CurveTables::kPointsPerOctave; i++)
+        {
+            const double x  = double(i) / CurveTables::kPointsPerOctave;
+            table.values[i] = float(Exp(kLn2Double * x));
+        }
+        return table;
+    }
+
+    constexpr CurveTables::Table MakeLog2Table()
+    {
+        CurveTables::Table table{};
+        for(int i = 0; i < CurveTables::kPointsPerOctave; i++)
+        {
+            const double x  = double(i) / CurveTables::kPointsPerOctave;
+            table.values[i] = float(Ln(1.0 + x) / kLn2Double);
+        }
+        return table;
+    }
+
+    constexpr CurveTables::Table MakeInvKnotTable()
+    {
+        CurveTables::Table table{};
+        for(int i = 0; i < CurveTables::kPointsPerOctave; i++)
+        {
+            const double x  = double(i) / CurveTables::kPointsPerOctave;
+            table.values[i] = float(1.0 / (1.0 + x));
+        }
+        return table;
+    }
+} // namespace
+
+const CurveTables::Table CurveTables::exp2Table_    = MakeExp2Table();
+const CurveTables::Table CurveTables::log2Table_    = MakeLog2Table();
+const CurveTables::Table CurveTables::invKnotTable_ = MakeInvKnotTable();
+
+} // namespace daisy
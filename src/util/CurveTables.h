@@ -0,0 +1,100 @@
+#pragma once
+#ifndef DSY_CURVE_TABLES_H
+#define DSY_CURVE_TABLES_H
+#include <stdint.h>
+#include <string.h>
+
+namespace daisy
+{
+/** @addtogroup utility
+    @{
+*/
+
+/** @brief Table based exp2() and log2() for mapping control values to curves
+ *
+ *  The logarithmic curves of Parameter and MappedFloatValue are evaluated
+ *  for every control update, and on the target expf()/powf()/log10f() are
+ *  computed in software by newlib. The tables are meant to be faster there,
+ *  which hasn't been measured yet. On an x86 host, glibc's expf() and
+ *  log2f() are faster than the tables, see the benchmark in
+ *  CurveTables_gtest.cpp. These functions look up 2^x and log2(x) at 64
+ *  points per octave in tables that are computed at compile time and
+ *  shared by all curves, and interpolate between the points with a short
+ *  polynomial. Each curve instance only stores its
+ *  range in the log2 domain, e.g. `log2(max / min)`.
+ *
+ *  Error bounds, checked over the whole range by the unit tests:
+ *  - Exp2(): relative error below 3e-7 (a few float ulps) for
+ *    -126 <= x < 128; the argument is clamped to that range.
+ *  - Log2(): absolute error below 2e-7 plus half an ulp of the result for
+ *    all normal floats > 0. Zero, negative and subnormal arguments return
+ *    -126.
+ */
+class CurveTables
+{
+  public:
+    /** The number of table points per octave */
+    static constexpr int kPointsPerOctave = 64;
+
+    /** A table with one value per point of an octave */
+    struct Table
+    {
+        float values[kPointsPerOctave];
+    };
+
+    /** Returns 2 to the power of x */
+    static inline float Exp2(float x)
+    {
+        x = x < -126.0f ? -126.0f : (x < 127.99f ? x : 127.99f);
+
+        // x = (octave * 64 + point + fraction) / 64
+        const float scaled = x * float(kPointsPerOctave);
+        int32_t     index  = int32_t(scaled);
+        index -= scaled < float(index) ? 1 : 0;
+        const float   t      = (scaled - float(index)) * kLn2 / 64.0f;
+        const int32_t point  = index & (kPointsPerOctave - 1);
+        const int32_t octave = (index - point) / kPointsPerOctave;
+
+        // 2^(t / ln2) = e^t with 0 <= t < ln2 / 64
+        const float poly = 1.0f + t * (1.0f + t * (0.5f + t * (1.0f / 6.0f)));
+
+        const uint32_t bits  = uint32_t(octave + 127) << 23;
+        float          scale = 0.0f;
+        memcpy(&scale, &bits, sizeof(scale));
+        return exp2Table_.values[point] * poly * scale;
+    }
+
+    /** Returns the base 2 logarithm of x */
+    static inline float Log2(float x)
+    {
+        uint32_t bits = 0;
+        memcpy(&bits, &x, sizeof(bits));
+        if(x <= 0.0f || (bits & 0x7F800000u) == 0)
+            return -126.0f;
+
+        // x = 2^octave * mantissa with 1 <= mantissa < 2
+        const int32_t  octave   = int32_t(bits >> 23) - 127;
+        const int32_t  point    = (bits >> 17) & (kPointsPerOctave - 1);
+        const uint32_t mbits    = (bits & 0x007FFFFFu) | 0x3F800000u;
+        float          mantissa = 0.0f;
+        memcpy(&mantissa, &mbits, sizeof(mantissa));
+
+        // mantissa = knot * (1 + r) with 0 <= r < 1/64
+        const float knot = 1.0f + float(point) / float(kPointsPerOctave);
+        const float r    = (mantissa - knot) * invKnotTable_.values[point];
+        const float q    = 0.5f - r * (1.0f / 3.0f - r * 0.25f);
+        const float poly = r * (1.0f - r * q);
+        return float(octave) + (log2Table_.values[point] + poly / kLn2);
+    }
+
+  private:
+    static constexpr float kLn2 = 0.693147180559945309f;
+
+    static const Table exp2Table_;    /**< 2^(i/64) */
+    static const Table log2Table_;    /**< log2(1 + i/64) */
+    static const Table invKnotTable_; /**< 1 / (1 + i/64) */
+};
+
+/** @} */
+} // namespace daisy
+#endif
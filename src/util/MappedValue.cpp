@@ -1,4 +1,5 @@
 #include "MappedValue.h"
+#include "CurveTables.h"
 #include <cmath>
 #include <cstring>
 
@@ -24,6 +25,11 @@ MappedFloatValue::MappedFloatValue(float       min,
   numDecimals_(numDecimals),
   forceSign_(forceSign)
 {
+    if(mapping_ == Mapping::log)
+    {
+        log2Min_   = CurveTables::Log2(min_);
+        log2Range_ = CurveTables::Log2(max_) - log2Min_;
+    }
 }
 
 void MappedFloatValue::Set(float newValue)
@@ -49,8 +55,8 @@ float MappedFloatValue::GetAs0to1() const
         case Mapping::lin: return (value_ - min_) / (max_ - min_);
         case Mapping::log:
         {
-            const float a = 1.0f / (log10f(max_ / min_));
-            return std::max(0.0f, std::min(1.0f, a * log10f(value_ / min_)));
+            const float octaves = CurveTables::Log2(value_) - log2Min_;
+            return std::max(0.0f, std::min(1.0f, octaves / log2Range_));
         }
         case Mapping::pow2:
         {
@@ -71,8 +77,8 @@ void MappedFloatValue::SetFrom0to1(float normalizedValue0to1)
             break;
         case Mapping::log:
         {
-            const float a = 1.0f / log10f(max_ / min_);
-            v             = min_ * powf(10, normalizedValue0to1 / a);
+            v = CurveTables::Exp2(normalizedValue0to1 * log2Range_
+                                  + log2Min_);
         }
         break;
         case Mapping::pow2:
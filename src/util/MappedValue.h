@@ -47,7 +47,8 @@ class MappedFloatValue : public MappedValue
         /** The value is mapped linearly between min and max. */
         lin,
         /** The value is mapped logarithmically. Note that the valid 
-         *  values must be strictly larger than zero, so: min > 0, max > 0
+         *  values must be strictly larger than zero, so: min > 0, max > 0.
+         *  The curve is evaluated with the lookup tables of CurveTables.
          */
         log,
         /** The value is mapped with a square law */
@@ -120,6 +121,8 @@ class MappedFloatValue : public MappedValue
     const char*            unitStr_;
     const uint8_t          numDecimals_;
     const bool             forceSign_;
+    float                  log2Min_            = 0.0f; // for Mapping::log
+    float                  log2Range_          = 1.0f; // for Mapping::log
     static constexpr float coarseStepSize0to1_ = 0.05f;
     static constexpr float fineStepSize0to1_   = 0.01f;
 };
@@ -0,0 +1,343 @@
+#pragma once
+#ifndef DSY_MIDI_CLOCK_FOLLOWER_H
+#define DSY_MIDI_CLOCK_FOLLOWER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hid/MidiEvent.h"
+
+namespace daisy
+{
+/** @brief Follows an incoming MIDI clock and estimates its tempo
+ *  @addtogroup utility
+ *
+ *  MIDI Timing Clock messages arrive with the jitter of the transport and of
+ *  the main loop that pops them from the MidiHandler. Instead of averaging
+ *  the raw intervals, this class fits a straight line through the receive
+ *  timestamps of the most recent clock ticks (least squares), which
+ *  gives a stable tempo and a smooth beat position to derive delay times or
+ *  LFO phases from.
+ *
+ *  Intervals that are far off the current estimate are treated as jitter and
+ *  left out of the fit; when several arrive in a row the tempo has changed and
+ *  the fit starts over.
+ *
+ *  Usage:
+ *  - Pass all MIDI events, together with a timestamp in microseconds
+ *    (e.g. `System::GetUs()`), to ProcessEvent().
+ *  - Call Process() once per audio block with the current time, then read
+ *    GetBeats() / GetBeatPhase().
+ */
+class MidiClockFollower
+{
+  public:
+    /** MIDI clock ticks per quarter note */
+    static constexpr size_t kTicksPerBeat = 24;
+    /** Maximum number of ticks used for the tempo fit */
+    static constexpr size_t kMaxWindowSize = 48;
+
+    struct Config
+    {
+        /** Number of ticks used for the tempo fit, up to kMaxWindowSize */
+        size_t window_size;
+        /** Number of ticks in the fit before the follower reports a lock */
+        size_t lock_ticks;
+        /** Maximum relative deviation of a tick interval from the estimated
+         *  period before it is treated as an outlier */
+        float max_deviation;
+        /** Number of consecutive outliers that indicate a tempo change */
+        size_t max_outliers;
+        /** Time without clock ticks after which the lock is lost */
+        uint32_t timeout_us;
+
+        void Defaults()
+        {
+            window_size   = 24;
+            lock_ticks    = 6;
+            max_deviation = 0.3f;
+            max_outliers  = 3;
+            timeout_us    = 500000;
+        }
+    };
+
+    MidiClockFollower() {}
+    ~MidiClockFollower() {}
+
+    /** Initializes the follower with the default configuration */
+    void Init()
+    {
+        Config config;
+        config.Defaults();
+        Init(config);
+    }
+
+    /** Initializes the follower */
+    void Init(const Config& config)
+    {
+        config_ = config;
+        if(config_.window_size > kMaxWindowSize)
+            config_.window_size = kMaxWindowSize;
+        if(config_.window_size < 2)
+            config_.window_size = 2;
+        if(config_.lock_ticks < 2)
+            config_.lock_ticks = 2;
+        running_      = false;
+        position_     = 0;
+        beats_        = 0.f;
+        period_us_    = 0.f;
+        fit_time_     = 0.f;
+        fit_origin_   = 0;
+        last_time_    = 0;
+        outlier_time_ = 0;
+        ResetFit();
+    }
+
+    /** Passes a MIDI event to the follower.
+     *  Handles Timing Clock, Start, Continue, Stop and Song Position Pointer;
+     *  all other events are ignored.
+     *  \param event   The received event
+     *  \param time_us Time of reception in microseconds
+     *  \return true if the event was used by the follower
+     */
+    bool ProcessEvent(const MidiEvent& event, uint32_t time_us)
+    {
+        if(event.type == SystemRealTime)
+        {
+            switch(event.srt_type)
+            {
+                case SystemRealTimeType::TimingClock:
+                    Clock(time_us);
+                    return true;
+                case SystemRealTimeType::Start: Start(); return true;
+                case SystemRealTimeType::Continue: Continue(); return true;
+                case SystemRealTimeType::Stop: Stop(); return true;
+                default: return false;
+            }
+        }
+        if(event.type == SystemCommon && event.sc_type == SongPositionPointer)
+        {
+            SongPosition(((uint16_t)event.data[1] << 7) | event.data[0]);
+            return true;
+        }
+        return false;
+    }
+
+    /** Handles a Timing Clock message received at the given time */
+    void Clock(uint32_t time_us)
+    {
+        // the position only moves while the transport is running
+        if(running_)
+            position_++;
+
+        if(fit_count_ > 0)
+        {
+            // measured from the last tick in the fit, so that a late tick
+            // doesn't make the next one look early as well
+            const uint32_t interval = time_us - last_time_;
+            if(fit_count_ >= 2)
+            {
+                // in ticks of the estimated period
+                const float    ticks   = (float)interval / period_us_;
+                const uint32_t elapsed = (uint32_t)(ticks + 0.5f);
+                const float    error   = ticks - (float)elapsed;
+                const float    limit   = config_.max_deviation;
+                const bool     on_grid = error <= limit && error >= -limit;
+                // after outliers, only the skipped ticks may lie in between
+                const size_t skipped = outliers_;
+                if(on_grid && elapsed > skipped
+                   && (skipped == 0 || elapsed == skipped + 1))
+                {
+                    // whole missing ticks (e.g. a dropped byte) are counted
+                    // instead of being treated as outliers; skipped ticks
+                    // are already in the position
+                    tick_ += elapsed - 1;
+                    if(running_)
+                        position_ += (int32_t)(elapsed - 1 - skipped);
+                }
+                else
+                {
+                    if(++outliers_ < config_.max_outliers)
+                    {
+                        // jitter: skip the timestamp, the tick is counted
+                        // when the next one is accepted
+                        outlier_time_ = time_us;
+                        return;
+                    }
+                    // tempo change: start over from the previous tick
+                    uint32_t prev_time = last_time_;
+                    if(outliers_ > 1)
+                        prev_time = outlier_time_;
+                    ResetFit();
+                    AddToFit(prev_time);
+                }
+            }
+        }
+        outliers_ = 0;
+        AddToFit(time_us);
+    }
+
+    /** Handles a Start message. The next clock tick is the first beat. */
+    void Start()
+    {
+        running_  = true;
+        position_ = -1;
+    }
+
+    /** Handles a Continue message. The position resumes where it stopped. */
+    void Continue() { running_ = true; }
+
+    /** Handles a Stop message */
+    void Stop() { running_ = false; }
+
+    /** Handles a Song Position Pointer message.
+     *  \param sixteenths Position in MIDI beats (sixteenth notes)
+     */
+    void SongPosition(uint16_t sixteenths)
+    {
+        position_ = (int32_t)sixteenths * (kTicksPerBeat / 4) - 1;
+    }
+
+    /** Updates the beat position for the given time and checks for a
+     *  timeout of the clock signal. Call this once per audio block.
+     */
+    void Process(uint32_t now_us)
+    {
+        const uint32_t since_last = now_us - last_time_;
+        if(fit_count_ > 0 && since_last > config_.timeout_us)
+        {
+            // keep the last tempo, but report that we're no longer locked
+            ResetFit();
+        }
+
+        if(!running_ || position_ < 0)
+        {
+            beats_ = position_ < 0 ? 0.f
+                                   : (float)position_ / (float)kTicksPerBeat;
+            return;
+        }
+
+        // interpolate between ticks using the fitted tick time, but never
+        // run further ahead than the next expected tick
+        float frac = 0.f;
+        if(period_us_ > 0.f)
+        {
+            frac = ((float)(now_us - fit_origin_) - fit_time_) / period_us_;
+            frac = frac < 0.f ? 0.f : (frac > 1.f ? 1.f : frac);
+        }
+        beats_ = ((float)position_ + frac) / (float)kTicksPerBeat;
+    }
+
+    /** Returns the position in quarter notes since Start, as of the
+     *  last call to Process() */
+    float GetBeats() const { return beats_; }
+
+    /** Returns the phase within the current quarter note, 0..1,
+     *  as of the last call to Process() */
+    float GetBeatPhase() const { return beats_ - (float)(int32_t)beats_; }
+
+    /** Returns the estimated tempo in beats per minute,
+     *  or 0 if no tempo has been measured yet */
+    float GetBpm() const
+    {
+        return period_us_ > 0.f
+                   ? 60000000.f / (period_us_ * (float)kTicksPerBeat)
+                   : 0.f;
+    }
+
+    /** Returns the estimated time between two clock ticks in microseconds */
+    float GetTickPeriodUs() const { return period_us_; }
+
+    /** Returns true if enough regular clock ticks have been received
+     *  for a reliable tempo estimate */
+    bool IsLocked() const { return fit_count_ >= config_.lock_ticks; }
+
+    /** Returns true between Start/Continue and Stop */
+    bool IsRunning() const { return running_; }
+
+  private:
+    void ResetFit()
+    {
+        fit_count_ = 0;
+        fit_head_  = 0;
+        outliers_  = 0;
+        tick_      = 0;
+    }
+
+    void AddToFit(uint32_t time_us)
+    {
+        times_[fit_head_] = time_us;
+        ticks_[fit_head_] = tick_;
+        fit_head_         = (fit_head_ + 1) % config_.window_size;
+        if(fit_count_ < config_.window_size)
+            fit_count_++;
+        last_time_ = time_us;
+        tick_++;
+        UpdateFit();
+    }
+
+    /** Least squares line through (tick, time) of the ticks in the window */
+    void UpdateFit()
+    {
+        if(fit_count_ < 2)
+        {
+            fit_origin_ = last_time_;
+            fit_time_   = 0.f;
+            return;
+        }
+
+        // work relative to the oldest entry to keep the floats small
+        const size_t   size        = config_.window_size;
+        const size_t   oldest      = (fit_head_ + size - fit_count_) % size;
+        const uint32_t origin_time = times_[oldest];
+        const uint32_t origin_tick = ticks_[oldest];
+
+        float sum_x = 0.f, sum_y = 0.f;
+        for(size_t i = 0; i < fit_count_; i++)
+        {
+            const size_t idx = (oldest + i) % size;
+            sum_x += (float)(ticks_[idx] - origin_tick);
+            sum_y += (float)(times_[idx] - origin_time);
+        }
+        const float mean_x = sum_x / (float)fit_count_;
+        const float mean_y = sum_y / (float)fit_count_;
+
+        float sxx = 0.f, sxy = 0.f;
+        for(size_t i = 0; i < fit_count_; i++)
+        {
+            const size_t idx = (oldest + i) % size;
+            const float  dx  = (float)(ticks_[idx] - origin_tick) - mean_x;
+            const float  dy  = (float)(times_[idx] - origin_time) - mean_y;
+            sxx += dx * dx;
+            sxy += dx * dy;
+        }
+        if(sxx <= 0.f)
+            return;
+
+        period_us_ = sxy / sxx;
+
+        // fitted time of the newest tick, relative to fit_origin_
+        const float newest_x = (float)(tick_ - 1 - origin_tick);
+        fit_origin_          = origin_time;
+        fit_time_            = mean_y + period_us_ * (newest_x - mean_x);
+    }
+
+    Config   config_;
+    uint32_t times_[kMaxWindowSize];
+    uint32_t ticks_[kMaxWindowSize];
+    size_t   fit_head_;
+    size_t   fit_count_;
+    size_t   outliers_;
+    uint32_t tick_;
+    uint32_t last_time_;
+    uint32_t outlier_time_;
+    uint32_t fit_origin_;
+    float    fit_time_;
+    float    period_us_;
+    bool     running_;
+    int32_t  position_;
+    float    beats_;
+};
+
+} // namespace daisy
+
+#endif
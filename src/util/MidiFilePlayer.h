@@ -0,0 +1,553 @@
+#pragma once
+#ifndef DSY_MIDI_FILE_PLAYER_H
+#define DSY_MIDI_FILE_PLAYER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hid/MidiEvent.h"
+#include "hid/midi_parser.h"
+#include "util/FileReader.h"
+
+namespace daisy
+{
+/** @brief Streams a Standard MIDI File (format 0 or 1) from an IReader
+ *  @addtogroup utility
+ *
+ *  Instead of loading the whole file into memory, each track chunk is read
+ *  through a small read-ahead buffer of kTrackBufferBytes, refilled from the
+ *  file as the track is played. The tracks are merged in time order with a
+ *  min-heap keyed on the absolute tick of each track's next event, so the cost
+ *  per event is O(log kMaxTracks) regardless of the file size.
+ *
+ *  Event times are converted to samples, following the Set Tempo meta events
+ *  of the file (or the SMPTE time division). Channel messages and SysEx are
+ *  returned as MidiEvents; meta events and SysEx escapes are skipped.
+ *
+ *  Usage, with the FatFS FileReader (or the stdio one on the host):
+ *  - Open() the file, then call Process() with the number of samples of
+ *    each audio block.
+ *  - While HasEvents(), the events that fall into the block can be read with
+ *    PopEvent(). GetNextEventTime() - (GetPosition() - block size) is the
+ *    sample offset of the next event within the block.
+ *
+ *  The tracks are read from the SD card on demand, so Process() and the
+ *  event functions should be called from the main loop, not from the
+ *  audio callback. The sample count can be taken from the audio callback.
+ *
+ *  @tparam kMaxTracks        Maximum number of tracks in a file
+ *  @tparam kTrackBufferBytes Read-ahead buffer size per track
+ */
+template <size_t kMaxTracks = 16, size_t kTrackBufferBytes = 64>
+class MidiFilePlayer
+{
+    static_assert(kMaxTracks > 0 && kMaxTracks < 256,
+                  "MidiFilePlayer supports 1 to 255 tracks");
+    static_assert(kTrackBufferBytes >= 4,
+                  "MidiFilePlayer needs a track buffer of at least 4 bytes");
+
+  public:
+    /** Return values for Open() */
+    enum class Result
+    {
+        Ok,
+        ReadError,         /**< The reader failed to seek or read */
+        InvalidFile,       /**< Not a Standard MIDI File, or truncated */
+        UnsupportedFormat, /**< Format 2 (sequential tracks) */
+        TooManyTracks,     /**< More than kMaxTracks tracks */
+    };
+
+    MidiFilePlayer() {}
+    ~MidiFilePlayer() {}
+
+    /** Initializes the player
+     *  \param samplerate Audio sample rate that event times are counted in
+     */
+    void Init(float samplerate)
+    {
+        samplerate_  = (uint32_t)(samplerate + 0.5f);
+        reader_      = nullptr;
+        num_tracks_  = 0;
+        heap_size_   = 0;
+        format_      = 0;
+        smpte_tempo_ = 0;
+        tempo_       = kDefaultTempo;
+        looping_     = false;
+        loop_start_  = 0;
+        position_    = 0;
+        pending_     = false;
+        parser_.Init();
+    }
+
+    /** Opens a file and rewinds playback to its start.
+     *  The reader must stay valid while the file is played.
+     */
+    Result Open(IReader* reader)
+    {
+        reader_     = reader;
+        num_tracks_ = 0;
+        heap_size_  = 0;
+
+        uint8_t header[14];
+        if(!reader_->seek(0))
+            return Result::ReadError;
+        reader_pos_ = 0;
+        if(ReadAt(0, header, 14) != 14)
+            return Result::InvalidFile;
+        const uint32_t header_len = ReadU32(header + 4);
+        if(ReadU32(header) != kMThd || header_len < 6)
+            return Result::InvalidFile;
+        format_                 = ReadU16(header + 8);
+        const uint16_t ntracks  = ReadU16(header + 10);
+        const uint16_t division = ReadU16(header + 12);
+        if(format_ > 2)
+            return Result::InvalidFile;
+        if(format_ == 2)
+            return Result::UnsupportedFormat;
+        if(ntracks > kMaxTracks)
+            return Result::TooManyTracks;
+        if(division == 0 || (division & 0x8000 && (division & 0xff) == 0))
+            return Result::InvalidFile;
+
+        if(division & 0x8000)
+        {
+            // SMPTE: ticks per second = frames per second * ticks per frame,
+            // counted with a fixed "tempo" of one second per tick unit
+            const uint8_t  fps    = 256 - (division >> 8);
+            const uint32_t frames = fps == 29 ? 30 : fps;
+            smpte_tempo_          = fps == 29 ? 1001000 : 1000000;
+            division_             = frames * (division & 0xff);
+        }
+        else
+        {
+            smpte_tempo_ = 0;
+            division_    = division;
+        }
+
+        // locate the track chunks, skipping any unknown chunks
+        uint32_t pos = 8 + header_len;
+        while(num_tracks_ < ntracks)
+        {
+            uint8_t chunk[8];
+            if(ReadAt(pos, chunk, 8) != 8)
+                return Result::InvalidFile;
+            const uint32_t len = ReadU32(chunk + 4);
+            pos += 8;
+            if(ReadU32(chunk) == kMTrk)
+            {
+                tracks_[num_tracks_].start = pos;
+                tracks_[num_tracks_].end   = pos + len;
+                num_tracks_++;
+            }
+            pos += len;
+        }
+        if(num_tracks_ == 0)
+            return Result::InvalidFile;
+
+        loop_start_ = 0;
+        position_   = 0;
+        Rewind();
+        return Result::Ok;
+    }
+
+    /** Restarts playback from the beginning of the file */
+    void Restart()
+    {
+        loop_start_ = 0;
+        position_   = 0;
+        Rewind();
+    }
+
+    /** When enabled, playback starts over after the last End of Track */
+    void SetLooping(bool looping) { looping_ = looping; }
+
+    /** Advances the playhead. Events before the new position become due. */
+    void Process(size_t num_samples) { position_ += num_samples; }
+
+    /** Returns true if an event is due, i.e. it's before the playhead */
+    bool HasEvents()
+    {
+        if(!pending_)
+            ReadNextEvent();
+        return pending_ && next_time_ < position_;
+    }
+
+    /** Returns the next event. Only valid after HasEvents() returned true. */
+    MidiEvent PopEvent()
+    {
+        pending_ = false;
+        return next_event_;
+    }
+
+    /** Returns the time in samples of the event that PopEvent() returns next.
+     *  Only valid after HasEvents() returned true.
+     */
+    uint32_t GetNextEventTime() const { return next_time_; }
+
+    /** Returns the playhead in samples since the start of playback */
+    uint32_t GetPosition() const { return position_; }
+
+    /** Returns true once all tracks have ended and all events were read */
+    bool IsFinished()
+    {
+        if(!pending_)
+            ReadNextEvent();
+        return !pending_;
+    }
+
+    /** Returns the current tempo in beats per minute, or 0 for files with
+     *  SMPTE time division */
+    float GetTempoBpm() const
+    {
+        return smpte_tempo_ != 0 ? 0.f : 60000000.f / (float)tempo_;
+    }
+
+    /** Returns the SMF format, 0 or 1 */
+    uint16_t GetFormat() const { return format_; }
+
+    /** Returns the number of tracks in the file */
+    size_t GetNumTracks() const { return num_tracks_; }
+
+  private:
+    static constexpr uint32_t kMThd         = 0x4d546864;
+    static constexpr uint32_t kMTrk         = 0x4d54726b;
+    static constexpr uint32_t kDefaultTempo = 500000; // 120 bpm
+
+    struct Track
+    {
+        uint32_t start;    /**< file offset of the first event */
+        uint32_t end;      /**< file offset of the end of the chunk */
+        uint32_t file_pos; /**< file offset of the next byte to buffer */
+        uint32_t tick;     /**< absolute tick of the next event */
+        uint16_t buf_pos;
+        uint16_t buf_len;
+        uint8_t  running_status;
+        uint8_t  buf[kTrackBufferBytes];
+    };
+
+    static uint32_t ReadU32(const uint8_t* b)
+    {
+        return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16)
+               | ((uint32_t)b[2] << 8) | b[3];
+    }
+    static uint16_t ReadU16(const uint8_t* b)
+    {
+        return ((uint16_t)b[0] << 8) | b[1];
+    }
+
+    /** Reads from the file, seeking only if the reader isn't there already */
+    size_t ReadAt(uint32_t pos, uint8_t* dst, size_t len)
+    {
+        if(pos != reader_pos_)
+        {
+            if(!reader_->seek(pos))
+                return 0;
+            reader_pos_ = pos;
+        }
+        const size_t n = reader_->read(dst, len);
+        reader_pos_ += n;
+        return n;
+    }
+
+    void Rewind()
+    {
+        tempo_     = smpte_tempo_ != 0 ? smpte_tempo_ : kDefaultTempo;
+        base_tick_ = 0;
+        base_time_ = loop_start_;
+        end_time_  = loop_start_;
+        pending_   = false;
+        heap_size_ = 0;
+        for(size_t i = 0; i < num_tracks_; i++)
+        {
+            Track& t         = tracks_[i];
+            t.file_pos       = t.start;
+            t.buf_pos        = 0;
+            t.buf_len        = 0;
+            t.running_status = 0;
+            t.tick           = 0;
+            if(ReadDelta(t))
+                HeapPush(i);
+        }
+    }
+
+    /** Returns the next byte of a track, refilling its buffer when empty
+     *  \return false at the end of the chunk or on a read error */
+    bool ReadByte(Track& t, uint8_t& byte)
+    {
+        if(t.buf_pos == t.buf_len)
+        {
+            const uint32_t remaining = t.end - t.file_pos;
+            if(remaining == 0)
+                return false;
+            const size_t len = remaining < kTrackBufferBytes
+                                   ? remaining
+                                   : kTrackBufferBytes;
+            t.buf_len = ReadAt(t.file_pos, t.buf, len);
+            t.buf_pos = 0;
+            t.file_pos += t.buf_len;
+            if(t.buf_len == 0)
+                return false;
+        }
+        byte = t.buf[t.buf_pos++];
+        return true;
+    }
+
+    /** Skips bytes of a track without copying them */
+    bool Skip(Track& t, uint32_t len)
+    {
+        const uint32_t buffered = t.buf_len - t.buf_pos;
+        if(len <= buffered)
+        {
+            t.buf_pos += len;
+            return true;
+        }
+        len -= buffered;
+        t.buf_pos = t.buf_len;
+        if(len > t.end - t.file_pos)
+            return false;
+        t.file_pos += len;
+        return true;
+    }
+
+    bool ReadVarLen(Track& t, uint32_t& value)
+    {
+        value = 0;
+        for(size_t i = 0; i < 4; i++)
+        {
+            uint8_t byte;
+            if(!ReadByte(t, byte))
+                return false;
+            value = (value << 7) | (byte & 0x7f);
+            if(!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    /** Reads the delta time of a track's next event
+     *  \return false if the track has ended */
+    bool ReadDelta(Track& t)
+    {
+        uint32_t delta;
+        if(!ReadVarLen(t, delta))
+            return false;
+        t.tick += delta;
+        return true;
+    }
+
+    /** Converts an absolute tick to samples, with the current tempo */
+    uint32_t TickToSamples(uint32_t tick) const
+    {
+        const uint64_t num = (uint64_t)(tick - base_tick_) * tempo_;
+        return base_time_
+               + (uint32_t)(num * samplerate_
+                            / ((uint64_t)division_ * 1000000));
+    }
+
+    /** Pops events from the heap until the next MidiEvent is found */
+    void ReadNextEvent()
+    {
+        while(!pending_)
+        {
+            if(heap_size_ == 0)
+            {
+                if(!looping_ || end_time_ == loop_start_)
+                    return;
+                loop_start_ = end_time_;
+                Rewind();
+                continue;
+            }
+
+            const uint8_t  track = heap_[0];
+            Track&         t     = tracks_[track];
+            const uint32_t time  = TickToSamples(t.tick);
+            const bool     more  = ReadEvent(t, time) && ReadDelta(t);
+            if(more)
+                HeapSiftDown(0);
+            else
+                HeapPop();
+        }
+    }
+
+    /** Reads one event of a track
+     *  \return false if the track has ended */
+    bool ReadEvent(Track& t, uint32_t time)
+    {
+        uint8_t status;
+        if(!ReadByte(t, status))
+            return false;
+
+        if(status == 0xff)
+        {
+            uint8_t  type;
+            uint32_t len;
+            if(!ReadByte(t, type) || !ReadVarLen(t, len))
+                return false;
+            if(type == 0x2f)
+            {
+                // End of Track
+                end_time_ = time > end_time_ ? time : end_time_;
+                return false;
+            }
+            if(type == 0x51 && len == 3 && smpte_tempo_ == 0)
+            {
+                uint8_t b[3];
+                for(size_t i = 0; i < 3; i++)
+                    if(!ReadByte(t, b[i]))
+                        return false;
+                const uint32_t tempo
+                    = ((uint32_t)b[0] << 16) | ((uint32_t)b[1] << 8) | b[2];
+                if(tempo > 0)
+                {
+                    base_time_ = time;
+                    base_tick_ = t.tick;
+                    tempo_     = tempo;
+                }
+                return true;
+            }
+            return Skip(t, len);
+        }
+
+        if(status == 0xf0 || status == 0xf7)
+        {
+            uint32_t len;
+            if(!ReadVarLen(t, len))
+                return false;
+            if(status == 0xf7)
+                return Skip(t, len); // escaped raw bytes
+            // SysEx: the length includes the terminating 0xf7
+            parser_.Reset();
+            parser_.Parse(0xf0, &next_event_);
+            uint8_t byte = 0;
+            for(uint32_t i = 0; i < len; i++)
+            {
+                if(!ReadByte(t, byte))
+                    return false;
+                if(parser_.Parse(byte, &next_event_))
+                    SetPending(time);
+            }
+            if(byte != 0xf7 && parser_.Parse(0xf7, &next_event_))
+                SetPending(time);
+            return true;
+        }
+
+        // other system messages don't belong in a file
+        if(status > 0xf0)
+            return false;
+
+        // channel message, possibly with running status
+        uint8_t data0;
+        if(status & 0x80)
+        {
+            t.running_status = status;
+            if(!ReadByte(t, data0))
+                return false;
+        }
+        else if(t.running_status != 0)
+        {
+            data0 = status;
+        }
+        else
+        {
+            return false;
+        }
+
+        const uint8_t type = t.running_status & 0xf0;
+        parser_.Reset();
+        parser_.Parse(t.running_status, &next_event_);
+        bool done = parser_.Parse(data0, &next_event_);
+        if(type != 0xc0 && type != 0xd0)
+        {
+            uint8_t data1;
+            if(!ReadByte(t, data1))
+                return false;
+            done = parser_.Parse(data1, &next_event_);
+        }
+        if(done)
+            SetPending(time);
+        return true;
+    }
+
+    void SetPending(uint32_t time)
+    {
+        pending_   = true;
+        next_time_ = time;
+        end_time_  = time > end_time_ ? time : end_time_;
+    }
+
+    /** Orders tracks by the tick of their next event; tracks with events at
+     *  the same tick play in track order, so the tempo map of track 0
+     *  applies before the notes of other tracks */
+    bool Before(uint8_t a, uint8_t b) const
+    {
+        return tracks_[a].tick < tracks_[b].tick
+               || (tracks_[a].tick == tracks_[b].tick && a < b);
+    }
+
+    void HeapPush(uint8_t track)
+    {
+        size_t i = heap_size_++;
+        heap_[i] = track;
+        while(i > 0)
+        {
+            const size_t parent = (i - 1) / 2;
+            if(!Before(heap_[i], heap_[parent]))
+                break;
+            const uint8_t tmp = heap_[i];
+            heap_[i]          = heap_[parent];
+            heap_[parent]     = tmp;
+            i                 = parent;
+        }
+    }
+
+    void HeapPop()
+    {
+        heap_[0] = heap_[--heap_size_];
+        HeapSiftDown(0);
+    }
+
+    void HeapSiftDown(size_t i)
+    {
+        while(true)
+        {
+            const size_t left     = 2 * i + 1;
+            const size_t right    = left + 1;
+            size_t       smallest = i;
+            if(left < heap_size_ && Before(heap_[left], heap_[smallest]))
+                smallest = left;
+            if(right < heap_size_ && Before(heap_[right], heap_[smallest]))
+                smallest = right;
+            if(smallest == i)
+                return;
+            const uint8_t tmp = heap_[i];
+            heap_[i]          = heap_[smallest];
+            heap_[smallest]   = tmp;
+            i                 = smallest;
+        }
+    }
+
+    IReader*   reader_;
+    uint32_t   reader_pos_;
+    MidiParser parser_;
+    Track      tracks_[kMaxTracks];
+    size_t     num_tracks_;
+    uint8_t    heap_[kMaxTracks];
+    size_t     heap_size_;
+    uint16_t   format_;
+    uint32_t   division_;
+    uint32_t   smpte_tempo_;
+    uint32_t   samplerate_;
+    uint32_t   tempo_;
+    uint32_t   base_tick_;
+    uint32_t   base_time_;
+    uint32_t   end_time_;
+    uint32_t   loop_start_;
+    uint32_t   position_;
+    bool       looping_;
+    bool       pending_;
+    MidiEvent  next_event_;
+    uint32_t   next_time_;
+};
+
+} // namespace daisy
+
+#endif
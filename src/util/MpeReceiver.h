@@ -0,0 +1,684 @@
+#pragma once
+#ifndef DSY_MPE_RECEIVER_H
+#define DSY_MPE_RECEIVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hid/MidiEvent.h"
+
+namespace daisy
+{
+/** @brief Receives MIDI Polyphonic Expression (MPE) and assigns it to voices
+ *  @addtogroup utility
+ *
+ *  MPE controllers play each note on its own member channel, so that pitch
+ *  bend, channel pressure and CC74 (timbre) on that channel only affect that
+ *  one note. This class keeps track of the Lower and Upper Zones (configured
+ *  with the MPE Configuration Message, RPN 6, on the Zone's master channel),
+ *  assigns each note to one of kNumVoices voices, and turns the per-channel
+ *  messages into per-voice expression updates.
+ *
+ *  Feed MidiEvents from a MidiHandler into ProcessEvent(). Each call returns
+ *  the number of MpeEvents it produced, which are read with GetEvent().
+ *  Expression events carry the new target value, ready to be passed to a
+ *  smoother (e.g. a fonepole or Port) in the voice:
+ *  - PITCH_BEND in semitones, member channel bend plus master channel bend,
+ *    each scaled by its pitch bend sensitivity (RPN 0)
+ *  - PRESSURE from channel pressure, 0 to 1
+ *  - TIMBRE from CC74, 0 to 1
+ *
+ *  Expression received on a member channel before its note starts is applied
+ *  to the new voice. Released voices keep following their channel until they
+ *  are reused or a new note starts on that channel, so pitch bends during the
+ *  release are heard. Sustain (CC64) and All Notes Off / All Sound Off are
+ *  taken from the master channel for the whole Zone. Other master channel
+ *  messages are left to the patch.
+ *
+ *  @tparam kNumVoices Number of voices, up to 254
+ */
+template <size_t kNumVoices>
+class MpeReceiver
+{
+    static_assert(kNumVoices > 0 && kNumVoices < 255,
+                  "MpeReceiver supports 1 to 254 voices");
+
+  public:
+    enum class ZoneId
+    {
+        LOWER, /**< Master channel 1 (index 0), members upwards */
+        UPPER, /**< Master channel 16 (index 15), members downwards */
+    };
+
+    struct Config
+    {
+        /** Number of member channels of the Lower Zone until an MPE
+         *  Configuration Message is received. 0 disables the Zone. */
+        uint8_t lower_zone_members;
+        /** Number of member channels of the Upper Zone until an MPE
+         *  Configuration Message is received. 0 disables the Zone. */
+        uint8_t upper_zone_members;
+
+        void Defaults()
+        {
+            lower_zone_members = 15;
+            upper_zone_members = 0;
+        }
+    };
+
+    struct MpeEvent
+    {
+        enum class Type
+        {
+            NOTE_ON,    /**< Start the voice, value is the pitch bend */
+            NOTE_OFF,   /**< Release the voice, with the release velocity */
+            PITCH_BEND, /**< value is the pitch bend in semitones */
+            PRESSURE,   /**< value is the pressure, 0 to 1 */
+            TIMBRE,     /**< value is the timbre (CC74), 0 to 1 */
+        };
+        Type    type;     /**< & */
+        size_t  voice;    /**< & */
+        uint8_t note;     /**< & */
+        uint8_t velocity; /**< & */
+        float   value;    /**< & */
+        /** NOTE_ON only: true if the voice was still playing another note */
+        bool stolen;
+    };
+
+    /** Current state of a voice */
+    struct Voice
+    {
+        uint8_t channel;  /**< Member channel of the note */
+        uint8_t note;     /**< & */
+        uint8_t velocity; /**< Note on velocity */
+        float   bend;     /**< Pitch bend in semitones */
+        float   pressure; /**< 0 to 1 */
+        float   timbre;   /**< 0 to 1 */
+
+        /** Returns the pitch of the voice in semitones, including bend */
+        float GetPitch() const { return (float)note + bend; }
+    };
+
+    MpeReceiver() {}
+    ~MpeReceiver() {}
+
+    /** Initializes the receiver with the default configuration,
+     *  a Lower Zone with 15 member channels */
+    void Init()
+    {
+        Config config;
+        config.Defaults();
+        Init(config);
+    }
+
+    /** Initializes the receiver, all voices start out free */
+    void Init(const Config& config)
+    {
+        for(size_t i = 0; i < 16; i++)
+        {
+            ChannelState& ch = channels_[i];
+            ch.bend          = 0.f;
+            ch.pressure      = 0.f;
+            ch.timbre        = 0.5f;
+            ch.rpn_msb       = kNullRpn;
+            ch.rpn_lsb       = kNullRpn;
+            ch.head          = kNone;
+            ch.tail          = kNone;
+        }
+        for(size_t i = 0; i < kNumVoices; i++)
+        {
+            VoiceState& v = states_[i];
+            v.state       = State::FREE;
+            v.linked      = false;
+            v.chan_prev   = kNone;
+            v.chan_next   = kNone;
+            v.age_prev    = kNone;
+            v.age_next    = kNone;
+            voices_[i]    = Voice{0, 0, 0, 0.f, 0.f, 0.5f};
+            free_[i]      = i;
+        }
+        free_read_  = 0;
+        free_count_ = kNumVoices;
+        oldest_     = kNone;
+        newest_     = kNone;
+        num_events_ = 0;
+        for(size_t z = 0; z < 2; z++)
+        {
+            zones_[z].members = 0;
+            zones_[z].master  = z == 0 ? 0 : 15;
+            ResetZone(zones_[z]);
+        }
+        for(size_t i = 0; i < 16; i++)
+            channel_zone_[i] = kNone;
+        SetZone(ZoneId::LOWER, config.lower_zone_members);
+        SetZone(ZoneId::UPPER, config.upper_zone_members);
+        num_events_ = 0;
+    }
+
+    /** Handles Note On/Off, Pitch Bend, Channel Pressure, CC74, CC64,
+     *  RPN 0 (pitch bend sensitivity), RPN 6 (MPE Configuration Message),
+     *  All Notes Off and All Sound Off. Other events are ignored.
+     *  \return Number of MpeEvents produced
+     */
+    size_t ProcessEvent(const MidiEvent& event)
+    {
+        num_events_ = 0;
+
+        const uint8_t channel = event.channel & 0x0f;
+        uint8_t       zone    = channel_zone_[channel];
+        if(zone == kNone)
+        {
+            // the master channel of a disabled Zone still receives the MPE
+            // Configuration Message
+            if(event.type != ControlChange || (channel != 0 && channel != 15))
+                return 0;
+            zone = channel == 0 ? 0 : 1;
+        }
+        const bool master = channel == zones_[zone].master;
+
+        switch(event.type)
+        {
+            case MidiMessageType::NoteOn:
+                if(master)
+                    return 0;
+                if(event.data[1] == 0)
+                    return NoteOff(channel, event.data[0], 64);
+                return NoteOn(channel, event.data[0], event.data[1]);
+            case MidiMessageType::NoteOff:
+                if(master)
+                    return 0;
+                return NoteOff(channel, event.data[0], event.data[1]);
+            case PitchBend:
+            {
+                const int value
+                    = (((int)event.data[1] << 7) | event.data[0]) - 8192;
+                const float bend = value * (1.f / 8192.f);
+                if(master)
+                    MasterBend(zone, bend);
+                else
+                    MemberBend(channel, bend);
+                return num_events_;
+            }
+            case ChannelPressure:
+                if(!master)
+                    SetExpression(channel,
+                                  MpeEvent::Type::PRESSURE,
+                                  event.data[0] * (1.f / 127.f));
+                return num_events_;
+            case ControlChange:
+                ControlChangeEvent(channel, zone, master, event);
+                return num_events_;
+            case ChannelMode:
+                if(event.data[0] == 120 || event.data[0] == 123)
+                {
+                    if(master)
+                        ReleaseZone(zone);
+                    else
+                        ReleaseChannel(channel);
+                }
+                return num_events_;
+            default: return 0;
+        }
+    }
+
+    /** Sets the number of member channels of a Zone, as an MPE Configuration
+     *  Message does. A Zone that overlaps is shrunk, and notes playing on
+     *  either Zone are released. Pitch bend sensitivities are reset to
+     *  48 semitones on the member channels and 2 on the master channel.
+     *  \return Number of MpeEvents produced
+     */
+    size_t SetZone(ZoneId id, uint8_t members)
+    {
+        num_events_        = 0;
+        const size_t z     = id == ZoneId::LOWER ? 0 : 1;
+        Zone&        zone  = zones_[z];
+        Zone&        other = zones_[1 - z];
+
+        members = members > 15 ? 15 : members;
+        if(members == zone.members)
+            return 0;
+        ReleaseZone(0);
+        ReleaseZone(1);
+
+        zone.members = members;
+        ResetZone(zone);
+        // the Zones may share at most 14 member channels
+        if(zone.members + other.members > 14)
+        {
+            other.members = zone.members >= 14 ? 0 : 14 - zone.members;
+            ResetZone(other);
+        }
+
+        for(size_t i = 0; i < 16; i++)
+            channel_zone_[i] = kNone;
+        for(size_t z2 = 0; z2 < 2; z2++)
+        {
+            if(zones_[z2].members == 0)
+                continue;
+            for(size_t i = 0; i <= zones_[z2].members; i++)
+            {
+                const size_t ch   = z2 == 0 ? i : 15 - i;
+                channel_zone_[ch] = z2;
+            }
+        }
+        return num_events_;
+    }
+
+    /** Returns the number of member channels of a Zone, 0 if it is off */
+    uint8_t GetZoneMembers(ZoneId id) const
+    {
+        return zones_[id == ZoneId::LOWER ? 0 : 1].members;
+    }
+
+    /** Returns the pitch bend sensitivity of a Zone in semitones
+     *  \param id     The Zone
+     *  \param master true for the master channel, false for the members
+     */
+    float GetPitchBendRange(ZoneId id, bool master) const
+    {
+        const Zone& zone = zones_[id == ZoneId::LOWER ? 0 : 1];
+        return master ? zone.master_range : zone.member_range;
+    }
+
+    /** Returns one of the events produced by the last call */
+    const MpeEvent& GetEvent(size_t idx) const { return events_[idx]; }
+
+    /** Returns the current state of a voice */
+    const Voice& GetVoice(size_t voice) const { return voices_[voice]; }
+
+    /** Returns true if the voice's note is held (by its key or the pedal) */
+    bool IsVoiceActive(size_t voice) const
+    {
+        return states_[voice].state == State::HELD
+               || states_[voice].state == State::SUSTAINED;
+    }
+
+    /** Returns the voice holding a note on a member channel, or -1 */
+    int GetVoiceForNote(uint8_t channel, uint8_t note) const
+    {
+        const uint8_t voice = FindHeld(channel & 0x0f, note & 0x7f);
+        return voice == kNone ? -1 : voice;
+    }
+
+  private:
+    static constexpr uint8_t kNone    = 0xff;
+    static constexpr uint8_t kNullRpn = 0x7f;
+
+    enum class State : uint8_t
+    {
+        FREE,
+        HELD,
+        SUSTAINED,
+        RELEASED,
+    };
+
+    /** Bookkeeping of a voice. Voices that sound (or release) on a channel
+     *  are linked into that channel's list, and voices that are held are
+     *  linked in start order for stealing. */
+    struct VoiceState
+    {
+        State   state;
+        bool    linked;
+        uint8_t chan_prev;
+        uint8_t chan_next;
+        uint8_t age_prev;
+        uint8_t age_next;
+    };
+
+    struct ChannelState
+    {
+        float   bend; /**< normalized, -1 to 1 */
+        float   pressure;
+        float   timbre;
+        uint8_t rpn_msb;
+        uint8_t rpn_lsb;
+        uint8_t head;
+        uint8_t tail;
+    };
+
+    struct Zone
+    {
+        uint8_t members;
+        uint8_t master;
+        float   member_range;
+        float   master_range;
+        float   master_bend; /**< semitones */
+        bool    sustain;
+    };
+
+    static void ResetZone(Zone& zone)
+    {
+        zone.member_range = 48.f;
+        zone.master_range = 2.f;
+        zone.master_bend  = 0.f;
+        zone.sustain      = false;
+    }
+
+    void PushEvent(typename MpeEvent::Type type,
+                   uint8_t                 voice,
+                   uint8_t                 velocity,
+                   float                   value,
+                   bool                    stolen)
+    {
+        MpeEvent& e = events_[num_events_++];
+        e.type      = type;
+        e.voice     = voice;
+        e.note      = voices_[voice].note;
+        e.velocity  = velocity;
+        e.value     = value;
+        e.stolen    = stolen;
+    }
+
+    size_t NoteOn(uint8_t channel, uint8_t note, uint8_t velocity)
+    {
+        note &= 0x7f;
+        ChannelState& ch = channels_[channel];
+
+        // a new note takes over the channel from notes in their release
+        for(uint8_t v = ch.head; v != kNone;)
+        {
+            const uint8_t next = states_[v].chan_next;
+            if(states_[v].state == State::RELEASED)
+                UnlinkChannel(v);
+            v = next;
+        }
+        // the same note again on the same channel restarts
+        uint8_t voice = FindHeld(channel, note);
+        if(voice != kNone)
+            ReleaseVoice(voice, 0, false);
+
+        bool stolen = false;
+        voice       = AcquireVoice(stolen);
+
+        states_[voice].state = State::HELD;
+
+        const Zone& zone = zones_[channel_zone_[channel]];
+        Voice&      v    = voices_[voice];
+        v.channel        = channel;
+        v.note           = note;
+        v.velocity       = velocity;
+        v.bend           = ch.bend * zone.member_range + zone.master_bend;
+        v.pressure       = ch.pressure;
+        v.timbre         = ch.timbre;
+        LinkChannel(voice);
+        LinkAge(voice);
+        PushEvent(MpeEvent::Type::NOTE_ON, voice, velocity, v.bend, stolen);
+        return num_events_;
+    }
+
+    size_t NoteOff(uint8_t channel, uint8_t note, uint8_t velocity)
+    {
+        const uint8_t voice = FindHeld(channel, note & 0x7f);
+        if(voice == kNone || states_[voice].state != State::HELD)
+            return 0;
+        if(zones_[channel_zone_[channel]].sustain)
+        {
+            states_[voice].state = State::SUSTAINED;
+            return 0;
+        }
+        ReleaseVoice(voice, velocity, true);
+        return num_events_;
+    }
+
+    void ControlChangeEvent(uint8_t          channel,
+                            uint8_t          zone,
+                            bool             master,
+                            const MidiEvent& event)
+    {
+        ChannelState& ch    = channels_[channel];
+        const uint8_t value = event.data[1];
+        switch(event.data[0])
+        {
+            case 74:
+                if(!master)
+                    SetExpression(
+                        channel, MpeEvent::Type::TIMBRE, value * (1.f / 127.f));
+                break;
+            case 64:
+                if(master)
+                    SetSustain(zone, value >= 64);
+                break;
+            case 101: ch.rpn_msb = value; break;
+            case 100: ch.rpn_lsb = value; break;
+            // NRPN selection deselects the RPN
+            case 99:
+            case 98: ch.rpn_msb = ch.rpn_lsb = kNullRpn; break;
+            case 6: DataEntry(channel, zone, master, value, true); break;
+            case 38: DataEntry(channel, zone, master, value, false); break;
+            default: break;
+        }
+    }
+
+    void DataEntry(uint8_t channel,
+                   uint8_t zone_idx,
+                   bool    master,
+                   uint8_t value,
+                   bool    msb)
+    {
+        const ChannelState& ch = channels_[channel];
+        if(ch.rpn_msb != 0)
+            return;
+        Zone& zone = zones_[zone_idx];
+        if(ch.rpn_lsb == 0)
+        {
+            // pitch bend sensitivity: semitones, then cents
+            float& range = master ? zone.master_range : zone.member_range;
+            if(msb)
+                range = (float)value;
+            else
+                range = (float)(int)range + value * 0.01f;
+        }
+        else if(ch.rpn_lsb == 6 && msb && (channel == 0 || channel == 15))
+        {
+            // the MPE Configuration Message is always taken from channel 1
+            // or 16, even if that is a member channel of the other Zone
+            SetZone(channel == 0 ? ZoneId::LOWER : ZoneId::UPPER, value);
+        }
+    }
+
+    void MemberBend(uint8_t channel, float bend)
+    {
+        ChannelState& ch   = channels_[channel];
+        const Zone&   zone = zones_[channel_zone_[channel]];
+        ch.bend            = bend;
+        for(uint8_t v = ch.head; v != kNone; v = states_[v].chan_next)
+        {
+            voices_[v].bend = bend * zone.member_range + zone.master_bend;
+            PushEvent(MpeEvent::Type::PITCH_BEND,
+                      v,
+                      voices_[v].velocity,
+                      voices_[v].bend,
+                      false);
+        }
+    }
+
+    void MasterBend(uint8_t zone_idx, float bend)
+    {
+        Zone& zone       = zones_[zone_idx];
+        zone.master_bend = bend * zone.master_range;
+        for(uint8_t v = 0; v < kNumVoices; v++)
+        {
+            if(!states_[v].linked
+               || channel_zone_[voices_[v].channel] != zone_idx)
+                continue;
+            const ChannelState& ch = channels_[voices_[v].channel];
+            voices_[v].bend = ch.bend * zone.member_range + zone.master_bend;
+            PushEvent(MpeEvent::Type::PITCH_BEND,
+                      v,
+                      voices_[v].velocity,
+                      voices_[v].bend,
+                      false);
+        }
+    }
+
+    void SetExpression(uint8_t channel, typename MpeEvent::Type type, float x)
+    {
+        ChannelState& ch = channels_[channel];
+        if(type == MpeEvent::Type::PRESSURE)
+            ch.pressure = x;
+        else
+            ch.timbre = x;
+        for(uint8_t v = ch.head; v != kNone; v = states_[v].chan_next)
+        {
+            if(type == MpeEvent::Type::PRESSURE)
+                voices_[v].pressure = x;
+            else
+                voices_[v].timbre = x;
+            PushEvent(type, v, voices_[v].velocity, x, false);
+        }
+    }
+
+    void SetSustain(uint8_t zone_idx, bool on)
+    {
+        zones_[zone_idx].sustain = on;
+        if(on)
+            return;
+        for(uint8_t v = 0; v < kNumVoices; v++)
+        {
+            if(states_[v].state == State::SUSTAINED
+               && channel_zone_[voices_[v].channel] == zone_idx)
+                ReleaseVoice(v, 64, true);
+        }
+    }
+
+    /** Releases all held voices of a Zone */
+    void ReleaseZone(uint8_t zone_idx)
+    {
+        for(uint8_t v = 0; v < kNumVoices; v++)
+        {
+            if(IsVoiceActive(v)
+               && channel_zone_[voices_[v].channel] == zone_idx)
+                ReleaseVoice(v, 64, true);
+        }
+    }
+
+    /** Releases all held voices of a member channel */
+    void ReleaseChannel(uint8_t channel)
+    {
+        for(uint8_t v = channels_[channel].head; v != kNone;)
+        {
+            const uint8_t next = states_[v].chan_next;
+            if(IsVoiceActive(v))
+                ReleaseVoice(v, 64, true);
+            v = next;
+        }
+    }
+
+    uint8_t FindHeld(uint8_t channel, uint8_t note) const
+    {
+        for(uint8_t v = channels_[channel].head; v != kNone;
+            v         = states_[v].chan_next)
+        {
+            if(voices_[v].note == note && IsVoiceActive(v))
+                return v;
+        }
+        return kNone;
+    }
+
+    /** Returns a free voice, or steals the oldest held one */
+    uint8_t AcquireVoice(bool& stolen)
+    {
+        uint8_t voice;
+        if(free_count_ > 0)
+        {
+            voice      = free_[free_read_];
+            free_read_ = (free_read_ + 1) % kNumVoices;
+            free_count_--;
+            stolen = false;
+        }
+        else
+        {
+            voice = oldest_;
+            UnlinkAge(voice);
+            stolen = true;
+        }
+        if(states_[voice].linked)
+            UnlinkChannel(voice);
+        return voice;
+    }
+
+    /** Releases a held voice. It stays linked to its channel until it is
+     *  reused, so it keeps following the channel's expression. */
+    void ReleaseVoice(uint8_t voice, uint8_t velocity, bool notify)
+    {
+        UnlinkAge(voice);
+        states_[voice].state = State::RELEASED;
+        const size_t tail    = (free_read_ + free_count_) % kNumVoices;
+        free_[tail]          = voice;
+        free_count_++;
+        if(notify)
+            PushEvent(MpeEvent::Type::NOTE_OFF, voice, velocity, 0.f, false);
+        else
+            UnlinkChannel(voice);
+    }
+
+    void LinkChannel(uint8_t voice)
+    {
+        ChannelState& ch = channels_[voices_[voice].channel];
+        VoiceState&   s  = states_[voice];
+        s.linked         = true;
+        s.chan_prev      = ch.tail;
+        s.chan_next      = kNone;
+        if(ch.tail != kNone)
+            states_[ch.tail].chan_next = voice;
+        else
+            ch.head = voice;
+        ch.tail = voice;
+    }
+
+    void UnlinkChannel(uint8_t voice)
+    {
+        ChannelState& ch = channels_[voices_[voice].channel];
+        VoiceState&   s  = states_[voice];
+        if(s.chan_prev != kNone)
+            states_[s.chan_prev].chan_next = s.chan_next;
+        else
+            ch.head = s.chan_next;
+        if(s.chan_next != kNone)
+            states_[s.chan_next].chan_prev = s.chan_prev;
+        else
+            ch.tail = s.chan_prev;
+        s.linked = false;
+    }
+
+    void LinkAge(uint8_t voice)
+    {
+        VoiceState& s = states_[voice];
+        s.age_prev    = newest_;
+        s.age_next    = kNone;
+        if(newest_ != kNone)
+            states_[newest_].age_next = voice;
+        else
+            oldest_ = voice;
+        newest_ = voice;
+    }
+
+    void UnlinkAge(uint8_t voice)
+    {
+        VoiceState& s = states_[voice];
+        if(s.age_prev != kNone)
+            states_[s.age_prev].age_next = s.age_next;
+        else
+            oldest_ = s.age_next;
+        if(s.age_next != kNone)
+            states_[s.age_next].age_prev = s.age_prev;
+        else
+            newest_ = s.age_prev;
+    }
+
+    Voice        voices_[kNumVoices];
+    VoiceState   states_[kNumVoices];
+    uint8_t      free_[kNumVoices];
+    size_t       free_read_;
+    size_t       free_count_;
+    uint8_t      oldest_;
+    uint8_t      newest_;
+    ChannelState channels_[16];
+    uint8_t      channel_zone_[16];
+    Zone         zones_[2];
+    MpeEvent     events_[kNumVoices + 1];
+    size_t       num_events_;
+};
+
+} // namespace daisy
+
+#endif
@@ -16,14 +16,6 @@ class StackBase
     {
     }
 
-    StackBase(T*                       buffer,
-              size_t                   bufferSize,
-              std::initializer_list<T> valuesToAdd)
-    : buffer_(buffer), bufferSize_(bufferSize), bufferHead_(0)
-    {
-        PushBack(valuesToAdd);
-    }
-
   public:
     /** Copies all elements from another Stack */
     StackBase<T>& operator=(const StackBase<T>& other)
@@ -206,8 +198,11 @@ class Stack : public StackBase<T>
 
     /** Creates a Stack and adds a list of values*/
     explicit Stack(std::initializer_list<T> valuesToAdd)
-    : StackBase<T>(buffer_, capacity, valuesToAdd)
+    : StackBase<T>(buffer_, capacity)
     {
+        // added here rather than by the base class, as buffer_ isn't
+        // constructed yet when the base class constructor runs
+        this->PushBack(valuesToAdd);
     }
 
     /** Creates a Stack and copies all values from another Stack */
@@ -1,4 +1,6 @@
 #pragma once
+#include <stddef.h>
+#include <stdint.h>
 
 namespace daisy
 {
@@ -14,11 +16,70 @@ namespace daisy
  * 
  *  This can also be used for 100mV/Semitone calibration as used by Buchla synthesizer 
  *  modules. To calibrate for this standard. You would send 1.2V, and 3.6V
+ *
+ *  For inputs that aren't quite linear over their range, the readings of
+ *  up to kMaxPoints known voltages can be added with AddPoint() instead.
+ *  Fit() then fits a polynomial through them (least squares), and caches it
+ *  in a lookup table, so that ProcessInput() still only interpolates
+ *  between two table entries. Outside of the recorded range, the curve
+ *  continues in a straight line.
+ *
+ *  Drift, e.g. with temperature, mostly shifts the whole curve. After
+ *  reading a single known voltage, RecordTrim() corrects for that without
+ *  a full calibration.
+ *
+ *  The Data struct holds the recorded points and the trim, and can be part
+ *  of the settings that are saved with PersistentStorage.
  */
 class VoctCalibration
 {
   public:
-    VoctCalibration() : scale_(0.f), offset_(0.f), cal_(false) {}
+    /** The maximum number of calibration points */
+    static constexpr size_t kMaxPoints = 16;
+    /** The number of segments of the lookup table */
+    static constexpr size_t kNumSegments = 64;
+    /** The highest degree of the fitted polynomial */
+    static constexpr size_t kMaxDegree = 3;
+
+    /** The recorded calibration, e.g. for PersistentStorage */
+    struct Data
+    {
+        /** The number of recorded points */
+        uint32_t num_points;
+        /** The degree of the fitted polynomial */
+        uint32_t degree;
+        /** The input values that were read */
+        float values[kMaxPoints];
+        /** The voltages that were applied */
+        float volts[kMaxPoints];
+        /** The offset for drift, in semitones */
+        float trim;
+
+        bool operator==(const Data &rhs) const
+        {
+            if(num_points != rhs.num_points || degree != rhs.degree
+               || trim != rhs.trim)
+                return false;
+            for(size_t i = 0; i < num_points && i < kMaxPoints; i++)
+                if(values[i] != rhs.values[i] || volts[i] != rhs.volts[i])
+                    return false;
+            return true;
+        }
+        bool operator!=(const Data &rhs) const { return !operator==(rhs); }
+    };
+
+    VoctCalibration() : scale_(0.f), offset_(0.f), cal_(false)
+    {
+        data_.num_points = 0;
+        data_.degree     = 1;
+        data_.trim       = 0.f;
+        for(size_t i = 0; i < kMaxPoints; i++)
+        {
+            data_.values[i] = 0.f;
+            data_.volts[i]  = 0.f;
+        }
+        SetLinear(0.f, 0.f);
+    }
 
     ~VoctCalibration() {}
 
@@ -28,7 +89,8 @@ class VoctCalibration
      * 
      *  \param val1V ADC reading for 1 volt
      *  \param val3V ADC reading for 3 volts
-     *  \retval returns true if the calibraiton is successful - this is always true
+     *  \retval returns true if the calibration is successful, i.e. the
+     *          readings differ
      * 
      *  \todo Add some sort of range validation. Originally we had a check
      *        for a valid range on the input, but given that the input circuit
@@ -38,14 +100,82 @@ class VoctCalibration
      **/
     bool Record(float val1V, float val3V)
     {
-        float delta = val3V - val1V;
-        scale_      = 24.f / delta;
-        offset_     = 12.f - scale_ * val1V;
-        cal_        = true;
-        return cal_;
+        ClearPoints();
+        AddPoint(val1V, 1.f);
+        AddPoint(val3V, 3.f);
+        return Fit(1);
+    }
+
+    /** Removes all recorded points and the trim. The current calibration
+     *  stays in use until the next Fit().
+     */
+    void ClearPoints()
+    {
+        data_.num_points = 0;
+        data_.trim       = 0.f;
+    }
+
+    /** Records the reading of a known voltage
+     *  \param val   the input value, e.g. from AnalogControl
+     *  \param volts the voltage at the input
+     *  \retval returns false if there's no room for more points
+     */
+    bool AddPoint(float val, float volts)
+    {
+        if(data_.num_points >= kMaxPoints)
+            return false;
+        data_.values[data_.num_points] = val;
+        data_.volts[data_.num_points]  = volts;
+        data_.num_points++;
+        return true;
+    }
+
+    /** \return the number of recorded points */
+    inline size_t GetNumPoints() const { return data_.num_points; }
+
+    /** Fits the calibration to the recorded points and fills the lookup
+     *  table. Takes some time, so shouldn't be called from the audio
+     *  callback.
+     *  \param degree the degree of the polynomial, up to kMaxDegree; 1 for
+     *         a straight line. Lowered to the number of points - 1.
+     *  \retval returns true if the calibration is successful, which needs
+     *          at least two points with different values
+     */
+    bool Fit(size_t degree = kMaxDegree)
+    {
+        data_.degree = degree;
+        return Build();
+    }
+
+    /** Corrects the calibration for drift with the reading of one known
+     *  voltage, by shifting all notes by the same amount.
+     *  \param val   the input value
+     *  \param volts the voltage at the input
+     */
+    void RecordTrim(float val, float volts)
+    {
+        SetTrim(data_.trim + 12.f * volts - ProcessInput(val));
+    }
+
+    /** Sets the drift correction
+     *  \param semitones added to all notes
+     */
+    void SetTrim(float semitones)
+    {
+        const float delta = semitones - data_.trim;
+        data_.trim        = semitones;
+        offset_ += delta;
+        low_offset_ += delta;
+        high_offset_ += delta;
+        for(size_t i = 0; i <= kNumSegments; i++)
+            lut_[i] += delta;
     }
 
-    /** Get the scale and offset data from the calibration 
+    /** \return the drift correction in semitones */
+    inline float GetTrim() const { return data_.trim; }
+
+    /** Get the scale and offset data from the calibration. For a curve
+     *  fitted through more points, this is its straight line fit.
      *  \retval returns true if calibration has been performed.
     */
     bool GetData(float &scale, float &offset)
@@ -58,23 +188,191 @@ class VoctCalibration
     /** Manually set the calibration data and mark internally as "calibrated" 
      *  This is used to reset the data after a power cycle without having to 
      *  redo the calibration procedure.
+     *  This replaces any recorded points with a straight line.
     */
     void SetData(float scale, float offset)
     {
-        scale_  = scale;
-        offset_ = offset;
-        cal_    = true;
+        data_.num_points = 0;
+        data_.trim       = 0.f;
+        SetLinear(scale, offset);
+        cal_ = true;
+    }
+
+    /** Get the recorded points, e.g. to save them
+     *  \retval returns true if calibration has been performed.
+     */
+    bool GetData(Data &data) const
+    {
+        data = data_;
+        return cal_;
+    }
+
+    /** Restore the recorded points, and fit the calibration to them
+     *  \retval returns true if the calibration is successful
+     */
+    bool SetData(const Data &data)
+    {
+        data_ = data;
+        if(data_.num_points > kMaxPoints)
+            data_.num_points = kMaxPoints;
+        return Build();
     }
 
     /** Process a value through the calibrated data to get a MIDI Note number */
     inline float ProcessInput(const float inval)
     {
-        return offset_ + (scale_ * inval);
+        const float pos = (inval - lut_min_) * lut_scale_;
+        if(pos <= 0.f)
+            return low_offset_ + (low_scale_ * inval);
+        if(pos >= float(kNumSegments))
+            return high_offset_ + (high_scale_ * inval);
+        const size_t idx  = size_t(pos);
+        const float  frac = pos - float(idx);
+        return lut_[idx] + frac * (lut_[idx + 1] - lut_[idx]);
     }
 
   private:
+    /** Uses a straight line everywhere */
+    void SetLinear(float scale, float offset)
+    {
+        scale_       = scale;
+        offset_      = offset;
+        low_scale_   = scale;
+        low_offset_  = offset;
+        high_scale_  = scale;
+        high_offset_ = offset;
+        lut_min_     = 0.f;
+        lut_scale_   = 0.f;
+        for(size_t i = 0; i <= kNumSegments; i++)
+            lut_[i] = 0.f;
+    }
+
+    /** Fits the polynomial, and fills the table */
+    bool Build()
+    {
+        const size_t n = data_.num_points;
+        if(n < 2)
+            return cal_ = false;
+        float x_min = data_.values[0], x_max = data_.values[0];
+        for(size_t i = 1; i < n; i++)
+        {
+            x_min = data_.values[i] < x_min ? data_.values[i] : x_min;
+            x_max = data_.values[i] > x_max ? data_.values[i] : x_max;
+        }
+        if(!(x_max > x_min))
+            return cal_ = false;
+
+        // the coefficients of the straight line, and of the curve, over
+        // x normalized to -1..1 for a well-conditioned fit
+        const double center = 0.5 * (double(x_max) + double(x_min));
+        const double half   = 0.5 * (double(x_max) - double(x_min));
+        double       line[kMaxDegree + 1];
+        double       poly[kMaxDegree + 1];
+        size_t degree = data_.degree < kMaxDegree ? data_.degree : kMaxDegree;
+        degree        = degree < n - 1 ? degree : n - 1;
+        degree        = degree > 0 ? degree : 1;
+        if(!FitPolynomial(center, half, 1, line)
+           || !FitPolynomial(center, half, degree, poly))
+            return cal_ = false;
+
+        const float trim = data_.trim;
+        SetLinear(float(line[1] / half),
+                  float(line[0] - line[1] * center / half) + trim);
+        if(degree > 1)
+        {
+            // the curve, and straight lines with its slope at both ends
+            auto eval = [&](double t) {
+                double y = 0.0;
+                for(size_t k = degree + 1; k-- > 0;)
+                    y = y * t + poly[k];
+                return y;
+            };
+            auto slope = [&](double t) {
+                double y = 0.0;
+                for(size_t k = degree; k > 0; k--)
+                    y = y * t + k * poly[k];
+                return y / half;
+            };
+            for(size_t i = 0; i <= kNumSegments; i++)
+            {
+                const double t = -1.0 + 2.0 * double(i) / kNumSegments;
+                lut_[i]        = float(eval(t)) + trim;
+            }
+            low_scale_   = float(slope(-1.0));
+            low_offset_  = lut_[0] - low_scale_ * x_min;
+            high_scale_  = float(slope(1.0));
+            high_offset_ = lut_[kNumSegments] - high_scale_ * x_max;
+            lut_min_     = x_min;
+            lut_scale_   = float(kNumSegments) / (x_max - x_min);
+        }
+        return cal_ = true;
+    }
+
+    /** Least squares fit of the notes over the normalized values
+     *  \param coeffs the coefficients, constant first
+     */
+    bool FitPolynomial(double  center,
+                       double  half,
+                       size_t  degree,
+                       double *coeffs) const
+    {
+        constexpr size_t kSize = kMaxDegree + 1;
+        const size_t     m     = degree + 1;
+
+        // the normal equations, solved by gaussian elimination
+        double a[kSize][kSize + 1] = {};
+        for(size_t i = 0; i < data_.num_points; i++)
+        {
+            const double t = (double(data_.values[i]) - center) / half;
+            const double y = 12.0 * double(data_.volts[i]);
+            double       powers[2 * kSize - 1];
+            powers[0] = 1.0;
+            for(size_t k = 1; k < 2 * m - 1; k++)
+                powers[k] = powers[k - 1] * t;
+            for(size_t r = 0; r < m; r++)
+            {
+                for(size_t c = 0; c < m; c++)
+                    a[r][c] += powers[r + c];
+                a[r][m] += powers[r] * y;
+            }
+        }
+        for(size_t col = 0; col < m; col++)
+        {
+            size_t pivot = col;
+            for(size_t r = col + 1; r < m; r++)
+                if(Abs(a[r][col]) > Abs(a[pivot][col]))
+                    pivot = r;
+            if(Abs(a[pivot][col]) < 1e-12)
+                return false;
+            for(size_t c = 0; c <= m; c++)
+            {
+                const double tmp = a[col][c];
+                a[col][c]        = a[pivot][c];
+                a[pivot][c]      = tmp;
+            }
+            for(size_t r = 0; r < m; r++)
+            {
+                if(r == col)
+                    continue;
+                const double f = a[r][col] / a[col][col];
+                for(size_t c = col; c <= m; c++)
+                    a[r][c] -= f * a[col][c];
+            }
+        }
+        for(size_t k = 0; k < m; k++)
+            coeffs[k] = a[k][m] / a[k][k];
+        return true;
+    }
+
+    static inline double Abs(double x) { return x < 0.0 ? -x : x; }
+
     float scale_, offset_;
     bool  cal_;
+    Data  data_;
+    float low_scale_, low_offset_;
+    float high_scale_, high_offset_;
+    float lut_min_, lut_scale_;
+    float lut_[kNumSegments + 1];
 };
 
-} // namespace daisy
\ No newline at end of file
+} // namespace daisy
@@ -0,0 +1,536 @@
+#pragma once
+#ifndef DSY_VOICE_ALLOCATOR_H
+#define DSY_VOICE_ALLOCATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hid/MidiEvent.h"
+#include "util/Stack.h"
+
+namespace daisy
+{
+/** @brief Assigns incoming MIDI notes to a fixed number of synth voices
+ *  @addtogroup utility
+ *
+ *  Feed MidiEvents from a MidiHandler into ProcessEvent() (or call NoteOn(),
+ *  NoteOff() and SetSustain() directly). Each call returns the number of
+ *  VoiceEvents it produced, which are read with GetEvent() and tell the synth
+ *  which voice to start, release or glide.
+ *
+ *  All operations are O(1) except QUIETEST voice stealing, which compares
+ *  the level of all sounding voices:
+ *  - a per-note index maps a note number to the voice playing it
+ *  - free voices are reused least recently released first, so release tails
+ *    get as much time as possible
+ *  - sounding voices are kept in start order, with voices that are only held
+ *    by the sustain pedal stolen before voices whose key is still down
+ *
+ *  @tparam kNumVoices Number of voices, up to 254
+ */
+template <size_t kNumVoices>
+class VoiceAllocator
+{
+    static_assert(kNumVoices > 0 && kNumVoices < 255,
+                  "VoiceAllocator supports 1 to 254 voices");
+
+  public:
+    /** Number of held notes remembered for last-note priority in mono modes */
+    static constexpr size_t kMaxHeldNotes = 16;
+
+    enum class Mode
+    {
+        POLY,   /**< One voice per note */
+        MONO,   /**< One voice, last note priority, every note retriggers */
+        LEGATO, /**< One voice, last note priority, overlapping notes glide */
+    };
+
+    enum class StealMode
+    {
+        OLDEST,   /**< Steal the voice that started first */
+        QUIETEST, /**< Steal the voice with the lowest level, see SetVoiceLevel() */
+        NONE,     /**< Ignore new notes while all voices are busy */
+    };
+
+    struct Config
+    {
+        Mode      mode;
+        StealMode steal_mode;
+        /** When true, a note that is already sounding restarts on its voice.
+         *  When false, the old voice is released and a new one is started. */
+        bool retrigger_same_note;
+        /** MIDI channel to listen to, or -1 for all channels */
+        int channel;
+
+        void Defaults()
+        {
+            mode                = Mode::POLY;
+            steal_mode          = StealMode::OLDEST;
+            retrigger_same_note = true;
+            channel             = -1;
+        }
+    };
+
+    struct VoiceEvent
+    {
+        enum class Type
+        {
+            NOTE_ON,  /**< Start (or restart) the voice */
+            NOTE_OFF, /**< Release the voice */
+            LEGATO,   /**< Change the pitch without retriggering */
+        };
+        Type    type;     /**< & */
+        size_t  voice;    /**< & */
+        uint8_t note;     /**< & */
+        uint8_t velocity; /**< & */
+        /** true if the voice was still sounding another note */
+        bool stolen;
+    };
+
+    VoiceAllocator() {}
+    ~VoiceAllocator() {}
+
+    /** Initializes the allocator with the default configuration */
+    void Init()
+    {
+        Config config;
+        config.Defaults();
+        Init(config);
+    }
+
+    /** Initializes the allocator, all voices start out free */
+    void Init(const Config& config)
+    {
+        config_ = config;
+        Reset();
+    }
+
+    /** Frees all voices without producing events */
+    void Reset()
+    {
+        for(size_t i = 0; i < 128; i++)
+        {
+            note_voice_[i]    = kNone;
+            note_velocity_[i] = 0;
+        }
+        for(size_t i = 0; i < kNumVoices; i++)
+        {
+            voices_[i].state    = VoiceState::FREE;
+            voices_[i].note     = 0;
+            voices_[i].velocity = 0;
+            voices_[i].level    = 0.f;
+            prev_[i]            = kNone;
+            next_[i]            = kNone;
+            free_[i]            = i;
+        }
+        for(size_t i = 0; i < 2; i++)
+        {
+            lists_[i].head = kNone;
+            lists_[i].tail = kNone;
+        }
+        free_read_  = 0;
+        free_count_ = kNumVoices;
+        held_notes_.Clear();
+        sustain_    = false;
+        num_events_ = 0;
+    }
+
+    /** Handles Note On, Note Off, Sustain (CC64), All Notes Off and
+     *  All Sound Off. Other events are ignored.
+     *  \return Number of VoiceEvents produced
+     */
+    size_t ProcessEvent(const MidiEvent& event)
+    {
+        num_events_ = 0;
+        if(config_.channel >= 0 && event.channel != config_.channel)
+            return 0;
+
+        switch(event.type)
+        {
+            case MidiMessageType::NoteOn:
+                return NoteOn(event.data[0], event.data[1]);
+            case MidiMessageType::NoteOff: return NoteOff(event.data[0]);
+            case ControlChange:
+                if(event.data[0] == 64)
+                    return SetSustain(event.data[1] >= 64);
+                return 0;
+            case ChannelMode:
+                if(event.data[0] == 120 || event.data[0] == 123)
+                    return AllNotesOff();
+                return 0;
+            default: return 0;
+        }
+    }
+
+    /** Starts a note. A velocity of 0 is a note off.
+     *  \return Number of VoiceEvents produced
+     */
+    size_t NoteOn(uint8_t note, uint8_t velocity)
+    {
+        num_events_ = 0;
+        note &= 0x7f;
+        if(velocity == 0)
+            return NoteOff(note);
+
+        if(config_.mode != Mode::POLY)
+        {
+            MonoNoteOn(note, velocity);
+            return num_events_;
+        }
+
+        uint8_t voice = note_voice_[note];
+        if(voice != kNone)
+        {
+            if(config_.retrigger_same_note)
+            {
+                Unlink(voice);
+                StartVoice(voice, note, velocity, false);
+                return num_events_;
+            }
+            ReleaseVoice(voice);
+        }
+
+        bool stolen = false;
+        voice       = AcquireVoice(stolen);
+        if(voice == kNone)
+            return num_events_;
+        StartVoice(voice, note, velocity, stolen);
+        return num_events_;
+    }
+
+    /** Releases a note, or marks it as sustained while the pedal is down.
+     *  \return Number of VoiceEvents produced
+     */
+    size_t NoteOff(uint8_t note)
+    {
+        num_events_ = 0;
+        note &= 0x7f;
+
+        if(config_.mode != Mode::POLY)
+        {
+            MonoNoteOff(note);
+            return num_events_;
+        }
+
+        const uint8_t voice = note_voice_[note];
+        if(voice == kNone)
+            return 0;
+
+        if(sustain_)
+        {
+            if(voices_[voice].state == VoiceState::HELD)
+            {
+                Unlink(voice);
+                voices_[voice].state = VoiceState::SUSTAINED;
+                Link(voice);
+            }
+            return 0;
+        }
+        ReleaseVoice(voice);
+        return num_events_;
+    }
+
+    /** Sets the sustain pedal state. Releasing the pedal releases all
+     *  voices whose keys are up.
+     *  \return Number of VoiceEvents produced
+     */
+    size_t SetSustain(bool on)
+    {
+        num_events_ = 0;
+        sustain_    = on;
+        if(on)
+            return 0;
+
+        if(config_.mode != Mode::POLY)
+        {
+            if(voices_[0].state == VoiceState::SUSTAINED)
+                MonoRelease();
+            return num_events_;
+        }
+
+        while(lists_[kSustainedList].head != kNone)
+            ReleaseVoice(lists_[kSustainedList].head);
+        return num_events_;
+    }
+
+    /** Releases all voices, regardless of the sustain pedal.
+     *  \return Number of VoiceEvents produced
+     */
+    size_t AllNotesOff()
+    {
+        num_events_ = 0;
+        held_notes_.Clear();
+        if(config_.mode != Mode::POLY)
+        {
+            if(voices_[0].state != VoiceState::FREE)
+                MonoRelease();
+            return num_events_;
+        }
+
+        for(size_t list = 0; list < 2; list++)
+        {
+            while(lists_[list].head != kNone)
+                ReleaseVoice(lists_[list].head);
+        }
+        return num_events_;
+    }
+
+    /** Returns one of the events produced by the last call */
+    const VoiceEvent& GetEvent(size_t idx) const { return events_[idx]; }
+
+    /** Returns the voice playing a note, or -1 */
+    int GetVoiceForNote(uint8_t note) const
+    {
+        const uint8_t voice = note_voice_[note & 0x7f];
+        return voice == kNone ? -1 : voice;
+    }
+
+    /** Returns true if the voice is playing a note (held or sustained) */
+    bool IsVoiceActive(size_t voice) const
+    {
+        return voices_[voice].state != VoiceState::FREE;
+    }
+
+    /** Returns the note last assigned to a voice */
+    uint8_t GetVoiceNote(size_t voice) const { return voices_[voice].note; }
+
+    /** Returns the number of voices that are playing a note */
+    size_t GetNumActiveVoices() const
+    {
+        if(config_.mode != Mode::POLY)
+            return voices_[0].state != VoiceState::FREE ? 1 : 0;
+        return kNumVoices - free_count_;
+    }
+
+    /** Updates the level used by StealMode::QUIETEST, for example from the
+     *  envelope of the voice. Starting a voice sets its level to velocity / 127.
+     */
+    void SetVoiceLevel(size_t voice, float level)
+    {
+        voices_[voice].level = level;
+    }
+
+  private:
+    static constexpr uint8_t kNone          = 0xff;
+    static constexpr size_t  kHeldList      = 0;
+    static constexpr size_t  kSustainedList = 1;
+
+    enum class VoiceState : uint8_t
+    {
+        FREE,
+        HELD,
+        SUSTAINED,
+    };
+
+    struct Voice
+    {
+        VoiceState state;
+        uint8_t    note;
+        uint8_t    velocity;
+        float      level;
+    };
+
+    struct List
+    {
+        uint8_t head;
+        uint8_t tail;
+    };
+
+    void PushEvent(typename VoiceEvent::Type type,
+                   size_t                    voice,
+                   uint8_t                   note,
+                   uint8_t                   velocity,
+                   bool                      stolen)
+    {
+        VoiceEvent& e = events_[num_events_++];
+        e.type        = type;
+        e.voice       = voice;
+        e.note        = note;
+        e.velocity    = velocity;
+        e.stolen      = stolen;
+    }
+
+    /** Appends a sounding voice to the list for its state */
+    void Link(uint8_t voice)
+    {
+        List& list   = lists_[voices_[voice].state == VoiceState::HELD
+                                ? kHeldList
+                                : kSustainedList];
+        prev_[voice] = list.tail;
+        next_[voice] = kNone;
+        if(list.tail != kNone)
+            next_[list.tail] = voice;
+        else
+            list.head = voice;
+        list.tail = voice;
+    }
+
+    /** Removes a sounding voice from the list for its state */
+    void Unlink(uint8_t voice)
+    {
+        List& list = lists_[voices_[voice].state == VoiceState::HELD
+                                ? kHeldList
+                                : kSustainedList];
+        if(prev_[voice] != kNone)
+            next_[prev_[voice]] = next_[voice];
+        else
+            list.head = next_[voice];
+        if(next_[voice] != kNone)
+            prev_[next_[voice]] = prev_[voice];
+        else
+            list.tail = prev_[voice];
+    }
+
+    /** Returns a free voice, or steals one. The returned voice is unlinked. */
+    uint8_t AcquireVoice(bool& stolen)
+    {
+        if(free_count_ > 0)
+        {
+            const uint8_t voice = free_[free_read_];
+            free_read_          = (free_read_ + 1) % kNumVoices;
+            free_count_--;
+            stolen = false;
+            return voice;
+        }
+
+        uint8_t voice = kNone;
+        switch(config_.steal_mode)
+        {
+            case StealMode::OLDEST:
+                voice = lists_[kSustainedList].head != kNone
+                            ? lists_[kSustainedList].head
+                            : lists_[kHeldList].head;
+                break;
+            case StealMode::QUIETEST:
+                voice = FindQuietest(kSustainedList);
+                if(voice == kNone)
+                    voice = FindQuietest(kHeldList);
+                break;
+            case StealMode::NONE: return kNone;
+        }
+
+        Unlink(voice);
+        note_voice_[voices_[voice].note] = kNone;
+        stolen                           = true;
+        return voice;
+    }
+
+    uint8_t FindQuietest(size_t list) const
+    {
+        uint8_t quietest = kNone;
+        for(uint8_t v = lists_[list].head; v != kNone; v = next_[v])
+        {
+            if(quietest == kNone || voices_[v].level < voices_[quietest].level)
+                quietest = v;
+        }
+        return quietest;
+    }
+
+    /** Starts an unlinked voice and appends it to the held list */
+    void StartVoice(uint8_t voice, uint8_t note, uint8_t velocity, bool stolen)
+    {
+        Voice& v          = voices_[voice];
+        v.state           = VoiceState::HELD;
+        v.note            = note;
+        v.velocity        = velocity;
+        v.level           = velocity * (1.f / 127.f);
+        note_voice_[note] = voice;
+        Link(voice);
+        PushEvent(VoiceEvent::Type::NOTE_ON, voice, note, velocity, stolen);
+    }
+
+    /** Releases a sounding voice and returns it to the back of the free queue */
+    void ReleaseVoice(uint8_t voice)
+    {
+        Voice& v = voices_[voice];
+        Unlink(voice);
+        v.state             = VoiceState::FREE;
+        note_voice_[v.note] = kNone;
+        const size_t tail   = (free_read_ + free_count_) % kNumVoices;
+        free_[tail]         = voice;
+        free_count_++;
+        PushEvent(VoiceEvent::Type::NOTE_OFF, voice, v.note, v.velocity, false);
+    }
+
+    void MonoNoteOn(uint8_t note, uint8_t velocity)
+    {
+        Voice&     v            = voices_[0];
+        const bool was_sounding = v.state != VoiceState::FREE;
+
+        held_notes_.RemoveAllEqualTo(note);
+        if(held_notes_.IsFull())
+            held_notes_.Remove(0);
+        held_notes_.PushBack(note);
+        note_velocity_[note] = velocity;
+
+        const bool glide = config_.mode == Mode::LEGATO && was_sounding;
+        MonoPlay(note, velocity, glide);
+    }
+
+    void MonoNoteOff(uint8_t note)
+    {
+        const size_t count  = held_notes_.GetNumElements();
+        const bool   active = count > 0 && held_notes_[count - 1] == note;
+        held_notes_.RemoveAllEqualTo(note);
+        if(!active)
+            return;
+
+        // return to the previous held note
+        if(!held_notes_.IsEmpty())
+        {
+            const uint8_t prev = held_notes_[held_notes_.GetNumElements() - 1];
+            MonoPlay(prev, note_velocity_[prev], config_.mode == Mode::LEGATO);
+        }
+        else if(sustain_)
+        {
+            voices_[0].state = VoiceState::SUSTAINED;
+        }
+        else
+        {
+            MonoRelease();
+        }
+    }
+
+    void MonoPlay(uint8_t note, uint8_t velocity, bool glide)
+    {
+        Voice& v = voices_[0];
+        if(v.state != VoiceState::FREE)
+            note_voice_[v.note] = kNone;
+        v.state           = VoiceState::HELD;
+        v.note            = note;
+        v.velocity        = velocity;
+        v.level           = velocity * (1.f / 127.f);
+        note_voice_[note] = 0;
+        PushEvent(glide ? VoiceEvent::Type::LEGATO : VoiceEvent::Type::NOTE_ON,
+                  0,
+                  note,
+                  velocity,
+                  false);
+    }
+
+    void MonoRelease()
+    {
+        Voice& v            = voices_[0];
+        v.state             = VoiceState::FREE;
+        note_voice_[v.note] = kNone;
+        PushEvent(VoiceEvent::Type::NOTE_OFF, 0, v.note, v.velocity, false);
+    }
+
+    Config                        config_;
+    Voice                         voices_[kNumVoices];
+    uint8_t                       prev_[kNumVoices];
+    uint8_t                       next_[kNumVoices];
+    List                          lists_[2];
+    uint8_t                       free_[kNumVoices];
+    size_t                        free_read_;
+    size_t                        free_count_;
+    uint8_t                       note_voice_[128];
+    uint8_t                       note_velocity_[128];
+    Stack<uint8_t, kMaxHeldNotes> held_notes_;
+    bool                          sustain_;
+    VoiceEvent                    events_[kNumVoices + 1];
+    size_t                        num_events_;
+};
+
+} // namespace daisy
+
+#endif
@@ -1449,11 +1449,21 @@ static const uint16_t Font6x7[] = {
     0x0000, 0x0000, 0x0000, 0x5000, 0xF000, 0xA000, 0x0000, // ~ Tilde
 };
 
-FontDef Font_4x6   = {4, 6, Font4x6};
-FontDef Font_4x8   = {4, 8, Font4x8};
-FontDef Font_5x8   = {5, 8, Font5x8};
-FontDef Font_6x7   = {6, 7, Font6x7};
-FontDef Font_6x8   = {6, 8, Font6x8};
-FontDef Font_7x10  = {7, 10, Font7x10};
-FontDef Font_11x18 = {11, 18, Font11x18};
-FontDef Font_16x26 = {16, 26, Font16x26};
+/* The same fonts as column bytes, see oled_fonts_columns.c */
+extern const uint8_t Font4x6Columns[];
+extern const uint8_t Font4x8Columns[];
+extern const uint8_t Font5x8Columns[];
+extern const uint8_t Font6x7Columns[];
+extern const uint8_t Font6x8Columns[];
+extern const uint8_t Font7x10Columns[];
+extern const uint8_t Font11x18Columns[];
+extern const uint8_t Font16x26Columns[];
+
+FontDef Font_4x6   = {4, 6, Font4x6, Font4x6Columns};
+FontDef Font_4x8   = {4, 8, Font4x8, Font4x8Columns};
+FontDef Font_5x8   = {5, 8, Font5x8, Font5x8Columns};
+FontDef Font_6x7   = {6, 7, Font6x7, Font6x7Columns};
+FontDef Font_6x8   = {6, 8, Font6x8, Font6x8Columns};
+FontDef Font_7x10  = {7, 10, Font7x10, Font7x10Columns};
+FontDef Font_11x18 = {11, 18, Font11x18, Font11x18Columns};
+FontDef Font_16x26 = {16, 26, Font16x26, Font16x26Columns};
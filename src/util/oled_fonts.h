@@ -12,12 +12,18 @@ Migrated to work with libdaisy from stm32-ssd1306
 @author afiskon on github.
 */
 
-/** Font struct */
+/** Font struct \n
+`data` holds one uint16_t per row, the leftmost pixel in the top bit.
+`columns` optionally holds the same glyphs for displays that store 8 vertical
+pixels per byte: [page][column] bytes, bit 0 at the top of the page. It is
+generated from `data` by ci/generate_oled_font_atlas.py.
+*/
 typedef struct
 {
     const uint8_t   FontWidth;  /*!< Font width in pixels */
     uint8_t         FontHeight; /*!< Font height in pixels */
     const uint16_t *data;       /*!< Pointer to data font data array */
+    const uint8_t  *columns;    /*!< Column byte glyphs, or NULL */
 } FontDef;
 
 
@@ -0,0 +1,260 @@
+#include "per/adc_mux_scan.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+AdcMuxScan::InputConfig MakeConfig(uint8_t            rate,
+                                   AdcMuxScan::Filter filter,
+                                   uint8_t            decimation = 0)
+{
+    AdcMuxScan::InputConfig cfg;
+    cfg.rate       = rate;
+    cfg.filter     = filter;
+    cfg.decimation = decimation;
+    return cfg;
+}
+
+/** The standard deviation of a series of values */
+double StdDev(const std::vector<double>& values)
+{
+    double mean = 0.0;
+    for(double v : values)
+        mean += v;
+    mean /= values.size();
+    double sum = 0.0;
+    for(double v : values)
+        sum += (v - mean) * (v - mean);
+    return std::sqrt(sum / values.size());
+}
+} // namespace
+
+TEST(per_AdcMuxScan, a_defaultsReadInTurn)
+{
+    uint16_t   output[8] = {};
+    AdcMuxScan scan;
+    scan.Init(output, 5);
+    EXPECT_EQ(scan.GetNumInputs(), 5u);
+    EXPECT_EQ(scan.GetCurrentInput(), 0);
+
+    // one input after the other, and the readings go straight through
+    for(int i = 0; i < 20; i++)
+    {
+        const uint8_t next = scan.Process(uint16_t(1000 * i));
+        EXPECT_EQ(next, (i + 1) % 5);
+        EXPECT_EQ(scan.Get(i % 5), 1000 * i);
+    }
+    EXPECT_FLOAT_EQ(scan.GetFloat(4), 19000.0f / 65536.0f);
+    EXPECT_EQ(output[5], 0);
+
+    scan.Process(1);
+    scan.Restart();
+    EXPECT_EQ(scan.GetCurrentInput(), 0);
+}
+
+TEST(per_AdcMuxScan, b_ratesShareScans)
+{
+    uint16_t   output[4];
+    AdcMuxScan scan;
+    scan.Init(output, 4);
+    const uint8_t rates[] = {4, 1, 1, 2};
+    for(size_t i = 0; i < 4; i++)
+        scan.SetInput(i, MakeConfig(rates[i], AdcMuxScan::Filter::NONE));
+    scan.Restart();
+
+    int    reads[4]   = {};
+    size_t last[4]    = {};
+    size_t max_gap[4] = {};
+    for(size_t t = 0; t < 800; t++)
+    {
+        const uint8_t input = scan.GetCurrentInput();
+        ASSERT_LT(input, 4);
+        reads[input]++;
+        max_gap[input] = std::max(max_gap[input], t - last[input]);
+        last[input]    = t;
+        scan.Process(0);
+    }
+
+    // in proportion to the rates, and spread out: at most one reading
+    // later than an even spacing would be
+    EXPECT_EQ(reads[0], 400);
+    EXPECT_EQ(reads[1], 100);
+    EXPECT_EQ(reads[2], 100);
+    EXPECT_EQ(reads[3], 200);
+    EXPECT_LE(max_gap[0], 3u);
+    EXPECT_EQ(max_gap[1], 8u);
+    EXPECT_EQ(max_gap[2], 8u);
+    EXPECT_LE(max_gap[3], 5u);
+
+    // a rate of 0 counts as 1, and input 0 still comes first, where the
+    // mux starts
+    scan.SetInput(0, MakeConfig(0, AdcMuxScan::Filter::NONE));
+    scan.Restart();
+    EXPECT_EQ(scan.GetCurrentInput(), 0);
+    int zero_reads = 0;
+    for(int t = 0; t < 500; t++)
+    {
+        zero_reads += scan.GetCurrentInput() == 0;
+        scan.Process(0);
+    }
+    EXPECT_EQ(zero_reads, 100);
+}
+
+TEST(per_AdcMuxScan, c_medianRemovesSpikes)
+{
+    std::mt19937 rng(48);
+    uint16_t     output[2];
+    AdcMuxScan   scan;
+    scan.Init(output, 2);
+    scan.SetInput(0, MakeConfig(1, AdcMuxScan::Filter::MEDIAN));
+
+    // single spikes on input 0 never get through, input 1 is unfiltered
+    int spikes = 0;
+    for(int t = 0; t < 2000; t++)
+    {
+        const bool     spike = t > 4 && t % 7 == 0;
+        const uint16_t value = spike ? uint16_t(rng()) : 1000;
+        const uint8_t  input = scan.GetCurrentInput();
+        scan.Process(value);
+        if(input == 0)
+        {
+            spikes += spike;
+            ASSERT_EQ(output[0], 1000) << t;
+        }
+        else
+        {
+            ASSERT_EQ(output[1], value);
+        }
+    }
+    EXPECT_GT(spikes, 100);
+
+    // a step gets through after two readings
+    scan.Restart();
+    const uint16_t expected[] = {1000, 2000, 2000};
+    for(int i = 0; i < 3; i++)
+    {
+        scan.Process(2000);
+        scan.Process(0);
+        EXPECT_EQ(output[0], expected[i]) << i;
+    }
+}
+
+TEST(per_AdcMuxScan, d_cicReducesNoise)
+{
+    std::mt19937                     rng(4800);
+    std::normal_distribution<double> noise(0.0, 300.0);
+    uint16_t                         output[4];
+    AdcMuxScan                       scan;
+    scan.Init(output, 4);
+    scan.SetInput(0, MakeConfig(1, AdcMuxScan::Filter::NONE));
+    scan.SetInput(1, MakeConfig(1, AdcMuxScan::Filter::CIC, 4));
+    scan.SetInput(2, MakeConfig(1, AdcMuxScan::Filter::MEDIAN_CIC, 4));
+    scan.SetInput(3, MakeConfig(1, AdcMuxScan::Filter::CIC, 6));
+    scan.Restart();
+
+    // a pot at 30000 with noise and, in about one of 50 readings, a spike
+    std::vector<double> values[4];
+    for(int t = 0; t < 200000; t++)
+    {
+        double raw = 30000.0 + noise(rng);
+        if(rng() % 50 == 0)
+            raw += 20000.0;
+        const uint8_t input = scan.GetCurrentInput();
+        scan.Process(uint16_t(raw));
+        if(t > 4000)
+            values[input].push_back(output[input]);
+    }
+
+    const double raw_noise = StdDev(values[0]);
+    double       reduction[4];
+    for(int i = 0; i < 4; i++)
+        reduction[i] = raw_noise / StdDev(values[i]);
+    EXPECT_GT(raw_noise, 300.0);
+    // the CIC averages the spikes in, the median takes them out first
+    EXPECT_GT(reduction[1], 3.0);
+    EXPECT_GT(reduction[2], 1.5 * reduction[1]);
+    EXPECT_GT(reduction[3], 1.5 * reduction[1]);
+    for(int i = 1; i < 4; i++)
+    {
+        ::testing::Test::RecordProperty(
+            "noise_reduction_x100_" + std::to_string(i),
+            int(reduction[i] * 100));
+    }
+    printf("noise reduction: CIC/16 %.1fx, median+CIC/16 %.1fx, "
+           "CIC/64 %.1fx\n",
+           reduction[1],
+           reduction[2],
+           reduction[3]);
+}
+
+TEST(per_AdcMuxScan, e_cicIsExact)
+{
+    // a constant comes out unchanged, even at full scale and the highest
+    // decimation, where the integrators wrap around
+    uint16_t   output[1];
+    AdcMuxScan scan;
+    scan.Init(output, 1);
+    for(uint16_t value : {uint16_t(0), uint16_t(12345), uint16_t(65535)})
+    {
+        scan.SetInput(0, MakeConfig(1, AdcMuxScan::Filter::CIC, 6));
+        for(int t = 0; t < 20000; t++)
+        {
+            scan.Process(value);
+            ASSERT_EQ(output[0], value) << t;
+        }
+    }
+
+    // until the first full window, the readings are passed through; after
+    // that, a step settles within two windows of 8 readings
+    scan.SetInput(0, MakeConfig(1, AdcMuxScan::Filter::CIC, 3));
+    for(int t = 0; t < 16; t++)
+    {
+        scan.Process(uint16_t(100 * t));
+        if(t < 8)
+        {
+            EXPECT_EQ(output[0], 100 * t);
+        }
+    }
+    for(int t = 0; t < 16; t++)
+        scan.Process(8000);
+    EXPECT_EQ(output[0], 8000);
+}
+
+TEST(per_AdcMuxScan, f_benchmark)
+{
+    std::mt19937 rng(480);
+    uint16_t     output[8];
+    AdcMuxScan   scan;
+    scan.Init(output, 8);
+    for(size_t i = 0; i < 8; i++)
+    {
+        const auto filter = AdcMuxScan::Filter(i % 4);
+        scan.SetInput(i, MakeConfig(uint8_t(1 + i % 3), filter, 4));
+    }
+    scan.Restart();
+
+    std::vector<uint16_t> samples(4096);
+    for(auto& sample : samples)
+        sample = uint16_t(rng());
+
+    using Clock             = std::chrono::steady_clock;
+    constexpr int kReadings = 2000000;
+    const auto    start     = Clock::now();
+    uint32_t      checksum  = 0;
+    for(int t = 0; t < kReadings; t++)
+        checksum += scan.Process(samples[t & 4095]) + output[t & 7];
+    const auto time = Clock::now() - start;
+
+    // one scan reads each of the 8 inputs once, on average
+    const double ns_per_scan
+        = std::chrono::duration<double, std::nano>(time).count() / kReadings
+          * 8;
+    RecordProperty("ns_per_scan", int(ns_per_scan));
+    printf("AdcMuxScan: %.1f ns per scan of 8 inputs\n", ns_per_scan);
+    EXPECT_NE(checksum, 0u);
+}
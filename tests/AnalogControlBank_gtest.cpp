@@ -0,0 +1,178 @@
+#include "hid/ctrl.h"
+#include "hid/ctrl_bank.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace daisy;
+
+namespace
+{
+constexpr float kRate = 1000.0f;
+
+/** The same settings on an array of AnalogControl and on a bank */
+template <size_t N>
+struct Controls
+{
+    uint16_t             raw[N] = {};
+    AnalogControl        single[N];
+    AnalogControlBank<N> bank;
+
+    explicit Controls(std::mt19937& rng)
+    {
+        bank.Init(raw, kRate);
+        for(size_t i = 0; i < N; i++)
+        {
+            switch(i % 4)
+            {
+                case 0:
+                    single[i].Init(&raw[i], kRate);
+                    break;
+                case 1:
+                    single[i].Init(&raw[i], kRate, true, false, 0.01f);
+                    bank.SetFlip(i, true);
+                    bank.SetCoeff(i, 1.0f / (0.01f * kRate * 0.5f));
+                    break;
+                case 2:
+                    single[i].InitBipolarCv(&raw[i], kRate);
+                    bank.InitBipolarCv(i);
+                    break;
+                default:
+                {
+                    // calibrated
+                    const float scale  = 0.9f + (rng() % 100) / 500.0f;
+                    const float offset = (rng() % 100) / 1000.0f;
+                    single[i].Init(&raw[i], kRate, true, true);
+                    single[i].SetScale(scale);
+                    single[i].SetOffset(offset);
+                    bank.SetFlip(i, true);
+                    bank.SetInvert(i, true);
+                    bank.SetScale(i, scale);
+                    bank.SetOffset(i, offset);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+template <size_t N>
+void ExpectSameValues(std::mt19937& rng)
+{
+    Controls<N> controls(rng);
+    for(int step = 0; step < 2000; step++)
+    {
+        // mostly small changes, sometimes jumps
+        for(auto& raw : controls.raw)
+            raw = (step % 100 == 0) ? rng() : raw + rng() % 64;
+        controls.bank.Process();
+        for(size_t i = 0; i < N; i++)
+        {
+            const float expected = controls.single[i].Process();
+            ASSERT_EQ(controls.bank.Value(i), expected)
+                << "control " << i << ", step " << step;
+        }
+    }
+}
+
+template <size_t N>
+void Benchmark(::testing::Test& test, std::mt19937& rng)
+{
+    Controls<N>* controls = new Controls<N>(rng);
+    for(auto& raw : controls->raw)
+        raw = rng();
+
+    using Clock            = std::chrono::steady_clock;
+    constexpr int kBlocks  = 200000;
+    const auto    start    = Clock::now();
+    float         checksum = 0.0f;
+    for(int b = 0; b < kBlocks; b++)
+    {
+        for(auto& control : controls->single)
+            checksum += control.Process();
+    }
+    const auto single_time = Clock::now() - start;
+
+    const auto bank_start = Clock::now();
+    for(int b = 0; b < kBlocks; b++)
+    {
+        controls->bank.Process();
+        checksum -= controls->bank.Value(b % N);
+    }
+    const auto bank_time = Clock::now() - bank_start;
+    delete controls;
+
+    auto ns = [](Clock::duration d) {
+        return std::chrono::duration<double, std::nano>(d).count() / kBlocks;
+    };
+    test.RecordProperty("ns_per_block_single_" + std::to_string(N),
+                        std::to_string(ns(single_time)));
+    test.RecordProperty("ns_per_block_bank_" + std::to_string(N),
+                        std::to_string(ns(bank_time)));
+    printf("%2d controls: %.1f ns/block with AnalogControl, %.1f ns/block "
+           "with AnalogControlBank\n",
+           int(N),
+           ns(single_time),
+           ns(bank_time));
+    // uses the results, so that they aren't optimized away
+    EXPECT_TRUE(std::isfinite(checksum));
+}
+} // namespace
+
+TEST(hid_AnalogControlBank, a_matchesAnalogControl)
+{
+    std::mt19937 rng(5);
+    ExpectSameValues<4>(rng);
+    ExpectSameValues<8>(rng);
+    ExpectSameValues<13>(rng);
+}
+
+TEST(hid_AnalogControlBank, b_settings)
+{
+    uint16_t             raw[2] = {0, 32768};
+    AnalogControlBank<2> bank;
+    bank.Init(raw, kRate);
+    EXPECT_EQ(bank.GetNumControls(), 2u);
+    EXPECT_EQ(bank.GetRawValue(1), 32768);
+
+    // no smoothing: the values follow the input right away
+    bank.SetCoeff(0, 2.0f);
+    bank.SetCoeff(1, 1.0f);
+    bank.InitBipolarCv(1);
+    bank.SetCoeff(1, 1.0f);
+    bank.Process();
+    EXPECT_FLOAT_EQ(bank.Values()[0], 0.0f);
+    EXPECT_FLOAT_EQ(bank.Values()[1], 0.0f);
+
+    raw[1] = 0;
+    bank.Process();
+    EXPECT_FLOAT_EQ(bank.Value(1), 1.0f);
+    bank.SetFlip(0, true);
+    bank.Process();
+    EXPECT_FLOAT_EQ(bank.Value(0), 1.0f);
+
+    // a higher rate smoothes more per call, as on a single control
+    AnalogControl single;
+    single.Init(&raw[0], kRate);
+    single.SetSampleRate(kRate * 4);
+    bank.Init(raw, kRate);
+    bank.SetSampleRate(kRate * 4);
+    raw[0] = 65535;
+    for(int i = 0; i < 4; i++)
+    {
+        bank.Process();
+        EXPECT_FLOAT_EQ(bank.Value(0), single.Process());
+    }
+    EXPECT_LT(bank.Value(0), 0.9f);
+}
+
+TEST(hid_AnalogControlBank, c_benchmark)
+{
+    std::mt19937 rng(6);
+    Benchmark<4>(*this, rng);
+    Benchmark<8>(*this, rng);
+    Benchmark<16>(*this, rng);
+    Benchmark<32>(*this, rng);
+}
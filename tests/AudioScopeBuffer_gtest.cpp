@@ -0,0 +1,248 @@
+#include "FramebufferDisplay.h"
+#include "sys/system.h"
+#include "ui/AudioScopePages.h"
+#include "util/AudioScopeBuffer.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** A UI that draws to a FramebufferDisplay */
+struct DisplayUi
+{
+    DisplayUi(uint16_t width, uint16_t height) : display(width, height)
+    {
+        UiCanvasDescriptor canvas;
+        canvas.id_                       = 0;
+        canvas.handle_                   = &display;
+        canvas.updateRateMs_             = 30;
+        canvas.redrawOnlyWhenInvalidated = true;
+        canvas.clearFunction_            = [](const UiCanvasDescriptor& c) {
+            static_cast<FramebufferDisplay*>(c.handle_)->Fill(false);
+        };
+        canvas.flushFunction_ = [](const UiCanvasDescriptor& c) {
+            static_cast<FramebufferDisplay*>(c.handle_)->Update();
+        };
+        ui.Init(queue, UI::SpecialControlIds(), {canvas}, 0);
+    }
+
+    void Run(uint32_t ms)
+    {
+        for(uint32_t i = 0; i < ms; i++)
+        {
+            System::Delay(1);
+            ui.Process();
+        }
+    }
+
+    FramebufferDisplay display;
+    UiEventQueue       queue;
+    UI                 ui;
+};
+
+/** The value of all samples of a frame in the concurrency test */
+float FrameValue(uint32_t number)
+{
+    return float(number % 997) / 997.0f;
+}
+} // namespace
+
+TEST(util_AudioScopeBuffer, a_decimatesColumns)
+{
+    AudioScopeBuffer<2, 4> buffer;
+    buffer.Init(3);
+    EXPECT_FALSE(buffer.HasNewFrame());
+    EXPECT_EQ(buffer.GetFrame().number, 0u);
+
+    // 12 samples make a frame; blocks don't have to line up with columns
+    const float left[]  = {0.1f, -0.2f, 0.3f, 0.5f, 0.5f, 0.5f,
+                          -1.0f, 0.0f, 0.0f, 0.25f, -0.25f, 0.0f};
+    const float right[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0.5f};
+    const float* block[]  = {left, right};
+    const float* block2[] = {left + 5, right + 5};
+    buffer.Process(block, 5);
+    EXPECT_FALSE(buffer.HasNewFrame());
+    buffer.Process(block2, 7);
+    ASSERT_TRUE(buffer.HasNewFrame());
+
+    const auto& frame = buffer.GetFrame();
+    EXPECT_FALSE(buffer.HasNewFrame());
+    EXPECT_EQ(frame.number, 1u);
+    const float mins[] = {-0.2f, 0.5f, -1.0f, -0.25f};
+    const float maxs[] = {0.3f, 0.5f, 0.0f, 0.25f};
+    for(int i = 0; i < 4; i++)
+    {
+        EXPECT_FLOAT_EQ(frame.min[0][i], mins[i]) << i;
+        EXPECT_FLOAT_EQ(frame.max[0][i], maxs[i]) << i;
+    }
+    EXPECT_FLOAT_EQ(frame.max[1][3], 0.5f);
+    EXPECT_FLOAT_EQ(frame.peak[0], 1.0f);
+    EXPECT_FLOAT_EQ(frame.peak[1], 0.5f);
+    float sum = 0.0f;
+    for(float sample : left)
+        sum += sample * sample;
+    EXPECT_NEAR(frame.rms[0], sqrtf(sum / 12.0f), 1e-6f);
+    EXPECT_NEAR(frame.rms[1], sqrtf(0.25f / 12.0f), 1e-6f);
+
+    // the frame stays the same until the next one is fetched
+    const float silence[12] = {};
+    const float* quiet[]    = {silence, silence};
+    buffer.Process(quiet, 12);
+    EXPECT_EQ(frame.number, 1u);
+    EXPECT_FLOAT_EQ(frame.peak[0], 1.0f);
+    EXPECT_EQ(buffer.GetFrame().number, 2u);
+    EXPECT_FLOAT_EQ(buffer.GetFrame().peak[0], 0.0f);
+}
+
+TEST(util_AudioScopeBuffer, b_interleaved)
+{
+    AudioScopeBuffer<2, 2> buffer;
+    buffer.Init(2);
+    const float samples[]
+        = {0.5f, -0.5f, 0.25f, 0.0f, -1.0f, 0.0f, 0.0f, 0.75f};
+    buffer.ProcessInterleaved(samples, 4);
+    const auto& frame = buffer.GetFrame();
+    ASSERT_EQ(frame.number, 1u);
+    EXPECT_FLOAT_EQ(frame.min[0][0], 0.25f);
+    EXPECT_FLOAT_EQ(frame.max[0][0], 0.5f);
+    EXPECT_FLOAT_EQ(frame.min[0][1], -1.0f);
+    EXPECT_FLOAT_EQ(frame.min[1][0], -0.5f);
+    EXPECT_FLOAT_EQ(frame.max[1][1], 0.75f);
+}
+
+TEST(util_AudioScopeBuffer, c_consistentFramesAcrossThreads)
+{
+    constexpr size_t   kColumns         = 16;
+    constexpr size_t   kSamplesPerCol   = 4;
+    constexpr size_t   kSamplesPerFrame = kColumns * kSamplesPerCol;
+    constexpr uint32_t kNumFrames       = 20000;
+
+    AudioScopeBuffer<2, kColumns> buffer;
+    buffer.Init(kSamplesPerCol);
+    std::atomic<bool> done(false);
+
+    // blocks of 48 samples, so frames start in the middle of blocks
+    std::thread producer([&]() {
+        std::vector<float> left(48), right(48);
+        for(size_t start = 0; start < kNumFrames * kSamplesPerFrame;
+            start += 48)
+        {
+            for(size_t i = 0; i < 48; i++)
+            {
+                const uint32_t number = (start + i) / kSamplesPerFrame + 1;
+                left[i]               = FrameValue(number);
+                right[i]              = -FrameValue(number);
+            }
+            const float* block[] = {left.data(), right.data()};
+            buffer.Process(block, 48);
+        }
+        done = true;
+    });
+
+    uint32_t last = 0, frames_seen = 0;
+    bool     consistent = true;
+    while(!done || buffer.HasNewFrame())
+    {
+        const auto& frame = buffer.GetFrame();
+        if(frame.number == last)
+            continue;
+        frames_seen++;
+        consistent &= frame.number > last;
+        last              = frame.number;
+        const float value = FrameValue(frame.number);
+        for(size_t x = 0; x < kColumns; x++)
+        {
+            consistent &= frame.min[0][x] == value && frame.max[0][x] == value
+                          && frame.min[1][x] == -value
+                          && frame.max[1][x] == -value;
+        }
+        consistent &= frame.peak[0] == value && frame.peak[1] == value;
+        consistent &= fabsf(frame.rms[0] - value) < 1e-5f;
+        if(!consistent)
+            break;
+    }
+    producer.join();
+
+    EXPECT_TRUE(consistent) << "frame " << last;
+    EXPECT_EQ(last, kNumFrames);
+    EXPECT_GT(frames_seen, 1u);
+    RecordProperty("frames_seen", std::to_string(frames_seen));
+}
+
+TEST(ui_AudioScopePages, a_scopeDrawsColumns)
+{
+    DisplayUi                   ui(8, 8);
+    AudioScopeBuffer<1, 8>      buffer;
+    ScopePage<decltype(buffer)> page;
+    buffer.Init(2);
+    page.Init(buffer);
+    ui.ui.OpenPage(page);
+    ui.Run(50);
+    ASSERT_EQ(ui.display.GetStats().updates, 1u);
+
+    // top, bottom, full swing, silence
+    const float samples[] = {1, 1, -1, -1, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    const float* block[] = {samples};
+    buffer.Process(block, 16);
+    page.Poll();
+    ui.Run(50);
+    EXPECT_EQ(ui.display.GetStats().updates, 2u);
+    EXPECT_EQ(ui.display.ToAscii(),
+              "#.#.....\n"
+              "..#.....\n"
+              "..#.....\n"
+              "..#.....\n"
+              "..######\n"
+              "..#.....\n"
+              "..#.....\n"
+              ".##.....\n");
+
+    // nothing new, no redraw
+    page.Poll();
+    ui.Run(50);
+    EXPECT_EQ(ui.display.GetStats().updates, 2u);
+}
+
+TEST(ui_AudioScopePages, b_meterShowsLevels)
+{
+    DisplayUi                        ui(32, 16);
+    AudioScopeBuffer<2, 4>           buffer;
+    LevelMeterPage<decltype(buffer)> page;
+    buffer.Init(4);
+    page.Init(buffer);
+    ui.ui.OpenPage(page);
+
+    // full scale on the left, -20 dB on the right with a peak at -6 dB
+    float left[16], right[16];
+    for(int i = 0; i < 16; i++)
+    {
+        left[i]  = (i % 2) ? 1.0f : -1.0f;
+        right[i] = 0.1f;
+    }
+    right[3]             = 0.5f;
+    const float* block[] = {left, right};
+    buffer.Process(block, 16);
+    page.Poll();
+    ui.Run(50);
+
+    const auto& frame = buffer.GetFrame();
+    const int   rms
+        = int((1.0f + 20.0f * log10f(frame.rms[1]) / 60.0f) * 30 + 0.5f);
+    const int peak = int((1.0f + 20.0f * log10f(0.5f) / 60.0f) * 30 + 0.5f);
+    EXPECT_GT(rms, 15);
+    EXPECT_GT(peak, rms);
+    for(int x = 1; x < 31; x++)
+    {
+        // left: full bar
+        EXPECT_TRUE(ui.display.GetPixel(x, 3)) << x;
+        // right: up to the RMS level, then the peak marker
+        EXPECT_EQ(ui.display.GetPixel(x, 11), x <= rms || x == peak) << x;
+    }
+    // outlines with a gap in between
+    EXPECT_TRUE(ui.display.GetPixel(0, 8));
+    EXPECT_FALSE(ui.display.GetPixel(5, 7));
+}
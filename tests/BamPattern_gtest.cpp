@@ -0,0 +1,99 @@
+#include "hid/bam_pattern.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace daisy;
+
+namespace
+{
+/** Applies BSRR words to a port like the GPIO peripheral does */
+uint32_t WriteBsrr(uint32_t odr, uint32_t bsrr)
+{
+    return (odr & ~(bsrr >> 16)) | (bsrr & 0xffff);
+}
+} // namespace
+
+TEST(hid_BamPattern, a_dutyCyclesMatchLevels)
+{
+    std::mt19937 rng(46);
+    BamPattern   pattern;
+    pattern.Init();
+
+    // LEDs on all but two pins, which the pattern must not touch
+    uint8_t levels[16];
+    for(uint8_t pin = 0; pin < 16; pin++)
+    {
+        levels[pin] = pin == 0 ? 0 : (pin == 1 ? 255 : uint8_t(rng()));
+        if(pin != 7 && pin != 12)
+            pattern.SetLevel(pin, levels[pin]);
+    }
+    EXPECT_EQ(pattern.GetLevel(5), levels[5]);
+
+    // run a cycle, starting with pins 7 and 12 high
+    uint32_t odr = (1u << 7) | (1u << 12);
+    int      on_slots[16]    = {};
+    int      transitions[16] = {};
+    for(size_t slot = 0; slot < BamPattern::kNumSlots; slot++)
+    {
+        const uint32_t next = WriteBsrr(odr, pattern.GetBuffer()[slot]);
+        for(int pin = 0; pin < 16; pin++)
+        {
+            on_slots[pin] += (next >> pin) & 1u;
+            transitions[pin] += ((next ^ odr) >> pin) & 1u;
+        }
+        odr = next;
+    }
+    for(int pin = 0; pin < 16; pin++)
+    {
+        if(pin == 7 || pin == 12)
+            EXPECT_EQ(on_slots[pin], 255) << pin;
+        else
+            EXPECT_EQ(on_slots[pin], levels[pin]) << pin;
+        // one stretch per bit: at most 8 changes per cycle, unlike PWM
+        // counters that would need a word per level step
+        EXPECT_LE(transitions[pin], 8) << pin;
+    }
+}
+
+TEST(hid_BamPattern, b_bitStretches)
+{
+    BamPattern pattern;
+    pattern.Init();
+    pattern.SetLevel(3, 0xA5); // bits 0, 2, 5 and 7
+
+    // bit n holds for 2^n slots, starting at slot 2^n - 1
+    const uint32_t on  = 1u << 3;
+    const uint32_t off = 1u << 19;
+    const auto*    buffer = pattern.GetBuffer();
+    for(size_t bit = 0; bit < BamPattern::kNumBits; bit++)
+    {
+        const uint32_t expected = (0xA5 >> bit) & 1 ? on : off;
+        for(size_t slot = (1u << bit) - 1; slot < (2u << bit) - 1; slot++)
+            EXPECT_EQ(buffer[slot], expected) << bit << " " << slot;
+    }
+
+    // changing one pin leaves the others as they are
+    pattern.SetLevel(4, 0xff);
+    pattern.SetLevel(3, 0x01);
+    EXPECT_EQ(buffer[0], on | (1u << 4));
+    for(size_t slot = 1; slot < BamPattern::kNumSlots; slot++)
+        EXPECT_EQ(buffer[slot], off | (1u << 4)) << slot;
+
+    // invalid pins are ignored
+    pattern.SetLevel(16, 0xff);
+    EXPECT_EQ(pattern.GetLevel(16), 0);
+    EXPECT_EQ(buffer[0], on | (1u << 4));
+}
+
+TEST(hid_BamPattern, c_levelFromDuty)
+{
+    EXPECT_EQ(BamPattern::LevelFromDuty(0.0f), 0);
+    EXPECT_EQ(BamPattern::LevelFromDuty(0.5f), 128);
+    EXPECT_EQ(BamPattern::LevelFromDuty(1.0f), uint8_t(BamPattern::kMaxLevel));
+
+    // Led::Set(1.5f) cubes to 3.375, which is fully on, and values below
+    // 0 are off
+    EXPECT_EQ(BamPattern::LevelFromDuty(1.5f * 1.5f * 1.5f),
+              uint8_t(BamPattern::kMaxLevel));
+    EXPECT_EQ(BamPattern::LevelFromDuty(-0.125f), 0);
+}
@@ -0,0 +1,137 @@
+#include "hid/parameter.h"
+#include "util/CurveTables.h"
+#include "util/MappedValue.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace daisy;
+
+TEST(util_CurveTables, a_exp2Accuracy)
+{
+    double max_error = 0.0;
+    for(int i = -126 * 4096; i < 128 * 4096 - 41; i++)
+    {
+        // odd steps so that the samples don't sit on the table points
+        const float  x     = float(i) / 4096.0f + 0.0001f;
+        const double exact = exp2(double(x));
+        const double error = fabs(CurveTables::Exp2(x) - exact) / exact;
+        max_error          = error > max_error ? error : max_error;
+    }
+    EXPECT_LT(max_error, 3e-7);
+    RecordProperty("max_relative_error_ppb", int(max_error * 1e9));
+
+    EXPECT_EQ(CurveTables::Exp2(0.0f), 1.0f);
+    EXPECT_EQ(CurveTables::Exp2(3.0f), 8.0f);
+    EXPECT_EQ(CurveTables::Exp2(-2.0f), 0.25f);
+    // clamped
+    EXPECT_GT(CurveTables::Exp2(1000.0f), 1e38f);
+    EXPECT_GT(CurveTables::Exp2(-1000.0f), 0.0f);
+}
+
+TEST(util_CurveTables, b_log2Accuracy)
+{
+    // every 101st float from the smallest normal number to the largest
+    double max_excess = 0.0;
+    for(uint32_t bits = 0x00800000u; bits < 0x7F800000u; bits += 101)
+    {
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        const double exact  = log2(double(x));
+        const float  approx = CurveTables::Log2(x);
+        const double ulp    = nextafterf(approx, INFINITY) - approx;
+        const double excess = fabs(approx - exact) - 0.5 * ulp;
+        max_excess          = excess > max_excess ? excess : max_excess;
+    }
+    EXPECT_LT(max_excess, 2e-7);
+    RecordProperty("max_absolute_error_ppb", int(max_excess * 1e9));
+
+    EXPECT_EQ(CurveTables::Log2(1.0f), 0.0f);
+    EXPECT_EQ(CurveTables::Log2(1024.0f), 10.0f);
+    EXPECT_EQ(CurveTables::Log2(0.125f), -3.0f);
+    EXPECT_EQ(CurveTables::Log2(0.0f), -126.0f);
+    EXPECT_EQ(CurveTables::Log2(-1.0f), -126.0f);
+}
+
+TEST(util_CurveTables, c_parameterLogCurve)
+{
+    uint16_t      raw = 0;
+    AnalogControl control;
+    control.Init(&raw, 1000.0f);
+    control.SetCoeff(1.0f);
+    Parameter param;
+    param.Init(control, 20.0f, 20000.0f, Parameter::LOGARITHMIC);
+
+    // the float rounding of the exponent alone is worth about 1e-6
+    for(uint32_t value = 0; value < 65536; value += 7)
+    {
+        raw                = uint16_t(value);
+        const double in    = value / 65536.0;
+        const double exact = 20.0 * pow(1000.0, in);
+        EXPECT_NEAR(param.Process(), exact, exact * 2e-6) << value;
+    }
+}
+
+TEST(util_CurveTables, d_benchmark)
+{
+    using Clock                = std::chrono::steady_clock;
+    constexpr int kNumValues   = 1000000;
+    float         checksum     = 0.0f;
+    auto          ns_per_value = [](Clock::duration d) {
+        return std::chrono::duration<double, std::nano>(d).count()
+               / kNumValues;
+    };
+    auto time = [&](float (*function)(float), float offset) {
+        const auto start = Clock::now();
+        for(int i = 0; i < kNumValues; i++)
+            checksum += function(float(i) * (1.0f / 65536.0f) + offset);
+        return ns_per_value(Clock::now() - start);
+    };
+
+    const double exp2_table = time(CurveTables::Exp2, -7.0f);
+    const double exp2_libm  = time(exp2f, -7.0f);
+    const double expf_libm  = time(expf, -7.0f);
+    const double log2_table = time(CurveTables::Log2, 0.01f);
+    const double log2_libm  = time(log2f, 0.01f);
+    const double log10_libm = time(log10f, 0.01f);
+
+    // the mapping of a log MappedFloatValue, e.g. a frequency
+    MappedFloatValue freq(
+        20.0f, 20000.0f, 440.0f, MappedFloatValue::Mapping::log);
+    auto start = Clock::now();
+    for(int i = 0; i < kNumValues; i++)
+    {
+        freq.SetFrom0to1(float(i % 1000) * 0.001f);
+        checksum += freq.GetAs0to1();
+    }
+    const double mapped_table = ns_per_value(Clock::now() - start);
+    // what it did before, with the C library
+    start = Clock::now();
+    for(int i = 0; i < kNumValues; i++)
+    {
+        const float a = 1.0f / log10f(20000.0f / 20.0f);
+        const float v = 20.0f * powf(10, float(i % 1000) * 0.001f / a);
+        checksum += a * log10f(v / 20.0f);
+    }
+    const double mapped_libm = ns_per_value(Clock::now() - start);
+
+    RecordProperty("ns_exp2_table", std::to_string(exp2_table));
+    RecordProperty("ns_exp2_libm", std::to_string(exp2_libm));
+    RecordProperty("ns_log2_table", std::to_string(log2_table));
+    RecordProperty("ns_log2_libm", std::to_string(log2_libm));
+    RecordProperty("ns_mapping_table", std::to_string(mapped_table));
+    RecordProperty("ns_mapping_libm", std::to_string(mapped_libm));
+    printf("ns per value: Exp2 %.2f, exp2f %.2f, expf %.2f, Log2 %.2f, "
+           "log2f %.2f, log10f %.2f; log mapping %.2f, with libm %.2f\n",
+           exp2_table,
+           exp2_libm,
+           expf_libm,
+           log2_table,
+           log2_libm,
+           log10_libm,
+           mapped_table,
+           mapped_libm);
+    EXPECT_TRUE(std::isfinite(checksum));
+}
@@ -0,0 +1,145 @@
+#include "hid/encoder.h"
+#include "sys/system.h"
+#include "ui/UiEventQueue.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Turns an encoder by one detent per entry, at 1 ms updates like
+ *  Encoder::Debounce(), and returns the accelerated increments of each step.
+ *  \param intervalsMs the time since the previous step; at least 4 ms, as a
+ *                     quadrature cycle takes four updates
+ */
+std::vector<int32_t> Replay(Encoder&                     encoder,
+                            const std::vector<uint32_t>& intervalsMs,
+                            bool                         clockwise,
+                            UiEventQueue*                queue = nullptr)
+{
+    // clockwise, B falls first and A follows; then both rise again
+    const bool a_levels[] = {true, false, false, true};
+    const bool b_levels[] = {false, false, true, true};
+
+    std::vector<int32_t> increments;
+    for(uint32_t interval : intervalsMs)
+    {
+        for(uint32_t t = 0; t < interval; t++)
+        {
+            System::Delay(1);
+            const size_t phase = t + 4 - interval;
+            const bool   a = t + 4 < interval ? true : a_levels[phase % 4];
+            const bool   b = t + 4 < interval ? true : b_levels[phase % 4];
+            if(clockwise)
+                encoder.Update(a, b, false);
+            else
+                encoder.Update(b, a, false);
+
+            if(encoder.Increment() != 0)
+            {
+                increments.push_back(encoder.AcceleratedIncrement());
+                if(queue != nullptr)
+                    queue->AddEncoderTurned(
+                        0, encoder.AcceleratedIncrement(), 24);
+            }
+        }
+    }
+    return increments;
+}
+
+int32_t Sum(const std::vector<int32_t>& values)
+{
+    int32_t sum = 0;
+    for(int32_t value : values)
+        sum += value;
+    return sum;
+}
+} // namespace
+
+TEST(hid_EncoderAcceleration, a_curve)
+{
+    EncoderAcceleration acceleration;
+    acceleration.Init(10.0f, 0.1f, 4.0f);
+
+    // 5 steps/s: below the threshold
+    uint32_t now = 1000000;
+    for(int i = 0; i < 5; i++)
+    {
+        now += 200000 - 1;
+        EXPECT_EQ(acceleration.Process(1, now), 1);
+    }
+    EXPECT_NEAR(acceleration.GetVelocity(now), 5.0f, 0.01f);
+
+    // 30 steps/s: a gain of 3, once the speed has settled
+    for(int i = 0; i < 10; i++)
+        acceleration.Process(1, now += 33333);
+    EXPECT_NEAR(acceleration.GetVelocity(now), 30.0f, 0.1f);
+    EXPECT_NEAR(acceleration.GetGain(), 3.0f, 0.01f);
+    EXPECT_EQ(acceleration.Process(1, now += 33333), 3);
+
+    // fractions are carried over: 20 steps/s is a gain of 2.5
+    for(int i = 0; i < 20; i++)
+        acceleration.Process(1, now += 40000);
+    EXPECT_NEAR(acceleration.GetGain(), 2.5f, 0.01f);
+    int32_t sum = 0;
+    for(int i = 0; i < 10; i++)
+        sum += acceleration.Process(1, now += 40000);
+    EXPECT_NEAR(sum, 25, 1);
+
+    // the gain is limited
+    for(int i = 0; i < 10; i++)
+        acceleration.Process(1, now += 1000);
+    EXPECT_FLOAT_EQ(acceleration.GetGain(), 4.0f);
+
+    // turning back starts slow, and so does a step after a pause
+    EXPECT_EQ(acceleration.Process(-1, now += 1000), -1);
+    EXPECT_FLOAT_EQ(acceleration.GetVelocity(now), 0.0f);
+    acceleration.Process(-1, now += 1000);
+    EXPECT_NEAR(acceleration.GetVelocity(now), -1000.0f, 0.1f);
+    EXPECT_FLOAT_EQ(acceleration.GetVelocity(now + 300000), 0.0f);
+    EXPECT_EQ(acceleration.Process(-1, now += 300000), -1);
+}
+
+TEST(hid_Encoder, a_replaysRecordedSpins)
+{
+    Encoder encoder;
+    encoder.SetAcceleration(10.0f, 0.1f, 8.0f);
+
+    // a recorded spin: speeding up to 200 steps/s and slowing down
+    const std::vector<uint32_t> spin = {250, 120, 60, 30, 16, 10, 7, 5, 5,
+                                        5,   5,   5,  6,  8,  12, 20, 40, 90};
+    const auto increments = Replay(encoder, spin, true);
+    ASSERT_EQ(increments.size(), spin.size());
+    EXPECT_EQ(increments[0], 1);
+    EXPECT_EQ(increments[1], 1);
+    for(int32_t increment : increments)
+        EXPECT_GE(increment, 1);
+    EXPECT_EQ(increments[10], 8);
+    EXPECT_GT(Sum(increments), 4 * int32_t(spin.size()));
+    EXPECT_GT(encoder.Velocity(), 10.0f);
+
+    // the speed is gone after a pause
+    System::Delay(500);
+    EXPECT_FLOAT_EQ(encoder.Velocity(), 0.0f);
+
+    // slow turns back are not accelerated
+    const auto back = Replay(encoder, {150, 150, 150}, false);
+    EXPECT_EQ(back, std::vector<int32_t>({-1, -1, -1}));
+    EXPECT_LT(encoder.Velocity(), -5.0f);
+}
+
+TEST(hid_Encoder, b_queueCarriesAcceleratedIncrements)
+{
+    Encoder      encoder;
+    UiEventQueue queue;
+    const std::vector<uint32_t> spin = {100, 8, 6, 5, 5, 5, 5, 5};
+    const auto increments = Replay(encoder, spin, true, &queue);
+
+    // the turns merged into one event with the accelerated sum
+    const auto event = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(event.type, UiEventQueue::Event::EventType::encoderTurned);
+    EXPECT_EQ(event.asEncoderTurned.increments, Sum(increments));
+    EXPECT_GT(event.asEncoderTurned.increments, int16_t(spin.size()));
+    EXPECT_TRUE(queue.IsQueueEmpty());
+}
@@ -0,0 +1,273 @@
+#pragma once
+#include "hid/disp/display.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/** A OneBitGraphicsDisplay that draws into memory, so that the graphics
+ *  and UI code can be tested and benchmarked on the host.
+ *
+ *  It only implements DrawPixel() and Fill(), i.e. it measures the generic
+ *  drawing code of OneBitGraphicsDisplayImpl. The number of calls is
+ *  counted, so tests can check how much work a redraw takes.
+ *
+ *  Frames can be saved and loaded as PBM images (P1 or P4) and compared
+ *  with golden images, see MatchesGoldenImage().
+ */
+class FramebufferDisplay
+: public daisy::OneBitGraphicsDisplayImpl<FramebufferDisplay>
+{
+  public:
+    /** What was drawn since the last ResetStats() */
+    struct Stats
+    {
+        size_t pixelWrites   = 0; /**< calls to DrawPixel() */
+        size_t pixelsChanged = 0; /**< calls that changed the pixel */
+        size_t fills         = 0; /**< calls to Fill() */
+        size_t updates       = 0; /**< calls to Update() */
+    };
+
+    FramebufferDisplay(uint16_t width = 128, uint16_t height = 64)
+    : width_(width), height_(height), pixels_(width * height, false)
+    {
+    }
+
+    uint16_t Width() const override { return width_; }
+    uint16_t Height() const override { return height_; }
+
+    void Fill(bool on) override
+    {
+        stats_.fills++;
+        pixels_.assign(pixels_.size(), on);
+    }
+
+    void DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) override
+    {
+        stats_.pixelWrites++;
+        if(x >= width_ || y >= height_)
+            return;
+        if(pixels_[y * width_ + x] != on)
+            stats_.pixelsChanged++;
+        pixels_[y * width_ + x] = on;
+    }
+
+    void Update() override
+    {
+        stats_.updates++;
+        flushed_ = pixels_;
+    }
+
+    bool UpdateFinished() override { return true; }
+
+    bool GetPixel(uint16_t x, uint16_t y) const
+    {
+        return x < width_ && y < height_ && pixels_[y * width_ + x];
+    }
+
+    /** \return the frame as it was at the last Update() */
+    const std::vector<bool>& GetFlushedFrame() const { return flushed_; }
+
+    const Stats& GetStats() const { return stats_; }
+    void         ResetStats() { stats_ = Stats(); }
+
+    /** \return the number of pixels that differ from another display of
+     *  the same size, or -1 if the sizes differ */
+    int CountDifferences(const FramebufferDisplay& other) const
+    {
+        if(other.width_ != width_ || other.height_ != height_)
+            return -1;
+        int differences = 0;
+        for(size_t i = 0; i < pixels_.size(); i++)
+            differences += pixels_[i] != other.pixels_[i];
+        return differences;
+    }
+
+    /** \return the frame as text, '#' for set pixels, '.' for cleared ones,
+     *  one line per row. Useful in failure messages. */
+    std::string ToAscii() const
+    {
+        std::string text;
+        for(uint16_t y = 0; y < height_; y++)
+        {
+            for(uint16_t x = 0; x < width_; x++)
+                text += GetPixel(x, y) ? '#' : '.';
+            text += '\n';
+        }
+        return text;
+    }
+
+    /** \return the frame as a binary (P4) or text (P1) PBM image */
+    std::string ToPbm(bool binary = true) const
+    {
+        std::string image = std::string(binary ? "P4\n" : "P1\n")
+                            + std::to_string(width_) + " "
+                            + std::to_string(height_) + "\n";
+        for(uint16_t y = 0; y < height_ && !binary; y++)
+        {
+            for(uint16_t x = 0; x < width_; x++)
+                image += GetPixel(x, y) ? '1' : '0';
+            image += '\n';
+        }
+        for(uint16_t y = 0; y < height_ && binary; y++)
+        {
+            for(uint16_t x = 0; x < width_; x += 8)
+            {
+                uint8_t byte = 0;
+                for(uint16_t bit = 0; bit < 8; bit++)
+                {
+                    if(GetPixel(x + bit, y))
+                        byte |= 0x80 >> bit;
+                }
+                image += char(byte);
+            }
+        }
+        return image;
+    }
+
+    /** Reads a P1 (text) or P4 (binary) PBM image into the frame and
+     *  resizes the display to it. \return false if it can't be parsed
+     */
+    bool FromPbm(const std::string& image)
+    {
+        std::istringstream in(image);
+        std::string        magic;
+        in >> magic;
+        int width = ReadNumber(in), height = ReadNumber(in);
+        if((magic != "P1" && magic != "P4") || width <= 0 || height <= 0)
+            return false;
+
+        std::vector<bool> pixels(width * height, false);
+        if(magic == "P1")
+        {
+            for(auto&& pixel : pixels)
+            {
+                char c;
+                do
+                {
+                    if(!in.get(c))
+                        return false;
+                } while(c != '0' && c != '1');
+                pixel = c == '1';
+            }
+        }
+        else
+        {
+            in.get(); // the single whitespace after the header
+            const int bytes_per_row = (width + 7) / 8;
+            for(int y = 0; y < height; y++)
+            {
+                for(int i = 0; i < bytes_per_row; i++)
+                {
+                    char c;
+                    if(!in.get(c))
+                        return false;
+                    const uint8_t byte = c;
+                    for(int bit = 0; bit < 8 && i * 8 + bit < width; bit++)
+                        pixels[y * width + i * 8 + bit]
+                            = (byte << bit) & 0x80;
+                }
+            }
+        }
+        width_  = width;
+        height_ = height;
+        pixels_ = pixels;
+        return true;
+    }
+
+    /** \return the frame packed like the data of a daisy::OneBitBitmap,
+     *  e.g. to draw an image read with ReadPbm() with DrawBitmap() */
+    std::vector<uint8_t> ToBitmapData() const
+    {
+        std::vector<uint8_t> data(((height_ + 7) / 8) * width_, 0);
+        for(uint16_t y = 0; y < height_; y++)
+        {
+            for(uint16_t x = 0; x < width_; x++)
+            {
+                if(GetPixel(x, y))
+                    data[(y / 8) * width_ + x] |= 1 << (y % 8);
+            }
+        }
+        return data;
+    }
+
+    bool WritePbm(const std::string& path, bool binary = true) const
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << ToPbm(binary);
+        return bool(file);
+    }
+
+    bool ReadPbm(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if(!file)
+            return false;
+        std::stringstream content;
+        content << file.rdbuf();
+        return FromPbm(content.str());
+    }
+
+  private:
+    /** reads a number from a PBM header, skipping comments */
+    static int ReadNumber(std::istream& in)
+    {
+        in >> std::ws;
+        while(in.peek() == '#')
+        {
+            std::string comment;
+            std::getline(in, comment);
+            in >> std::ws;
+        }
+        int value = -1;
+        in >> value;
+        return value;
+    }
+
+    uint16_t          width_, height_;
+    std::vector<bool> pixels_;
+    std::vector<bool> flushed_;
+    Stats             stats_;
+};
+
+/** Compares the frame with the golden image tests/golden/<name>.pbm.
+ *
+ *  Golden images are text (P1) PBM files, so changes show up in diffs.
+ *  If the frame differs, the frame is written to <name>.actual.pbm in the
+ *  working directory for inspection. With the environment variable
+ *  DAISY_UPDATE_GOLDEN_IMAGES set, the golden image is (re)written
+ *  instead and the comparison passes.
+ */
+inline ::testing::AssertionResult
+MatchesGoldenImage(const FramebufferDisplay& display, const std::string& name)
+{
+    std::string dir = __FILE__;
+    dir             = dir.substr(0, dir.find_last_of("/\\") + 1) + "golden/";
+    const std::string golden_path = dir + name + ".pbm";
+
+    if(std::getenv("DAISY_UPDATE_GOLDEN_IMAGES") != nullptr)
+    {
+        if(!display.WritePbm(golden_path, false))
+            return ::testing::AssertionFailure()
+                   << "can't write " << golden_path;
+        return ::testing::AssertionSuccess();
+    }
+
+    FramebufferDisplay golden;
+    if(!golden.ReadPbm(golden_path))
+        return ::testing::AssertionFailure()
+               << "can't read " << golden_path
+               << ", set DAISY_UPDATE_GOLDEN_IMAGES to create it";
+    const int differences = display.CountDifferences(golden);
+    if(differences == 0)
+        return ::testing::AssertionSuccess();
+
+    display.WritePbm(name + ".actual.pbm");
+    return ::testing::AssertionFailure()
+           << name << ": " << differences
+           << " pixels differ from the golden image (-1: size differs), "
+           << "the frame was written to " << name << ".actual.pbm\n"
+           << display.ToAscii();
+}
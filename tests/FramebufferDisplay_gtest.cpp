@@ -0,0 +1,212 @@
+#include "FramebufferDisplay.h"
+#include "sys/system.h"
+#include "ui/FullScreenItemMenu.h"
+#include "ui/UI.h"
+#include "util/MappedValue.h"
+#include <chrono>
+#include <gtest/gtest.h>
+
+using namespace daisy;
+
+namespace
+{
+/** A UI with a FullScreenItemMenu that draws to a FramebufferDisplay */
+class MenuFixture
+{
+  public:
+    MenuFixture()
+    : cutoff_(20.0f, 20000.0f, 1000.0f, MappedFloatValue::Mapping::log, "Hz")
+    {
+        items_[0].type                            = ItemType::checkboxItem;
+        items_[0].text                            = "Bypass";
+        items_[0].asCheckboxItem.valueToModify    = &bypass_;
+        items_[1].type                            = ItemType::valueItem;
+        items_[1].text                            = "Cutoff";
+        items_[1].asMappedValueItem.valueToModify = &cutoff_;
+        items_[2].type                            = ItemType::closeMenuItem;
+        items_[2].text                            = "Back";
+        menu_.Init(items_, 3);
+
+        UiCanvasDescriptor canvas;
+        canvas.id_            = 0;
+        canvas.handle_        = &display_;
+        canvas.updateRateMs_  = 30;
+        canvas.clearFunction_ = [](const UiCanvasDescriptor& c) {
+            static_cast<FramebufferDisplay*>(c.handle_)->Fill(false);
+        };
+        canvas.flushFunction_ = [](const UiCanvasDescriptor& c) {
+            static_cast<FramebufferDisplay*>(c.handle_)->Update();
+        };
+        UI::SpecialControlIds ids;
+        ui_.Init(queue_, ids, {canvas}, 0);
+        ui_.OpenPage(menu_);
+    }
+
+    /** Runs UI::Process() every millisecond for a while */
+    void Run(uint32_t ms)
+    {
+        for(uint32_t i = 0; i < ms; i++)
+        {
+            System::Delay(1);
+            ui_.Process();
+        }
+    }
+
+    using ItemType = AbstractMenu::ItemType;
+
+    FramebufferDisplay       display_;
+    UiEventQueue             queue_;
+    UI                       ui_;
+    FullScreenItemMenu       menu_;
+    AbstractMenu::ItemConfig items_[3];
+    bool                     bypass_ = true;
+    MappedFloatValue         cutoff_;
+};
+} // namespace
+
+TEST(FramebufferDisplay, a_drawsIntoMemory)
+{
+    FramebufferDisplay display(16, 8);
+    EXPECT_EQ(display.Width(), 16);
+    EXPECT_EQ(display.Height(), 8);
+
+    display.DrawRect(2, 1, 5, 3, true, true);
+    EXPECT_TRUE(display.GetPixel(2, 1));
+    EXPECT_TRUE(display.GetPixel(5, 3));
+    EXPECT_FALSE(display.GetPixel(6, 3));
+    EXPECT_EQ(display.GetStats().pixelsChanged, 4u * 3u);
+
+    // out of bounds pixels are counted, but not drawn
+    display.ResetStats();
+    display.DrawPixel(16, 0, true);
+    display.DrawPixel(3, 2, true);
+    EXPECT_EQ(display.GetStats().pixelWrites, 2u);
+    EXPECT_EQ(display.GetStats().pixelsChanged, 0u);
+
+    EXPECT_TRUE(display.GetFlushedFrame().empty());
+    display.Update();
+    EXPECT_EQ(display.GetStats().updates, 1u);
+    EXPECT_TRUE(display.GetFlushedFrame()[1 * 16 + 2]);
+}
+
+TEST(FramebufferDisplay, b_pbmRoundTrip)
+{
+    FramebufferDisplay display(13, 5);
+    display.DrawLine(0, 0, 12, 4, true);
+    display.DrawPixel(12, 0, true);
+
+    for(bool binary : {true, false})
+    {
+        FramebufferDisplay copy;
+        ASSERT_TRUE(copy.FromPbm(display.ToPbm(binary)));
+        EXPECT_EQ(copy.Width(), 13);
+        EXPECT_EQ(copy.Height(), 5);
+        EXPECT_EQ(copy.CountDifferences(display), 0);
+    }
+
+    FramebufferDisplay parsed;
+    ASSERT_TRUE(parsed.FromPbm("P1\n# comment\n3 2\n1 0 1\n0 1 0\n"));
+    EXPECT_EQ(parsed.ToAscii(), "#.#\n.#.\n");
+    EXPECT_FALSE(parsed.FromPbm("P2\n3 2\n"));
+    EXPECT_EQ(parsed.CountDifferences(display), -1);
+}
+
+TEST(FramebufferDisplay, c_fullScreenMenuGoldenImages)
+{
+    MenuFixture fixture;
+    fixture.Run(50);
+    EXPECT_GT(fixture.display_.GetStats().updates, 0u);
+    EXPECT_TRUE(
+        MatchesGoldenImage(fixture.display_, "FullScreenItemMenu_checkbox"));
+
+    fixture.menu_.SelectItem(1);
+    fixture.Run(50);
+    EXPECT_TRUE(
+        MatchesGoldenImage(fixture.display_, "FullScreenItemMenu_value"));
+}
+
+TEST(FramebufferDisplay, d_benchmarkStaticMenu)
+{
+    MenuFixture fixture;
+    fixture.Run(50);
+    fixture.display_.ResetStats();
+
+    // one simulated second of a menu that doesn't change
+    using Clock      = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    fixture.Run(1000);
+    const auto elapsed = Clock::now() - start;
+
+    const auto& stats = fixture.display_.GetStats();
+    const double ms
+        = std::chrono::duration<double, std::milli>(elapsed).count();
+    RecordProperty("updates_per_second", std::to_string(stats.updates));
+    RecordProperty("pixel_writes_per_second",
+                   std::to_string(stats.pixelWrites));
+    printf("static menu: %zu updates, %zu fills, %zu pixel writes per second, "
+           "%.2f ms host time\n",
+           stats.updates,
+           stats.fills,
+           stats.pixelWrites,
+           ms);
+}
+
+TEST(FramebufferDisplay, e_drawsBitmaps)
+{
+    // a 3x10 arrow pointing down, spanning two pages
+    FramebufferDisplay arrow;
+    ASSERT_TRUE(arrow.FromPbm("P1\n3 10\n"
+                              "010\n010\n010\n010\n010\n"
+                              "010\n010\n111\n111\n010\n"));
+    const std::vector<uint8_t> data = arrow.ToBitmapData();
+    ASSERT_EQ(data.size(), 6u);
+    EXPECT_EQ(data[1], 0xff);
+    EXPECT_EQ(data[3], 0x01);
+    EXPECT_EQ(data[4], 0x03);
+    const OneBitBitmap bitmap = {3, 10, data.data()};
+    EXPECT_EQ(bitmap.GetNumPages(), 2);
+    EXPECT_TRUE(bitmap.GetPixel(0, 8));
+    EXPECT_FALSE(bitmap.GetPixel(0, 9));
+
+    // partially off screen
+    FramebufferDisplay display(8, 8);
+    display.DrawBitmap(-1, -3, bitmap);
+    EXPECT_EQ(display.ToAscii(),
+              "#.......\n"
+              "#.......\n"
+              "#.......\n"
+              "#.......\n"
+              "##......\n"
+              "##......\n"
+              "#.......\n"
+              "........\n");
+
+    // inverted and transparent
+    display.Fill(false);
+    display.DrawBitmap(6, 0, bitmap, false);
+    display.DrawBitmap(0, 0, bitmap, true, true);
+    EXPECT_EQ(display.ToAscii(),
+              ".#....#.\n"
+              ".#....#.\n"
+              ".#....#.\n"
+              ".#....#.\n"
+              ".#....#.\n"
+              ".#....#.\n"
+              ".#....#.\n"
+              "###.....\n");
+}
+
+TEST(FramebufferDisplay, f_drawsPbmImages)
+{
+    const std::string  file = __FILE__;
+    const std::string  dir  = file.substr(0, file.find_last_of("/\\") + 1);
+    FramebufferDisplay image;
+    ASSERT_TRUE(image.ReadPbm(dir + "golden/FullScreenItemMenu_value.pbm"));
+    const std::vector<uint8_t> data = image.ToBitmapData();
+    const OneBitBitmap bitmap = {image.Width(), image.Height(), data.data()};
+
+    FramebufferDisplay display;
+    display.Fill(true);
+    display.DrawBitmap(0, 0, bitmap);
+    EXPECT_TRUE(MatchesGoldenImage(display, "FullScreenItemMenu_value"));
+}
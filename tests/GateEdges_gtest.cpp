@@ -0,0 +1,248 @@
+#include "hid/gate_edges.h"
+#include "sys/system.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+constexpr float    kSampleRate = 48000.0f;
+constexpr size_t   kBlockSize  = 256;
+constexpr uint32_t kBlockUs    = 5333; // 256 frames at 48 kHz, rounded
+
+/** A gate signal with its edges at known times */
+struct GateSignal
+{
+    std::vector<GateEdge> edges;
+    size_t                next = 0;
+
+    /** Stands in for the interrupt: adds the edges up to now to the queue,
+     *  timestamped with the time of the edge
+     */
+    template <size_t capacity>
+    void RunInterrupts(GateEdgeQueue<capacity>& queue, uint32_t now_us)
+    {
+        while(next < edges.size()
+              && int32_t(now_us - edges[next].time_us) >= 0)
+            queue.Push(edges[next++]);
+    }
+};
+
+/** A clock with 10 ms pulses, with the period and jitter in microseconds */
+GateSignal MakeClock(uint32_t      start_us,
+                     size_t        num_pulses,
+                     uint32_t      period_us,
+                     uint32_t      jitter_us,
+                     std::mt19937& rng)
+{
+    GateSignal clock;
+    for(size_t i = 0; i < num_pulses; i++)
+    {
+        const uint32_t rise = start_us + uint32_t(i) * period_us
+                              + (jitter_us > 0 ? rng() % jitter_us : 0);
+        clock.edges.push_back({rise, true});
+        clock.edges.push_back({rise + 10000, false});
+    }
+    return clock;
+}
+} // namespace
+
+TEST(hid_GateEdges, a_queue)
+{
+    GateEdgeQueue<4> queue;
+    queue.Init();
+    GateEdge edge;
+    EXPECT_TRUE(queue.IsEmpty());
+    EXPECT_FALSE(queue.Pop(edge));
+
+    // first in, first out
+    for(uint32_t i = 0; i < 4; i++)
+        EXPECT_TRUE(queue.Push({100 * i, i % 2 == 0}));
+    EXPECT_EQ(queue.GetNumEdges(), 4u);
+
+    // when full, new edges are dropped
+    EXPECT_FALSE(queue.Push({400, true}));
+    EXPECT_EQ(queue.GetNumDropped(), 1u);
+
+    ASSERT_TRUE(queue.Peek(edge));
+    EXPECT_EQ(edge.time_us, 0u);
+    EXPECT_EQ(queue.GetNumEdges(), 4u);
+    for(uint32_t i = 0; i < 4; i++)
+    {
+        ASSERT_TRUE(queue.Pop(edge));
+        EXPECT_EQ(edge.time_us, 100 * i);
+        EXPECT_EQ(edge.rising, i % 2 == 0);
+    }
+    EXPECT_TRUE(queue.IsEmpty());
+
+    // and it wraps around
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        EXPECT_TRUE(queue.Push({i, true}));
+        ASSERT_TRUE(queue.Pop(edge));
+        EXPECT_EQ(edge.time_us, i);
+    }
+    EXPECT_EQ(queue.GetNumDropped(), 1u);
+}
+
+TEST(hid_GateEdges, b_placesEdgesInBlocks)
+{
+    std::mt19937      rng(47);
+    GateEdgeQueue<16> queue;
+    GateEdgeTracker   tracker;
+    queue.Init();
+    tracker.Init(kSampleRate, kBlockSize);
+
+    // a clock at random times, against audio callbacks every block
+    const uint32_t start = 1000000;
+    GateSignal     clock = MakeClock(start + 777, 200, 21001, 3000, rng);
+    System::SetUsForUnitTest(start);
+    size_t num_edges = 0;
+    float  max_error = 0.0f, max_polled_error = 0.0f;
+    bool   state     = false;
+    for(size_t block = 0; block < 1000; block++)
+    {
+        const uint32_t now = start + uint32_t(block) * kBlockUs;
+        System::SetUsForUnitTest(now);
+        clock.RunInterrupts(queue, System::GetUs());
+
+        // an edge that comes in while the callback runs stays in the queue
+        const size_t   pending   = clock.next;
+        const GateEdge late      = {now + 1, !state};
+        const bool     push_late = pending < clock.edges.size()
+                               && clock.edges[pending].time_us - now > 2000;
+        if(push_late)
+            queue.Push(late);
+
+        tracker.Process(queue, now);
+        const float block_start
+            = float(now) - kBlockSize * 1e6f / kSampleRate;
+        for(size_t i = 0; i < tracker.GetNumEdges(); i++)
+        {
+            const GateEdge& edge   = clock.edges[num_edges++];
+            const auto&     placed = tracker.GetEdge(i);
+            ASSERT_LT(placed.offset, kBlockSize);
+            EXPECT_EQ(placed.rising, edge.rising);
+            if(i > 0)
+            {
+                EXPECT_GE(placed.offset, tracker.GetEdge(i - 1).offset);
+            }
+
+            // the time of the frame, against the time of the edge
+            const float frame_us
+                = block_start + placed.offset * 1e6f / kSampleRate;
+            const float error = std::fabs(frame_us - float(edge.time_us));
+            max_error         = std::fmax(max_error, error);
+            // polling would put the edge at the start of the block
+            max_polled_error = std::fmax(max_polled_error,
+                                         float(edge.time_us) - block_start);
+            state = edge.rising;
+        }
+        EXPECT_EQ(tracker.State(), state);
+
+        // take back the test edge, as if it had been real
+        if(push_late)
+        {
+            GateEdge edge;
+            ASSERT_TRUE(queue.Pop(edge));
+            EXPECT_EQ(edge.time_us, late.time_us);
+        }
+        ASSERT_TRUE(queue.IsEmpty());
+    }
+    EXPECT_EQ(num_edges, clock.next);
+    EXPECT_GT(num_edges, 300u);
+
+    // within one frame, instead of within one block
+    EXPECT_LT(max_error, 1e6f / kSampleRate + 1.0f);
+    EXPECT_GT(max_polled_error, 5000.0f);
+    ::testing::Test::RecordProperty("maxErrorUs", int(max_error));
+    ::testing::Test::RecordProperty("maxPolledErrorUs",
+                                    int(max_polled_error));
+    printf("edge timing error: %.1f us, polled: %.1f us\n",
+           max_error,
+           max_polled_error);
+}
+
+TEST(hid_GateEdges, c_latePlacesAtBlockStart)
+{
+    GateEdgeQueue<32> queue;
+    GateEdgeTracker   tracker;
+    queue.Init();
+    tracker.Init(kSampleRate, kBlockSize);
+
+    // a callback that comes late: older edges go to the first frame
+    queue.Push({1000, true});
+    queue.Push({9000, false});
+    ASSERT_EQ(tracker.Process(queue, 1000 + 3 * kBlockUs), 2u);
+    EXPECT_EQ(tracker.GetEdge(0).offset, 0u);
+    EXPECT_EQ(tracker.GetEdge(1).offset, 0u);
+    EXPECT_FALSE(tracker.State());
+
+    // an edge right at the callback goes to the last frame
+    queue.Push({20000, true});
+    ASSERT_EQ(tracker.Process(queue, 20000), 1u);
+    EXPECT_EQ(tracker.GetEdge(0).offset, kBlockSize - 1);
+    EXPECT_TRUE(tracker.State());
+
+    // more edges than fit in a block still update the state
+    for(uint32_t i = 0; i < 20; i++)
+        queue.Push({21000 + i, i % 2 == 1});
+    EXPECT_EQ(tracker.Process(queue, 21020),
+              size_t(GateEdgeTracker::kMaxEdgesPerBlock));
+    EXPECT_TRUE(tracker.State());
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(hid_GateEdges, d_estimatesClockPeriod)
+{
+    std::mt19937      rng(4700);
+    GateEdgeQueue<16> queue;
+    GateEdgeTracker   tracker;
+    queue.Init();
+    tracker.Init(kSampleRate, kBlockSize);
+    EXPECT_FLOAT_EQ(tracker.GetPeriodUs(), 0.0f);
+
+    // 16th notes at 120 BPM with 0.4 ms of jitter
+    GateSignal clock = MakeClock(0, 64, 125000, 400, rng);
+    // a glitch between two pulses doesn't change the estimate
+    clock.edges.insert(clock.edges.begin() + 82,
+                       {{40 * 125000 + 30000, true},
+                        {40 * 125000 + 31000, false}});
+    // then 16th notes at 100 BPM
+    GateSignal slower = MakeClock(64 * 125000, 32, 150000, 0, rng);
+    clock.edges.insert(
+        clock.edges.end(), slower.edges.begin(), slower.edges.end());
+
+    uint32_t now = 0;
+    for(size_t block = 0; now < 64 * 125000 + 3 * 150000; block++)
+    {
+        now = uint32_t(block) * kBlockUs;
+        clock.RunInterrupts(queue, now);
+        tracker.Process(queue, now);
+
+        if(now > 8 * 125000 && now < 64 * 125000)
+        {
+            ASSERT_NEAR(tracker.GetPeriodUs(), 125000.0f, 300.0f) << now;
+            ASSERT_NEAR(tracker.GetFrequency(), 8.0f, 0.02f);
+            ASSERT_NEAR(tracker.GetPeriodFrames(), 6000.0f, 15.0f);
+        }
+    }
+
+    // the tempo change is followed after two intervals
+    EXPECT_NEAR(tracker.GetPeriodUs(), 150000.0f, 100.0f);
+
+    // and the estimate times out when the clock stops
+    while(clock.next < clock.edges.size())
+    {
+        now += kBlockUs;
+        clock.RunInterrupts(queue, now);
+        tracker.Process(queue, now);
+    }
+    EXPECT_GT(tracker.GetPeriodUs(), 0.0f);
+    tracker.Process(queue, now + 2100000);
+    EXPECT_FLOAT_EQ(tracker.GetPeriodUs(), 0.0f);
+    EXPECT_FLOAT_EQ(tracker.GetFrequency(), 0.0f);
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "util/MappedValue.h"
+#include <cmath>
 
 using namespace daisy;
 
@@ -211,6 +212,25 @@ TEST(util_MappedFloatValue, g_stepUpDown)
     EXPECT_EQ(val.GetAs0to1(), 0.0f);
 }
 
+TEST(util_MappedFloatValue, h_mapLogAccuracy)
+{
+    // the table based curve matches the C library over the whole range
+    const float      min = 20.0f, max = 20000.0f;
+    const float      a = 1.0f / log10f(max / min);
+    MappedFloatValue val(min, max, min, MappedFloatValue::Mapping::log);
+    for(int i = 0; i <= 1000; i++)
+    {
+        const float normalized = float(i) / 1000.0f;
+        const float exact = std::min(max, min * powf(10, normalized / a));
+        val.SetFrom0to1(normalized);
+        EXPECT_NEAR(val.Get(), exact, exact * 2e-6f) << normalized;
+
+        val = exact;
+        EXPECT_NEAR(val.GetAs0to1(), a * log10f(exact / min), 1e-6f)
+            << normalized;
+    }
+}
+
 // ==========================================================================
 
 // ==========================================================================
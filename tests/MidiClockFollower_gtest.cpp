@@ -0,0 +1,332 @@
+#include "util/MidiClockFollower.h"
+#include "hid/midi_parser.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+
+using namespace daisy;
+
+namespace
+{
+float TickPeriodUs(float bpm)
+{
+    return 60000000.f / (bpm * MidiClockFollower::kTicksPerBeat);
+}
+
+/** Generates clock ticks at a given tempo with uniformly distributed jitter */
+class ClockSource
+{
+  public:
+    ClockSource(float bpm, float jitter_us, uint32_t seed = 1234)
+    : period_us_(TickPeriodUs(bpm)), jitter_us_(jitter_us), rng_(seed)
+    {
+    }
+
+    void SetBpm(float bpm) { period_us_ = TickPeriodUs(bpm); }
+
+    /** Time of the next tick, including jitter */
+    uint32_t Next()
+    {
+        ideal_time_ += period_us_;
+        std::uniform_real_distribution<float> dist(-jitter_us_, jitter_us_);
+        return (uint32_t)(ideal_time_ + dist(rng_));
+    }
+
+    double IdealTime() const { return ideal_time_; }
+
+  private:
+    double       period_us_;
+    float        jitter_us_;
+    double       ideal_time_ = 1000.0;
+    std::mt19937 rng_;
+};
+} // namespace
+
+TEST(util_MidiClockFollower, a_stateAfterInit)
+{
+    MidiClockFollower follower;
+    follower.Init();
+    EXPECT_FLOAT_EQ(follower.GetBpm(), 0.f);
+    EXPECT_FALSE(follower.IsLocked());
+    EXPECT_FALSE(follower.IsRunning());
+    EXPECT_FLOAT_EQ(follower.GetBeats(), 0.f);
+}
+
+TEST(util_MidiClockFollower, b_steadyClock)
+{
+    MidiClockFollower follower;
+    follower.Init();
+    ClockSource source(120.f, 0.f);
+
+    for(size_t i = 0; i < 5; i++)
+        follower.Clock(source.Next());
+    EXPECT_FALSE(follower.IsLocked());
+    follower.Clock(source.Next());
+    EXPECT_TRUE(follower.IsLocked());
+    EXPECT_NEAR(follower.GetBpm(), 120.f, 0.01f);
+}
+
+TEST(util_MidiClockFollower, c_jitteredClock)
+{
+    // +-2ms of jitter, e.g. from polling the MidiHandler once per audio block
+    for(float bpm : {60.f, 98.5f, 120.f, 174.f})
+    {
+        MidiClockFollower follower;
+        follower.Init();
+        ClockSource source(bpm, 2000.f);
+
+        // let the fit window fill up
+        uint32_t last_time = 0;
+        for(size_t i = 0; i < MidiClockFollower::kTicksPerBeat; i++)
+        {
+            last_time = source.Next();
+            follower.Clock(last_time);
+        }
+        ASSERT_TRUE(follower.IsLocked());
+
+        float max_error = 0.f, max_naive_error = 0.f;
+        for(size_t i = 0; i < 500; i++)
+        {
+            const uint32_t time = source.Next();
+            follower.Clock(time);
+
+            // what a patch gets from the last interval alone
+            const float naive_bpm = 60000000.f
+                                    / ((float)(time - last_time)
+                                       * MidiClockFollower::kTicksPerBeat);
+            last_time = time;
+
+            max_error
+                = std::max(max_error, std::fabs(follower.GetBpm() - bpm));
+            max_naive_error
+                = std::max(max_naive_error, std::fabs(naive_bpm - bpm));
+        }
+        EXPECT_TRUE(follower.IsLocked());
+        EXPECT_LT(max_error, bpm * 0.01f) << bpm;
+        EXPECT_LT(max_error * 5.f, max_naive_error) << bpm;
+        RecordProperty("max_bpm_error_" + std::to_string((int)bpm),
+                       std::to_string(max_error));
+    }
+}
+
+TEST(util_MidiClockFollower, d_tempoChange)
+{
+    MidiClockFollower follower;
+    follower.Init();
+    ClockSource source(120.f, 500.f);
+
+    for(size_t i = 0; i < 48; i++)
+        follower.Clock(source.Next());
+    EXPECT_NEAR(follower.GetBpm(), 120.f, 0.5f);
+
+    // jump to 90 bpm: a few outliers, then a new fit
+    source.SetBpm(90.f);
+    size_t ticks_to_lock = 0;
+    bool   was_unlocked  = false;
+    for(size_t i = 0; i < 48; i++)
+    {
+        follower.Clock(source.Next());
+        was_unlocked |= !follower.IsLocked();
+        if(was_unlocked && follower.IsLocked() && ticks_to_lock == 0)
+            ticks_to_lock = i + 1;
+    }
+    EXPECT_TRUE(was_unlocked);
+    EXPECT_GT(ticks_to_lock, 0u);
+    EXPECT_LE(ticks_to_lock, 10u);
+    EXPECT_NEAR(follower.GetBpm(), 90.f, 0.5f);
+}
+
+TEST(util_MidiClockFollower, e_droppedTick)
+{
+    MidiClockFollower follower;
+    follower.Init();
+    follower.Start();
+    ClockSource source(120.f, 300.f);
+
+    for(size_t i = 0; i < 24; i++)
+        follower.Clock(source.Next());
+    // lose one tick
+    source.Next();
+    uint32_t time = 0;
+    for(size_t i = 0; i < 24; i++)
+    {
+        time = source.Next();
+        follower.Clock(time);
+    }
+
+    EXPECT_TRUE(follower.IsLocked());
+    EXPECT_NEAR(follower.GetBpm(), 120.f, 0.5f);
+    // 49 ticks after start, the position of the last one is 48
+    follower.Process(time);
+    EXPECT_NEAR(follower.GetBeats(), 2.f, 0.01f);
+}
+
+TEST(util_MidiClockFollower, f_transport)
+{
+    MidiClockFollower follower;
+    follower.Init();
+    ClockSource source(120.f, 0.f);
+
+    // clock without transport only measures tempo
+    uint32_t time = 0;
+    for(size_t i = 0; i < 12; i++)
+    {
+        time = source.Next();
+        follower.Clock(time);
+    }
+    follower.Process(time);
+    EXPECT_FALSE(follower.IsRunning());
+    EXPECT_FLOAT_EQ(follower.GetBeats(), 0.f);
+
+    // the first tick after start is beat 0
+    follower.Start();
+    EXPECT_TRUE(follower.IsRunning());
+    for(size_t i = 0; i < 37; i++)
+    {
+        time = source.Next();
+        follower.Clock(time);
+    }
+    follower.Process(time);
+    EXPECT_NEAR(follower.GetBeats(), 1.5f, 1e-4f);
+    EXPECT_NEAR(follower.GetBeatPhase(), 0.5f, 1e-4f);
+
+    // stop freezes the position
+    follower.Stop();
+    for(size_t i = 0; i < 10; i++)
+    {
+        time = source.Next();
+        follower.Clock(time);
+    }
+    follower.Process(time);
+    EXPECT_FALSE(follower.IsRunning());
+    EXPECT_NEAR(follower.GetBeats(), 1.5f, 1e-4f);
+
+    // continue resumes with the next tick
+    follower.Continue();
+    time = source.Next();
+    follower.Clock(time);
+    follower.Process(time);
+    EXPECT_NEAR(follower.GetBeats(), 1.5f + 1.f / 24.f, 1e-4f);
+
+    // song position 8 sixteenths = beat 2, reached on the next tick
+    follower.Stop();
+    follower.SongPosition(8);
+    follower.Continue();
+    time = source.Next();
+    follower.Clock(time);
+    follower.Process(time);
+    EXPECT_NEAR(follower.GetBeats(), 2.f, 1e-4f);
+}
+
+TEST(util_MidiClockFollower, g_phaseBetweenTicks)
+{
+    MidiClockFollower follower;
+    follower.Init();
+    follower.Start();
+    const float period = TickPeriodUs(120.f);
+    ClockSource source(120.f, 0.f);
+
+    uint32_t time = 0;
+    for(size_t i = 0; i < 24; i++)
+    {
+        time = source.Next();
+        follower.Clock(time);
+    }
+
+    // sampled once per "audio block", the position grows smoothly
+    float last_beats = 0.f;
+    for(size_t i = 0; i <= 4; i++)
+    {
+        follower.Process(time + (uint32_t)(period * 0.25f * i));
+        EXPECT_NEAR(follower.GetBeats(), (23.f + 0.25f * i) / 24.f, 1e-3f);
+        EXPECT_GE(follower.GetBeats(), last_beats);
+        last_beats = follower.GetBeats();
+    }
+
+    // but it never runs ahead of a late tick
+    follower.Process(time + (uint32_t)(period * 3.f));
+    EXPECT_NEAR(follower.GetBeats(), 1.f, 1e-3f);
+}
+
+TEST(util_MidiClockFollower, h_timeout)
+{
+    MidiClockFollower follower;
+    follower.Init();
+    ClockSource source(120.f, 0.f);
+
+    uint32_t time = 0;
+    for(size_t i = 0; i < 24; i++)
+    {
+        time = source.Next();
+        follower.Clock(time);
+    }
+    follower.Process(time + 400000);
+    EXPECT_TRUE(follower.IsLocked());
+    follower.Process(time + 600000);
+    EXPECT_FALSE(follower.IsLocked());
+    // the last tempo is kept
+    EXPECT_NEAR(follower.GetBpm(), 120.f, 0.01f);
+}
+
+TEST(util_MidiClockFollower, i_processEvent)
+{
+    MidiClockFollower follower;
+    MidiParser        parser;
+    MidiEvent         event;
+    follower.Init();
+    parser.Init();
+
+    const uint8_t bytes[]
+        = {0xfa, 0xf8, 0x90, 60, 100, 0xf8, 0xfc, 0xf2, 16, 1};
+    uint32_t time = 0;
+    size_t   used = 0;
+    for(uint8_t byte : bytes)
+    {
+        if(parser.Parse(byte, &event))
+        {
+            time += 20833;
+            used += follower.ProcessEvent(event, time) ? 1 : 0;
+        }
+    }
+    // everything but the note
+    EXPECT_EQ(used, 5u);
+    EXPECT_FALSE(follower.IsRunning());
+
+    follower.Process(time);
+    // song position 144 sixteenths, reached on the next tick
+    EXPECT_NEAR(follower.GetBeats(), 36.f - 1.f / 24.f, 1e-4f);
+}
+
+TEST(util_MidiClockFollower, j_singleLateTick)
+{
+    MidiClockFollower         follower;
+    MidiClockFollower::Config config;
+    config.Defaults();
+    config.max_outliers = 2;
+    follower.Init(config);
+    follower.Start();
+    ClockSource source(120.f, 0.f);
+
+    uint32_t time = 0;
+    for(size_t i = 0; i < 24; i++)
+    {
+        time = source.Next();
+        follower.Clock(time);
+    }
+    ASSERT_TRUE(follower.IsLocked());
+
+    // one tick 40% of a period late; the next one is on time again and
+    // must not count as a second outlier
+    const uint32_t period = (uint32_t)TickPeriodUs(120.f);
+    follower.Clock(source.Next() + period * 2 / 5);
+    for(size_t i = 0; i < 23; i++)
+    {
+        time = source.Next();
+        follower.Clock(time);
+        ASSERT_TRUE(follower.IsLocked()) << i;
+    }
+    EXPECT_NEAR(follower.GetBpm(), 120.f, 0.01f);
+    // 48 ticks after start, the position of the last one is 47
+    follower.Process(time);
+    EXPECT_NEAR(follower.GetBeats(), 47.f / 24.f, 1e-4f);
+}
@@ -0,0 +1,433 @@
+#define FILEIO_ENABLE_CSTDIO_READER
+#include "util/MidiFilePlayer.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+using Bytes = std::vector<uint8_t>;
+
+/** Appends a variable length quantity */
+void PutVarLen(Bytes& out, uint32_t value)
+{
+    uint8_t buf[4];
+    size_t  n = 0;
+    do
+    {
+        buf[n++] = value & 0x7f;
+        value >>= 7;
+    } while(value > 0);
+    while(n > 0)
+    {
+        n--;
+        out.push_back(buf[n] | (n > 0 ? 0x80 : 0));
+    }
+}
+
+/** Builds the events of a track chunk */
+class Track
+{
+  public:
+    Track& Event(uint32_t delta, const Bytes& bytes)
+    {
+        PutVarLen(data_, delta);
+        data_.insert(data_.end(), bytes.begin(), bytes.end());
+        return *this;
+    }
+
+    Track& Tempo(uint32_t delta, uint32_t us_per_quarter)
+    {
+        return Event(delta,
+                     {0xff,
+                      0x51,
+                      0x03,
+                      (uint8_t)(us_per_quarter >> 16),
+                      (uint8_t)(us_per_quarter >> 8),
+                      (uint8_t)us_per_quarter});
+    }
+
+    Track& End(uint32_t delta) { return Event(delta, {0xff, 0x2f, 0x00}); }
+
+    const Bytes& Data() const { return data_; }
+
+  private:
+    Bytes data_;
+};
+
+void PutU32(Bytes& out, uint32_t value)
+{
+    for(int shift = 24; shift >= 0; shift -= 8)
+        out.push_back((uint8_t)(value >> shift));
+}
+
+Bytes BuildFile(uint16_t format, uint16_t division, std::vector<Track> tracks)
+{
+    Bytes out = {'M', 'T', 'h', 'd'};
+    PutU32(out, 6);
+    out.push_back(format >> 8);
+    out.push_back(format & 0xff);
+    out.push_back(tracks.size() >> 8);
+    out.push_back(tracks.size() & 0xff);
+    out.push_back(division >> 8);
+    out.push_back(division & 0xff);
+    for(const auto& track : tracks)
+    {
+        out.insert(out.end(), {'M', 'T', 'r', 'k'});
+        PutU32(out, track.Data().size());
+        out.insert(out.end(), track.Data().begin(), track.Data().end());
+    }
+    return out;
+}
+
+/** Writes the file contents to a temporary file on disk */
+class TempFile
+{
+  public:
+    explicit TempFile(const Bytes& bytes) : file_(tmpfile())
+    {
+        fwrite(bytes.data(), 1, bytes.size(), file_);
+        rewind(file_);
+    }
+    ~TempFile() { fclose(file_); }
+    FILE* Get() { return file_; }
+
+  private:
+    FILE* file_;
+};
+
+/** Counts the reads that go to the file */
+class CountingReader : public IReader
+{
+  public:
+    explicit CountingReader(FILE* f) : reader_(f) {}
+    size_t read(void* dst, size_t bytes) override
+    {
+        num_reads++;
+        max_read = std::max(max_read, bytes);
+        return reader_.read(dst, bytes);
+    }
+    bool seek(uint32_t pos) override
+    {
+        num_seeks++;
+        return reader_.seek(pos);
+    }
+    uint32_t position() const override { return reader_.position(); }
+    uint32_t size() const override { return reader_.size(); }
+
+    size_t num_reads = 0;
+    size_t num_seeks = 0;
+    size_t max_read  = 0;
+
+  private:
+    FileReader reader_;
+};
+
+struct TimedEvent
+{
+    uint32_t  time;
+    MidiEvent event;
+};
+
+/** Plays the whole file in blocks of the given size */
+template <typename Player>
+std::vector<TimedEvent> PlayAll(Player& player, size_t block_size)
+{
+    std::vector<TimedEvent> events;
+    for(size_t i = 0; i < 100000 && !player.IsFinished(); i++)
+    {
+        player.Process(block_size);
+        while(player.HasEvents())
+        {
+            const uint32_t time = player.GetNextEventTime();
+            events.push_back({time, player.PopEvent()});
+        }
+    }
+    return events;
+}
+
+Track NoteTrack(uint8_t channel, const std::vector<uint32_t>& deltas)
+{
+    Track track;
+    for(uint32_t delta : deltas)
+        track.Event(delta, {(uint8_t)(0x90 | channel), 60, 100});
+    track.End(0);
+    return track;
+}
+} // namespace
+
+TEST(util_MidiFilePlayer, a_format0Timing)
+{
+    Track track;
+    track.Event(0, {0x90, 60, 100})
+        .Event(96, {0x80, 60, 0})
+        .Event(96, {0x90, 62, 100})
+        .Event(0, {64, 90}) // running status
+        .Event(48, {0xc0, 5})
+        .Event(0, {0xe0, 0x00, 0x50})
+        .End(0);
+    TempFile   file(BuildFile(0, 96, {track}));
+    FileReader reader(file.Get());
+
+    MidiFilePlayer<> player;
+    player.Init(48000.f);
+    // defaults before a file is opened
+    EXPECT_EQ(player.GetFormat(), 0);
+    EXPECT_FLOAT_EQ(player.GetTempoBpm(), 120.f);
+    ASSERT_EQ(player.Open(&reader), MidiFilePlayer<>::Result::Ok);
+    EXPECT_EQ(player.GetFormat(), 0);
+    EXPECT_EQ(player.GetNumTracks(), 1u);
+    EXPECT_FLOAT_EQ(player.GetTempoBpm(), 120.f);
+
+    auto events = PlayAll(player, 48);
+    ASSERT_EQ(events.size(), 6u);
+    // 120 bpm, one quarter note = 24000 samples
+    const uint32_t times[] = {0, 24000, 48000, 48000, 60000, 60000};
+    for(size_t i = 0; i < events.size(); i++)
+        EXPECT_EQ(events[i].time, times[i]) << i;
+
+    EXPECT_EQ(events[0].event.type, NoteOn);
+    EXPECT_EQ(events[1].event.type, NoteOff);
+    EXPECT_EQ(events[3].event.type, NoteOn);
+    EXPECT_EQ(events[3].event.data[0], 64);
+    EXPECT_EQ(events[3].event.data[1], 90);
+    EXPECT_EQ(events[4].event.type, ProgramChange);
+    EXPECT_EQ(events[4].event.data[0], 5);
+    EXPECT_EQ(events[5].event.type, PitchBend);
+    EXPECT_TRUE(player.IsFinished());
+}
+
+TEST(util_MidiFilePlayer, b_tempoMap)
+{
+    // format 1: the tempo map in track 0, notes in track 1
+    Track tempo;
+    tempo.Tempo(0, 250000).Tempo(96, 1000000).End(0);
+    Track      notes = NoteTrack(0, {0, 96, 96, 48});
+    TempFile   file(BuildFile(1, 96, {tempo, notes}));
+    FileReader reader(file.Get());
+
+    MidiFilePlayer<> player;
+    player.Init(48000.f);
+    ASSERT_EQ(player.Open(&reader), MidiFilePlayer<>::Result::Ok);
+    EXPECT_EQ(player.GetNumTracks(), 2u);
+
+    auto events = PlayAll(player, 64);
+    ASSERT_EQ(events.size(), 4u);
+    // 240 bpm for the first beat, then 60 bpm
+    EXPECT_EQ(events[0].time, 0u);
+    EXPECT_EQ(events[1].time, 12000u);
+    EXPECT_EQ(events[2].time, 12000u + 48000u);
+    EXPECT_EQ(events[3].time, 12000u + 48000u + 24000u);
+    EXPECT_FLOAT_EQ(player.GetTempoBpm(), 60.f);
+
+    // restarting also restarts the tempo map
+    player.Restart();
+    events = PlayAll(player, 64);
+    ASSERT_EQ(events.size(), 4u);
+    EXPECT_EQ(events[1].time, 12000u);
+}
+
+TEST(util_MidiFilePlayer, c_mergeTracks)
+{
+    std::mt19937       rng(42);
+    std::vector<Track> tracks;
+    size_t             num_notes = 0;
+    for(uint8_t t = 0; t < 12; t++)
+    {
+        std::vector<uint32_t> deltas;
+        for(size_t i = 0; i < 40u + t; i++)
+            deltas.push_back(rng() % 3 == 0 ? 0 : rng() % 50);
+        num_notes += deltas.size();
+        tracks.push_back(NoteTrack(t, deltas));
+    }
+    TempFile   file(BuildFile(1, 480, tracks));
+    FileReader reader(file.Get());
+
+    MidiFilePlayer<> player;
+    player.Init(48000.f);
+    ASSERT_EQ(player.Open(&reader), MidiFilePlayer<>::Result::Ok);
+    auto events = PlayAll(player, 48);
+    ASSERT_EQ(events.size(), num_notes);
+
+    // in time order, with simultaneous events in track order
+    for(size_t i = 1; i < events.size(); i++)
+    {
+        ASSERT_LE(events[i - 1].time, events[i].time) << i;
+        if(events[i - 1].time == events[i].time)
+        {
+            EXPECT_LE(events[i - 1].event.channel, events[i].event.channel);
+        }
+    }
+}
+
+TEST(util_MidiFilePlayer, d_streamingBuffers)
+{
+    std::vector<Track> tracks;
+    for(uint8_t t = 0; t < 4; t++)
+        tracks.push_back(NoteTrack(t, std::vector<uint32_t>(200, 10 + t)));
+    TempFile file(BuildFile(1, 96, tracks));
+
+    using SmallPlayer = MidiFilePlayer<4, 8>;
+    using LargePlayer = MidiFilePlayer<4, 256>;
+
+    CountingReader small_reader(file.Get());
+    SmallPlayer    small_player;
+    small_player.Init(48000.f);
+    ASSERT_EQ(small_player.Open(&small_reader), SmallPlayer::Result::Ok);
+    const auto small_events = PlayAll(small_player, 48);
+    // each read fetches at most one buffer
+    EXPECT_LE(small_reader.max_read, 14u);
+
+    CountingReader large_reader(file.Get());
+    LargePlayer    large_player;
+    large_player.Init(48000.f);
+    ASSERT_EQ(large_player.Open(&large_reader), LargePlayer::Result::Ok);
+    const auto large_events = PlayAll(large_player, 48);
+    EXPECT_LT(large_reader.num_reads, small_reader.num_reads);
+
+    ASSERT_EQ(small_events.size(), 800u);
+    ASSERT_EQ(small_events.size(), large_events.size());
+    for(size_t i = 0; i < small_events.size(); i++)
+    {
+        EXPECT_EQ(small_events[i].time, large_events[i].time);
+        EXPECT_EQ(small_events[i].event.channel,
+                  large_events[i].event.channel);
+    }
+}
+
+TEST(util_MidiFilePlayer, e_metaAndSysex)
+{
+    Track track;
+    track.Event(0, {0xff, 0x03, 0x04, 'B', 'a', 's', 's'}) // track name
+        .Event(0, {0xf0, 0x05, 0x7e, 0x7f, 0x09, 0x01, 0xf7})
+        .Event(10, {0xf7, 0x02, 0xf3, 0x01}) // escaped song select
+        .Event(10, {0x91, 48, 1})
+        .End(0);
+    Bytes bytes = BuildFile(0, 96, {track});
+    // an unknown chunk before the track is skipped
+    const Bytes junk = {'X', 'Y', 'Z', 'W', 0, 0, 0, 2, 0xaa, 0xbb};
+    bytes.insert(bytes.begin() + 14, junk.begin(), junk.end());
+    TempFile   file(bytes);
+    FileReader reader(file.Get());
+
+    MidiFilePlayer<> player;
+    player.Init(48000.f);
+    ASSERT_EQ(player.Open(&reader), MidiFilePlayer<>::Result::Ok);
+    auto events = PlayAll(player, 48);
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].event.type, SystemCommon);
+    EXPECT_EQ(events[0].event.sc_type, SystemExclusive);
+    EXPECT_EQ(events[0].event.sysex_message_len, 4);
+    EXPECT_EQ(events[0].event.sysex_data[0], 0x7e);
+    EXPECT_EQ(events[1].event.type, NoteOn);
+    EXPECT_EQ(events[1].event.channel, 1);
+    EXPECT_EQ(events[1].time, 5000u);
+}
+
+TEST(util_MidiFilePlayer, f_invalidFiles)
+{
+    using Result = MidiFilePlayer<4>::Result;
+    MidiFilePlayer<4> player;
+    player.Init(48000.f);
+
+    auto open = [&player](const Bytes& bytes) {
+        TempFile   file(bytes);
+        FileReader reader(file.Get());
+        return player.Open(&reader);
+    };
+
+    const Track track = NoteTrack(0, {0});
+    EXPECT_EQ(open(BuildFile(0, 96, {track})), Result::Ok);
+    EXPECT_EQ(open(BuildFile(2, 96, {track})), Result::UnsupportedFormat);
+    EXPECT_EQ(open(BuildFile(1, 96, std::vector<Track>(5, track))),
+              Result::TooManyTracks);
+    EXPECT_EQ(open(BuildFile(0, 0, {track})), Result::InvalidFile);
+    EXPECT_EQ(open({'R', 'I', 'F', 'F', 0, 0, 0, 6, 0, 0, 0, 1, 0, 96}),
+              Result::InvalidFile);
+
+    // the header promises two tracks
+    Bytes missing = BuildFile(1, 96, {track});
+    missing[11]   = 2;
+    EXPECT_EQ(open(missing), Result::InvalidFile);
+
+    // a truncated track plays what is there
+    Bytes truncated = BuildFile(0, 96, {NoteTrack(0, {0, 10, 10})});
+    truncated.resize(truncated.size() - 6);
+    TempFile   file(truncated);
+    FileReader reader(file.Get());
+    ASSERT_EQ(player.Open(&reader), Result::Ok);
+    EXPECT_EQ(PlayAll(player, 48).size(), 2u);
+}
+
+TEST(util_MidiFilePlayer, g_blockOffsets)
+{
+    // one event per tick, 250 samples apart
+    TempFile         file(BuildFile(0, 96, {NoteTrack(0, {1, 1, 1, 1})}));
+    FileReader       reader(file.Get());
+    MidiFilePlayer<> player;
+    player.Init(48000.f);
+    ASSERT_EQ(player.Open(&reader), MidiFilePlayer<>::Result::Ok);
+
+    std::vector<size_t> blocks, offsets;
+    for(size_t block = 0; block < 30; block++)
+    {
+        player.Process(48);
+        while(player.HasEvents())
+        {
+            blocks.push_back(block);
+            offsets.push_back(player.GetNextEventTime()
+                              - (player.GetPosition() - 48));
+            player.PopEvent();
+        }
+    }
+    EXPECT_EQ(blocks, (std::vector<size_t>{5, 10, 15, 20}));
+    EXPECT_EQ(offsets, (std::vector<size_t>{10, 20, 30, 40}));
+}
+
+TEST(util_MidiFilePlayer, h_looping)
+{
+    Track track;
+    track.Event(0, {0x90, 60, 100}).Event(96, {0x80, 60, 0}).End(96);
+    TempFile         file(BuildFile(0, 96, {track}));
+    FileReader       reader(file.Get());
+    MidiFilePlayer<> player;
+    player.Init(48000.f);
+    ASSERT_EQ(player.Open(&reader), MidiFilePlayer<>::Result::Ok);
+    player.SetLooping(true);
+
+    std::vector<uint32_t> times;
+    for(size_t i = 0; i < 3000; i++)
+    {
+        player.Process(48);
+        while(player.HasEvents())
+        {
+            times.push_back(player.GetNextEventTime());
+            player.PopEvent();
+        }
+    }
+    // the loop is two beats long, up to the End of Track
+    EXPECT_EQ(times,
+              (std::vector<uint32_t>{0, 24000, 48000, 72000, 96000, 120000}));
+    EXPECT_FALSE(player.IsFinished());
+}
+
+TEST(util_MidiFilePlayer, i_smpteDivision)
+{
+    // 25 fps, 40 ticks per frame: 1000 ticks per second, tempo is ignored
+    Track track;
+    track.Tempo(0, 1000000).Event(500, {0x90, 60, 100}).End(0);
+    TempFile         file(BuildFile(0, 0xe728, {track}));
+    FileReader       reader(file.Get());
+    MidiFilePlayer<> player;
+    player.Init(48000.f);
+    ASSERT_EQ(player.Open(&reader), MidiFilePlayer<>::Result::Ok);
+
+    auto events = PlayAll(player, 48);
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].time, 24000u);
+    EXPECT_FLOAT_EQ(player.GetTempoBpm(), 0.f);
+}
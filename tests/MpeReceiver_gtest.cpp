@@ -0,0 +1,385 @@
+#include "util/MpeReceiver.h"
+#include "hid/midi_parser.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+using Receiver = MpeReceiver<4>;
+using Type     = Receiver::MpeEvent::Type;
+using ZoneId   = Receiver::ZoneId;
+using Bytes    = std::vector<uint8_t>;
+
+/** Parses raw MIDI bytes and passes all events to the receiver
+ *  \return the events produced by the receiver, in order
+ */
+template <size_t N>
+std::vector<typename MpeReceiver<N>::MpeEvent>
+Play(MpeReceiver<N>& receiver, const std::vector<uint8_t>& bytes)
+{
+    std::vector<typename MpeReceiver<N>::MpeEvent> events;
+    MidiParser                                     parser;
+    MidiEvent                                      event;
+    parser.Init();
+    for(uint8_t byte : bytes)
+    {
+        if(!parser.Parse(byte, &event))
+            continue;
+        const size_t n = receiver.ProcessEvent(event);
+        for(size_t i = 0; i < n; i++)
+            events.push_back(receiver.GetEvent(i));
+    }
+    return events;
+}
+
+/** Pitch bend message for a normalized bend of -1 to 1 */
+std::vector<uint8_t> Bend(uint8_t channel, float bend)
+{
+    int value = 8192 + (int)(bend * 8192.f);
+    value     = value > 16383 ? 16383 : value;
+    return {(uint8_t)(0xe0 | channel),
+            (uint8_t)(value & 0x7f),
+            (uint8_t)(value >> 7)};
+}
+
+std::vector<uint8_t> Rpn(uint8_t channel, uint8_t rpn, uint8_t msb)
+{
+    const uint8_t status = 0xb0 | channel;
+    return {status, 101, 0, status, 100, rpn, status, 6, msb};
+}
+
+std::vector<uint8_t> operator+(std::vector<uint8_t>        a,
+                               const std::vector<uint8_t>& b)
+{
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+}
+} // namespace
+
+TEST(util_MpeReceiver, a_memberChannelExpression)
+{
+    Receiver receiver;
+    receiver.Init();
+    EXPECT_EQ(receiver.GetZoneMembers(ZoneId::LOWER), 15);
+    EXPECT_EQ(receiver.GetZoneMembers(ZoneId::UPPER), 0);
+
+    auto events = Play(receiver, {0x91, 60, 100});
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].type, Type::NOTE_ON);
+    EXPECT_EQ(events[0].voice, 0u);
+    EXPECT_EQ(events[0].note, 60);
+    EXPECT_EQ(events[0].velocity, 100);
+    EXPECT_EQ(receiver.GetVoiceForNote(1, 60), 0);
+
+    // the default member pitch bend sensitivity is 48 semitones
+    events = Play(receiver, Bend(1, 0.5f));
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].type, Type::PITCH_BEND);
+    EXPECT_EQ(events[0].voice, 0u);
+    EXPECT_FLOAT_EQ(events[0].value, 24.f);
+    EXPECT_FLOAT_EQ(receiver.GetVoice(0).GetPitch(), 84.f);
+
+    events = Play(receiver, {0xd1, 127, 0xb1, 74, 0});
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].type, Type::PRESSURE);
+    EXPECT_FLOAT_EQ(events[0].value, 1.f);
+    EXPECT_EQ(events[1].type, Type::TIMBRE);
+    EXPECT_FLOAT_EQ(events[1].value, 0.f);
+
+    // expression on another channel doesn't touch the note
+    EXPECT_TRUE(Play(receiver, Bend(2, -1.f) + Bytes{0xd2, 5}).empty());
+
+    events = Play(receiver, {0x81, 60, 30});
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].type, Type::NOTE_OFF);
+    EXPECT_EQ(events[0].velocity, 30);
+    EXPECT_FALSE(receiver.IsVoiceActive(0));
+    EXPECT_EQ(receiver.GetVoiceForNote(1, 60), -1);
+}
+
+TEST(util_MpeReceiver, b_expressionBeforeNote)
+{
+    Receiver receiver;
+    receiver.Init();
+
+    // controllers send the initial expression right before the note
+    const Bytes expression = Bend(3, -0.25f) + Bytes{0xb3, 74, 127, 0xd3, 0};
+    auto        events     = Play(receiver, expression + Bytes{0x93, 64, 90});
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].type, Type::NOTE_ON);
+    EXPECT_FLOAT_EQ(events[0].value, -12.f);
+
+    const auto& voice = receiver.GetVoice(events[0].voice);
+    EXPECT_EQ(voice.channel, 3);
+    EXPECT_FLOAT_EQ(voice.bend, -12.f);
+    EXPECT_FLOAT_EQ(voice.pressure, 0.f);
+    EXPECT_FLOAT_EQ(voice.timbre, 1.f);
+}
+
+TEST(util_MpeReceiver, c_masterPitchBend)
+{
+    Receiver receiver;
+    receiver.Init();
+    Play(receiver, {0x91, 60, 100, 0x92, 64, 100});
+    Play(receiver, Bend(2, 0.5f));
+
+    // the master channel bends the whole Zone by up to 2 semitones
+    auto events = Play(receiver, Bend(0, -0.5f));
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].type, Type::PITCH_BEND);
+    EXPECT_EQ(events[0].note, 60);
+    EXPECT_FLOAT_EQ(events[0].value, -1.f);
+    EXPECT_EQ(events[1].note, 64);
+    EXPECT_FLOAT_EQ(events[1].value, 23.f);
+
+    // and stays applied to member bends and new notes
+    events = Play(receiver, Bend(1, 0.25f) + Bytes{0x93, 67, 1});
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_FLOAT_EQ(events[0].value, 11.f);
+    EXPECT_EQ(events[1].type, Type::NOTE_ON);
+    EXPECT_FLOAT_EQ(events[1].value, -1.f);
+
+    // notes on the master channel aren't voices
+    EXPECT_TRUE(Play(receiver, {0x90, 50, 100}).empty());
+}
+
+TEST(util_MpeReceiver, d_configurationMessage)
+{
+    Receiver receiver;
+    receiver.Init();
+    Play(receiver, {0x91, 60, 100});
+
+    // an Upper Zone with 3 member channels shrinks the Lower Zone
+    auto events = Play(receiver, Rpn(15, 6, 3));
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].type, Type::NOTE_OFF);
+    EXPECT_EQ(receiver.GetZoneMembers(ZoneId::UPPER), 3);
+    EXPECT_EQ(receiver.GetZoneMembers(ZoneId::LOWER), 11);
+
+    // resending the same configuration changes nothing
+    Play(receiver, {0x91, 60, 100});
+    EXPECT_TRUE(Play(receiver, Rpn(15, 6, 3)).empty());
+
+    // the Upper Zone has its own master channel
+    events = Play(receiver, Bytes{0x9e, 62, 100} + Bend(15, 1.f));
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].type, Type::NOTE_ON);
+    EXPECT_EQ(events[1].type, Type::PITCH_BEND);
+    EXPECT_EQ(events[1].note, 62);
+    EXPECT_NEAR(events[1].value, 2.f, 1e-3f);
+
+    // channel 8 (index 7) is now between the Zones
+    Play(receiver, Rpn(0, 6, 5));
+    EXPECT_EQ(receiver.GetZoneMembers(ZoneId::UPPER), 3);
+    EXPECT_TRUE(Play(receiver, {0x97, 60, 100}).empty());
+
+    // disabling the Lower Zone, then enabling it again from its master
+    Play(receiver, Rpn(0, 6, 0));
+    EXPECT_EQ(receiver.GetZoneMembers(ZoneId::LOWER), 0);
+    EXPECT_TRUE(Play(receiver, {0x91, 60, 100}).empty());
+    Play(receiver, Rpn(0, 6, 15));
+    EXPECT_EQ(receiver.GetZoneMembers(ZoneId::LOWER), 15);
+    EXPECT_EQ(receiver.GetZoneMembers(ZoneId::UPPER), 0);
+}
+
+TEST(util_MpeReceiver, e_pitchBendSensitivity)
+{
+    Receiver receiver;
+    receiver.Init();
+
+    // RPN 0 on any member channel sets the range for all members
+    Play(receiver, Rpn(4, 0, 24) + Bytes{0xb4, 38, 50});
+    EXPECT_FLOAT_EQ(receiver.GetPitchBendRange(ZoneId::LOWER, false), 24.5f);
+    EXPECT_FLOAT_EQ(receiver.GetPitchBendRange(ZoneId::LOWER, true), 2.f);
+    Play(receiver, Rpn(0, 0, 12));
+    EXPECT_FLOAT_EQ(receiver.GetPitchBendRange(ZoneId::LOWER, true), 12.f);
+
+    auto events = Play(receiver, Bytes{0x92, 60, 100} + Bend(2, 0.5f));
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_FLOAT_EQ(events[1].value, 12.25f);
+
+    // an NRPN data entry doesn't change the range
+    Play(receiver, {0xb2, 99, 0, 0xb2, 98, 0, 0xb2, 6, 1});
+    EXPECT_FLOAT_EQ(receiver.GetPitchBendRange(ZoneId::LOWER, false), 24.5f);
+
+    // the Configuration Message resets the ranges
+    Play(receiver, Rpn(0, 6, 7));
+    EXPECT_FLOAT_EQ(receiver.GetPitchBendRange(ZoneId::LOWER, false), 48.f);
+    EXPECT_FLOAT_EQ(receiver.GetPitchBendRange(ZoneId::LOWER, true), 2.f);
+}
+
+TEST(util_MpeReceiver, f_stealingAndRelease)
+{
+    MpeReceiver<2> receiver;
+    receiver.Init();
+    using Type2 = MpeReceiver<2>::MpeEvent::Type;
+
+    Play(receiver, {0x91, 60, 100, 0x92, 62, 100});
+    auto events = Play(receiver, {0x93, 64, 100});
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].voice, 0u);
+    EXPECT_TRUE(events[0].stolen);
+    EXPECT_EQ(receiver.GetVoiceForNote(1, 60), -1);
+
+    // the stolen note's channel no longer reaches the voice
+    EXPECT_TRUE(Play(receiver, Bend(1, 0.5f)).empty());
+    EXPECT_TRUE(Play(receiver, {0x81, 60, 0}).empty());
+
+    // a released voice keeps following its channel ...
+    Play(receiver, {0x82, 62, 0});
+    events = Play(receiver, Bend(2, 0.25f));
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].type, Type2::PITCH_BEND);
+    EXPECT_EQ(events[0].voice, 1u);
+
+    // ... until a new note starts on the channel
+    events = Play(receiver, Bytes{0x92, 65, 100} + Bend(2, 0.f));
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].voice, 1u);
+    EXPECT_FALSE(events[0].stolen);
+    EXPECT_EQ(events[1].voice, 1u);
+    EXPECT_EQ(events[1].note, 65);
+}
+
+TEST(util_MpeReceiver, g_sustainAndAllNotesOff)
+{
+    Receiver receiver;
+    receiver.Init();
+    Play(receiver, {0x91, 60, 100, 0x92, 64, 100, 0xb0, 64, 127});
+
+    EXPECT_TRUE(Play(receiver, {0x81, 60, 0, 0x92, 64, 0}).empty());
+    EXPECT_TRUE(receiver.IsVoiceActive(0));
+    EXPECT_TRUE(receiver.IsVoiceActive(1));
+    Play(receiver, {0x93, 67, 100});
+
+    auto events = Play(receiver, {0xb0, 64, 0});
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].type, Type::NOTE_OFF);
+    EXPECT_EQ(events[1].type, Type::NOTE_OFF);
+    EXPECT_TRUE(receiver.IsVoiceActive(2));
+
+    // All Notes Off on a member channel ends that channel's notes
+    Play(receiver, {0x94, 70, 100});
+    events = Play(receiver, {0xb4, 123, 0});
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].note, 70);
+
+    // on the master channel, all notes of the Zone
+    events = Play(receiver, {0xb0, 120, 0});
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].note, 67);
+}
+
+TEST(util_MpeReceiver, h_recordedStream)
+{
+    // a two-finger slide captured from a controller: MCM, bend range,
+    // then two notes with running status pitch bend and pressure
+    const std::vector<uint8_t> stream = {
+        0xb0, 0x79, 0x00, 0x65, 0x00, 0x64, 0x06, 0x06, 0x0f, // MCM
+        0xb1, 0x65, 0x00, 0x64, 0x00, 0x06, 0x30,             // range
+        0xe1, 0x00, 0x40, 0xd1, 0x00, 0xb1, 0x4a, 0x40,       // initial
+        0x91, 0x3c, 0x50,                                     // note on
+        0xd1, 0x10, 0x20, 0x38,                               // pressure
+        0xe1, 0x00, 0x44, 0x00, 0x48,                         // slide up
+        0xe2, 0x00, 0x40, 0xd2, 0x00, 0x92, 0x43, 0x40,       // 2nd note
+        0xe2, 0x7f, 0x3f, 0x00, 0x3c,                         // slide down
+        0x81, 0x3c, 0x20,                                     // note off
+        0xe1, 0x00, 0x50,                                     // release bend
+    };
+
+    Receiver receiver;
+    receiver.Init();
+    auto events = Play(receiver, stream);
+
+    size_t counts[5] = {};
+    for(const auto& e : events)
+        counts[(size_t)e.type]++;
+    EXPECT_EQ(counts[(size_t)Type::NOTE_ON], 2u);
+    EXPECT_EQ(counts[(size_t)Type::NOTE_OFF], 1u);
+    EXPECT_EQ(counts[(size_t)Type::PITCH_BEND], 5u);
+    EXPECT_EQ(counts[(size_t)Type::PRESSURE], 3u);
+
+    const auto& first = receiver.GetVoice(0);
+    EXPECT_EQ(first.note, 60);
+    EXPECT_FALSE(receiver.IsVoiceActive(0));
+    EXPECT_FLOAT_EQ(first.bend, 12.f);
+    EXPECT_FLOAT_EQ(first.pressure, 0x38 / 127.f);
+    EXPECT_FLOAT_EQ(first.timbre, 0x40 / 127.f);
+
+    const auto& second = receiver.GetVoice(1);
+    EXPECT_EQ(second.note, 67);
+    EXPECT_TRUE(receiver.IsVoiceActive(1));
+    EXPECT_FLOAT_EQ(second.bend, -3.f);
+}
+
+TEST(util_MpeReceiver, i_benchmark16Voices)
+{
+    // 10 fingers on a 15 channel Zone, mostly expression as in a real
+    // MPE stream: about 2% notes, the rest bend, pressure and timbre
+    constexpr size_t       kNumEvents = 1 << 20;
+    std::vector<MidiEvent> stream(kNumEvents);
+    std::mt19937           rng(3);
+    uint8_t                channel_note[16] = {};
+    for(size_t i = 0; i < kNumEvents; i++)
+    {
+        MidiEvent&    e       = stream[i];
+        const uint8_t channel = 1 + rng() % 10;
+        const size_t  kind    = rng() % 100;
+        e.channel             = channel;
+        if(kind < 2)
+        {
+            const uint8_t note = channel_note[channel];
+            e.type = note ? MidiMessageType::NoteOff : MidiMessageType::NoteOn;
+            e.data[0]             = note ? note : 40 + rng() % 40;
+            e.data[1]             = 100;
+            channel_note[channel] = note ? 0 : e.data[0];
+        }
+        else if(kind < 60)
+        {
+            e.type    = PitchBend;
+            e.data[0] = rng() & 0x7f;
+            e.data[1] = rng() & 0x7f;
+        }
+        else if(kind < 85)
+        {
+            e.type    = ChannelPressure;
+            e.data[0] = rng() & 0x7f;
+        }
+        else
+        {
+            e.type    = ControlChange;
+            e.data[0] = 74;
+            e.data[1] = rng() & 0x7f;
+        }
+    }
+
+    using Clock    = std::chrono::steady_clock;
+    auto* receiver = new MpeReceiver<16>;
+    receiver->Init();
+    size_t     num_events = 0;
+    float      checksum   = 0.f;
+    const auto start      = Clock::now();
+    for(const auto& e : stream)
+    {
+        const size_t n = receiver->ProcessEvent(e);
+        num_events += n;
+        if(n > 0)
+            checksum += receiver->GetEvent(0).value;
+    }
+    const auto elapsed = Clock::now() - start;
+    delete receiver;
+
+    EXPECT_GT(num_events, kNumEvents / 2);
+    EXPECT_NE(checksum, 0.f);
+
+    const double ns_per_event
+        = std::chrono::duration<double, std::nano>(elapsed).count()
+          / kNumEvents;
+    RecordProperty("ns_per_event", std::to_string(ns_per_event));
+    printf("MpeReceiver<16>: %.2f ns/event\n", ns_per_event);
+}
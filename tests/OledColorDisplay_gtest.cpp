@@ -0,0 +1,333 @@
+#include "dev/oled_ssd1327.h"
+#include "dev/oled_ssd1351.h"
+#include "hid/disp/oled_color_display.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Simulates the RAM and the address window of the display controller */
+struct Panel
+{
+    static constexpr size_t kWidth  = 128;
+    static constexpr size_t kHeight = 128;
+
+    std::vector<uint16_t> ram = std::vector<uint16_t>(kWidth * kHeight);
+    size_t                columns[2] = {0, kWidth - 1};
+    size_t                rows[2]    = {0, kHeight - 1};
+    size_t                x = 0, y = 0;
+    size_t                data_bytes = 0; // pixel data, not the arguments
+    size_t                transfers  = 0;
+
+    void SetWindow(const size_t (&new_columns)[2], const size_t (&new_rows)[2])
+    {
+        columns[0] = new_columns[0];
+        columns[1] = new_columns[1];
+        rows[0]    = new_rows[0];
+        rows[1]    = new_rows[1];
+        x          = columns[0];
+        y          = rows[0];
+    }
+
+    /** Writes a pixel and moves to the next, wrapping within the window */
+    void Write(uint16_t value)
+    {
+        ram[y * kWidth + x] = value;
+        if(++x > columns[1])
+        {
+            x = columns[0];
+            if(++y > rows[1])
+                y = rows[0];
+        }
+    }
+
+    uint16_t Pixel(size_t px, size_t py) const { return ram[py * kWidth + px]; }
+
+    void ResetCounters()
+    {
+        data_bytes = 0;
+        transfers  = 0;
+    }
+};
+
+/** Decodes the SSD1351 commands: window arguments are sent as data, the
+ *  pixels follow 0x5c as big endian RGB565.
+ */
+class Ssd1351Transport
+{
+  public:
+    struct Config
+    {
+        Panel* panel;
+        void   Defaults() { panel = nullptr; }
+    };
+    void Init(const Config& config) { panel_ = config.panel; }
+    void SendCommand(uint8_t cmd)
+    {
+        command_ = cmd;
+        args_.clear();
+        if(cmd == 0x5c)
+            panel_->SetWindow(columns_, rows_);
+    }
+    void SendData(uint8_t data) { SendData(&data, 1); }
+    void SendData(uint8_t* buff, size_t size)
+    {
+        for(size_t i = 0; i < size; i++)
+            Receive(buff[i]);
+    }
+    void SendDataDma(uint8_t*                          buff,
+                     size_t                            size,
+                     SpiHandle::EndCallbackFunctionPtr end_callback,
+                     void*                             context)
+    {
+        panel_->transfers++;
+        SendData(buff, size);
+        end_callback(context, SpiHandle::Result::OK);
+    }
+
+  private:
+    void Receive(uint8_t byte)
+    {
+        if(command_ != 0x5c)
+        {
+            args_.push_back(byte);
+            if(args_.size() == 2 && command_ == 0x15)
+                columns_[0] = args_[0], columns_[1] = args_[1];
+            if(args_.size() == 2 && command_ == 0x75)
+                rows_[0] = args_[0], rows_[1] = args_[1];
+            return;
+        }
+        panel_->data_bytes++;
+        if(high_byte_)
+        {
+            high_ = byte;
+            high_byte_ = false;
+            return;
+        }
+        panel_->Write(uint16_t((high_ << 8) | byte));
+        high_byte_ = true;
+    }
+
+    Panel*               panel_;
+    uint8_t              command_ = 0;
+    std::vector<uint8_t> args_;
+    size_t               columns_[2] = {0, Panel::kWidth - 1};
+    size_t               rows_[2]    = {0, Panel::kHeight - 1};
+    uint8_t              high_       = 0;
+    bool                 high_byte_  = true;
+};
+
+/** Decodes the SSD1327 commands: window arguments are commands, the data is
+ *  two 4 bit pixels per byte, stored as one RAM column per byte.
+ */
+class Ssd1327Transport
+{
+  public:
+    struct Config
+    {
+        Panel* panel;
+        void   Defaults() { panel = nullptr; }
+    };
+    void Init(const Config& config) { panel_ = config.panel; }
+    void SendCommand(uint8_t cmd)
+    {
+        if(pending_args_ > 0)
+        {
+            args_.push_back(cmd);
+            if(--pending_args_ == 0)
+            {
+                size_t* target = window_command_ == 0x15 ? columns_ : rows_;
+                target[0]      = args_[0];
+                target[1]      = args_[1];
+                panel_->SetWindow(columns_, rows_);
+            }
+            return;
+        }
+        if(cmd == 0x15 || cmd == 0x75)
+        {
+            window_command_ = cmd;
+            pending_args_   = 2;
+            args_.clear();
+        }
+    }
+    void SendDataDma(uint8_t*                          buff,
+                     size_t                            size,
+                     SpiHandle::EndCallbackFunctionPtr end_callback,
+                     void*                             context)
+    {
+        panel_->transfers++;
+        panel_->data_bytes += size;
+        for(size_t i = 0; i < size; i++)
+            panel_->Write(buff[i]);
+        end_callback(context, SpiHandle::Result::OK);
+    }
+
+  private:
+    Panel*               panel_;
+    uint8_t              window_command_ = 0;
+    size_t               pending_args_   = 0;
+    std::vector<uint8_t> args_;
+    size_t               columns_[2] = {0, Panel::kWidth / 2 - 1};
+    size_t               rows_[2]    = {0, Panel::kHeight - 1};
+};
+
+using Ssd1351Display
+    = OledColorDisplay<SSD1351Driver<128, 128, Ssd1351Transport>>;
+using Ssd1351TiledDisplay
+    = OledColorDisplay<SSD1351TiledDriver<128, 128, 16, Ssd1351Transport>>;
+using Ssd1327Display
+    = OledColorDisplay<SSD1327Driver<128, 128, Ssd1327Transport>>;
+
+template <typename Display>
+void InitDisplay(Display& display, Panel& panel)
+{
+    typename Display::Config config;
+    config.driver_config.transport_config.panel = &panel;
+    display.Init(config);
+    panel.ResetCounters();
+}
+
+const Rgb565 kBlue  = Rgb565::FromRgb888(0, 0, 255);
+const Rgb565 kRed   = Rgb565::FromRgb888(255, 0, 0);
+const Rgb565 kGreen = Rgb565::FromRgb888(0, 255, 0);
+const Rgb565 kWhite = Rgb565(0xffff);
+
+/** A frame with several colors */
+void DrawScene(ColorGraphicsDisplay& display)
+{
+    display.Fill(kBlue);
+    display.DrawRect(10, 10, 40, 30, kRed, true);
+    display.DrawLine(0, 127, 127, 0, kGreen);
+    display.DrawCircle(90, 90, 20, kWhite);
+    display.SetCursor(2, 60);
+    display.WriteString("Colors", Font_7x10, kWhite, kRed);
+}
+} // namespace
+
+TEST(hid_OledColorDisplay, a_rgb565Components)
+{
+    const Rgb565 color = Rgb565::FromRgb888(0xff, 0x80, 0x08);
+    EXPECT_EQ(color.GetRed(), 0x1f);
+    EXPECT_EQ(color.GetGreen(), 0x20);
+    EXPECT_EQ(color.GetBlue(), 0x01);
+    EXPECT_EQ(color.GetValue(), 0xfc01);
+    EXPECT_EQ(kWhite.GetGray4(), 15);
+    EXPECT_EQ(Rgb565().GetGray4(), 0);
+    // green is the brightest primary
+    EXPECT_GT(kGreen.GetGray4(), kRed.GetGray4());
+    EXPECT_GT(kRed.GetGray4(), kBlue.GetGray4());
+}
+
+TEST(hid_OledColorDisplay, b_ssd1351DrawsInColor)
+{
+    Panel          panel;
+    Ssd1351Display display;
+    InitDisplay(display, panel);
+
+    DrawScene(display);
+    display.Update();
+
+    EXPECT_EQ(panel.data_bytes, 128u * 128u * 2u);
+    EXPECT_EQ(panel.Pixel(100, 5), kBlue.GetValue());
+    EXPECT_EQ(panel.Pixel(25, 20), kRed.GetValue());
+    EXPECT_EQ(panel.Pixel(0, 127), kGreen.GetValue());
+    EXPECT_EQ(panel.Pixel(110, 90), kWhite.GetValue());
+    // the text cell is filled with the background color
+    EXPECT_EQ(panel.Pixel(2, 60), kRed.GetValue());
+
+    // bool drawing still uses the foreground/background colors
+    display.SetColorFG(0, 0x3f, 0);
+    display.DrawPixel(127, 127, true);
+    display.Update();
+    EXPECT_EQ(panel.Pixel(127, 127), kGreen.GetValue());
+}
+
+TEST(hid_OledColorDisplay, c_ssd1351SendsChangedWindow)
+{
+    Panel          panel;
+    Ssd1351Display display;
+    InitDisplay(display, panel);
+    DrawScene(display);
+    display.Update();
+
+    // redrawing the same frame sends nothing
+    panel.ResetCounters();
+    DrawScene(display);
+    display.Update();
+    EXPECT_EQ(panel.data_bytes, 0u);
+
+    // a small change only sends the rectangle around it, one row per
+    // transfer
+    DrawScene(display);
+    display.DrawRect(50, 100, 59, 104, kRed, true);
+    display.Update();
+    EXPECT_EQ(panel.data_bytes, 10u * 5u * 2u);
+    EXPECT_EQ(panel.transfers, 5u);
+
+    // full width changes go out as a single transfer
+    panel.ResetCounters();
+    display.DrawLine(0, 3, 127, 3, kRed);
+    display.Update();
+    EXPECT_EQ(panel.data_bytes, 128u * 2u);
+    EXPECT_EQ(panel.transfers, 1u);
+
+    Panel          reference;
+    Ssd1351Display full;
+    InitDisplay(full, reference);
+    DrawScene(full);
+    full.DrawRect(50, 100, 59, 104, kRed, true);
+    full.DrawLine(0, 3, 127, 3, kRed);
+    full.Update();
+    EXPECT_EQ(panel.ram, reference.ram);
+}
+
+TEST(hid_OledColorDisplay, d_ssd1327ConvertsToGray)
+{
+    Panel          panel;
+    Ssd1327Display display;
+    InitDisplay(display, panel);
+
+    display.Fill(kWhite);
+    display.Update();
+    EXPECT_EQ(panel.data_bytes, 64u * 128u);
+    EXPECT_EQ(panel.Pixel(10, 10), 0xff);
+
+    panel.ResetCounters();
+    display.DrawPixel(4, 7, kRed);
+    display.DrawPixel(9, 8, Rgb565());
+    display.Update();
+    // columns 2 to 4 (pixels 4 to 9) of rows 7 and 8
+    EXPECT_EQ(panel.data_bytes, 3u * 2u);
+    EXPECT_EQ(panel.Pixel(2, 7), (kRed.GetGray4() << 4) | 0x0f);
+    EXPECT_EQ(panel.Pixel(4, 8), 0xf0);
+    EXPECT_EQ(panel.Pixel(3, 8), 0xff);
+}
+
+TEST(hid_OledColorDisplay, e_tiledMatchesFullBuffer)
+{
+    Panel          reference;
+    Ssd1351Display full;
+    InitDisplay(full, reference);
+    DrawScene(full);
+    full.Update();
+
+    Panel               panel;
+    Ssd1351TiledDisplay tiled;
+    InitDisplay(tiled, panel);
+    size_t calls = 0;
+    tiled.Render([&]() {
+        calls++;
+        DrawScene(tiled);
+    });
+    EXPECT_EQ(calls, 128u / 16u);
+    EXPECT_TRUE(tiled.UpdateFinished());
+    EXPECT_EQ(panel.data_bytes, 128u * 128u * 2u);
+    EXPECT_EQ(panel.ram, reference.ram);
+
+    // drawing outside of Render() is ignored
+    tiled.DrawPixel(0, 0, kRed);
+    tiled.Update();
+    EXPECT_EQ(panel.data_bytes, 128u * 128u * 2u);
+}
@@ -0,0 +1,265 @@
+#include "dev/oled_transfer_chain.h"
+#include "dev/oled_ssd130x.h"
+#include "dev/oled_ssd1327.h"
+#include "dev/oled_ssd1351.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Records what goes over the bus. DMA transfers can be held back and
+ *  completed by the test, like an interrupt that fires later.
+ */
+struct Bus
+{
+    struct Pending
+    {
+        uint8_t*                          buff;
+        size_t                            size;
+        SpiHandle::EndCallbackFunctionPtr end_callback;
+        void*                             context;
+    };
+
+    std::vector<uint8_t> commands;
+    std::vector<uint8_t> data;
+    std::vector<Pending> pending;
+    bool                 deferred = false;
+
+    /** Finishes the oldest transfer. The data is read now, as a DMA
+     *  controller would read it while the transfer runs.
+     */
+    bool Complete()
+    {
+        if(pending.empty())
+            return false;
+        const Pending transfer = pending.front();
+        pending.erase(pending.begin());
+        data.insert(data.end(), transfer.buff, transfer.buff + transfer.size);
+        transfer.end_callback(transfer.context, SpiHandle::Result::OK);
+        return true;
+    }
+
+    /** Finishes all transfers, including the ones started from callbacks */
+    size_t CompleteAll()
+    {
+        size_t num_transfers = 0;
+        while(Complete())
+            num_transfers++;
+        return num_transfers;
+    }
+
+    void Clear()
+    {
+        commands.clear();
+        data.clear();
+    }
+};
+
+class MockTransport
+{
+  public:
+    struct Config
+    {
+        Bus* bus;
+        void Defaults() { bus = nullptr; }
+    };
+    void Init(const Config& config) { bus_ = config.bus; }
+    void SendCommand(uint8_t cmd) { bus_->commands.push_back(cmd); }
+    void SendData(uint8_t data) { bus_->data.push_back(data); }
+    void SendData(uint8_t* buff, size_t size)
+    {
+        bus_->data.insert(bus_->data.end(), buff, buff + size);
+    }
+    void SendDataDma(uint8_t*                          buff,
+                     size_t                            size,
+                     SpiHandle::EndCallbackFunctionPtr end_callback,
+                     void*                             context)
+    {
+        bus_->pending.push_back({buff, size, end_callback, context});
+        if(!bus_->deferred)
+            bus_->Complete();
+    }
+
+  private:
+    Bus* bus_;
+};
+
+using Chain = OledTransferChain<MockTransport, 4>;
+
+template <typename Driver>
+void InitDriver(Driver& driver, Bus& bus)
+{
+    typename Driver::Config config;
+    config.transport_config.bus = &bus;
+    driver.Init(config);
+    bus.Clear();
+}
+} // namespace
+
+TEST(dev_OledTransferChain, a_blockingTransport)
+{
+    Bus           bus;
+    MockTransport transport;
+    transport.Init({&bus});
+    Chain chain;
+    chain.Init(&transport);
+
+    uint8_t       data[]   = {1, 2, 3, 4, 5};
+    const uint8_t first[]  = {0xb0, 0x00, 0x10};
+    const uint8_t second[] = {0xb1};
+    EXPECT_TRUE(chain.Add(first, 3, data, 2));
+    EXPECT_TRUE(chain.Add(second, 1, data + 2, 3));
+    chain.Start();
+
+    // the whole frame is sent before Start() returns
+    EXPECT_FALSE(chain.IsBusy());
+    EXPECT_EQ(bus.commands, std::vector<uint8_t>({0xb0, 0x00, 0x10, 0xb1}));
+    EXPECT_EQ(bus.data, std::vector<uint8_t>({1, 2, 3, 4, 5}));
+
+    // the same segments can be sent again
+    chain.Start();
+    EXPECT_EQ(bus.data.size(), 10u);
+
+    // a full chain rejects more segments
+    chain.Clear();
+    for(size_t i = 0; i < 4; i++)
+        EXPECT_TRUE(chain.Add(first, 3, data, 1));
+    EXPECT_FALSE(chain.Add(first, 3, data, 1));
+    EXPECT_FALSE(chain.Add(first, Chain::kMaxCommands + 1, data, 1));
+}
+
+TEST(dev_OledTransferChain, b_dmaTransport)
+{
+    Bus bus;
+    bus.deferred = true;
+    MockTransport transport;
+    transport.Init({&bus});
+    Chain chain;
+    chain.Init(&transport);
+
+    // nothing to send
+    chain.Start();
+    EXPECT_FALSE(chain.IsBusy());
+
+    uint8_t       data[]   = {1, 2, 3};
+    const uint8_t first[]  = {0xb0};
+    const uint8_t second[] = {0xb1};
+    const uint8_t third[]  = {0xb2};
+    chain.Add(first, 1, data, 1);
+    chain.Add(second, 1, data + 1, 1);
+    chain.Add(third, 1, data + 2, 1);
+    chain.Start();
+
+    // each segment starts when the previous one is done
+    EXPECT_TRUE(chain.IsBusy());
+    EXPECT_EQ(bus.commands, std::vector<uint8_t>({0xb0}));
+    EXPECT_TRUE(bus.data.empty());
+    bus.Complete();
+    EXPECT_TRUE(chain.IsBusy());
+    EXPECT_EQ(bus.commands, std::vector<uint8_t>({0xb0, 0xb1}));
+    EXPECT_EQ(bus.data, std::vector<uint8_t>({1}));
+
+    EXPECT_EQ(bus.CompleteAll(), 2u);
+    EXPECT_FALSE(chain.IsBusy());
+    EXPECT_EQ(bus.commands, std::vector<uint8_t>({0xb0, 0xb1, 0xb2}));
+    EXPECT_EQ(bus.data, std::vector<uint8_t>({1, 2, 3}));
+}
+
+TEST(dev_OledTransferChain, c_ssd130xDrawsWhileSending)
+{
+    Bus bus;
+    bus.deferred = true;
+    SSD130xDriver<128, 64, MockTransport> driver;
+    InitDriver(driver, bus);
+
+    driver.Fill(true);
+    driver.Update();
+    EXPECT_FALSE(driver.UpdateFinished());
+    EXPECT_EQ(bus.pending.size(), 1u);
+
+    // drawing while the frame is sent doesn't change the frame
+    driver.DrawPixel(0, 0, false);
+    driver.DrawPixel(127, 63, false);
+    EXPECT_EQ(bus.CompleteAll(), 8u);
+    EXPECT_TRUE(driver.UpdateFinished());
+    ASSERT_EQ(bus.data.size(), 1024u);
+    for(uint8_t byte : bus.data)
+        EXPECT_EQ(byte, 0xff);
+
+    // the next update sends what was drawn in the meantime
+    bus.Clear();
+    driver.Update();
+    EXPECT_EQ(bus.CompleteAll(), 2u);
+    EXPECT_EQ(bus.data, std::vector<uint8_t>({0xfe, 0x7f}));
+    EXPECT_EQ(bus.commands,
+              std::vector<uint8_t>({0xb0, 0x00, 0x10, 0xb7, 0x0f, 0x17}));
+}
+
+TEST(dev_OledTransferChain, d_ssd1307FullFrame)
+{
+    Bus bus;
+    bus.deferred = true;
+    SSD1307Driver<128, 64, MockTransport> driver;
+    InitDriver(driver, bus);
+
+    driver.Fill(false);
+    driver.DrawPixel(5, 0, true);
+    driver.Update();
+    driver.Fill(true);
+    EXPECT_EQ(bus.CompleteAll(), 8u);
+    EXPECT_TRUE(driver.UpdateFinished());
+    ASSERT_EQ(bus.data.size(), 1024u);
+    EXPECT_EQ(bus.data[5], 0x01);
+    EXPECT_EQ(bus.data[6], 0x00);
+    EXPECT_EQ(bus.commands.size(), 24u);
+}
+
+TEST(dev_OledTransferChain, e_ssd1351DrawsWhileSending)
+{
+    Bus bus;
+    SSD1351Driver<128, 128, MockTransport> driver;
+    InitDriver(driver, bus);
+    bus.deferred = true;
+
+    driver.Fill(false);
+    driver.DrawPixel(1, 0, true);
+    driver.Update();
+
+    // the window is set up, and the frame goes out as one transfer
+    EXPECT_EQ(bus.commands, std::vector<uint8_t>({0x15, 0x75, 0x5c}));
+    EXPECT_EQ(bus.data, std::vector<uint8_t>({0x00, 127, 0x00, 127}));
+    EXPECT_FALSE(driver.UpdateFinished());
+
+    driver.Fill(true);
+    bus.Clear();
+    EXPECT_EQ(bus.CompleteAll(), 1u);
+    EXPECT_TRUE(driver.UpdateFinished());
+    ASSERT_EQ(bus.data.size(), 128u * 128u * 2u);
+    EXPECT_EQ(bus.data[0], 0x00);
+    EXPECT_EQ(bus.data[2], 0xff);
+    EXPECT_EQ(bus.data[3], 0xff);
+    EXPECT_EQ(bus.data[4], 0x00);
+}
+
+TEST(dev_OledTransferChain, f_ssd1327DrawsWhileSending)
+{
+    Bus bus;
+    SSD1327Driver<128, 128, MockTransport> driver;
+    InitDriver(driver, bus);
+    bus.deferred = true;
+
+    driver.Fill(false);
+    driver.DrawPixel(0, 0, true);
+    driver.Update();
+    EXPECT_EQ(bus.commands,
+              std::vector<uint8_t>({0x15, 0x00, 63, 0x75, 0x00, 127}));
+
+    driver.Fill(true);
+    EXPECT_EQ(bus.CompleteAll(), 1u);
+    EXPECT_TRUE(driver.UpdateFinished());
+    ASSERT_EQ(bus.data.size(), 8192u);
+    EXPECT_EQ(bus.data[0], 0xf0);
+    EXPECT_EQ(bus.data[1], 0x00);
+}
@@ -0,0 +1,159 @@
+#include "hid/parameter.h"
+#include "hid/parameter_ramp.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace daisy;
+
+namespace
+{
+constexpr float  kSampleRate = 48000.0f;
+constexpr size_t kBlockSize  = 48;
+} // namespace
+
+TEST(hid_ParameterRamp, a_linearStepResponse)
+{
+    ParameterRamp ramp;
+    ramp.Init(kSampleRate, ParameterRamp::LINEAR, 0.002f, 0.5f);
+
+    float out[kBlockSize];
+    ramp.ProcessBlock(1.5f, out, kBlockSize);
+    for(size_t i = 0; i < kBlockSize; i++)
+        EXPECT_NEAR(out[i], 0.5f + float(i + 1) / kBlockSize, 1e-6f) << i;
+    EXPECT_EQ(out[kBlockSize - 1], 1.5f);
+    EXPECT_EQ(ramp.Value(), 1.5f);
+
+    // holds the value, then ramps down over a shorter block
+    ramp.ProcessBlock(out, kBlockSize);
+    EXPECT_EQ(out[0], 1.5f);
+    ramp.ProcessBlock(-0.5f, out, 4);
+    EXPECT_FLOAT_EQ(out[0], 1.0f);
+    EXPECT_FLOAT_EQ(out[1], 0.5f);
+    EXPECT_EQ(out[3], -0.5f);
+
+    ramp.Reset(2.0f);
+    ramp.ProcessBlock(out, 2);
+    EXPECT_EQ(out[0], 2.0f);
+}
+
+TEST(hid_ParameterRamp, b_onePoleStepResponse)
+{
+    // a time constant of 1 ms is 48 samples
+    ParameterRamp ramp;
+    ramp.Init(kSampleRate, ParameterRamp::ONE_POLE, 0.001f);
+    ramp.SetTarget(1.0f);
+
+    float out[5 * kBlockSize];
+    ramp.ProcessBlock(out, 5 * kBlockSize);
+    EXPECT_NEAR(out[kBlockSize - 1], 1.0f - expf(-1.0f), 1e-4f);
+    EXPECT_NEAR(out[5 * kBlockSize - 1], 1.0f - expf(-5.0f), 1e-4f);
+    for(size_t i = 1; i < 5 * kBlockSize; i++)
+        ASSERT_GT(out[i], out[i - 1]) << i;
+
+    // blocks of any size continue the same curve
+    ParameterRamp blocks;
+    blocks.Init(kSampleRate, ParameterRamp::ONE_POLE, 0.001f);
+    blocks.SetTarget(1.0f);
+    size_t done = 0;
+    for(size_t size : {1, 7, 32, 64, 136})
+    {
+        float block[136];
+        blocks.ProcessBlock(block, size);
+        for(size_t i = 0; i < size; i++)
+            ASSERT_NEAR(block[i], out[done + i], 1e-6f) << done + i;
+        done += size;
+    }
+    EXPECT_EQ(done, 5 * kBlockSize);
+
+    // no time constant: jumps
+    ramp.SetTimeConstant(0.0f);
+    ramp.ProcessBlock(-1.0f, out, 2);
+    EXPECT_EQ(out[0], -1.0f);
+}
+
+TEST(hid_ParameterRamp, c_smoothesParameterSteps)
+{
+    // a knob that jumps from 0 to full scale between two blocks
+    uint16_t      raw = 0;
+    AnalogControl knob;
+    knob.Init(&raw, kSampleRate / kBlockSize);
+    knob.SetCoeff(1.0f);
+    Parameter cutoff;
+    cutoff.Init(knob, 100.0f, 1000.0f, Parameter::LINEAR);
+
+    ParameterRamp ramp;
+    ramp.Init(kSampleRate);
+    ramp.Reset(cutoff.Process());
+    raw = 65535;
+
+    float out[kBlockSize];
+    ramp.ProcessBlock(cutoff.Process(), out, kBlockSize);
+    float largest_step = 0.0f;
+    float last         = 100.0f;
+    for(float value : out)
+    {
+        largest_step = fmaxf(largest_step, value - last);
+        last         = value;
+    }
+    EXPECT_NEAR(last, 1000.0f, 0.1f);
+    // instead of one step of 900
+    EXPECT_LT(largest_step, 900.0f / kBlockSize + 0.01f);
+}
+
+TEST(hid_ParameterRamp, d_benchmark)
+{
+    using Clock              = std::chrono::steady_clock;
+    constexpr int kNumBlocks = 100000;
+    float         out[kBlockSize];
+    float         checksum = 0.0f;
+
+    auto run = [&](ParameterRamp::Mode mode) {
+        ParameterRamp ramp;
+        ramp.Init(kSampleRate, mode);
+        const auto start = Clock::now();
+        for(int b = 0; b < kNumBlocks; b++)
+        {
+            ramp.ProcessBlock(float(b % 100), out, kBlockSize);
+            checksum += out[b % kBlockSize];
+        }
+        return Clock::now() - start;
+    };
+    const auto linear_time   = run(ParameterRamp::LINEAR);
+    const auto one_pole_time = run(ParameterRamp::ONE_POLE);
+
+    // what a patch does without it: a one pole filter per sample with the
+    // coefficient computed in the loop
+    const auto per_sample_start = Clock::now();
+    float      value            = 0.0f;
+    for(int b = 0; b < kNumBlocks; b++)
+    {
+        const float target = float(b % 100);
+        for(size_t i = 0; i < kBlockSize; i++)
+        {
+            value += (1.0f - expf(-1.0f / (0.002f * kSampleRate)))
+                     * (target - value);
+            out[i] = value;
+        }
+        checksum += out[b % kBlockSize];
+    }
+    const auto per_sample_time = Clock::now() - per_sample_start;
+
+    auto ns = [](Clock::duration d) {
+        return std::chrono::duration<double, std::nano>(d).count()
+               / kNumBlocks;
+    };
+    RecordProperty("ns_per_block_linear", std::to_string(ns(linear_time)));
+    RecordProperty("ns_per_block_one_pole", std::to_string(ns(one_pole_time)));
+    RecordProperty("ns_per_block_per_sample",
+                   std::to_string(ns(per_sample_time)));
+    printf("%d sample blocks: %.1f ns linear, %.1f ns one pole, %.1f ns "
+           "per sample filter\n",
+           int(kBlockSize),
+           ns(linear_time),
+           ns(one_pole_time),
+           ns(per_sample_time));
+    // uses the results, so that they aren't optimized away
+    EXPECT_TRUE(std::isfinite(checksum));
+}
@@ -0,0 +1,250 @@
+#include "hid/encoder.h"
+#include "hid/port_debouncer.h"
+#include "hid/switch.h"
+#include "hid/switch3.h"
+#include "sys/system.h"
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace daisy;
+
+namespace
+{
+/** Stands in for the GPIO ports */
+struct MockPortReader
+{
+    void InitPin(Pin /* pin */, GPIO::Pull /* pull */) { numPins++; }
+
+    uint32_t ReadPort(GPIOPort port)
+    {
+        reads[port]++;
+        return levels[port];
+    }
+
+    /** Sets the level of a pin */
+    void Set(Pin pin, bool high)
+    {
+        if(high)
+            levels[pin.port] |= 1u << pin.pin;
+        else
+            levels[pin.port] &= ~(1u << pin.pin);
+    }
+
+    uint32_t levels[PORTX] = {};
+    int      reads[PORTX]  = {};
+    int      numPins       = 0;
+};
+
+/** One input debounced the slow way, to compare against */
+struct ReferenceDebouncer
+{
+    bool Process(bool sample)
+    {
+        count = sample != state ? count + 1 : 0;
+        if(count < 4)
+            return false;
+        state = sample;
+        count = 0;
+        return true;
+    }
+
+    bool state = false;
+    int  count = 0;
+};
+} // namespace
+
+TEST(hid_PortDebouncer, a_rejectsBounce)
+{
+    BitDebouncer debouncer;
+    debouncer.Init();
+
+    // bouncing contacts, then pressed: the fourth stable sample counts
+    const uint32_t samples[] = {1, 0, 1, 1, 0, 1, 1, 1, 1, 1};
+    for(int i = 0; i < 10; i++)
+    {
+        debouncer.Process(samples[i]);
+        EXPECT_EQ(debouncer.State(), i >= 8 ? 1u : 0u) << i;
+        EXPECT_EQ(debouncer.Rising(), i == 8 ? 1u : 0u) << i;
+        EXPECT_EQ(debouncer.Falling(), 0u) << i;
+    }
+
+    // and released
+    const uint32_t release[] = {0, 0, 1, 0, 0, 0, 0};
+    for(int i = 0; i < 7; i++)
+    {
+        debouncer.Process(release[i]);
+        EXPECT_EQ(debouncer.State(), i >= 6 ? 0u : 1u) << i;
+        EXPECT_EQ(debouncer.Falling(), i == 6 ? 1u : 0u) << i;
+        EXPECT_EQ(debouncer.Rising(), 0u) << i;
+    }
+}
+
+TEST(hid_PortDebouncer, b_debouncesAllBitsIndependently)
+{
+    // random bounces on each input match a debouncer per input
+    std::mt19937       rng(44);
+    BitDebouncer       debouncer;
+    ReferenceDebouncer reference[32];
+    bool               level[32] = {};
+    debouncer.Init();
+    for(int t = 0; t < 20000; t++)
+    {
+        uint32_t sample = 0;
+        for(int bit = 0; bit < 32; bit++)
+        {
+            // each input flips with a different probability
+            if(rng() % (bit + 2) == 0)
+                level[bit] = !level[bit];
+            sample |= uint32_t(level[bit]) << bit;
+        }
+        debouncer.Process(sample);
+        for(int bit = 0; bit < 32; bit++)
+        {
+            const bool changed = reference[bit].Process(level[bit]);
+            ASSERT_EQ((debouncer.State() >> bit) & 1u, reference[bit].state)
+                << "input " << bit << " at " << t;
+            ASSERT_EQ((debouncer.Rising() >> bit) & 1u,
+                      changed && reference[bit].state);
+            ASSERT_EQ((debouncer.Falling() >> bit) & 1u,
+                      changed && !reference[bit].state);
+        }
+    }
+}
+
+TEST(hid_PortDebouncer, c_readsEachPortOnce)
+{
+    // 40 switches to ground on three ports
+    PortDebouncer<40, MockPortReader> inputs;
+    MockPortReader&                   ports = inputs.GetPortReader();
+    ports.levels[PORTA] = ports.levels[PORTB] = ports.levels[PORTC] = 0xffff;
+    for(uint8_t i = 0; i < 40; i++)
+    {
+        const Pin pin(GPIOPort(PORTA + i / 16), i % 16);
+        EXPECT_EQ(inputs.AddInput(pin), i);
+    }
+    EXPECT_EQ(inputs.AddInput(Pin(PORTD, 0)), 40u);
+    EXPECT_EQ(ports.numPins, 40);
+    EXPECT_EQ(inputs.GetNumInputs(), 40u);
+
+    // press the switches on PB3 and PC7
+    ports.Set(Pin(PORTB, 3), false);
+    ports.Set(Pin(PORTC, 7), false);
+    for(int i = 0; i < 4; i++)
+        inputs.Update();
+    EXPECT_EQ(ports.reads[PORTA], 4);
+    EXPECT_EQ(ports.reads[PORTB], 4);
+    EXPECT_EQ(ports.reads[PORTC], 4);
+    EXPECT_EQ(ports.reads[PORTD], 0);
+    for(size_t i = 0; i < 40; i++)
+    {
+        const bool pressed = i == 16 + 3 || i == 32 + 7;
+        EXPECT_EQ(inputs.Pressed(i), pressed) << i;
+        EXPECT_EQ(inputs.RisingEdge(i), pressed) << i;
+        EXPECT_EQ(inputs.RawState(i), pressed) << i;
+    }
+    EXPECT_EQ(inputs.GetDebouncer(1).State(), 1u << 7);
+
+    // active high inputs aren't inverted
+    PortDebouncer<1, MockPortReader> gate;
+    gate.AddInput(Pin(PORTA, 0), false, GPIO::Pull::NOPULL);
+    gate.GetPortReader().Set(Pin(PORTA, 0), true);
+    gate.Update();
+    EXPECT_TRUE(gate.RawState(0));
+}
+
+TEST(hid_PortDebouncer, d_edgeTimingAndSwitches)
+{
+    PortDebouncer<2, MockPortReader> inputs;
+    MockPortReader&                  ports = inputs.GetPortReader();
+    const Pin                        pin(PORTG, 10);
+    ports.Set(pin, true);
+    inputs.AddInput(pin);
+    Switch button;
+
+    auto tick = [&]() {
+        System::Delay(1);
+        if(inputs.Process())
+            button.Update(inputs.Pressed(0));
+    };
+    tick();
+
+    // no more than one update per millisecond
+    EXPECT_FALSE(inputs.Process());
+    EXPECT_EQ(ports.reads[PORTG], 1);
+
+    // press with bounces, the edge comes 4 ms after the last bounce
+    const bool presses[] = {true, false, true, false, true, true, true, true};
+    uint32_t   rising_edge_time = 0;
+    for(bool pressed : presses)
+    {
+        ports.Set(pin, !pressed);
+        tick();
+        EXPECT_EQ(button.RisingEdge(), inputs.RisingEdge(0));
+        if(button.RisingEdge())
+            rising_edge_time = System::GetNow();
+    }
+    EXPECT_TRUE(inputs.Pressed(0));
+    EXPECT_EQ(rising_edge_time, System::GetNow());
+
+    // the edge is only reported by the call that updated; like with
+    // Debounce(), the switch counts as pressed from the next update on
+    EXPECT_FALSE(inputs.Process());
+    EXPECT_FALSE(inputs.RisingEdge(0));
+    tick();
+    EXPECT_FALSE(button.RisingEdge());
+    EXPECT_TRUE(button.Pressed());
+    System::Delay(99);
+    EXPECT_FLOAT_EQ(button.TimeHeldMs(), 100.0f);
+
+    // a short glitch doesn't release the switch
+    ports.Set(pin, true);
+    tick();
+    tick();
+    ports.Set(pin, false);
+    tick();
+    EXPECT_TRUE(button.Pressed());
+    EXPECT_FALSE(button.FallingEdge());
+
+    // a release does, after 4 ms
+    ports.Set(pin, true);
+    for(int i = 0; i < 4; i++)
+    {
+        EXPECT_FALSE(button.FallingEdge());
+        tick();
+    }
+    EXPECT_TRUE(button.FallingEdge());
+    EXPECT_FALSE(button.Pressed());
+    tick();
+    EXPECT_FALSE(button.FallingEdge());
+}
+
+TEST(hid_PortDebouncer, e_encoderAndSwitch3)
+{
+    Encoder encoder;
+
+    // clockwise: A falls while B is low
+    const bool a_cw[] = {true, true, false, false, true};
+    const bool b_cw[] = {true, false, false, true, true};
+    int        sum    = 0;
+    for(int i = 0; i < 5; i++)
+    {
+        encoder.Update(a_cw[i], b_cw[i], false);
+        sum += encoder.Increment();
+    }
+    EXPECT_EQ(sum, 1);
+
+    // counter clockwise: B falls while A is low
+    sum = 0;
+    for(int i = 0; i < 5; i++)
+    {
+        encoder.Update(b_cw[i], a_cw[i], i >= 3);
+        sum += encoder.Increment();
+        EXPECT_EQ(encoder.RisingEdge(), i == 3);
+    }
+    EXPECT_EQ(sum, -1);
+    EXPECT_TRUE(encoder.Pressed());
+
+    EXPECT_EQ(Switch3::Position(false, false), Switch3::POS_CENTER);
+    EXPECT_EQ(Switch3::Position(true, false), Switch3::POS_UP);
+    EXPECT_EQ(Switch3::Position(false, true), Switch3::POS_DOWN);
+}
@@ -0,0 +1,322 @@
+#include "ui/PotMonitor.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+struct TestBackend
+{
+    float GetPotValue(uint16_t potId) { return values[potId]; }
+    float values[2] = {};
+};
+
+using TestMonitor = PotMonitor<TestBackend, 2>;
+
+/** A pot position at one point in time, and the span of time after it */
+struct TracePoint
+{
+    uint32_t timeMs;
+    float    position;
+};
+
+/** Records a pot that moves in straight lines between the points, read
+ *  once per ms by a 12 bit ADC with noise.
+ */
+std::vector<float> RecordTrace(const std::vector<TracePoint>& points,
+                               float                          noiseLsb,
+                               uint32_t                       seed)
+{
+    std::mt19937                    rng(seed);
+    std::normal_distribution<float> noise(0.0f, noiseLsb);
+    std::vector<float>              trace;
+    for(size_t i = 1; i < points.size(); i++)
+    {
+        const TracePoint& a = points[i - 1];
+        const TracePoint& b = points[i];
+        for(uint32_t t = a.timeMs; t < b.timeMs; t++)
+        {
+            const float pos = a.position
+                              + (b.position - a.position) * (t - a.timeMs)
+                                    / (b.timeMs - a.timeMs);
+            const float lsb = std::round(pos * 4095.0f + noise(rng));
+            trace.push_back(std::fmin(std::fmax(lsb, 0.0f), 4095.0f)
+                            / 4095.0f);
+        }
+    }
+    return trace;
+}
+
+/** The events of a replayed trace */
+struct Replay
+{
+    std::vector<uint32_t> moveTimes;
+    std::vector<float>    positions;
+    int                   numActivityChanged = 0;
+
+    /** Counts the moves in [startMs, endMs) */
+    size_t MovesBetween(uint32_t startMs, uint32_t endMs) const
+    {
+        size_t n = 0;
+        for(uint32_t t : moveTimes)
+            n += t >= startMs && t < endMs;
+        return n;
+    }
+};
+
+/** Plays a trace into pot 0, one value per ms, and collects the events */
+Replay ReplayTrace(TestMonitor&              monitor,
+                   TestBackend&              backend,
+                   UiEventQueue&             queue,
+                   const std::vector<float>& trace)
+{
+    Replay replay;
+    for(uint32_t t = 0; t < trace.size(); t++)
+    {
+        System::SetUsForUnitTest((t + 1) * 1000);
+        backend.values[0] = trace[t];
+        monitor.Process();
+        while(!queue.IsQueueEmpty())
+        {
+            const auto e = queue.GetAndRemoveNextEvent();
+            if(e.type == UiEventQueue::Event::EventType::potMoved)
+            {
+                replay.moveTimes.push_back(t);
+                replay.positions.push_back(e.asPotMoved.newPosition);
+            }
+            else if(e.type
+                    == UiEventQueue::Event::EventType::potActivityChanged)
+            {
+                replay.numActivityChanged++;
+            }
+        }
+    }
+    return replay;
+}
+
+/** Rests at 0.3, moves slowly to 0.35, rests, quickly moves to 0.9 and
+ *  rests again
+ */
+const std::vector<TracePoint> kPotTrace = {{0, 0.3f},
+                                           {2000, 0.3f},
+                                           {7000, 0.35f},
+                                           {8000, 0.35f},
+                                           {8200, 0.9f},
+                                           {10200, 0.9f}};
+} // namespace
+
+TEST(ui_PotMonitor, a_fixedDeadBands)
+{
+    System::SetUsForUnitTest(0);
+    UiEventQueue queue;
+    TestBackend  backend;
+    TestMonitor  monitor;
+    monitor.Init(queue, backend, 500, 0.01f, 0.001f);
+    EXPECT_EQ(&monitor.GetBackend(), &backend);
+
+    // pots start out moving, and go idle after the timeout
+    backend.values[0] = 0.0005f;
+    monitor.Process();
+    EXPECT_TRUE(monitor.IsMoving(0));
+    System::Delay(500);
+    monitor.Process();
+    EXPECT_FALSE(monitor.IsMoving(0));
+    for(uint16_t id = 0; id < 2; id++)
+    {
+        const auto e = queue.GetAndRemoveNextEvent();
+        EXPECT_EQ(e.type, UiEventQueue::Event::EventType::potActivityChanged);
+        EXPECT_EQ(e.asPotActivityChanged.id, id);
+    }
+    EXPECT_TRUE(queue.IsQueueEmpty());
+
+    // an idle pot needs to move past the idle dead band
+    backend.values[0] = 0.005f;
+    monitor.Process();
+    EXPECT_TRUE(queue.IsQueueEmpty());
+    EXPECT_FALSE(monitor.IsMoving(0));
+    backend.values[0] = 0.02f;
+    monitor.Process();
+    EXPECT_TRUE(monitor.IsMoving(0));
+    EXPECT_FLOAT_EQ(monitor.GetCurrentPotValue(0), 0.02f);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type,
+              UiEventQueue::Event::EventType::potActivityChanged);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type,
+              UiEventQueue::Event::EventType::potMoved);
+
+    // a moving pot past the smaller one
+    backend.values[0] = 0.0215f;
+    monitor.Process();
+    EXPECT_FLOAT_EQ(monitor.GetCurrentPotValue(0), 0.0215f);
+    EXPECT_EQ(queue.GetAndRemoveNextEvent().type,
+              UiEventQueue::Event::EventType::potMoved);
+
+    // the pot goes idle after the timeout, even when it's not hit exactly
+    for(int i = 0; i < 200; i++)
+    {
+        System::Delay(3);
+        monitor.Process();
+    }
+    EXPECT_FALSE(monitor.IsMoving(0));
+    const auto e = queue.GetAndRemoveNextEvent();
+    EXPECT_EQ(e.type, UiEventQueue::Event::EventType::potActivityChanged);
+    EXPECT_EQ(e.asPotActivityChanged.newActivityType,
+              UiEventQueue::Event::ActivityType::inactive);
+    EXPECT_TRUE(queue.IsQueueEmpty());
+
+    const auto& stats = monitor.GetStats();
+    EXPECT_EQ(stats.numMoved, 2u);
+    EXPECT_EQ(stats.numActivityChanged, 4u);
+    EXPECT_EQ(stats.numRateLimited, 0u);
+    monitor.ResetStats();
+    EXPECT_EQ(monitor.GetStats().numMoved, 0u);
+
+    // the noise is only estimated for the adaptive dead bands
+    EXPECT_FLOAT_EQ(monitor.GetNoiseFloor(0), 0.0f);
+}
+
+TEST(ui_PotMonitor, b_adaptiveIgnoresNoise)
+{
+    // 3 LSB of noise is more than the fixed dead bands
+    const std::vector<float> trace = RecordTrace(kPotTrace, 3.0f, 50);
+
+    UiEventQueue queue;
+    TestBackend  backend;
+    TestMonitor  fixed;
+    System::SetUsForUnitTest(0);
+    fixed.Init(queue, backend);
+    const Replay fixedReplay = ReplayTrace(fixed, backend, queue, trace);
+
+    TestMonitor                   adaptive;
+    TestMonitor::AdaptiveSettings settings;
+    settings.Defaults();
+    System::SetUsForUnitTest(0);
+    adaptive.InitAdaptive(queue, backend, settings);
+    const Replay replay = ReplayTrace(adaptive, backend, queue, trace);
+
+    // at rest, the fixed dead bands let the noise through all the time
+    const size_t fixedAtRest = fixedReplay.MovesBetween(500, 2000)
+                               + fixedReplay.MovesBetween(8700, 10200);
+    EXPECT_GT(fixedAtRest, 1000u);
+
+    // the adaptive ones not at all, after the first position, which is
+    // held back by the minimum event interval, and the settling at the end
+    // of the moves
+    const size_t atRest
+        = replay.MovesBetween(11, 2000) + replay.MovesBetween(8700, 10200);
+    EXPECT_EQ(atRest, 0u);
+    EXPECT_FALSE(adaptive.IsMoving(0));
+
+    // the noise is estimated, 3 LSB
+    EXPECT_NEAR(adaptive.GetNoiseFloor(0), 3.0f / 4095.0f, 0.5f / 4095.0f);
+    EXPECT_NEAR(adaptive.GetNoiseFloor(1), 0.0f, 1.0f / 4095.0f);
+
+    // and the events over the whole trace are a small fraction
+    const auto& stats = adaptive.GetStats();
+    EXPECT_EQ(stats.numMoved, replay.moveTimes.size());
+    EXPECT_EQ(stats.numActivityChanged, uint32_t(replay.numActivityChanged));
+    EXPECT_LT(replay.moveTimes.size() * 10, fixedReplay.moveTimes.size());
+    ::testing::Test::RecordProperty("fixedMoveEvents",
+                                    int(fixedReplay.moveTimes.size()));
+    ::testing::Test::RecordProperty("adaptiveMoveEvents",
+                                    int(replay.moveTimes.size()));
+    printf("move events: fixed dead bands %d, adaptive %d\n",
+           int(fixedReplay.moveTimes.size()),
+           int(replay.moveTimes.size()));
+}
+
+TEST(ui_PotMonitor, c_adaptiveFollowsSlowMoves)
+{
+    const std::vector<float> trace = RecordTrace(kPotTrace, 3.0f, 51);
+
+    UiEventQueue                  queue;
+    TestBackend                   backend;
+    TestMonitor                   monitor;
+    TestMonitor::AdaptiveSettings settings;
+    settings.Defaults();
+    System::SetUsForUnitTest(0);
+    monitor.InitAdaptive(queue, backend, settings);
+    const Replay replay = ReplayTrace(monitor, backend, queue, trace);
+
+    // the slow move, 0.05 in 5 s, is about 200 steps of 12 bits but
+    // hidden in the noise from one ms to the next. It's still followed,
+    // in steps of about the dead band.
+    const size_t slowMoves = replay.MovesBetween(2000, 7500);
+    EXPECT_GT(slowMoves, 5u);
+    float lastSlowPosition = 0.0f;
+    for(size_t i = 0; i < replay.moveTimes.size(); i++)
+    {
+        if(replay.moveTimes[i] < 8000)
+            lastSlowPosition = replay.positions[i];
+    }
+    // between steps the pot can go idle, so it ends up within the idle
+    // dead band, 12 times the noise
+    EXPECT_NEAR(lastSlowPosition, 0.35f, 12.0f * 3.0f / 4095.0f);
+
+    // the posted positions are quantized to 12 bits and go up only
+    for(size_t i = 0; i < replay.positions.size(); i++)
+    {
+        const float steps = replay.positions[i] * 4096.0f;
+        EXPECT_FLOAT_EQ(steps, std::round(steps));
+        if(i > 0)
+        {
+            EXPECT_GT(replay.positions[i], replay.positions[i - 1]);
+        }
+    }
+    ::testing::Test::RecordProperty("slowMoveEvents", int(slowMoves));
+}
+
+TEST(ui_PotMonitor, d_adaptiveLimitsEventRate)
+{
+    const std::vector<float> trace = RecordTrace(kPotTrace, 3.0f, 52);
+
+    UiEventQueue                  queue;
+    TestBackend                   backend;
+    TestMonitor                   monitor;
+    TestMonitor::AdaptiveSettings settings;
+    settings.Defaults();
+    settings.minEventIntervalMs = 20;
+    System::SetUsForUnitTest(0);
+    monitor.InitAdaptive(queue, backend, settings);
+    const Replay replay = ReplayTrace(monitor, backend, queue, trace);
+
+    // in the fast move, 0.55 in 200 ms, the pot leaves even the largest
+    // dead band every few ms
+    const size_t fastMoves = replay.MovesBetween(8000, 8200);
+    EXPECT_LE(fastMoves, 200u / 20u + 1u);
+    EXPECT_GE(fastMoves, 200u / 20u - 1u);
+    for(size_t i = 1; i < replay.moveTimes.size(); i++)
+    {
+        EXPECT_GE(replay.moveTimes[i] - replay.moveTimes[i - 1], 20u);
+    }
+    EXPECT_GT(monitor.GetStats().numRateLimited, 100u);
+
+    // the final position is posted once the pot rests
+    EXPECT_NEAR(replay.positions.back(), 0.9f, 0.005f);
+    EXPECT_FLOAT_EQ(monitor.GetCurrentPotValue(0), replay.positions.back());
+    EXPECT_FALSE(monitor.IsMoving(0));
+}
+
+TEST(ui_PotMonitor, e_noiseEstimateAtOtherRates)
+{
+    // a resting pot, read every 5 ms instead of every ms
+    const std::vector<float> trace
+        = RecordTrace({{0, 0.5f}, {3000, 0.5f}}, 3.0f, 53);
+
+    UiEventQueue                  queue;
+    TestBackend                   backend;
+    TestMonitor                   monitor;
+    TestMonitor::AdaptiveSettings settings;
+    settings.Defaults();
+    System::SetUsForUnitTest(0);
+    monitor.InitAdaptive(queue, backend, settings);
+    for(uint32_t t = 0; t < trace.size(); t += 5)
+    {
+        System::SetUsForUnitTest((t + 5) * 1000);
+        backend.values[0] = trace[t];
+        monitor.Process();
+    }
+    EXPECT_NEAR(monitor.GetNoiseFloor(0), 3.0f / 4095.0f, 0.6f / 4095.0f);
+}
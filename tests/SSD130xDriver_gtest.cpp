@@ -0,0 +1,746 @@
+#include "dev/oled_ssd130x.h"
+#include "dev/oled_sh1106.h"
+#include "hid/disp/oled_display.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace daisy;
+
+namespace
+{
+/** Simulates the RAM of the display controller from the bytes it receives */
+struct Panel
+{
+    static constexpr size_t kColumns = 132;
+    static constexpr size_t kPages   = 8;
+
+    uint8_t ram[kPages][kColumns] = {};
+    uint8_t page                  = 0;
+    uint8_t column                = 0;
+    size_t  num_commands          = 0;
+    size_t  num_data_bytes        = 0;
+
+    void Command(uint8_t cmd)
+    {
+        num_commands++;
+        if(cmd >= 0xb0 && cmd <= 0xb7)
+            page = cmd & 0x07;
+        else if(cmd <= 0x0f)
+            column = (column & 0xf0) | cmd;
+        else if(cmd >= 0x10 && cmd <= 0x1f)
+            column = (column & 0x0f) | ((cmd & 0x0f) << 4);
+    }
+
+    void Data(const uint8_t* buff, size_t size)
+    {
+        num_data_bytes += size;
+        for(size_t i = 0; i < size; i++)
+        {
+            if(column < kColumns)
+                ram[page][column] = buff[i];
+            column++;
+        }
+    }
+
+    /** Clears the counters, e.g. after a frame */
+    size_t TakeBytes()
+    {
+        const size_t bytes = num_data_bytes + num_commands;
+        num_commands       = 0;
+        num_data_bytes     = 0;
+        return bytes;
+    }
+};
+
+/** Transport that feeds a simulated panel instead of an SPI/I2C bus */
+class MockTransport
+{
+  public:
+    struct Config
+    {
+        Panel* panel;
+        void   Defaults() { panel = nullptr; }
+    };
+    void Init(const Config& config) { panel_ = config.panel; }
+    void SendCommand(uint8_t cmd) { panel_->Command(cmd); }
+    void SendData(uint8_t* buff, size_t size) { panel_->Data(buff, size); }
+    void SendDataDma(uint8_t*                          buff,
+                     size_t                            size,
+                     SpiHandle::EndCallbackFunctionPtr end_callback,
+                     void*                             context)
+    {
+        panel_->Data(buff, size);
+        end_callback(context, SpiHandle::Result::OK);
+    }
+
+  private:
+    Panel* panel_;
+};
+
+using Driver       = SSD130xDriver<128, 64, MockTransport>;
+using Display      = OledDisplay<Driver>;
+using SH1106Mock   = SH1106Driver<128, 64, MockTransport>;
+using SH1106Screen = OledDisplay<SH1106Mock>;
+
+/** Draws through the same driver, but only with DrawPixel(), i.e. without
+ *  the span operations of OneBitGraphicsDisplayImpl */
+class PixelDisplay : public OneBitGraphicsDisplayImpl<PixelDisplay>
+{
+  public:
+    struct Config
+    {
+        Driver::Config driver_config;
+    };
+    void     Init(Config config) { driver_.Init(config.driver_config); }
+    uint16_t Height() const override { return driver_.Height(); }
+    uint16_t Width() const override { return driver_.Width(); }
+    void     Fill(bool on) override { driver_.Fill(on); }
+    void     DrawPixel(uint_fast8_t x, uint_fast8_t y, bool on) override
+    {
+        driver_.DrawPixel(x, y, on);
+    }
+    void Update() override { driver_.Update(); }
+    bool UpdateFinished() override { return driver_.UpdateFinished(); }
+
+  private:
+    Driver driver_;
+};
+
+template <typename DisplayType>
+void InitDisplay(DisplayType& display, Panel& panel)
+{
+    typename DisplayType::Config config;
+    config.driver_config.transport_config.panel = &panel;
+    display.Init(config);
+    panel.TakeBytes();
+}
+
+/** A parameter page with four lines, one of them showing a value */
+template <typename DisplayType>
+void DrawMenu(DisplayType& display, int cutoff)
+{
+    char value[16];
+    snprintf(value, sizeof(value), "Cutoff %5d", cutoff);
+    display.Fill(false);
+    display.SetCursor(0, 0);
+    display.WriteString("Filter", Font_7x10, true);
+    display.DrawLine(0, 12, 127, 12, true);
+    display.SetCursor(0, 16);
+    display.WriteString(value, Font_7x10, true);
+    display.SetCursor(0, 28);
+    display.WriteString("Reso      0.40", Font_7x10, true);
+    display.SetCursor(0, 40);
+    display.WriteString("Drive     1.00", Font_7x10, true);
+}
+
+/** A full screen menu page with a frame, a selection bar, a slider and
+ *  inverted text */
+template <typename DisplayType>
+void DrawMenuPage(DisplayType& display, int selected, int value)
+{
+    display.Fill(false);
+    display.DrawRect(0, 0, 127, 63, true);
+    display.SetCursor(2, 2);
+    display.WriteString("Voice Settings", Font_6x8, true);
+    display.DrawLine(1, 11, 126, 11, true);
+    const char* items[] = {"Attack", "Decay", "Sustain", "Release"};
+    for(int i = 0; i < 4; i++)
+    {
+        const uint_fast8_t y        = 13 + i * 11;
+        const bool         inverted = (i == selected);
+        display.DrawRect(2, y, 125, y + 10, inverted, true);
+        display.SetCursor(4, y + 1);
+        display.WriteString(items[i], Font_7x10, !inverted);
+        display.DrawRect(70, y + 2, 122, y + 8, !inverted);
+        display.DrawRect(
+            72, y + 4, 72 + (value + i * 13) % 49, y + 6, !inverted, true);
+    }
+}
+
+bool SameRam(const Panel& a, const Panel& b)
+{
+    return memcmp(a.ram, b.ram, sizeof(a.ram)) == 0;
+}
+} // namespace
+
+TEST(dev_SSD130xDriver, a_firstUpdateSendsEverything)
+{
+    Panel   panel;
+    Display display;
+    InitDisplay(display, panel);
+
+    display.Fill(false);
+    display.Update();
+    // 8 pages of 128 bytes, 3 address commands each
+    EXPECT_EQ(panel.num_data_bytes, 1024u);
+    EXPECT_EQ(panel.num_commands, 24u);
+    panel.TakeBytes();
+
+    // nothing changed, nothing sent
+    display.Update();
+    EXPECT_EQ(panel.TakeBytes(), 0u);
+    display.Fill(false);
+    display.Update();
+    EXPECT_EQ(panel.TakeBytes(), 0u);
+}
+
+TEST(dev_SSD130xDriver, b_singlePixel)
+{
+    Panel   panel;
+    Display display;
+    InitDisplay(display, panel);
+    display.Fill(false);
+    display.Update();
+    panel.TakeBytes();
+
+    display.DrawPixel(100, 37, true);
+    display.Update();
+    EXPECT_EQ(panel.num_data_bytes, 1u);
+    EXPECT_EQ(panel.num_commands, 3u);
+    EXPECT_EQ(panel.ram[4][100], 1 << 5);
+    panel.TakeBytes();
+
+    // setting it again doesn't make the page dirty
+    display.DrawPixel(100, 37, true);
+    display.DrawPixel(200, 37, true); // off screen
+    display.Update();
+    EXPECT_EQ(panel.TakeBytes(), 0u);
+
+    // a range on one page goes out in one transfer
+    display.DrawPixel(10, 33, true);
+    display.DrawPixel(20, 34, true);
+    display.DrawPixel(100, 37, false);
+    display.Update();
+    EXPECT_EQ(panel.num_data_bytes, 91u);
+    EXPECT_EQ(panel.num_commands, 3u);
+    EXPECT_EQ(panel.ram[4][100], 0);
+    EXPECT_EQ(panel.ram[4][10], 1 << 1);
+}
+
+TEST(dev_SSD130xDriver, c_fill)
+{
+    Panel   panel;
+    Display display;
+    InitDisplay(display, panel);
+    display.Fill(false);
+    display.Update();
+    panel.TakeBytes();
+
+    display.Fill(true);
+    display.Update();
+    EXPECT_EQ(panel.num_data_bytes, 1024u);
+    EXPECT_EQ(panel.ram[7][127], 0xff);
+    panel.TakeBytes();
+
+    // clearing a small area only sends that area
+    display.DrawRect(30, 20, 40, 22, false, true);
+    display.Update();
+    EXPECT_EQ(panel.num_data_bytes, 11u);
+    EXPECT_EQ(panel.ram[2][35], 0x8f);
+    panel.TakeBytes();
+
+    // filling it again sends the same area back
+    display.Fill(true);
+    display.Update();
+    EXPECT_EQ(panel.num_data_bytes, 11u);
+    EXPECT_EQ(panel.ram[2][35], 0xff);
+    panel.TakeBytes();
+
+    // clearing and refilling before an update sends nothing
+    display.DrawRect(30, 20, 40, 22, false, true);
+    display.Fill(true);
+    display.Update();
+    EXPECT_EQ(panel.TakeBytes(), 0u);
+}
+
+TEST(dev_SSD130xDriver, d_menuRedraw)
+{
+    Panel   panel;
+    Display display;
+    InitDisplay(display, panel);
+
+    DrawMenu(display, 1200);
+    display.Update();
+    const size_t full_frame = panel.TakeBytes();
+
+    // the usual UI loop redraws everything, but only the value changed
+    size_t total = 0;
+    for(int cutoff = 1201; cutoff <= 1300; cutoff++)
+    {
+        DrawMenu(display, cutoff);
+        display.Update();
+        total += panel.TakeBytes();
+    }
+    const size_t per_frame = total / 100;
+
+    // an unchanged frame costs nothing
+    DrawMenu(display, 1300);
+    display.Update();
+    EXPECT_EQ(panel.TakeBytes(), 0u);
+
+    // the panel shows the same as a display drawn from scratch
+    Panel   reference_panel;
+    Display reference;
+    InitDisplay(reference, reference_panel);
+    DrawMenu(reference, 1300);
+    reference.Update();
+    EXPECT_TRUE(SameRam(panel, reference_panel));
+
+    // the digits are at most 4 characters of 7 pixels on 2 pages
+    EXPECT_LE(per_frame, 2u * (4u * 7u + 3u));
+    EXPECT_LT(per_frame * 20, full_frame);
+    RecordProperty("bytes_full_frame", std::to_string(full_frame));
+    RecordProperty("bytes_per_value_change", std::to_string(per_frame));
+    printf("full frame: %zu bytes, value change: %zu bytes\n",
+           full_frame,
+           per_frame);
+}
+
+TEST(dev_SSD130xDriver, e_setAllDirty)
+{
+    Panel   panel;
+    Driver  driver;
+    Driver::Config config;
+    config.transport_config.panel = &panel;
+    driver.Init(config);
+    driver.Fill(false);
+    driver.Update();
+    panel.TakeBytes();
+
+    // e.g. after the display was power cycled
+    driver.SetAllDirty();
+    driver.Update();
+    EXPECT_EQ(panel.num_data_bytes, 1024u);
+}
+
+TEST(dev_SSD130xDriver, f_sh1106ColumnOffset)
+{
+    Panel        panel;
+    SH1106Screen display;
+    InitDisplay(display, panel);
+    display.Fill(false);
+    display.Update();
+    panel.TakeBytes();
+
+    display.DrawPixel(0, 0, true);
+    display.DrawPixel(127, 63, true);
+    display.Update();
+    EXPECT_EQ(panel.num_data_bytes, 2u);
+    // the visible area starts at RAM column 2
+    EXPECT_EQ(panel.ram[0][2], 0x01);
+    EXPECT_EQ(panel.ram[7][129], 0x80);
+    EXPECT_EQ(panel.ram[0][0], 0);
+}
+
+TEST(dev_SSD130xDriver, g_spansMatchPixels)
+{
+    Panel        panel;
+    Display      display;
+    Panel        reference_panel;
+    PixelDisplay reference;
+    InitDisplay(display, panel);
+    InitDisplay(reference, reference_panel);
+
+    auto draw = [](OneBitGraphicsDisplay& d, std::mt19937& rng) {
+        const uint_fast8_t x1 = rng() % 140;
+        const uint_fast8_t y1 = rng() % 72;
+        const uint_fast8_t x2 = rng() % 140;
+        const uint_fast8_t y2 = rng() % 72;
+        const bool         on = rng() % 2;
+        switch(rng() % 6)
+        {
+            case 0: d.DrawRect(x1, y1, x2, y2, on, true); break;
+            case 1: d.DrawRect(x1, y1, x2, y2, on, false); break;
+            case 2: d.DrawLine(x1, y1, x2, y1, on); break;
+            case 3: d.DrawLine(x1, y1, x1, y2, on); break;
+            case 4: d.DrawLine(x1, y1, x2, y2, on); break;
+            default:
+            {
+                const FontDef* fonts[]
+                    = {&Font_4x6, &Font_6x8, &Font_7x10, &Font_11x18};
+                d.SetCursor(x1, y1);
+                d.WriteString("Ag#7", *fonts[rng() % 4], on);
+                break;
+            }
+        }
+    };
+
+    std::mt19937 rng(1), reference_rng(1);
+    for(int frame = 0; frame < 50; frame++)
+    {
+        display.Fill(frame % 2);
+        reference.Fill(frame % 2);
+        for(int i = 0; i < 40; i++)
+        {
+            draw(display, rng);
+            draw(reference, reference_rng);
+        }
+        display.Update();
+        reference.Update();
+        ASSERT_TRUE(SameRam(panel, reference_panel)) << "frame " << frame;
+    }
+
+    for(int selected = 0; selected < 4; selected++)
+    {
+        DrawMenuPage(display, selected, selected * 17);
+        DrawMenuPage(reference, selected, selected * 17);
+        display.Update();
+        reference.Update();
+        EXPECT_TRUE(SameRam(panel, reference_panel));
+    }
+}
+
+TEST(dev_SSD130xDriver, h_benchmarkMenuRedraw)
+{
+    Panel         panel;
+    Display*      display = new Display;
+    PixelDisplay* pixels  = new PixelDisplay;
+    InitDisplay(*display, panel);
+    InitDisplay(*pixels, panel);
+
+    // only the drawing is timed, not Update()
+    using Clock              = std::chrono::steady_clock;
+    constexpr int kNumFrames = 2000;
+    const auto    start      = Clock::now();
+    for(int i = 0; i < kNumFrames; i++)
+        DrawMenuPage(*display, i % 4, i);
+    const auto span_time    = Clock::now() - start;
+    const auto pixels_start = Clock::now();
+    for(int i = 0; i < kNumFrames; i++)
+        DrawMenuPage(*pixels, i % 4, i);
+    const auto pixel_time = Clock::now() - pixels_start;
+
+    display->Update();
+    EXPECT_GT(panel.num_data_bytes, 0u);
+    delete display;
+    delete pixels;
+
+    const double us_spans
+        = std::chrono::duration<double, std::micro>(span_time).count()
+          / kNumFrames;
+    const double us_pixels
+        = std::chrono::duration<double, std::micro>(pixel_time).count()
+          / kNumFrames;
+    RecordProperty("us_per_frame", std::to_string(us_spans));
+    RecordProperty("us_per_frame_pixels", std::to_string(us_pixels));
+    printf("menu redraw: %.2f us/frame with spans, %.2f us/frame per pixel\n",
+           us_spans,
+           us_pixels);
+}
+
+namespace
+{
+const FontDef* const kFonts[] = {&Font_4x6,
+                                 &Font_4x8,
+                                 &Font_5x8,
+                                 &Font_6x7,
+                                 &Font_6x8,
+                                 &Font_7x10,
+                                 &Font_11x18,
+                                 &Font_16x26};
+
+/** The same font without the column bytes */
+FontDef RowsOnly(const FontDef& font)
+{
+    return {font.FontWidth, font.FontHeight, font.data, nullptr};
+}
+
+/** A screen full of page aligned text */
+template <typename DisplayType>
+void DrawTextPage(DisplayType& display, const FontDef& font, int frame)
+{
+    char line[32];
+    const int line_height = 8 * ((font.FontHeight + 7) / 8);
+    for(int y = 0; y + font.FontHeight <= 64; y += line_height)
+    {
+        snprintf(line, sizeof(line), "%02d Param %7d", y, frame * 7 + y);
+        display.SetCursor(0, y);
+        display.WriteString(line, font, true);
+    }
+}
+} // namespace
+
+TEST(dev_SSD130xDriver, i_fontColumnsMatchRows)
+{
+    // fails if oled_fonts_columns.c wasn't regenerated after a font change
+    for(const FontDef* font : kFonts)
+    {
+        const size_t pages = (font->FontHeight + 7) / 8;
+        for(size_t glyph = 0; glyph < 95; glyph++)
+        {
+            for(size_t row = 0; row < pages * 8; row++)
+            {
+                for(size_t col = 0; col < font->FontWidth; col++)
+                {
+                    const bool expected
+                        = row < font->FontHeight
+                          && ((font->data[glyph * font->FontHeight + row]
+                               << col)
+                              & 0x8000);
+                    const uint8_t byte
+                        = font->columns[(glyph * pages + row / 8)
+                                            * font->FontWidth
+                                        + col];
+                    ASSERT_EQ(expected, ((byte >> (row % 8)) & 1) != 0)
+                        << font->FontWidth << "x" << int(font->FontHeight)
+                        << " glyph " << glyph << " row " << row << " col "
+                        << col;
+                }
+            }
+        }
+    }
+}
+
+TEST(dev_SSD130xDriver, j_textMatchesPixels)
+{
+    Panel        panel;
+    Display      display;
+    Panel        reference_panel;
+    PixelDisplay reference;
+    Panel        rows_panel;
+    Display      rows_display;
+    InitDisplay(display, panel);
+    InitDisplay(reference, reference_panel);
+    InitDisplay(rows_display, rows_panel);
+
+    const char text[] = "!09AZaz~{|}";
+    for(const FontDef* font : kFonts)
+    {
+        const FontDef rows_only = RowsOnly(*font);
+        for(int y = 0; y < 16; y++)
+        {
+            for(bool on : {true, false})
+            {
+                // text over a pattern, to see that the background is drawn
+                display.Fill(!on);
+                reference.Fill(!on);
+                rows_display.Fill(!on);
+                display.DrawRect(0, 4, 127, 9, on, true);
+                reference.DrawRect(0, 4, 127, 9, on, true);
+                rows_display.DrawRect(0, 4, 127, 9, on, true);
+                display.SetCursor(y, y);
+                reference.SetCursor(y, y);
+                rows_display.SetCursor(y, y);
+                display.WriteString(text, *font, on);
+                reference.WriteString(text, *font, on);
+                rows_display.WriteString(text, rows_only, on);
+                display.Update();
+                reference.Update();
+                rows_display.Update();
+                ASSERT_TRUE(SameRam(panel, reference_panel))
+                    << font->FontWidth << "x" << int(font->FontHeight)
+                    << " at y " << y;
+                ASSERT_TRUE(SameRam(rows_panel, reference_panel))
+                    << font->FontWidth << "x" << int(font->FontHeight)
+                    << " at y " << y;
+            }
+        }
+    }
+}
+
+TEST(dev_SSD130xDriver, k_benchmarkText)
+{
+    Panel         panel;
+    Display*      display = new Display;
+    PixelDisplay* pixels  = new PixelDisplay;
+    InitDisplay(*display, panel);
+    InitDisplay(*pixels, panel);
+
+    using Clock              = std::chrono::steady_clock;
+    constexpr int kNumFrames = 2000;
+    for(const FontDef* font : {&Font_6x8, &Font_7x10, &Font_11x18})
+    {
+        const FontDef rows_only = RowsOnly(*font);
+
+        const auto start = Clock::now();
+        for(int i = 0; i < kNumFrames; i++)
+            DrawTextPage(*display, *font, i);
+        const auto columns_time = Clock::now() - start;
+
+        const auto rows_start = Clock::now();
+        for(int i = 0; i < kNumFrames; i++)
+            DrawTextPage(*display, rows_only, i);
+        const auto rows_time = Clock::now() - rows_start;
+
+        const auto pixels_start = Clock::now();
+        for(int i = 0; i < kNumFrames; i++)
+            DrawTextPage(*pixels, *font, i);
+        const auto pixel_time = Clock::now() - pixels_start;
+
+        auto us = [](Clock::duration d) {
+            return std::chrono::duration<double, std::micro>(d).count()
+                   / kNumFrames;
+        };
+        const std::string name = std::to_string(font->FontWidth) + "x"
+                                 + std::to_string(font->FontHeight);
+        RecordProperty("us_per_frame_columns_" + name,
+                       std::to_string(us(columns_time)));
+        RecordProperty("us_per_frame_rows_" + name,
+                       std::to_string(us(rows_time)));
+        RecordProperty("us_per_frame_pixels_" + name,
+                       std::to_string(us(pixel_time)));
+        printf("%s text page: %.2f us/frame with column bytes, %.2f us/frame "
+               "transposing, %.2f us/frame per pixel\n",
+               name.c_str(),
+               us(columns_time),
+               us(rows_time),
+               us(pixel_time));
+    }
+
+    display->Update();
+    EXPECT_GT(panel.num_data_bytes, 0u);
+    delete display;
+    delete pixels;
+}
+
+namespace
+{
+/** A bitmap of random pixels */
+struct RandomBitmap
+{
+    RandomBitmap(uint16_t width, uint16_t height, std::mt19937& rng)
+    : data(((height + 7) / 8) * width)
+    {
+        for(auto& byte : data)
+            byte = rng();
+        bitmap = {width, height, data.data()};
+    }
+    std::vector<uint8_t> data;
+    OneBitBitmap         bitmap;
+};
+} // namespace
+
+TEST(dev_SSD130xDriver, l_bitmapsMatchPixels)
+{
+    Panel        panel;
+    Display      display;
+    Panel        reference_panel;
+    PixelDisplay reference;
+    InitDisplay(display, panel);
+    InitDisplay(reference, reference_panel);
+
+    std::mt19937 rng(3);
+    for(int frame = 0; frame < 200; frame++)
+    {
+        display.Fill(frame % 2);
+        reference.Fill(frame % 2);
+        for(int i = 0; i < 10; i++)
+        {
+            // from aligned icons to odd sizes hanging over any edge
+            const bool         aligned = i < 3;
+            const uint16_t     width   = 1 + rng() % 48;
+            const uint16_t     height  = aligned ? 16 : 1 + rng() % 48;
+            RandomBitmap       image(width, height, rng);
+            const int_fast16_t x  = int_fast16_t(rng() % 180) - 50;
+            const int_fast16_t y  = aligned ? 8 * (rng() % 8)
+                                            : int_fast16_t(rng() % 120) - 50;
+            const bool         on = rng() % 2;
+            const bool         transparent = rng() % 2;
+            display.DrawBitmap(x, y, image.bitmap, on, transparent);
+            reference.DrawBitmap(x, y, image.bitmap, on, transparent);
+        }
+        display.Update();
+        reference.Update();
+        ASSERT_TRUE(SameRam(panel, reference_panel)) << "frame " << frame;
+    }
+
+    // the virtual default implementation draws the same pixels
+    Panel        base_panel;
+    PixelDisplay base;
+    InitDisplay(base, base_panel);
+    RandomBitmap image(37, 29, rng);
+    for(bool transparent : {false, true})
+    {
+        display.Fill(true);
+        base.Fill(true);
+        display.DrawBitmap(-5, 40, image.bitmap, false, transparent);
+        base.OneBitGraphicsDisplay::DrawBitmap(
+            -5, 40, image.bitmap, false, transparent);
+        display.Update();
+        base.Update();
+        EXPECT_TRUE(SameRam(panel, base_panel));
+    }
+}
+
+TEST(dev_SSD130xDriver, m_benchmarkBitmaps)
+{
+    Panel         panel;
+    Display*      display = new Display;
+    PixelDisplay* pixels  = new PixelDisplay;
+    InitDisplay(*display, panel);
+    InitDisplay(*pixels, panel);
+
+    std::mt19937 rng(4);
+    RandomBitmap splash(128, 64, rng);
+    RandomBitmap icon(16, 16, rng);
+
+    // a splash screen, and a row of icons at an aligned and an odd height
+    auto draw = [&](OneBitGraphicsDisplay& d, int frame) {
+        d.DrawBitmap(0, 0, splash.bitmap);
+        for(int i = 0; i < 8; i++)
+        {
+            d.DrawBitmap(i * 16, 8, icon.bitmap, true, true);
+            d.DrawBitmap(i * 16, 37 + frame % 2, icon.bitmap, false);
+        }
+    };
+    // the per pixel loops that drawing a bitmap used to take
+    auto draw_pixels = [&](PixelDisplay& d, int frame) {
+        for(uint16_t y = 0; y < 64; y++)
+            for(uint16_t x = 0; x < 128; x++)
+                d.DrawPixel(x, y, splash.bitmap.GetPixel(x, y));
+        for(int i = 0; i < 8; i++)
+        {
+            for(uint16_t y = 0; y < 16; y++)
+            {
+                for(uint16_t x = 0; x < 16; x++)
+                {
+                    const bool set = icon.bitmap.GetPixel(x, y);
+                    if(set)
+                        d.DrawPixel(i * 16 + x, 8 + y, true);
+                    d.DrawPixel(i * 16 + x, 37 + frame % 2 + y, !set);
+                }
+            }
+        }
+    };
+
+    using Clock              = std::chrono::steady_clock;
+    constexpr int kNumFrames = 2000;
+    const auto    start      = Clock::now();
+    for(int i = 0; i < kNumFrames; i++)
+        draw(*display, i);
+    const auto blit_time    = Clock::now() - start;
+    const auto pixels_start = Clock::now();
+    for(int i = 0; i < kNumFrames; i++)
+        draw_pixels(*pixels, i);
+    const auto pixel_time = Clock::now() - pixels_start;
+
+    display->Update();
+    pixels->Update();
+    EXPECT_GT(panel.num_data_bytes, 0u);
+
+    // both draw the same frame
+    Panel reference_panel;
+    InitDisplay(*pixels, reference_panel);
+    draw(*display, 0);
+    draw_pixels(*pixels, 0);
+    display->Update();
+    pixels->Update();
+    EXPECT_TRUE(SameRam(panel, reference_panel));
+    delete display;
+    delete pixels;
+
+    const double us_blit
+        = std::chrono::duration<double, std::micro>(blit_time).count()
+          / kNumFrames;
+    const double us_pixels
+        = std::chrono::duration<double, std::micro>(pixel_time).count()
+          / kNumFrames;
+    RecordProperty("us_per_frame_blit", std::to_string(us_blit));
+    RecordProperty("us_per_frame_pixels", std::to_string(us_pixels));
+    printf("bitmaps: %.2f us/frame blitting, %.2f us/frame per pixel\n",
+           us_blit,
+           us_pixels);
+}
@@ -0,0 +1,337 @@
+#include "FramebufferDisplay.h"
+#include "sys/system.h"
+#include "ui/FullScreenItemMenu.h"
+#include "ui/UI.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+/** Counts the calls of the canvas functions */
+struct CanvasCalls
+{
+    int                    clears  = 0;
+    int                    flushes = 0;
+    std::vector<Rectangle> clearedAreas;
+};
+
+/** A page that records the areas it was asked to draw */
+class CountingPage : public UiPage
+{
+  public:
+    void Draw(const UiCanvasDescriptor& canvas) override
+    {
+        drawnAreas.push_back(canvas.redrawArea_);
+    }
+    std::vector<Rectangle> drawnAreas;
+};
+
+UiCanvasDescriptor MakeCanvas(CanvasCalls& calls, bool onlyWhenInvalidated)
+{
+    UiCanvasDescriptor canvas;
+    canvas.id_                       = 0;
+    canvas.handle_                   = &calls;
+    canvas.updateRateMs_             = 30;
+    canvas.redrawOnlyWhenInvalidated = onlyWhenInvalidated;
+    canvas.clearFunction_            = [](const UiCanvasDescriptor& c) {
+        static_cast<CanvasCalls*>(c.handle_)->clears++;
+    };
+    canvas.flushFunction_ = [](const UiCanvasDescriptor& c) {
+        static_cast<CanvasCalls*>(c.handle_)->flushes++;
+    };
+    return canvas;
+}
+
+/** A page that records the input it receives */
+class InputPage : public UiPage
+{
+  public:
+    bool OnEncoderTurned(uint16_t encoderID,
+                         int16_t  turns,
+                         uint16_t stepsPerRevolution) override
+    {
+        (void)stepsPerRevolution;
+        encoderTurns.push_back({encoderID, turns});
+        return true;
+    }
+    bool OnPotMoved(uint16_t potID, float newPosition) override
+    {
+        potMoves.push_back({potID, newPosition});
+        return true;
+    }
+    bool OnPotActivityChanged(uint16_t potID, bool isCurrentlyActive) override
+    {
+        (void)potID;
+        (void)isCurrentlyActive;
+        activityChanges++;
+        System::Delay(handlerDelayMs);
+        return true;
+    }
+    void OnUserInteraction() override { userInteractions++; }
+    void Draw(const UiCanvasDescriptor&) override {}
+
+    std::vector<std::pair<uint16_t, int16_t>> encoderTurns;
+    std::vector<std::pair<uint16_t, float>>   potMoves;
+    int                                       activityChanges  = 0;
+    int                                       userInteractions = 0;
+    uint32_t                                  handlerDelayMs   = 0;
+};
+
+/** Runs UI::Process() every millisecond for a while */
+void RunUi(UI& ui, uint32_t ms)
+{
+    for(uint32_t i = 0; i < ms; i++)
+    {
+        System::Delay(1);
+        ui.Process();
+    }
+}
+} // namespace
+
+TEST(ui_UI, a_redrawsAtTheUpdateRateByDefault)
+{
+    CanvasCalls  calls;
+    CountingPage page;
+    UiEventQueue queue;
+    UI           ui;
+    ui.Init(queue, UI::SpecialControlIds(), {MakeCanvas(calls, false)});
+    ui.OpenPage(page);
+
+    RunUi(ui, 1000);
+    // every 31 ms
+    EXPECT_EQ(calls.flushes, 32);
+    EXPECT_EQ(page.drawnAreas.size(), 32u);
+}
+
+TEST(ui_UI, b_redrawsOnlyWhenInvalidated)
+{
+    CanvasCalls  calls;
+    CountingPage page;
+    UiEventQueue queue;
+    UI           ui;
+    ui.Init(queue, UI::SpecialControlIds(), {MakeCanvas(calls, true)});
+    ui.OpenPage(page);
+
+    // the first frame is drawn, then nothing while idle
+    RunUi(ui, 1000);
+    EXPECT_EQ(calls.clears, 1);
+    EXPECT_EQ(calls.flushes, 1);
+
+    // after a long idle time, the redraw is immediate
+    page.Invalidate();
+    RunUi(ui, 1);
+    EXPECT_EQ(calls.flushes, 2);
+
+    // invalidations within the update period are combined into one frame
+    page.Invalidate();
+    RunUi(ui, 10);
+    page.Invalidate();
+    RunUi(ui, 100);
+    EXPECT_EQ(calls.flushes, 3);
+
+    // user input redraws, too
+    queue.AddButtonPressed(3, 1);
+    RunUi(ui, 100);
+    EXPECT_EQ(calls.flushes, 4);
+
+    // pages that aren't on the UI can't invalidate it
+    CountingPage closed;
+    closed.Invalidate();
+    RunUi(ui, 100);
+    EXPECT_EQ(calls.flushes, 4);
+
+    // closing a page redraws what's below
+    ui.ClosePage(page);
+    RunUi(ui, 100);
+    EXPECT_EQ(calls.flushes, 5);
+}
+
+TEST(ui_UI, c_redrawsInvalidatedAreas)
+{
+    CanvasCalls        calls;
+    CountingPage       page;
+    UiEventQueue       queue;
+    UI                 ui;
+    UiCanvasDescriptor canvas = MakeCanvas(calls, true);
+    canvas.clearAreaFunction_ = [](const UiCanvasDescriptor& c,
+                                   const Rectangle&          area) {
+        static_cast<CanvasCalls*>(c.handle_)->clearedAreas.push_back(area);
+    };
+    ui.Init(queue, UI::SpecialControlIds(), {canvas});
+    ui.OpenPage(page);
+    RunUi(ui, 100);
+    ASSERT_EQ(page.drawnAreas.size(), 1u);
+    EXPECT_EQ(calls.clears, 1);
+    EXPECT_TRUE(calls.clearedAreas.empty());
+
+    // two areas are combined
+    page.Invalidate(Rectangle(10, 20, 5, 5));
+    page.Invalidate(Rectangle(30, 10, 10, 4));
+    RunUi(ui, 100);
+    ASSERT_EQ(calls.clearedAreas.size(), 1u);
+    EXPECT_EQ(calls.clearedAreas[0], Rectangle(10, 10, 30, 15));
+    ASSERT_EQ(page.drawnAreas.size(), 2u);
+    EXPECT_EQ(page.drawnAreas[1], Rectangle(10, 10, 30, 15));
+    EXPECT_EQ(calls.clears, 1);
+
+    // a full invalidation overrides any area
+    page.Invalidate(Rectangle(0, 0, 2, 2));
+    page.Invalidate();
+    RunUi(ui, 100);
+    EXPECT_EQ(calls.clears, 2);
+    EXPECT_EQ(calls.clearedAreas.size(), 1u);
+    EXPECT_GT(page.drawnAreas[2].GetWidth(), 1000);
+}
+
+TEST(ui_UI, d_staticMenuDrawCallsPerSecond)
+{
+    for(bool onlyWhenInvalidated : {false, true})
+    {
+        FramebufferDisplay display;
+        UiEventQueue       queue;
+        UI                 ui;
+        FullScreenItemMenu menu;
+        bool               bypass = true;
+
+        using ItemType = AbstractMenu::ItemType;
+        AbstractMenu::ItemConfig items[2];
+        items[0].type                         = ItemType::checkboxItem;
+        items[0].text                         = "Bypass";
+        items[0].asCheckboxItem.valueToModify = &bypass;
+        items[1].type                         = ItemType::closeMenuItem;
+        items[1].text                         = "Back";
+        menu.Init(items, 2);
+
+        UiCanvasDescriptor canvas;
+        canvas.id_                       = 0;
+        canvas.handle_                   = &display;
+        canvas.updateRateMs_             = 30;
+        canvas.redrawOnlyWhenInvalidated = onlyWhenInvalidated;
+        canvas.clearFunction_            = [](const UiCanvasDescriptor& c) {
+            static_cast<FramebufferDisplay*>(c.handle_)->Fill(false);
+        };
+        canvas.flushFunction_ = [](const UiCanvasDescriptor& c) {
+            static_cast<FramebufferDisplay*>(c.handle_)->Update();
+        };
+        ui.Init(queue, UI::SpecialControlIds(), {canvas}, 0);
+        ui.OpenPage(menu);
+        RunUi(ui, 50);
+        EXPECT_TRUE(
+            MatchesGoldenImage(display, "FullScreenItemMenu_checkbox"));
+
+        display.ResetStats();
+        RunUi(ui, 1000);
+        const auto& stats = display.GetStats();
+        RecordProperty(onlyWhenInvalidated ? "invalidated_pixel_writes"
+                                           : "interval_pixel_writes",
+                       std::to_string(stats.pixelWrites));
+        printf("static menu, %s: %zu flushes, %zu pixel writes per second\n",
+               onlyWhenInvalidated ? "redraw when invalidated"
+                                   : "redraw every 30 ms",
+               stats.updates,
+               stats.pixelWrites);
+        if(onlyWhenInvalidated)
+        {
+            EXPECT_EQ(stats.updates, 0u);
+            EXPECT_EQ(stats.pixelWrites, 0u);
+
+            // selecting another item redraws once
+            menu.SelectItem(1);
+            RunUi(ui, 1000);
+            EXPECT_EQ(display.GetStats().updates, 1u);
+        }
+        else
+            EXPECT_GT(stats.updates, 30u);
+    }
+}
+
+TEST(ui_UI, e_coalescesEncoderAndPotEvents)
+{
+    CanvasCalls  calls;
+    InputPage    page;
+    UiEventQueue queue;
+    UI           ui;
+    ui.Init(queue, UI::SpecialControlIds(), {MakeCanvas(calls, true)});
+    ui.OpenPage(page);
+
+    // a fast turn and two moving pots end up as one event per control
+    for(int i = 0; i < 100; i++)
+    {
+        queue.AddEncoderTurned(5, 1, 24);
+        queue.AddPotMoved(1, i / 100.0f);
+        queue.AddPotMoved(2, 1.0f - i / 100.0f);
+    }
+    EXPECT_EQ(queue.GetStats().numMerged, 297u);
+    EXPECT_EQ(queue.GetStats().numDropped, 0u);
+
+    RunUi(ui, 1);
+    ASSERT_EQ(page.encoderTurns.size(), 1u);
+    EXPECT_EQ(page.encoderTurns[0].first, 5);
+    EXPECT_EQ(page.encoderTurns[0].second, 100);
+    ASSERT_EQ(page.potMoves.size(), 2u);
+    EXPECT_FLOAT_EQ(page.potMoves[0].second, 0.99f);
+    EXPECT_NEAR(page.potMoves[1].second, 0.01f, 1e-6f);
+    // one notification for the batch
+    EXPECT_EQ(page.userInteractions, 1);
+
+    // other events aren't reordered, so they stop the merging
+    queue.ResetStats();
+    queue.AddEncoderTurned(5, 2, 24);
+    queue.AddPotActivityChanged(1, false);
+    queue.AddEncoderTurned(5, -1, 24);
+    queue.AddEncoderTurned(6, 1, 24);
+    queue.AddEncoderTurned(5, -1, 24);
+    EXPECT_EQ(queue.GetStats().numMerged, 1u);
+    RunUi(ui, 1);
+    ASSERT_EQ(page.encoderTurns.size(), 4u);
+    EXPECT_EQ(page.encoderTurns[1].second, 2);
+    EXPECT_EQ(page.encoderTurns[2].second, -2);
+    EXPECT_EQ(page.encoderTurns[3].first, 6);
+
+    // increments that don't fit are queued separately
+    queue.AddEncoderTurned(5, 30000, 24);
+    queue.AddEncoderTurned(5, 30000, 24);
+    RunUi(ui, 1);
+    EXPECT_EQ(page.encoderTurns.size(), 6u);
+}
+
+TEST(ui_UI, f_countsDroppedEvents)
+{
+    UiEventQueue queue;
+    for(int i = 0; i < 300; i++)
+        queue.AddPotActivityChanged(0, i % 2 == 0);
+    // the queue holds 256 events
+    EXPECT_EQ(queue.GetStats().numDropped, 300u - 256u);
+    queue.ResetStats();
+    EXPECT_EQ(queue.GetStats().numDropped, 0u);
+}
+
+TEST(ui_UI, g_limitsTheTimeSpentOnEvents)
+{
+    CanvasCalls  calls;
+    InputPage    page;
+    UiEventQueue queue;
+    UI           ui;
+    ui.Init(queue, UI::SpecialControlIds(), {MakeCanvas(calls, true)});
+    ui.OpenPage(page);
+    ui.SetEventTimeBudget(2500);
+    page.handlerDelayMs = 1;
+
+    for(int i = 0; i < 10; i++)
+        queue.AddPotActivityChanged(0, i % 2 == 0);
+    ui.Process();
+    EXPECT_EQ(page.activityChanges, 3);
+    EXPECT_FALSE(queue.IsQueueEmpty());
+
+    // at least one event is processed, even if it takes longer
+    ui.SetEventTimeBudget(1);
+    ui.Process();
+    EXPECT_EQ(page.activityChanges, 4);
+
+    ui.SetEventTimeBudget(0);
+    ui.Process();
+    EXPECT_EQ(page.activityChanges, 10);
+    EXPECT_TRUE(queue.IsQueueEmpty());
+}
@@ -0,0 +1,415 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "hid/midi_parser.h"
+#include "hid/ump_parser.h"
+#include "hid/ump_translator.h"
+
+using namespace daisy;
+
+namespace
+{
+std::vector<MidiEvent> ParseBytes(const std::vector<uint8_t>& bytes)
+{
+    MidiParser             parser;
+    std::vector<MidiEvent> events;
+    MidiEvent              event;
+    parser.Init();
+    for(uint8_t byte : bytes)
+    {
+        if(parser.Parse(byte, &event))
+            events.push_back(event);
+    }
+    return events;
+}
+
+/** MIDI 1.0 -> UMP -> MIDI 1.0 through two independent translators */
+std::vector<MidiEvent> RoundTrip(const std::vector<MidiEvent>& events,
+                                 UmpTranslator::Protocol       protocol)
+{
+    UmpTranslator to_ump, to_midi;
+    to_ump.Init(protocol);
+    to_midi.Init();
+
+    std::vector<MidiEvent> result;
+    UmpPacket              packets[32];
+    MidiEvent              out[4];
+    for(const MidiEvent& event : events)
+    {
+        const size_t num_packets = to_ump.MidiToUmp(event, packets, 32);
+        for(size_t i = 0; i < num_packets; i++)
+        {
+            const size_t num_events = to_midi.UmpToMidi(packets[i], out, 4);
+            result.insert(result.end(), out, out + num_events);
+        }
+    }
+    return result;
+}
+} // namespace
+
+TEST(hid_UmpParser, a_packetSize)
+{
+    const size_t expected[16] = {1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4};
+    for(uint8_t mt = 0; mt < 16; mt++)
+    {
+        EXPECT_EQ(UmpPacket::GetNumWords(mt), expected[mt]);
+    }
+}
+
+TEST(hid_UmpParser, b_assemblePackets)
+{
+    UmpParser parser;
+    UmpPacket packet;
+    parser.Init();
+
+    // 32 bit MIDI 1.0 note on, group 3
+    EXPECT_TRUE(parser.Parse(0x23904064, &packet));
+    EXPECT_EQ(packet.GetMessageType(), UmpMidi1ChannelVoice);
+    EXPECT_EQ(packet.GetGroup(), 3);
+    EXPECT_EQ(packet.words[1], 0u);
+
+    // 64 bit MIDI 2.0 note on
+    EXPECT_FALSE(parser.Parse(0x40923c00, &packet));
+    EXPECT_TRUE(parser.Parse(0xabcd1234, &packet));
+    EXPECT_EQ(packet.GetNumWords(), 2u);
+    EXPECT_EQ(packet.GetMessageType(), UmpMidi2ChannelVoice);
+    EXPECT_EQ(packet.GetStatus(), UmpNoteOn);
+    Midi2NoteOnEvent note_on = packet.AsMidi2NoteOn();
+    EXPECT_EQ(note_on.channel, 2);
+    EXPECT_EQ(note_on.note, 0x3c);
+    EXPECT_EQ(note_on.velocity, 0xabcd);
+    EXPECT_EQ(note_on.attribute, 0x1234);
+
+    // 128 bit stream message, then a 32 bit message clears the tail
+    EXPECT_FALSE(parser.Parse(0xf0000001, &packet));
+    EXPECT_FALSE(parser.Parse(0x11111111, &packet));
+    EXPECT_FALSE(parser.Parse(0x22222222, &packet));
+    EXPECT_TRUE(parser.Parse(0x33333333, &packet));
+    EXPECT_EQ(packet.words[3], 0x33333333u);
+    EXPECT_TRUE(parser.Parse(0x10f80000, &packet));
+    EXPECT_EQ(packet.words[1], 0u);
+    EXPECT_EQ(packet.words[3], 0u);
+
+    // reset drops a partial packet
+    EXPECT_FALSE(parser.Parse(0x40b01000, &packet));
+    parser.Reset();
+    EXPECT_TRUE(parser.Parse(0x20b01040, &packet));
+    EXPECT_EQ(packet.GetMessageType(), UmpMidi1ChannelVoice);
+}
+
+TEST(hid_UmpParser, c_parseBytes)
+{
+    // little endian words, as on USB
+    const uint8_t bytes[] = {0x64, 0x40, 0x90, 0x20, 0x00, 0x7f, 0xb1, 0x40,
+                             0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0xe0, 0x40};
+    UmpParser     parser;
+    parser.Init();
+
+    std::vector<UmpPacket> packets;
+    const size_t           num = parser.ParseBytes(
+        bytes,
+        sizeof(bytes) - 4,
+        [](const UmpPacket& p, void* ctx) {
+            static_cast<std::vector<UmpPacket>*>(ctx)->push_back(p);
+        },
+        &packets);
+    EXPECT_EQ(num, 2u);
+    ASSERT_EQ(packets.size(), 2u);
+    EXPECT_EQ(packets[0].words[0], 0x20904064u);
+    Midi2ControlChangeEvent cc = packets[1].AsMidi2ControlChange();
+    EXPECT_EQ(cc.channel, 1);
+    EXPECT_EQ(cc.index, 0x7f);
+    EXPECT_EQ(cc.value, 0xffffffffu);
+
+    // the last word is a packet start
+    EXPECT_EQ(parser.ParseBytes(bytes + 12, 4, nullptr, nullptr), 0u);
+}
+
+TEST(hid_UmpTranslator, d_scaling)
+{
+    // min, center, and max are preserved
+    EXPECT_EQ(UmpTranslator::ScaleUp(0, 7, 32), 0u);
+    EXPECT_EQ(UmpTranslator::ScaleUp(64, 7, 32), 0x80000000u);
+    EXPECT_EQ(UmpTranslator::ScaleUp(127, 7, 32), 0xffffffffu);
+    EXPECT_EQ(UmpTranslator::ScaleUp(127, 7, 16), 0xffffu);
+    EXPECT_EQ(UmpTranslator::ScaleUp(8192, 14, 32), 0x80000000u);
+    EXPECT_EQ(UmpTranslator::ScaleUp(16383, 14, 32), 0xffffffffu);
+
+    // scaling is monotonic and reversible
+    uint32_t last = 0;
+    for(uint32_t v = 0; v < 128; v++)
+    {
+        const uint32_t up = UmpTranslator::ScaleUp(v, 7, 32);
+        EXPECT_EQ(UmpTranslator::ScaleDown(up, 32, 7), v);
+        EXPECT_EQ(UmpTranslator::ScaleDown(UmpTranslator::ScaleUp(v, 7, 16),
+                                           16,
+                                           7),
+                  v);
+        if(v > 0)
+        {
+            EXPECT_GT(up, last);
+        }
+        last = up;
+    }
+    for(uint32_t v = 0; v < 16384; v++)
+    {
+        EXPECT_EQ(UmpTranslator::ScaleDown(
+                      UmpTranslator::ScaleUp(v, 14, 32), 32, 14),
+                  v);
+    }
+}
+
+TEST(hid_UmpTranslator, e_channelVoiceRoundTrip)
+{
+    const std::vector<MidiEvent> events = ParseBytes({
+        0x93, 60,  100, // note on
+        0x83, 60,  30,  // note off
+        0x95, 61,  0,   // note on velocity 0
+        0xa1, 62,  17,  // poly pressure
+        0xb2, 74,  127, // cc
+        0xb2, 123, 0,   // all notes off (channel mode)
+        0xc4, 12,       // program change
+        0xd5, 99,       // channel pressure
+        0xe6, 0x00, 0x40, // pitch bend center
+        0xe6, 0x7f, 0x7f, // pitch bend max
+        0xf8,             // clock
+        0xf2, 0x10, 0x20, // song position
+    });
+    ASSERT_EQ(events.size(), 12u);
+
+    for(auto protocol :
+        {UmpTranslator::Protocol::MIDI1, UmpTranslator::Protocol::MIDI2})
+    {
+        const std::vector<MidiEvent> result = RoundTrip(events, protocol);
+        ASSERT_EQ(result.size(), events.size());
+        for(size_t i = 0; i < events.size(); i++)
+        {
+            EXPECT_EQ(result[i].type, events[i].type) << i;
+            EXPECT_EQ(result[i].channel, events[i].channel) << i;
+            // real time messages carry no data
+            if(events[i].type == SystemRealTime)
+                continue;
+            EXPECT_EQ(result[i].data[0], events[i].data[0]) << i;
+            if(events[i].type != ProgramChange
+               && events[i].type != ChannelPressure)
+            {
+                EXPECT_EQ(result[i].data[1], events[i].data[1]) << i;
+            }
+        }
+        EXPECT_EQ(result[5].cm_type, AllNotesOff);
+        EXPECT_EQ(result[10].srt_type, TimingClock);
+        EXPECT_EQ(result[11].sc_type, SongPositionPointer);
+    }
+}
+
+TEST(hid_UmpTranslator, f_midi2Resolution)
+{
+    UmpTranslator translator;
+    translator.Init(UmpTranslator::Protocol::MIDI2, 5);
+
+    UmpPacket packet;
+    MidiEvent event = ParseBytes({0x91, 64, 127})[0];
+    ASSERT_EQ(translator.MidiToUmp(event, &packet, 1), 1u);
+    EXPECT_EQ(packet.GetMessageType(), UmpMidi2ChannelVoice);
+    EXPECT_EQ(packet.GetGroup(), 5);
+    EXPECT_EQ(packet.AsMidi2NoteOn().velocity, 0xffff);
+
+    event = ParseBytes({0xe1, 0x7f, 0x7f})[0];
+    ASSERT_EQ(translator.MidiToUmp(event, &packet, 1), 1u);
+    EXPECT_EQ(packet.AsMidi2PitchBend().value, 0xffffffffu);
+
+    // a quiet MIDI 2.0 note on must not become a MIDI 1.0 note off
+    packet.words[0] = 0x40903c00;
+    packet.words[1] = 0x00010000;
+    MidiEvent out[4];
+    ASSERT_EQ(translator.UmpToMidi(packet, out, 4), 1u);
+    EXPECT_EQ(out[0].type, NoteOn);
+    EXPECT_EQ(out[0].data[1], 1);
+
+    // non-MIDI 1.0 messages are dropped
+    packet.words[0] = 0x40603c00; // per-note pitch bend
+    EXPECT_EQ(translator.UmpToMidi(packet, out, 4), 0u);
+    packet.words[0] = 0x00000000; // utility no-op
+    EXPECT_EQ(translator.UmpToMidi(packet, out, 4), 0u);
+}
+
+TEST(hid_UmpTranslator, g_bankAndProgram)
+{
+    const std::vector<MidiEvent> events
+        = ParseBytes({0xb3, 0, 5, 0xb3, 32, 9, 0xc3, 42});
+    UmpTranslator translator;
+    translator.Init();
+
+    UmpPacket packets[4];
+    size_t    num = 0;
+    for(const MidiEvent& event : events)
+        num += translator.MidiToUmp(event, packets + num, 4 - num);
+    ASSERT_EQ(num, 1u);
+
+    Midi2ProgramChangeEvent pc = packets[0].AsMidi2ProgramChange();
+    EXPECT_EQ(pc.channel, 3);
+    EXPECT_EQ(pc.program, 42);
+    EXPECT_TRUE(pc.bank_valid);
+    EXPECT_EQ(pc.bank_msb, 5);
+    EXPECT_EQ(pc.bank_lsb, 9);
+
+    // and back into three MIDI 1.0 messages
+    MidiEvent out[4];
+    ASSERT_EQ(translator.UmpToMidi(packets[0], out, 4), 3u);
+    EXPECT_EQ(out[0].type, ControlChange);
+    EXPECT_EQ(out[0].data[0], 0);
+    EXPECT_EQ(out[0].data[1], 5);
+    EXPECT_EQ(out[1].data[0], 32);
+    EXPECT_EQ(out[1].data[1], 9);
+    EXPECT_EQ(out[2].type, ProgramChange);
+    EXPECT_EQ(out[2].data[0], 42);
+
+    // not enough room for all three
+    EXPECT_EQ(translator.UmpToMidi(packets[0], out, 2), 0u);
+}
+
+TEST(hid_UmpTranslator, h_registeredController)
+{
+    // RPN 0/0 (pitch bend range) = 12 semitones, 50 cents
+    const std::vector<MidiEvent> events = ParseBytes(
+        {0xb0, 101, 0, 0xb0, 100, 0, 0xb0, 6, 12, 0xb0, 38, 50});
+    UmpTranslator translator;
+    translator.Init();
+
+    UmpPacket packets[4];
+    size_t    num = 0;
+    for(const MidiEvent& event : events)
+        num += translator.MidiToUmp(event, packets + num, 4 - num);
+    ASSERT_EQ(num, 2u);
+
+    Midi2ControllerEvent rpn = packets[1].AsMidi2Controller();
+    EXPECT_TRUE(rpn.registered);
+    EXPECT_EQ(rpn.bank, 0);
+    EXPECT_EQ(rpn.index, 0);
+    EXPECT_EQ(UmpTranslator::ScaleDown(rpn.value, 32, 14), (12u << 7) | 50u);
+
+    MidiEvent out[4];
+    ASSERT_EQ(translator.UmpToMidi(packets[1], out, 4), 4u);
+    const uint8_t expected[4][2] = {{101, 0}, {100, 0}, {6, 12}, {38, 50}};
+    for(size_t i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(out[i].type, ControlChange);
+        EXPECT_EQ(out[i].data[0], expected[i][0]);
+        EXPECT_EQ(out[i].data[1], expected[i][1]);
+    }
+
+    // after the null RPN, data entry is a plain CC again
+    const std::vector<MidiEvent> null_rpn
+        = ParseBytes({0xb0, 101, 127, 0xb0, 100, 127, 0xb0, 6, 3});
+    num = 0;
+    for(const MidiEvent& event : null_rpn)
+        num += translator.MidiToUmp(event, packets + num, 4 - num);
+    ASSERT_EQ(num, 1u);
+    EXPECT_EQ(packets[0].GetStatus(), UmpControlChange);
+    EXPECT_EQ(packets[0].AsMidi2ControlChange().index, 6);
+}
+
+TEST(hid_UmpTranslator, i_sysEx)
+{
+    std::vector<uint8_t> bytes = {0xf0};
+    for(uint8_t i = 0; i < 20; i++)
+        bytes.push_back(i * 3);
+    bytes.push_back(0xf7);
+    const MidiEvent event = ParseBytes(bytes)[0];
+    ASSERT_EQ(event.sysex_message_len, 20);
+
+    UmpTranslator translator;
+    translator.Init();
+    UmpPacket    packets[8];
+    const size_t num = translator.MidiToUmp(event, packets, 8);
+    ASSERT_EQ(num, 4u);
+    EXPECT_EQ(packets[0].GetStatus(), UmpSysExStart);
+    EXPECT_EQ(packets[1].GetStatus(), UmpSysExContinue);
+    EXPECT_EQ(packets[2].GetStatus(), UmpSysExContinue);
+    EXPECT_EQ(packets[3].GetStatus(), UmpSysExEnd);
+    EXPECT_EQ((packets[3].words[0] >> 16) & 0x0f, 2u);
+
+    MidiEvent out[4];
+    for(size_t i = 0; i < 3; i++)
+        EXPECT_EQ(translator.UmpToMidi(packets[i], out, 4), 0u);
+    ASSERT_EQ(translator.UmpToMidi(packets[3], out, 4), 1u);
+    EXPECT_EQ(out[0].type, SystemCommon);
+    EXPECT_EQ(out[0].sc_type, SystemExclusive);
+    ASSERT_EQ(out[0].sysex_message_len, 20);
+    for(uint8_t i = 0; i < 20; i++)
+        EXPECT_EQ(out[0].sysex_data[i], i * 3);
+
+    // a continuation without a start is ignored
+    EXPECT_EQ(translator.UmpToMidi(packets[3], out, 4), 0u);
+
+    // a message that doesn't fit isn't truncated, but dropped
+    packets[0].words[0] = 0;
+    EXPECT_EQ(translator.MidiToUmp(event, packets, 2), 0u);
+    EXPECT_EQ(translator.MidiToUmp(event, packets, 3), 0u);
+    EXPECT_EQ(packets[0].words[0], 0u);
+    EXPECT_EQ(translator.MidiToUmp(event, packets, 4), 4u);
+}
+
+TEST(hid_UmpParser, j_parseThroughput)
+{
+    // Compares the cost of getting a note/cc stream into the application
+    // through the MIDI 1.0 byte parser and the UMP word parser.
+    constexpr size_t kNumMessages = 1 << 20;
+    std::vector<uint8_t>  bytes;
+    std::vector<uint32_t> words;
+    bytes.reserve(kNumMessages * 3);
+    words.reserve(kNumMessages * 2);
+    for(size_t i = 0; i < kNumMessages; i++)
+    {
+        const uint8_t status = (i & 1) ? 0xb0 : 0x90;
+        const uint8_t data0  = i & 0x7f;
+        const uint8_t data1  = (i >> 7) & 0x7f;
+        bytes.push_back(status | (i & 0x0f));
+        bytes.push_back(data0);
+        bytes.push_back(data1 | 1);
+        words.push_back(0x40000000 | ((status | (i & 0x0f)) << 16)
+                        | (data0 << 8));
+        words.push_back((uint32_t)i * 2654435761u);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    uint32_t checksum_midi1 = 0, checksum_ump = 0;
+
+    MidiParser midi_parser;
+    MidiEvent  event;
+    midi_parser.Init();
+    const auto midi1_start = Clock::now();
+    for(uint8_t byte : bytes)
+    {
+        if(midi_parser.Parse(byte, &event))
+            checksum_midi1 += event.data[1];
+    }
+    const auto midi1_time = Clock::now() - midi1_start;
+
+    UmpParser ump_parser;
+    UmpPacket packet;
+    ump_parser.Init();
+    const auto ump_start = Clock::now();
+    for(uint32_t word : words)
+    {
+        if(ump_parser.Parse(word, &packet))
+            checksum_ump += packet.words[1];
+    }
+    const auto ump_time = Clock::now() - ump_start;
+
+    EXPECT_NE(checksum_midi1, 0u);
+    EXPECT_NE(checksum_ump, 0u);
+
+    const double ns_midi1
+        = std::chrono::duration<double, std::nano>(midi1_time).count()
+          / kNumMessages;
+    const double ns_ump
+        = std::chrono::duration<double, std::nano>(ump_time).count()
+          / kNumMessages;
+    RecordProperty("ns_per_message_midi1", std::to_string(ns_midi1));
+    RecordProperty("ns_per_message_ump", std::to_string(ns_ump));
+    printf("MidiParser: %.2f ns/message, UmpParser: %.2f ns/message\n",
+           ns_midi1,
+           ns_ump);
+}
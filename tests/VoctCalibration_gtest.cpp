@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 #include "util/VoctCalibration.h"
+#include "util/PersistentStorage.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
 
 using namespace daisy;
 
@@ -81,4 +87,211 @@ TEST(util_VoctCalibration, d_manualValueSetting)
     EXPECT_TRUE(isCalibrated);
     EXPECT_FLOAT_EQ(scale, 60.f);
     EXPECT_FLOAT_EQ(offset, -1.f);
-}
\ No newline at end of file
+}
+namespace
+{
+/** An input that reads 0.1 per volt, and bends a little over 8 octaves */
+float SimulatedInput(float volts)
+{
+    return 0.05f + 0.1f * volts - 0.0006f * volts * volts
+           + 0.00002f * volts * volts * volts;
+}
+
+/** The largest error in cents over 0..8 V */
+float MaxErrorCents(VoctCalibration& cal)
+{
+    float max_error = 0.f;
+    for(int i = 0; i <= 8000; i++)
+    {
+        const float volts = i / 1000.f;
+        const float error
+            = std::fabs(cal.ProcessInput(SimulatedInput(volts)) - 12.f * volts);
+        max_error = std::max(max_error, error * 100.f);
+    }
+    return max_error;
+}
+} // namespace
+
+TEST(util_VoctCalibration, e_multiPointAccuracy)
+{
+    // the two point calibration is off away from 1V and 3V
+    VoctCalibration two_point;
+    EXPECT_TRUE(two_point.Record(SimulatedInput(1.f), SimulatedInput(3.f)));
+    const float two_point_error = MaxErrorCents(two_point);
+    EXPECT_GT(two_point_error, 50.f);
+
+    // nine points with some noise, over 8 octaves
+    std::mt19937                    rng(49);
+    std::normal_distribution<float> noise(0.f, 0.00002f);
+    VoctCalibration                 cal;
+    for(int v = 0; v <= 8; v++)
+        EXPECT_TRUE(cal.AddPoint(SimulatedInput(v) + noise(rng), float(v)));
+    EXPECT_EQ(cal.GetNumPoints(), 9u);
+    EXPECT_TRUE(cal.Fit());
+    const float error = MaxErrorCents(cal);
+    EXPECT_LT(error, 1.f);
+
+    // a straight line through the same points
+    EXPECT_TRUE(cal.Fit(1));
+    const float line_error = MaxErrorCents(cal);
+    EXPECT_GT(line_error, 5.f * error);
+    float scale, offset;
+    EXPECT_TRUE(cal.GetData(scale, offset));
+    // about 96 semitones over the range of readings
+    EXPECT_NEAR(scale, 96.f / (SimulatedInput(8.f) - SimulatedInput(0.f)), 1.f);
+
+    // beyond the recorded range, the curve continues smoothly
+    EXPECT_TRUE(cal.Fit());
+    const float below = cal.ProcessInput(SimulatedInput(-0.5f));
+    const float above = cal.ProcessInput(SimulatedInput(8.5f));
+    EXPECT_NEAR(below, -6.f, 0.05f);
+    EXPECT_NEAR(above, 102.f, 0.05f);
+
+    ::testing::Test::RecordProperty("two_point_error_mcents",
+                                    int(two_point_error * 1000.f));
+    ::testing::Test::RecordProperty("line_error_mcents",
+                                    int(line_error * 1000.f));
+    ::testing::Test::RecordProperty("error_mcents", int(error * 1000.f));
+    printf("max error over 8 octaves: two point %.2f cents, line %.2f cents, "
+           "curve %.2f cents\n",
+           two_point_error,
+           line_error,
+           error);
+
+    // too few points, or all at the same value
+    VoctCalibration bad;
+    EXPECT_FALSE(bad.Fit());
+    bad.AddPoint(0.3f, 1.f);
+    bad.AddPoint(0.3f, 2.f);
+    EXPECT_FALSE(bad.Fit());
+    float bad_scale, bad_offset;
+    EXPECT_FALSE(bad.GetData(bad_scale, bad_offset));
+    for(size_t i = 2; i < VoctCalibration::kMaxPoints; i++)
+        EXPECT_TRUE(bad.AddPoint(0.1f * i, float(i)));
+    EXPECT_FALSE(bad.AddPoint(2.f, 20.f));
+}
+
+TEST(util_VoctCalibration, f_trim)
+{
+    VoctCalibration cal;
+    for(int v = 0; v <= 8; v += 2)
+        cal.AddPoint(SimulatedInput(v), float(v));
+    ASSERT_TRUE(cal.Fit());
+    const float before = cal.ProcessInput(SimulatedInput(5.f));
+
+    // the input drifted by 30 cents: one reading corrects it
+    const float drift = 0.0025f;
+    cal.RecordTrim(SimulatedInput(0.f) + drift, 0.f);
+    EXPECT_NEAR(cal.GetTrim(), -0.3f, 0.02f);
+    EXPECT_NEAR(cal.ProcessInput(SimulatedInput(0.f) + drift), 0.f, 0.001f);
+    EXPECT_NEAR(cal.ProcessInput(SimulatedInput(5.f) + drift), 60.f, 0.02f);
+
+    // and can be undone
+    cal.SetTrim(0.f);
+    EXPECT_FLOAT_EQ(cal.ProcessInput(SimulatedInput(5.f)), before);
+
+    // the trim also applies to straight lines
+    VoctCalibration line;
+    line.SetData(60.f, 0.f);
+    line.SetTrim(0.5f);
+    float scale, offset;
+    line.GetData(scale, offset);
+    EXPECT_FLOAT_EQ(offset, 0.5f);
+    EXPECT_FLOAT_EQ(line.ProcessInput(0.2f), 12.5f);
+}
+
+struct CalibrationSettings
+{
+    VoctCalibration::Data cv[2];
+
+    bool operator==(const CalibrationSettings& rhs) const
+    {
+        return cv[0] == rhs.cv[0] && cv[1] == rhs.cv[1];
+    }
+    bool operator!=(const CalibrationSettings& rhs) const
+    {
+        return !operator==(rhs);
+    }
+};
+
+TEST(util_VoctCalibration, g_persistentStorage)
+{
+    VoctCalibration cal;
+    for(int v = 0; v <= 8; v++)
+        cal.AddPoint(SimulatedInput(v), float(v));
+    ASSERT_TRUE(cal.Fit());
+    cal.SetTrim(0.1f);
+
+    // save the calibration of one input, leaving the other uncalibrated
+    QSPIHandle                             qspi;
+    PersistentStorage<CalibrationSettings> storage(qspi);
+    CalibrationSettings                    defaults;
+    VoctCalibration().GetData(defaults.cv[0]);
+    VoctCalibration().GetData(defaults.cv[1]);
+    storage.Init(defaults);
+    EXPECT_TRUE(cal.GetData(storage.GetSettings().cv[0]));
+    storage.Save();
+
+    // and restore it after a "power cycle"
+    PersistentStorage<CalibrationSettings> restored_storage(qspi);
+    restored_storage.Init(defaults);
+    EXPECT_EQ(restored_storage.GetState(),
+              PersistentStorage<CalibrationSettings>::State::USER);
+    VoctCalibration restored;
+    EXPECT_TRUE(restored.SetData(restored_storage.GetSettings().cv[0]));
+    EXPECT_FALSE(VoctCalibration().SetData(
+        restored_storage.GetSettings().cv[1]));
+    EXPECT_FLOAT_EQ(restored.GetTrim(), 0.1f);
+    for(int i = 0; i <= 100; i++)
+    {
+        const float val = SimulatedInput(-0.5f + i * 0.09f);
+        EXPECT_EQ(restored.ProcessInput(val), cal.ProcessInput(val)) << i;
+    }
+}
+
+TEST(util_VoctCalibration, h_benchmark)
+{
+    VoctCalibration line, curve;
+    line.Record(SimulatedInput(1.f), SimulatedInput(3.f));
+    for(int v = 0; v <= 8; v++)
+        curve.AddPoint(SimulatedInput(v), float(v));
+    curve.Fit();
+
+    std::mt19937       rng(490);
+    std::vector<float> inputs(4096);
+    for(auto& input : inputs)
+        input = SimulatedInput((rng() % 8000) / 1000.f);
+
+    using Clock             = std::chrono::steady_clock;
+    constexpr int kRuns     = 500;
+    float         checksum  = 0.f;
+    auto          time_with = [&](VoctCalibration& cal) {
+        const auto start = Clock::now();
+        for(int r = 0; r < kRuns; r++)
+            for(float input : inputs)
+                checksum += cal.ProcessInput(input);
+        return std::chrono::duration<double, std::nano>(Clock::now() - start)
+                   .count()
+               / (kRuns * inputs.size());
+    };
+    const double line_ns  = time_with(line);
+    const double curve_ns = time_with(curve);
+
+    const auto fit_start = Clock::now();
+    for(int r = 0; r < 1000; r++)
+        curve.Fit();
+    const double fit_us
+        = std::chrono::duration<double, std::micro>(Clock::now() - fit_start)
+              .count()
+          / 1000;
+
+    RecordProperty("line_ps_per_input", int(line_ns * 1000));
+    RecordProperty("curve_ps_per_input", int(curve_ns * 1000));
+    RecordProperty("fit_ns", int(fit_us * 1000));
+    printf("ProcessInput: %.2f ns with a line, %.2f ns with the table; "
+           "Fit: %.2f us\n",
+           line_ns,
+           curve_ns,
+           fit_us);
+    EXPECT_TRUE(std::isfinite(checksum));
+}
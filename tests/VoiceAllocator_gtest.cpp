@@ -0,0 +1,464 @@
+#include "util/VoiceAllocator.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace daisy;
+
+namespace
+{
+template <size_t N>
+using Event = typename VoiceAllocator<N>::VoiceEvent;
+
+template <size_t N>
+std::vector<Event<N>> Events(const VoiceAllocator<N>& alloc, size_t num)
+{
+    std::vector<Event<N>> events;
+    for(size_t i = 0; i < num; i++)
+        events.push_back(alloc.GetEvent(i));
+    return events;
+}
+
+MidiEvent MakeEvent(MidiMessageType type, uint8_t data0, uint8_t data1)
+{
+    MidiEvent event;
+    event.type    = type;
+    event.channel = 0;
+    event.data[0] = data0;
+    event.data[1] = data1;
+    return event;
+}
+} // namespace
+
+using NoteType = VoiceAllocator<4>::VoiceEvent::Type;
+
+TEST(util_VoiceAllocator, a_freeVoices)
+{
+    VoiceAllocator<4> alloc;
+    alloc.Init();
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 0u);
+
+    // notes take the free voices in order
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        ASSERT_EQ(alloc.NoteOn(60 + i, 100), 1u);
+        EXPECT_EQ(alloc.GetEvent(0).type, NoteType::NOTE_ON);
+        EXPECT_EQ(alloc.GetEvent(0).voice, i);
+        EXPECT_EQ(alloc.GetEvent(0).note, 60 + i);
+        EXPECT_FALSE(alloc.GetEvent(0).stolen);
+        EXPECT_EQ(alloc.GetVoiceForNote(60 + i), i);
+    }
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 4u);
+
+    // release voice 1, then voice 3
+    ASSERT_EQ(alloc.NoteOff(61), 1u);
+    EXPECT_EQ(alloc.GetEvent(0).type, NoteType::NOTE_OFF);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 1u);
+    EXPECT_EQ(alloc.GetVoiceForNote(61), -1);
+    ASSERT_EQ(alloc.NoteOff(63), 1u);
+    EXPECT_EQ(alloc.NoteOff(63), 0u);
+
+    // the least recently released voice is reused first
+    alloc.NoteOn(70, 100);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 1u);
+    alloc.NoteOn(71, 100);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 3u);
+}
+
+TEST(util_VoiceAllocator, b_stealOldest)
+{
+    VoiceAllocator<4> alloc;
+    alloc.Init();
+    for(uint8_t i = 0; i < 4; i++)
+        alloc.NoteOn(60 + i, 100);
+
+    ASSERT_EQ(alloc.NoteOn(72, 100), 1u);
+    EXPECT_EQ(alloc.GetEvent(0).type, NoteType::NOTE_ON);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 0u);
+    EXPECT_TRUE(alloc.GetEvent(0).stolen);
+    EXPECT_EQ(alloc.GetVoiceForNote(60), -1);
+    EXPECT_EQ(alloc.GetVoiceForNote(72), 0);
+
+    // the stolen note's key-up is ignored
+    EXPECT_EQ(alloc.NoteOff(60), 0u);
+
+    alloc.NoteOn(73, 100);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 1u);
+}
+
+TEST(util_VoiceAllocator, c_stealQuietest)
+{
+    VoiceAllocator<4>::Config config;
+    config.Defaults();
+    config.steal_mode = VoiceAllocator<4>::StealMode::QUIETEST;
+    VoiceAllocator<4> alloc;
+    alloc.Init(config);
+
+    const uint8_t velocities[4] = {100, 20, 90, 50};
+    for(uint8_t i = 0; i < 4; i++)
+        alloc.NoteOn(60 + i, velocities[i]);
+
+    alloc.NoteOn(72, 100);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 1u);
+    EXPECT_TRUE(alloc.GetEvent(0).stolen);
+
+    // levels can be updated from the envelopes
+    alloc.SetVoiceLevel(0, 0.01f);
+    alloc.NoteOn(73, 100);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 0u);
+
+    config.steal_mode = VoiceAllocator<4>::StealMode::NONE;
+    alloc.Init(config);
+    for(uint8_t i = 0; i < 4; i++)
+        alloc.NoteOn(60 + i, 100);
+    EXPECT_EQ(alloc.NoteOn(72, 100), 0u);
+    EXPECT_EQ(alloc.GetVoiceForNote(72), -1);
+}
+
+TEST(util_VoiceAllocator, d_sameNote)
+{
+    VoiceAllocator<4> alloc;
+    alloc.Init();
+    alloc.NoteOn(60, 100);
+    alloc.NoteOn(62, 100);
+
+    // retrigger on the same voice
+    ASSERT_EQ(alloc.NoteOn(60, 50), 1u);
+    EXPECT_EQ(alloc.GetEvent(0).type, NoteType::NOTE_ON);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 0u);
+    EXPECT_EQ(alloc.GetEvent(0).velocity, 50);
+    EXPECT_FALSE(alloc.GetEvent(0).stolen);
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 2u);
+
+    // the retriggered note is now the newest
+    alloc.NoteOn(64, 100);
+    alloc.NoteOn(65, 100);
+    alloc.NoteOn(66, 100);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 1u);
+
+    // or release and take a new voice
+    VoiceAllocator<4>::Config config;
+    config.Defaults();
+    config.retrigger_same_note = false;
+    alloc.Init(config);
+    alloc.NoteOn(60, 100);
+    ASSERT_EQ(alloc.NoteOn(60, 100), 2u);
+    auto events = Events(alloc, 2);
+    EXPECT_EQ(events[0].type, NoteType::NOTE_OFF);
+    EXPECT_EQ(events[0].voice, 0u);
+    EXPECT_EQ(events[1].type, NoteType::NOTE_ON);
+    EXPECT_EQ(events[1].voice, 1u);
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 1u);
+}
+
+TEST(util_VoiceAllocator, e_sustainPedal)
+{
+    VoiceAllocator<4> alloc;
+    alloc.Init();
+    alloc.ProcessEvent(MakeEvent(NoteOn, 60, 100));
+    alloc.ProcessEvent(MakeEvent(NoteOn, 62, 100));
+    EXPECT_EQ(alloc.ProcessEvent(MakeEvent(ControlChange, 64, 127)), 0u);
+
+    // key-up while the pedal is down keeps the voices
+    EXPECT_EQ(alloc.ProcessEvent(MakeEvent(NoteOff, 60, 0)), 0u);
+    EXPECT_EQ(alloc.ProcessEvent(MakeEvent(NoteOff, 62, 0)), 0u);
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 2u);
+
+    // a held note survives the pedal release
+    alloc.ProcessEvent(MakeEvent(NoteOn, 64, 100));
+    // restriking a sustained note reuses its voice
+    alloc.ProcessEvent(MakeEvent(NoteOn, 62, 90));
+    EXPECT_EQ(alloc.GetEvent(0).voice, 1u);
+    alloc.ProcessEvent(MakeEvent(NoteOff, 62, 0));
+
+    ASSERT_EQ(alloc.ProcessEvent(MakeEvent(ControlChange, 64, 0)), 2u);
+    auto events = Events(alloc, 2);
+    EXPECT_EQ(events[0].type, NoteType::NOTE_OFF);
+    EXPECT_EQ(events[0].note, 60);
+    EXPECT_EQ(events[1].type, NoteType::NOTE_OFF);
+    EXPECT_EQ(events[1].note, 62);
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 1u);
+    EXPECT_EQ(alloc.GetVoiceForNote(64), 2);
+}
+
+TEST(util_VoiceAllocator, f_stealSustainedFirst)
+{
+    VoiceAllocator<4> alloc;
+    alloc.Init();
+    alloc.SetSustain(true);
+    for(uint8_t i = 0; i < 4; i++)
+        alloc.NoteOn(60 + i, 100);
+    // only voice 2 has its key up
+    alloc.NoteOff(62);
+
+    alloc.NoteOn(72, 100);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 2u);
+    EXPECT_TRUE(alloc.GetEvent(0).stolen);
+    alloc.NoteOn(73, 100);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 0u);
+}
+
+TEST(util_VoiceAllocator, g_allNotesOffAndChannel)
+{
+    VoiceAllocator<4>::Config config;
+    config.Defaults();
+    config.channel = 2;
+    VoiceAllocator<4> alloc;
+    alloc.Init(config);
+
+    MidiEvent event = MakeEvent(NoteOn, 60, 100);
+    EXPECT_EQ(alloc.ProcessEvent(event), 0u);
+    event.channel = 2;
+    EXPECT_EQ(alloc.ProcessEvent(event), 1u);
+    event.data[0] = 61;
+    alloc.ProcessEvent(event);
+    alloc.SetSustain(true);
+
+    MidiEvent all_off = MakeEvent(ChannelMode, 123, 0);
+    all_off.channel   = 2;
+    EXPECT_EQ(alloc.ProcessEvent(all_off), 2u);
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 0u);
+}
+
+TEST(util_VoiceAllocator, h_mono)
+{
+    VoiceAllocator<4>::Config config;
+    config.Defaults();
+    config.mode = VoiceAllocator<4>::Mode::MONO;
+    VoiceAllocator<4> alloc;
+    alloc.Init(config);
+
+    alloc.NoteOn(60, 100);
+    ASSERT_EQ(alloc.NoteOn(64, 80), 1u);
+    EXPECT_EQ(alloc.GetEvent(0).type, NoteType::NOTE_ON);
+    EXPECT_EQ(alloc.GetEvent(0).voice, 0u);
+    EXPECT_EQ(alloc.GetEvent(0).note, 64);
+    EXPECT_EQ(alloc.GetVoiceForNote(60), -1);
+
+    // releasing a note that isn't sounding does nothing
+    alloc.NoteOn(67, 80);
+    EXPECT_EQ(alloc.NoteOff(64), 0u);
+
+    // last note priority: back to 60
+    ASSERT_EQ(alloc.NoteOff(67), 1u);
+    EXPECT_EQ(alloc.GetEvent(0).type, NoteType::NOTE_ON);
+    EXPECT_EQ(alloc.GetEvent(0).note, 60);
+    EXPECT_EQ(alloc.GetEvent(0).velocity, 100);
+
+    ASSERT_EQ(alloc.NoteOff(60), 1u);
+    EXPECT_EQ(alloc.GetEvent(0).type, NoteType::NOTE_OFF);
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 0u);
+
+    // sustain holds the last note
+    alloc.SetSustain(true);
+    alloc.NoteOn(50, 100);
+    EXPECT_EQ(alloc.NoteOff(50), 0u);
+    EXPECT_EQ(alloc.GetNumActiveVoices(), 1u);
+    ASSERT_EQ(alloc.SetSustain(false), 1u);
+    EXPECT_EQ(alloc.GetEvent(0).type, NoteType::NOTE_OFF);
+}
+
+TEST(util_VoiceAllocator, i_legato)
+{
+    VoiceAllocator<1>::Config config;
+    config.Defaults();
+    config.mode = VoiceAllocator<1>::Mode::LEGATO;
+    VoiceAllocator<1> alloc;
+    alloc.Init(config);
+
+    using Type = VoiceAllocator<1>::VoiceEvent::Type;
+    alloc.NoteOn(60, 100);
+    EXPECT_EQ(alloc.GetEvent(0).type, Type::NOTE_ON);
+    alloc.NoteOn(62, 100);
+    EXPECT_EQ(alloc.GetEvent(0).type, Type::LEGATO);
+    alloc.NoteOff(62);
+    EXPECT_EQ(alloc.GetEvent(0).type, Type::LEGATO);
+    EXPECT_EQ(alloc.GetEvent(0).note, 60);
+    alloc.NoteOff(60);
+    EXPECT_EQ(alloc.GetEvent(0).type, Type::NOTE_OFF);
+
+    // detached notes retrigger
+    alloc.NoteOn(64, 100);
+    EXPECT_EQ(alloc.GetEvent(0).type, Type::NOTE_ON);
+}
+
+TEST(util_VoiceAllocator, j_randomStreamConsistency)
+{
+    // Checks the allocator against a simple model on a long random stream
+    constexpr size_t        kVoices = 8;
+    VoiceAllocator<kVoices> alloc;
+    alloc.Init();
+    std::mt19937 rng(42);
+
+    int  voice_note[kVoices];
+    bool key_down[128] = {};
+    bool sustain       = false;
+    for(size_t i = 0; i < kVoices; i++)
+        voice_note[i] = -1;
+
+    for(size_t step = 0; step < 100000; step++)
+    {
+        const uint32_t r    = rng();
+        const uint8_t  note = 36 + (r >> 8) % 24;
+        size_t         num;
+        if((r & 0xff) < 4)
+        {
+            sustain = !sustain;
+            num     = alloc.SetSustain(sustain);
+        }
+        else if((r & 0xff) < 140)
+        {
+            key_down[note] = true;
+            num            = alloc.NoteOn(note, 1 + (r >> 16) % 127);
+        }
+        else
+        {
+            key_down[note] = false;
+            num            = alloc.NoteOff(note);
+        }
+
+        for(size_t i = 0; i < num; i++)
+        {
+            const auto& e = alloc.GetEvent(i);
+            ASSERT_LT(e.voice, kVoices);
+            if(e.type == VoiceAllocator<kVoices>::VoiceEvent::Type::NOTE_OFF)
+            {
+                ASSERT_EQ(voice_note[e.voice], e.note);
+                voice_note[e.voice] = -1;
+            }
+            else
+            {
+                ASSERT_EQ(e.stolen, voice_note[e.voice] != -1
+                                        && voice_note[e.voice] != e.note);
+                voice_note[e.voice] = e.note;
+            }
+        }
+
+        // the index agrees with the events, and no note plays twice
+        size_t active = 0;
+        for(size_t v = 0; v < kVoices; v++)
+        {
+            if(voice_note[v] < 0)
+                continue;
+            active++;
+            ASSERT_EQ(alloc.GetVoiceForNote(voice_note[v]), (int)v);
+            // without the pedal, every sounding note has its key down
+            if(!sustain)
+            {
+                ASSERT_TRUE(key_down[voice_note[v]]);
+            }
+        }
+        ASSERT_EQ(active, alloc.GetNumActiveVoices());
+    }
+}
+
+namespace
+{
+/** The kind of allocator patches tend to write: linear scans for everything */
+template <size_t N>
+class LinearScanAllocator
+{
+  public:
+    void Init()
+    {
+        for(size_t i = 0; i < N; i++)
+        {
+            note_[i] = -1;
+            age_[i]  = 0;
+        }
+        counter_ = 0;
+    }
+
+    size_t NoteOn(uint8_t note)
+    {
+        size_t voice = N;
+        for(size_t i = 0; i < N && voice == N; i++)
+            voice = note_[i] == note ? i : voice;
+        for(size_t i = 0; i < N && voice == N; i++)
+            voice = note_[i] < 0 ? i : voice;
+        if(voice == N)
+        {
+            voice = 0;
+            for(size_t i = 1; i < N; i++)
+                voice = age_[i] < age_[voice] ? i : voice;
+        }
+        note_[voice] = note;
+        age_[voice]  = ++counter_;
+        return voice;
+    }
+
+    size_t NoteOff(uint8_t note)
+    {
+        for(size_t i = 0; i < N; i++)
+        {
+            if(note_[i] == note)
+            {
+                note_[i] = -1;
+                return i;
+            }
+        }
+        return N;
+    }
+
+  private:
+    int      note_[N];
+    uint32_t age_[N];
+    uint32_t counter_;
+};
+} // namespace
+
+TEST(util_VoiceAllocator, k_benchmark64Voices)
+{
+    // dense stream: 96 keys down at most, so the 64 voices are mostly
+    // full and stealing is frequent
+    constexpr size_t kNumEvents = 1 << 20;
+    std::vector<uint8_t> notes(kNumEvents);
+    std::vector<bool>    ons(kNumEvents);
+    std::mt19937         rng(7);
+    bool                 down[128] = {};
+    for(size_t i = 0; i < kNumEvents; i++)
+    {
+        const uint8_t note = 16 + rng() % 96;
+        notes[i]           = note;
+        ons[i]             = !down[note];
+        down[note]         = !down[note];
+    }
+
+    using Clock = std::chrono::steady_clock;
+    auto* alloc = new VoiceAllocator<64>;
+    alloc->Init();
+    size_t     checksum = 0;
+    const auto start    = Clock::now();
+    for(size_t i = 0; i < kNumEvents; i++)
+    {
+        const size_t n
+            = ons[i] ? alloc->NoteOn(notes[i], 100) : alloc->NoteOff(notes[i]);
+        if(n > 0)
+            checksum += alloc->GetEvent(0).voice;
+    }
+    const auto alloc_time = Clock::now() - start;
+
+    LinearScanAllocator<64> linear;
+    linear.Init();
+    const auto linear_start = Clock::now();
+    for(size_t i = 0; i < kNumEvents; i++)
+        checksum += ons[i] ? linear.NoteOn(notes[i]) : linear.NoteOff(notes[i]);
+    const auto linear_time = Clock::now() - linear_start;
+
+    EXPECT_GT(checksum, 0u);
+    delete alloc;
+
+    const double ns_alloc
+        = std::chrono::duration<double, std::nano>(alloc_time).count()
+          / kNumEvents;
+    const double ns_linear
+        = std::chrono::duration<double, std::nano>(linear_time).count()
+          / kNumEvents;
+    RecordProperty("ns_per_event", std::to_string(ns_alloc));
+    RecordProperty("ns_per_event_linear_scan", std::to_string(ns_linear));
+    printf("VoiceAllocator<64>: %.2f ns/event, linear scan: %.2f ns/event\n",
+           ns_alloc,
+           ns_linear);
+}
@@ -1,7 +1,14 @@
 #include "sys/system.cpp"
 #include "ui/AbstractMenu.cpp"
+#include "ui/FullScreenItemMenu.cpp"
 #include "ui/UI.cpp"
+#include "util/CurveTables.cpp"
 #include "util/MappedValue.cpp"
 #include "util/oled_fonts.c"
+#include "util/oled_fonts_columns.c"
 #include "per/qspi.cpp"
+#include "hid/ctrl.cpp"
 #include "hid/midi_parser.cpp"
+#include "hid/parameter.cpp"
+#include "hid/ump_parser.cpp"
+#include "hid/ump_translator.cpp"